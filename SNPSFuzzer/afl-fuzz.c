@@ -73,6 +73,9 @@
 #endif
 
 #include "aflnet.h"
+#include "snapshot_sys.h"
+#include "bitmap_ops.h"
+#include "corpus_pack.h"
 #include "monitor-src/monitor_bridge.h"
 #include "monitor-src/ssh_predicate_adapter.h"
 #include "monitor-src/rtsp_predicate_adapter.h"
@@ -80,11 +83,15 @@
 #include "monitor-src/dtls_predicate_adapter.h"
 #include "monitor-src/sip_predicate_adapter.h"
 #include "monitor-src/dnsmasq_predicate_adapter.h"
-#include <graphviz/gvc.h>
+#include "monitor-src/smtp_predicate_adapter.h"
+#include "monitor-src/pred_trace.h"
 #include <math.h>
 
 #include <setjmp.h>
 #include <stdarg.h>
+#if defined(__x86_64__) || defined(__i386__)
+#  include <x86intrin.h>
+#endif
 #include "criu4snpsfuzzer/lib/c/criu.h"
 #include "criu4snpsfuzzer/soccr/soccr.h"
 
@@ -154,6 +161,7 @@ EXP_ST u8  skip_deterministic,        /* Skip deterministic stages?       */
            no_arith,                  /* Skip most arithmetic ops         */
            shuffle_queue,             /* Shuffle input queue?             */
            bitmap_changed = 1,        /* Time to update bitmap?           */
+           trace_hits_virgin = 1,     /* trace_bits & virgin_bits != 0?   */
            qemu_mode,                 /* Running in QEMU mode?            */
            skip_requested,            /* Skip request, via SIGUSR1        */
            run_over10m,               /* Run time over 10 minutes?        */
@@ -229,6 +237,11 @@ static u64 total_violations,            /* Total number of violations */
            unique_violations,           /* Violations with unique signatures */
            last_violation_time;         /* Time for most recent violation */
 static u8 g_last_violation_detected = 0;  /* Flag for current test */
+
+static u8  virgin_monitor[MONITOR_MAP_SIZE];  /* Automaton edges not yet seen */
+static u8  monitor_new_bits;                  /* Current test hit new ones?   */
+static u16 monitor_near;                      /* Current test's closeness     */
+static u32 queued_with_monitor_cov;           /* Paths with new automaton cov */
 #define KEEP_UNIQUE_VIOLATIONS 5000  /* Max unique violations to keep */
 
 
@@ -281,6 +294,7 @@ struct queue_entry {
       was_fuzzed,                     /* Had any fuzzing done yet?        */
       passed_det,                     /* Deterministic stages passed?     */
       has_new_cov,                    /* Triggers new coverage?           */
+      has_new_monitor_cov,            /* Triggers new automaton coverage? */
       var_behavior,                   /* Variable behavior?               */
       favored,                        /* Currently favored?               */
       fs_redundant;                   /* Marked as redundant in the fs?   */
@@ -305,6 +319,8 @@ struct queue_entry {
   u32 generating_state_id;            /* ID of the start at which the new seed was generated */
   u8 is_initial_seed;                 /* Is this an initial seed */
   u32 unique_state_count;             /* Unique number of states traversed by this queue entry */
+  u16 monitor_near;                   /* Closeness of its session to a violation (1/1000) */
+  u64 pack_off;                       /* Contents in the corpus pack, 0 if not packed */
 
 };
 
@@ -415,9 +431,9 @@ u32 state_cycles = 0;
 u32 messages_sent = 0;
 EXP_ST u8 session_virgin_bits[MAP_SIZE];     /* Regions yet untouched while the SUT is still running */
 EXP_ST u8 *cleanup_script; /* script to clean up the environment of the SUT -- make fuzzing more deterministic */
-char **was_fuzzed_map = NULL; /* A 2D array keeping state-specific was_fuzzed information */
-u32 fuzzed_map_states = 0;
-u32 fuzzed_map_qentries = 0;
+u64 *was_fuzzed_map = NULL;  /* State-specific was_fuzzed information, see below */
+u32 fuzzed_map_states = 0;   /* rows allocated in was_fuzzed_map */
+u32 fuzzed_map_words = 0;    /* u64 words per bit plane in a row */
 u32 max_seed_region_count = 0;
 u32 local_port;		/* TCP/UDP port number to use as source */
 
@@ -434,14 +450,27 @@ u8 region_level_mutation = 0;
 u8 state_selection_algo = ROUND_ROBIN, seed_selection_algo = RANDOM_SELECTION;
 u8 false_negative_reduction = 0;
 
-/* Implemented state machine */
-Agraph_t  *ipsm;
-static FILE* ipsm_dot_file;
+/* State table: one state_info_t per state in discovery order, so that
+   state_table[i].id == state_ids[i]; km32_states maps a state ID to its
+   index. Both arrays grow geometrically (state_table_size entries), so
+   pointers into state_table are only good until the next state is added. */
+state_info_t *state_table;
+u32 state_table_size;
+khash_t(m32) *km32_states;
+static u32 state_mark;   /* see mark_state() */
+
+/* Implemented state machine: the states are those of state_table that have
+   an ipsm_node, the transitions are kept in discovery order in ipsm_edges
+   and indexed by (from << 32 | to) in km64_ipsm_edges. ipsm.dot is only
+   rewritten with the stats file and on exit. */
+ipsm_edge_t *ipsm_edges;
+u32 ipsm_edges_count;
+khash_t(m64) *km64_ipsm_edges;
+static u8 ipsm_dirty;
 
 /* Hash table/map and list */
 klist_t(lms) *kl_messages;
 khash_t(hs32) *khs_ipsm_paths;
-khash_t(hms) *khms_states;
 
 //M2_prev points to the last message of M1 (i.e., prefix)
 //If M1 is empty, M2_prev == NULL
@@ -454,11 +483,10 @@ unsigned int* (*extract_response_codes)(unsigned char* buf, unsigned int buf_siz
 region_t* (*extract_requests)(unsigned char* buf, unsigned int buf_size, unsigned int* region_count_ref) = NULL;
 /*End of AFLNET*/
 
-void (*build_request_pred_line)(const unsigned char *buf, unsigned int len,
-                                char *out, size_t out_sz) = NULL;
-void (*build_response_pred_line)(const unsigned char *buf, unsigned int len,
-                                 char *out, size_t out_sz) = NULL;
-void (*predicate_reset_session)(void) = NULL;
+/* Predicate adapter of the selected protocol and its session context */
+const predicate_adapter_t *pred_adapter = NULL;
+void *pred_ctx = NULL;
+pred_stream_t resp_stream;                                //S2C framing of the session
 
 /* SNPSFuzzer-specific variables */
 khash_t(m32)* km32_state_snapshot;                        //hashtable to determine if the state has snapshot
@@ -468,6 +496,7 @@ u8 has_snapshot_flag = 0;                                 //has snapshot flag
 u8 can_snapshot_flag = 0;                                 //can take snapshot flag 
 u8 is_restoring = 0;                                      // whether is restoring
 u32 restore_tms;                                          // restore timeout (ms)
+u8 fork_snapshot;                                         //snapshot by fork() in the target (AFL_FORK_SNAPSHOT)
 u8 is_first_run_of_fuzz_one = 0;
 
 s32 criu_dump_monitor_pid;                                //pid of process snapshot taken
@@ -545,6 +574,30 @@ char* response_buf_m23 = NULL;
 int response_buf_size_m23 = 0;                            //the size of the whole M23 response buffer
 u32* response_bytes_m23 = NULL;                           //an array keeping accumulated response buffer size for M23
 
+/* LTL_TRACE_REF: instead of adapters hex-encoding every packet into the
+   predicate line, remember where the bytes of each monitor event live and
+   dump them only when a violation is saved. One entry per emitted event,
+   in session order. */
+enum {
+  TRACE_SRC_MSG,                                          //kl_messages[idx]
+  TRACE_SRC_MSG_M1,                                       //kl_messages_m1[idx]
+  TRACE_SRC_MSG_M23,                                      //kl_messages_m2_m3[idx]
+  TRACE_SRC_RESP,                                         //response_buf + off
+  TRACE_SRC_RESP_M1,                                      //response_buf_m1 + off
+  TRACE_SRC_RESP_M23                                      //response_buf_m23 + off
+};
+
+struct trace_ref {
+  u8  src;
+  u32 idx;                                                //message index (TRACE_SRC_MSG*)
+  u32 off;                                                //buffer offset (TRACE_SRC_RESP*)
+  u32 len;
+};
+
+u8 trace_by_ref = 0;                                      //LTL_TRACE_REF set
+struct trace_ref* trace_refs = NULL;
+u32 trace_refs_cnt = 0, trace_refs_size = 0;
+
 typedef enum SNPSF_RES{
   OK, 
   M1_TIMEOUT         = 0x1, 
@@ -636,17 +689,83 @@ s32 check_state_snapshot()
 
 }
 
-/* Initialize the implemented state machine as a graphviz graph */
+/* CRIU image store. Image sets live in snapshot_img_root, a per-run
+   directory on tmpfs unless AFL_SNAPSHOT_STORE points elsewhere, so dump
+   and restore never touch the disk. A set is only restored while the
+   seed whose M1 produced it is being fuzzed (has_snapshot_flag is cleared
+   whenever a new state and seed are picked), so each dump replaces the
+   previous set and the store holds one at a time. */
+
+static u8* snapshot_img_root;
+static u8  snapshot_img_private;      /* root is ours to remove at exit   */
+static s64 snapshot_img_state = -1;   /* state of the set on tmpfs, or -1 */
+
+static u8* snapshot_img_dir(u32 state_id) {
+
+  return alloc_printf("%s/state%u_images", snapshot_img_root, state_id);
+
+}
+
+static void snapshot_store_setup(void) {
+
+  u8* store = getenv("AFL_SNAPSHOT_STORE");
+
+  if (!store) store = SNAPSHOT_STORE_DIR;
+
+  if (!access(store, W_OK)) {
+
+    snapshot_img_root = alloc_printf("%s/snpsfuzzer-%u", store, getpid());
+    if (mkdir(snapshot_img_root, 0700) && errno != EEXIST)
+      PFATAL("Unable to create '%s'", snapshot_img_root);
+    snapshot_img_private = 1;
+
+  } else {
+
+    WARNF("Snapshot store '%s' is not writable, keeping images in snapshot_dir", store);
+    snapshot_img_root = ck_strdup("snapshot_dir");
+
+  }
+
+}
+
+/* About to dump state_id: drop the set of any other state. */
+
+static void snapshot_store_replace(u32 state_id) {
+
+  if (snapshot_img_state >= 0 && snapshot_img_state != state_id) {
+
+    u8* dir = snapshot_img_dir(snapshot_img_state);
+
+    #ifdef SNAPSHOT_DEBUG
+    SNAPSHOT_LOG("drop images of state %u\n", (u32)snapshot_img_state);
+    #endif
+
+    if (!snap_clear_dir(dir)) rmdir(dir);
+    ck_free(dir);
+
+  }
+
+  snapshot_img_state = state_id;
+
+}
+
+static void snapshot_store_destroy(void) {
+
+  if (snapshot_img_private && !snap_clear_dir(snapshot_img_root))
+    rmdir(snapshot_img_root);
+
+  ck_free(snapshot_img_root);
+
+}
+
+/* Initialize the implemented state machine */
 void setup_ipsm()
 {
-  ipsm = agopen("g", Agdirected, 0);
-
-  agattr(ipsm, AGNODE, "color", "black"); //Default node colr is black
-  agattr(ipsm, AGEDGE, "color", "black"); //Default edge color is black
+  km64_ipsm_edges = kh_init(m64);
 
   khs_ipsm_paths = kh_init(hs32);
 
-  khms_states = kh_init(hms);
+  km32_states = kh_init(m32);
 
   if (use_snapshot) km32_state_snapshot = kh_init(m32);  //initialization
 }
@@ -654,45 +773,159 @@ void setup_ipsm()
 /* Free memory allocated to state-machine variables */
 void destroy_ipsm()
 {
-  agclose(ipsm);
+  u32 i;
+
+  kh_destroy(m64, km64_ipsm_edges);
+  ck_free(ipsm_edges);
 
   kh_destroy(hs32, khs_ipsm_paths);
 
-  state_info_t *state;
-  kh_foreach_value(khms_states, state, {ck_free(state->seeds); ck_free(state);});
-  kh_destroy(hms, khms_states);
+  for (i = 0; i < state_ids_count; i++) ck_free(state_table[i].seeds);
+  ck_free(state_table);
+  kh_destroy(m32, km32_states);
 
   if (use_snapshot) kh_destroy(m32, km32_state_snapshot);
 
   ck_free(state_ids);
+  ck_free(was_fuzzed_map);
 }
 
-/* Get state index in the state IDs list, given a state ID */
+/* Get state index in the state IDs list, given a state ID. state_ids_count
+   if the state has not been seen. */
 u32 get_state_index(u32 state_id) {
-  u32 index = 0;
-  for (index = 0; index < state_ids_count; index++) {
-    if (state_ids[index] == state_id) break;
+  khint_t k = kh_get(m32, km32_states, state_id);
+  return k == kh_end(km32_states) ? state_ids_count : kh_val(km32_states, k);
+}
+
+/* The state with a given ID, NULL if it has not been seen */
+static inline state_info_t *get_state(u32 state_id) {
+  u32 index = get_state_index(state_id);
+  return index == state_ids_count ? NULL : &state_table[index];
+}
+
+/* Mark a state once per state sequence: bump state_mark before walking the
+   sequence, then count a state only when this returns 1. Replaces a
+   throwaway hash set per sequence. */
+static inline u8 mark_state(state_info_t *state) {
+  if (state->mark == state_mark) return 0;
+  state->mark = state_mark;
+  return 1;
+}
+
+static void next_state_mark(void) {
+  u32 i;
+  if (++state_mark) return;
+  //Wrapped around: forget the old marks so none of them can match again
+  for (i = 0; i < state_ids_count; i++) state_table[i].mark = 0;
+  state_mark = 1;
+}
+
+/* The was_fuzzed map is a single flat bitmap of states x queue entries.
+   Row i belongs to state_table[i] and holds two bit planes of
+   fuzzed_map_words u64 each, indexed by queue entry: "reachable" (the seed
+   reaches the state) then "fuzzed" (the seed was fuzzed while the state was
+   targeted). A cell is unreachable (-1 in the old char map) when neither bit
+   is set, reachable but not fuzzed (0) when only the first is, fuzzed (1)
+   when the second is. Rows and the row stride grow geometrically, so a new
+   seed or state costs amortized O(1) instead of touching every cell. */
+
+static inline u64 *fuzzed_map_row(u32 state_index) {
+  return was_fuzzed_map + (u64)state_index * 2 * fuzzed_map_words;
+}
+
+/* Make room for the given number of states (rows) and queue entries (columns) */
+void expand_was_fuzzed_map(u32 states, u32 qentries) {
+  u32 i, words = fuzzed_map_words;
+
+  while ((u64)words * 64 < qentries) words = words ? words * 2 : 1;
+
+  if (words != fuzzed_map_words) {
+    //Re-stride: copy every row's planes into the wider layout
+    u32 rows = fuzzed_map_states;
+    if (states > rows) rows = MAX(states, fuzzed_map_states * 2);
+    u64 *map = ck_alloc((u64)rows * 2 * words * sizeof(u64));
+
+    for (i = 0; fuzzed_map_words && i < fuzzed_map_states; i++) {
+      memcpy(map + (u64)i * 2 * words, fuzzed_map_row(i), fuzzed_map_words * sizeof(u64));
+      memcpy(map + (u64)i * 2 * words + words, fuzzed_map_row(i) + fuzzed_map_words,
+             fuzzed_map_words * sizeof(u64));
+    }
+
+    ck_free(was_fuzzed_map);
+    was_fuzzed_map = map;
+    fuzzed_map_words = words;
+    fuzzed_map_states = rows;
   }
-  return index;
+
+  if (states > fuzzed_map_states) {
+    u32 rows = MAX(states, fuzzed_map_states * 2);
+    //ck_realloc zeroes the new rows, i.e., unreachable everywhere
+    was_fuzzed_map = ck_realloc(was_fuzzed_map, (u64)rows * 2 * fuzzed_map_words * sizeof(u64));
+    fuzzed_map_states = rows;
+  }
+}
+
+static inline void set_seed_reachable(u32 state_index, u32 qindex) {
+  if (state_index >= state_ids_count) return;
+  fuzzed_map_row(state_index)[qindex >> 6] |= 1ULL << (qindex & 63);
+}
+
+static inline void set_seed_fuzzed(u32 state_index, u32 qindex) {
+  if (state_index >= state_ids_count) return;
+  fuzzed_map_row(state_index)[fuzzed_map_words + (qindex >> 6)] |= 1ULL << (qindex & 63);
+}
+
+/* Was the seed fuzzed while the state was targeted */
+static inline u8 seed_was_fuzzed(u32 state_index, u32 qindex) {
+  if (state_index >= state_ids_count) return 0;
+  return (fuzzed_map_row(state_index)[fuzzed_map_words + (qindex >> 6)] >> (qindex & 63)) & 1;
+}
+
+/* Does the seed reach the state without having been fuzzed for it yet */
+static inline u8 seed_is_pending(u32 state_index, u32 qindex) {
+  u64 *row;
+  if (state_index >= state_ids_count) return 0;
+  row = fuzzed_map_row(state_index);
+  return ((row[qindex >> 6] & ~row[fuzzed_map_words + (qindex >> 6)]) >> (qindex & 63)) & 1;
+}
+
+/* Number of seeds reaching the state that have not been fuzzed for it */
+static u32 count_pending_seeds(u32 state_index) {
+  u64 *row;
+  u32 i, count = 0, words;
+  if (state_index >= state_ids_count) return 0;
+  row = fuzzed_map_row(state_index);
+  words = MIN(fuzzed_map_words, (queued_paths + 63) >> 6);
+  for (i = 0; i < words; i++)
+    count += __builtin_popcountll(row[i] & ~row[fuzzed_map_words + i]);
+  return count;
 }
 
-/* Expand the size of the map when a new seed or a new state has been discovered */
-void expand_was_fuzzed_map(u32 new_states, u32 new_qentries) {
-  int i, j;
-  //Realloc the memory
-  was_fuzzed_map = (char **)ck_realloc(was_fuzzed_map, (fuzzed_map_states + new_states) * sizeof(char *));
-  for (i = 0; i < fuzzed_map_states + new_states; i++)
-    was_fuzzed_map[i] = (char *)ck_realloc(was_fuzzed_map[i], (fuzzed_map_qentries + new_qentries) * sizeof(char));
+/* Add a newly seen state to the state table, return its index */
+static u32 add_state(u32 state_id) {
+  state_info_t *state;
+  int discard;
+  khint_t k;
+
+  if (state_ids_count == state_table_size) {
+    state_table_size = state_table_size ? state_table_size * 2 : 16;
+    state_table = (state_info_t *) ck_realloc(state_table, state_table_size * sizeof(state_info_t));
+    state_ids = (u32 *) ck_realloc(state_ids, state_table_size * sizeof(u32));
+  }
+
+  state = &state_table[state_ids_count];
+  memset(state, 0, sizeof(state_info_t));
+  state->id = state_id;
+  state->is_covered = 1;
+  state->score = 1;
 
-  //All new cells are marked as -1 -- meaning UNREACHABLE
-  //Keep other cells untouched
-  for (i = 0; i < fuzzed_map_states + new_states; i++)
-    for (j = 0; j < fuzzed_map_qentries + new_qentries; j++)
-      if ((i >= fuzzed_map_states) || (j >= fuzzed_map_qentries)) was_fuzzed_map[i][j] = -1;
+  k = kh_put(m32, km32_states, state_id, &discard);
+  kh_value(km32_states, k) = state_ids_count;
 
-  //Update total number of states (rows) and total number of queue entries (columns) in the was_fuzzed_map
-  fuzzed_map_states += new_states;
-  fuzzed_map_qentries += new_qentries;
+  state_ids[state_ids_count] = state_id;
+  expand_was_fuzzed_map(state_ids_count + 1, queued_paths);
+
+  return state_ids_count++;
 }
 
 /* Get unique state count, given a state sequence */
@@ -761,6 +994,64 @@ void update_region_annotations(struct queue_entry* q)
   }
 }
 
+/* Packed corpus store (see corpus_pack.h), used when AFL_CORPUS_PACK is
+   set. Queue entries are then read back through its mapping instead of
+   from their files, and the replayable copies of test cases exist only in
+   the pack. By default everything goes through separate files. */
+
+static corpus_pack_t corpus_pack = { .fd = -1 };
+
+/* Add a queue entry's contents (q->len bytes at mem) to the pack */
+static void pack_queue_entry(struct queue_entry *q, const u8 *mem) {
+  if (corpus_pack.fd < 0 || q->pack_off) return;
+  q->pack_off = pack_append(&corpus_pack, PACK_QUEUE, basename(q->fname), mem, q->len);
+  if (!q->pack_off) PFATAL("Unable to append to the corpus pack");
+}
+
+/* The contents of a queue entry, NULL if it is not in the pack. Only valid
+   until the next read from the pack. */
+static const u8 *queue_entry_data(struct queue_entry *q) {
+  return q->pack_off ? pack_data(&corpus_pack, q->pack_off, q->len) : NULL;
+}
+
+/* Read up to len bytes at offset off of a queue entry; returns the number read */
+static u32 read_queue_entry(struct queue_entry *q, u8 *buf, u32 off, u32 len) {
+  const u8 *data = queue_entry_data(q);
+  s32 fd, res;
+
+  if (off >= q->len) return 0;
+  if (len > q->len - off) len = q->len - off;
+
+  if (data) {
+    memcpy(buf, data + off, len);
+    return len;
+  }
+
+  fd = open(q->fname, O_RDONLY);
+  if (fd < 0) PFATAL("Unable to open '%s'", q->fname);
+  res = pread(fd, buf, len, off);
+  close(fd);
+  return res < 0 ? 0 : res;
+}
+
+/* Keep a message sequence in replayable form, as a pack record of the given
+   kind or as out_dir/<its directory>/name */
+static void save_replayable(u8 kind, u8 *name, klist_t(lms) *kl, u32 max_count) {
+  u32 len;
+  u8 *mem, *fn;
+
+  if (corpus_pack.fd < 0) {
+    fn = alloc_printf("%s/%s/%s", out_dir, pack_kind_dirs[kind], name);
+    save_kl_messages_to_file(kl, fn, 1, max_count);
+    ck_free(fn);
+    return;
+  }
+
+  mem = kl_messages_to_buf(kl, 1, max_count, &len);
+  if (!pack_append(&corpus_pack, kind, name, mem, len)) PFATAL("Unable to append to the corpus pack");
+  ck_free(mem);
+}
+
 /* Choose a region data for region-level mutations */
 u8* choose_source_region(u32 *out_len) {
   u8 *out = NULL;
@@ -783,10 +1074,7 @@ u8* choose_source_region(u32 *out_len) {
       if (out == NULL) PFATAL("Unable allocate a memory region to store a region");
       *out_len = len;
       //Read region data into memory. */
-      FILE *fp = fopen(q->fname, "rb");
-      fseek(fp, q->regions[reg_index].start_byte, SEEK_CUR);
-      fread(out, 1, len, fp);
-      fclose(fp);
+      read_queue_entry(q, out, q->regions[reg_index].start_byte, len);
     }
   }
 
@@ -795,29 +1083,18 @@ u8* choose_source_region(u32 *out_len) {
 
 /* Update #fuzzs visiting a specific state */
 void update_fuzzs() {
-  unsigned int state_count, i, discard;
+  unsigned int state_count, i;
   unsigned int *state_sequence = (*extract_response_codes)(response_buf, response_buf_size, &state_count);
+  state_info_t *state;
 
-  //A hash set is used so that the #paths is not updated more than once for one specific state
-  khash_t(hs32) *khs_state_ids;
-  khint_t k;
-  khs_state_ids = kh_init(hs32);
+  //Each state is counted at most once per sequence
+  next_state_mark();
 
   for(i = 0; i < state_count; i++) {
-    unsigned int state_id = state_sequence[i];
-
-    if (kh_get(hs32, khs_state_ids, state_id) != kh_end(khs_state_ids)) {
-      continue;
-    } else {
-      kh_put(hs32, khs_state_ids, state_id, &discard);
-      k = kh_get(hms, khms_states, state_id);
-      if (k != kh_end(khms_states)) {
-        kh_val(khms_states, k)->fuzzs++;
-      }
-    }
+    state = get_state(state_sequence[i]);
+    if (state && mark_state(state)) state->fuzzs++;
   }
   ck_free(state_sequence);
-  kh_destroy(hs32, khs_state_ids);
 }
 
 /* Return the index of the "region" containing a given value */
@@ -839,27 +1116,25 @@ u32 update_scores_and_select_next_state(u8 mode) {
   state_scores = (u32 *)ck_alloc(state_ids_count * sizeof(u32));
   if (!state_scores) PFATAL("Cannot allocate memory for state_scores");
 
-  khint_t k;
   state_info_t *state;
   //Update the states' score
   for(i = 0; i < state_ids_count; i++) {
-    u32 state_id = state_ids[i];
-
-    k = kh_get(hms, khms_states, state_id);
-    if (k != kh_end(khms_states)) {
-      state = kh_val(khms_states, k);
-      switch(mode) {
-      case FAVOR:
-        state->score = ceil(1000 * pow(2, -log10(log10(state->fuzzs + 1) * state->selected_times + 1)) * pow(2, log(state->paths_discovered + 1)));
-        break;
-        //other cases are reserved
-      }
+    state = &state_table[i];
+    switch(mode) {
+    case FAVOR:
+      state->score = ceil(1000 * pow(2, -log10(log10(state->fuzzs + 1) * state->selected_times + 1)) * pow(2, log(state->paths_discovered + 1)));
+      break;
+    case NEAR_VIOLATION:
+      state->score = ceil(1000 * pow(2, -log10(log10(state->fuzzs + 1) * state->selected_times + 1)) * pow(2, log(state->paths_discovered + 1))
+                          * pow(2, NEAR_STATE_BOOST * state->monitor_near / 1000.0));
+      break;
+      //other cases are reserved
+    }
 
-      if (i == 0) {
-        state_scores[i] = state->score;
-      } else {
-        state_scores[i] = state_scores[i-1] + state->score;
-      }
+    if (i == 0) {
+      state_scores[i] = state->score;
+    } else {
+      state_scores[i] = state_scores[i-1] + state->score;
     }
   }
 
@@ -886,6 +1161,7 @@ unsigned int choose_target_state(u8 mode) {
     if (selected_state_index == state_ids_count) selected_state_index = 0;
     break;
   case FAVOR:
+  case NEAR_VIOLATION:
     /* Do ROUND_ROBIN for a few cycles to get enough statistical information*/
     if (state_cycles < 5) {
       result = state_ids[selected_state_index];
@@ -897,7 +1173,7 @@ unsigned int choose_target_state(u8 mode) {
       break;
     }
 
-    result = update_scores_and_select_next_state(FAVOR);
+    result = update_scores_and_select_next_state(mode);
     break;
   default:
     break;
@@ -906,16 +1182,21 @@ unsigned int choose_target_state(u8 mode) {
   return result;
 }
 
+/* Weight of a seed in NEAR_VIOLATION seed selection */
+static u32 near_seed_weight(u32 state_index, struct queue_entry *q) {
+  u32 w = NEAR_SEED_BASE + q->monitor_near;
+  return seed_was_fuzzed(state_index, q->index) ? w : w * 2;
+}
+
 /* Select a seed to exercise the target state */
 struct queue_entry *choose_seed(u32 target_state_id, u8 mode)
 {
-  khint_t k;
+  u32 target_state_index = get_state_index(target_state_id);
   state_info_t *state;
   struct queue_entry *result = NULL;
 
-  k = kh_get(hms, khms_states, target_state_id);
-  if (k != kh_end(khms_states)) {
-    state = kh_val(khms_states, k);
+  if (target_state_index < state_ids_count) {
+    state = &state_table[target_state_index];
 
     if (state->seeds_count == 0) return NULL;
 
@@ -934,6 +1215,8 @@ struct queue_entry *choose_seed(u32 target_state_id, u8 mode)
         //Do seed selection similar to AFL + take into account state-aware information
         //e.g., was_fuzzed information becomes state-aware
         u32 passed_cycles = 0;
+        //Skipping to new arrivals only makes sense if this state has any
+        u8 skip_to_new = pending_favored && count_pending_seeds(target_state_index);
         while (passed_cycles < 5) {
           result = state->seeds[state->selected_seed_index];
           if (state->selected_seed_index + 1 == state->seeds_count) {
@@ -945,12 +1228,11 @@ struct queue_entry *choose_seed(u32 target_state_id, u8 mode)
           //current target_state_id was targeted
           if (result->generating_state_id != target_state_id && !result->is_initial_seed && UR(100) < 90) continue;
 
-          u32 target_state_index = get_state_index(target_state_id);
-          if (pending_favored) {
+          if (skip_to_new) {
             /* If we have any favored, non-fuzzed new arrivals in the queue,
                possibly skip to them at the expense of already-fuzzed or non-favored
                cases. */
-            if (((was_fuzzed_map[target_state_index][result->index] == 1) || !result->favored) && UR(100) < SKIP_TO_NEW_PROB) continue;
+            if ((seed_was_fuzzed(target_state_index, result->index) || !result->favored) && UR(100) < SKIP_TO_NEW_PROB) continue;
 
             /* Otherwise, this seed is selected */
             break;
@@ -958,7 +1240,7 @@ struct queue_entry *choose_seed(u32 target_state_id, u8 mode)
             /* Otherwise, still possibly skip non-favored cases, albeit less often.
                The odds of skipping stuff are higher for already-fuzzed inputs and
                lower for never-fuzzed entries. */
-            if (queue_cycle > 1 && (was_fuzzed_map[target_state_index][result->index] == 0)) {
+            if (queue_cycle > 1 && seed_is_pending(target_state_index, result->index)) {
               if (UR(100) < SKIP_NFAV_NEW_PROB) continue;
             } else {
               if (UR(100) < SKIP_NFAV_OLD_PROB) continue;
@@ -975,6 +1257,25 @@ struct queue_entry *choose_seed(u32 target_state_id, u8 mode)
         if (state->selected_seed_index == state->seeds_count) state->selected_seed_index = 0;
       }
       break;
+    case NEAR_VIOLATION: {
+      //Roulette over the seeds, favoring those whose sessions came close to a violation
+      u32 total = 0, pick, i;
+
+      for (i = 0; i < state->seeds_count; i++)
+        total += near_seed_weight(target_state_index, state->seeds[i]);
+
+      pick = UR(total);
+
+      for (i = 0; i + 1 < state->seeds_count; i++) {
+        u32 w = near_seed_weight(target_state_index, state->seeds[i]);
+        if (pick < w) break;
+        pick -= w;
+      }
+
+      state->selected_seed_index = i;
+      result = state->seeds[i];
+      break;
+    }
     default:
       break;
     }
@@ -1069,11 +1370,79 @@ s32 message_chain_analysis(s32 *M2_start_region_ID_PREV, s32 M2_start_region_ID_
   else PFATAL("error mca_algo value");
 }
 
+/* Add a state to the implemented state machine. States the region
+   annotation has already put into the state table keep their state_info_t. */
+static void add_ipsm_state(u32 id, u8 dry_run)
+{
+  u32 index = get_state_index(id);
+  state_info_t *state;
+
+  //Insert this newly discovered state into the state table
+  if (index == state_ids_count) index = add_state(id);
+  state = &state_table[index];
+
+  if (!state->ipsm_node) state->ipsm_node = dry_run ? IPSM_SEED : IPSM_FUZZ;
+}
+
+/* Count a transition of the implemented state machine, adding it if new */
+static void add_ipsm_edge(u32 from, u32 to, u8 dry_run)
+{
+  int absent;
+  khint_t k = kh_put(m64, km64_ipsm_edges, ((u64)from << 32) | to, &absent);
+
+  if (absent) {
+    ipsm_edges = (ipsm_edge_t *) ck_realloc(ipsm_edges, (ipsm_edges_count + 1) * sizeof(ipsm_edge_t));
+    ipsm_edges[ipsm_edges_count].from = from;
+    ipsm_edges[ipsm_edges_count].to = to;
+    ipsm_edges[ipsm_edges_count].hits = 0;
+    ipsm_edges[ipsm_edges_count].found = dry_run ? IPSM_SEED : IPSM_FUZZ;
+    kh_value(km64_ipsm_edges, k) = ipsm_edges_count++;
+  }
+
+  ipsm_edges[kh_value(km64_ipsm_edges, k)].hits++;
+}
+
+/* Write out ipsm.dot if the state machine has changed since the last time.
+   Seed-discovered states and transitions are blue, fuzzing-discovered red. */
+static void write_ipsm_dot(void)
+{
+  static const char *colors[] = { "black", "blue", "red" };
+  u32 i;
+  s32 fd;
+  FILE *f;
+  u8 *tmp;
+
+  if (!ipsm_dirty) return;
+
+  tmp = alloc_printf("%s/ipsm.dot", out_dir);
+  fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0) PFATAL("Unable to create %s", tmp);
+  ck_free(tmp);
+
+  f = fdopen(fd, "w");
+  if (!f) PFATAL("fdopen() failed");
+
+  fprintf(f, "digraph g {\n\tnode [color=black];\n\tedge [color=black];\n");
+
+  for (i = 0; i < state_ids_count; i++)
+    if (state_table[i].ipsm_node)
+      fprintf(f, "\t%u\t[color=%s];\n", state_ids[i], colors[state_table[i].ipsm_node]);
+
+  for (i = 0; i < ipsm_edges_count; i++)
+    fprintf(f, "\t%u -> %u\t[color=%s, hits=%u];\n", ipsm_edges[i].from, ipsm_edges[i].to,
+            colors[ipsm_edges[i].found], ipsm_edges[i].hits);
+
+  fprintf(f, "}\n");
+  fclose(f);
+
+  ipsm_dirty = 0;
+}
+
 /* Update state-aware variables */
 void update_state_aware_variables(struct queue_entry *q, u8 dry_run)
 {
-  khint_t k;
-  int discard, i;
+  int i;
+  u32 state_index;
   state_info_t *state;
   unsigned int state_count;
 
@@ -1086,10 +1455,10 @@ void update_state_aware_variables(struct queue_entry *q, u8 dry_run)
   if (is_state_sequence_interesting(state_sequence, state_count)) {
     //Save the current kl_messages to a file which can be used to replay the newly discovered paths on the ipsm
     u8 *temp_str = state_sequence_to_string(state_sequence, state_count);
-    u8 *fname = alloc_printf("%s/replayable-new-ipsm-paths/id:%s:%s", out_dir, temp_str, dry_run ? basename(q->fname) : "new");
-    save_kl_messages_to_file(kl_messages, fname, 1, messages_sent);
+    u8 *name = alloc_printf("id:%s:%s", temp_str, dry_run ? basename(q->fname) : "new");
+    save_replayable(PACK_REPLAY_IPSM, name, kl_messages, messages_sent);
     ck_free(temp_str);
-    ck_free(fname);
+    ck_free(name);
 
     //Update the IPSM graph
     if (state_count > 1) {
@@ -1097,101 +1466,20 @@ void update_state_aware_variables(struct queue_entry *q, u8 dry_run)
 
       for(i=1; i < state_count; i++) {
         unsigned int curStateID = state_sequence[i];
-        char fromState[STATE_STR_LEN], toState[STATE_STR_LEN];
-        snprintf(fromState, STATE_STR_LEN, "%d", prevStateID);
-        snprintf(toState, STATE_STR_LEN, "%d", curStateID);
-
-        //Check if the prevStateID and curStateID have been added to the state machine as vertices
-        //Check also if the edge prevStateID->curStateID has been added
-        Agnode_t *from, *to;
-        Agedge_t *edge;
-        from = agnode(ipsm, fromState, FALSE);
-        if (!from) {
-          //Add a node to the graph
-          from = agnode(ipsm, fromState, TRUE);
-          if (dry_run) agset(from,"color","blue");
-          else agset(from,"color","red");
-
-          //Insert this newly discovered state into the states hashtable
-          state_info_t *newState_From = (state_info_t *) ck_alloc (sizeof(state_info_t));
-          newState_From->id = prevStateID;
-          newState_From->is_covered = 1;
-          newState_From->paths = 0;
-          newState_From->paths_discovered = 0;
-          newState_From->selected_times = 0;
-          newState_From->fuzzs = 0;
-          newState_From->score = 1;
-          newState_From->selected_seed_index = 0;
-          newState_From->seeds = NULL;
-          newState_From->seeds_count = 0;
-
-          k = kh_put(hms, khms_states, prevStateID, &discard);
-          kh_value(khms_states, k) = newState_From;
-
-          //Insert this into the state_ids array too
-          state_ids = (u32 *) ck_realloc(state_ids, (state_ids_count + 1) * sizeof(u32));
-          state_ids[state_ids_count++] = prevStateID;
-
-          if (prevStateID != 0) expand_was_fuzzed_map(1, 0);
-        }
-
-        to = agnode(ipsm, toState, FALSE);
-        if (!to) {
-          //Add a node to the graph
-          to = agnode(ipsm, toState, TRUE);
-          if (dry_run) agset(to,"color","blue");
-          else agset(to,"color","red");
-
-          //Insert this newly discovered state into the states hashtable
-          state_info_t *newState_To = (state_info_t *) ck_alloc (sizeof(state_info_t));
-          newState_To->id = curStateID;
-          newState_To->is_covered = 1;
-          newState_To->paths = 0;
-          newState_To->paths_discovered = 0;
-          newState_To->selected_times = 0;
-          newState_To->fuzzs = 0;
-          newState_To->score = 1;
-          newState_To->selected_seed_index = 0;
-          newState_To->seeds = NULL;
-          newState_To->seeds_count = 0;
-
-          k = kh_put(hms, khms_states, curStateID, &discard);
-          kh_value(khms_states, k) = newState_To;
-
-          //Insert this into the state_ids array too
-          state_ids = (u32 *) ck_realloc(state_ids, (state_ids_count + 1) * sizeof(u32));
-          state_ids[state_ids_count++] = curStateID;
-
-          if (curStateID != 0) expand_was_fuzzed_map(1, 0);
-        }
 
-        //Check if an edge from->to exists
-        edge = agedge(ipsm, from, to, NULL, FALSE);
-        if (!edge) {
-          //Add an edge to the graph
-          edge = agedge(ipsm, from, to, "new_edge", TRUE);
-          if (dry_run) agset(edge, "color", "blue");
-          else agset(edge, "color", "red");
-        }
+        //Add prevStateID and curStateID to the state machine as vertices,
+        //and the edge prevStateID->curStateID, unless they are there already
+        add_ipsm_state(prevStateID, dry_run);
+        add_ipsm_state(curStateID, dry_run);
+        add_ipsm_edge(prevStateID, curStateID, dry_run);
 
         //Update prevStateID
         prevStateID = curStateID;
       }
     }
 
-    //Update the dot file
-    s32 fd;
-    u8* tmp;
-    tmp = alloc_printf("%s/ipsm.dot", out_dir);
-    fd = open(tmp, O_WRONLY | O_CREAT, 0600);
-    if (fd < 0) {
-      PFATAL("Unable to create %s", tmp);
-    } else {
-      ipsm_dot_file = fdopen(fd, "w");
-      agwrite(ipsm, ipsm_dot_file);
-      close(fileno(ipsm_dot_file));
-      ck_free(tmp);
-    }
+    //The dot file is behind now
+    ipsm_dirty = 1;
   }
 
   //Update others no matter the new seed leads to interesting state sequence or not
@@ -1202,14 +1490,14 @@ void update_state_aware_variables(struct queue_entry *q, u8 dry_run)
   //Update the states hashtable to keep the list of seeds which help us to reach a specific state
   //Iterate over the regions & their annotated state (sub)sequences and update the hashtable accordingly
   //All seed should "reach" state 0 (initial state) so we add this one to the map first
-  k = kh_get(hms, khms_states, 0);
-  if (k != kh_end(khms_states)) {
-    state = kh_val(khms_states, k);
+  state_index = get_state_index(0);
+  if (state_index < state_ids_count) {
+    state = &state_table[state_index];
     state->seeds = (void **) ck_realloc (state->seeds, (state->seeds_count + 1) * sizeof(void *));
     state->seeds[state->seeds_count] = (void *)q;
     state->seeds_count++;
 
-    was_fuzzed_map[0][q->index] = 0; //Mark it as reachable but not fuzzed
+    set_seed_reachable(state_index, q->index); //Mark it as reachable but not fuzzed
   } else {
     PFATAL("AFLNet - the states hashtable should always contain an entry of the initial state");
   }
@@ -1221,9 +1509,9 @@ void update_state_aware_variables(struct queue_entry *q, u8 dry_run)
       //reachable_state_id is the last ID in the state_sequence
       unsigned int reachable_state_id = q->regions[i].state_sequence[regional_state_count - 1];
 
-      k = kh_get(hms, khms_states, reachable_state_id);
-      if (k != kh_end(khms_states)) {
-        state = kh_val(khms_states, k);
+      state_index = get_state_index(reachable_state_id);
+      if (state_index < state_ids_count) {
+        state = &state_table[state_index];
         state->seeds = (void **) ck_realloc (state->seeds, (state->seeds_count + 1) * sizeof(void *));
         state->seeds[state->seeds_count] = (void *)q;
         state->seeds_count++;
@@ -1234,61 +1522,36 @@ void update_state_aware_variables(struct queue_entry *q, u8 dry_run)
         //To completely fix this, we should fix all causes leading to potential undeterminism
         //For now, we just add the state into the hashtable
 
-        state_info_t *newState = (state_info_t *) ck_alloc (sizeof(state_info_t));
-        newState->id = reachable_state_id;
-        newState->is_covered = 1;
-        newState->paths = 0;
-        newState->paths_discovered = 0;
-        newState->selected_times = 0;
-        newState->fuzzs = 0;
-        newState->score = 1;
-        newState->selected_seed_index = 0;
-        newState->seeds = NULL;
-        newState->seeds = (void **) ck_realloc (newState->seeds, sizeof(void *));
-        newState->seeds[0] = (void *)q;
-        newState->seeds_count = 1;
-
-        k = kh_put(hms, khms_states, reachable_state_id, &discard);
-        kh_value(khms_states, k) = newState;
-
-        //Insert this into the state_ids array too
-        state_ids = (u32 *) ck_realloc(state_ids, (state_ids_count + 1) * sizeof(u32));
-        state_ids[state_ids_count++] = reachable_state_id;
-
-        if (reachable_state_id != 0) expand_was_fuzzed_map(1, 0);
+        state_index = add_state(reachable_state_id);
+        state = &state_table[state_index];
+        state->seeds = (void **) ck_alloc (sizeof(void *));
+        state->seeds[0] = (void *)q;
+        state->seeds_count = 1;
       }
 
-      was_fuzzed_map[get_state_index(reachable_state_id)][q->index] = 0; //Mark it as reachable but not fuzzed
+      set_seed_reachable(state_index, q->index); //Mark it as reachable but not fuzzed
     }
   }
 
   //Update the number of paths which have traversed a specific state
   //It can be used for calculating fuzzing energy
-  //A hash set is used so that the #paths is not updated more than once for one specific state
-  khash_t(hs32) *khs_state_ids;
-  khs_state_ids = kh_init(hs32);
+  //The #paths is not updated more than once for one specific state
+  //The dry run ends no monitor sessions, so initial seeds are not rated
+  q->monitor_near = dry_run ? 0 : monitor_near;
+  next_state_mark();
 
   for(i = 0; i < state_count; i++) {
-    unsigned int state_id = state_sequence[i];
-
-    if (kh_get(hs32, khs_state_ids, state_id) != kh_end(khs_state_ids)) {
-      continue;
-    } else {
-      kh_put(hs32, khs_state_ids, state_id, &discard);
-      k = kh_get(hms, khms_states, state_id);
-      if (k != kh_end(khms_states)) {
-        kh_val(khms_states, k)->paths++;
-      }
+    state = get_state(state_sequence[i]);
+    if (state && mark_state(state)) {
+      state->paths++;
+      if (q->monitor_near > state->monitor_near) state->monitor_near = q->monitor_near;
     }
   }
-  kh_destroy(hs32, khs_state_ids);
 
   //Update paths_discovered
   if (!dry_run) {
-    k = kh_get(hms, khms_states, target_state_id);
-    if (k != kh_end(khms_states)) {
-      kh_val(khms_states, k)->paths_discovered++;
-    }
+    state = get_state(target_state_id);
+    if (state) state->paths_discovered++;
 
     //update value paths_discovered of the corresponding region
     if (state_aware_mode && use_snapshot && (mca_algo == MCA_SMART) && (current_choose_position != -1)) {
@@ -1346,90 +1609,278 @@ void clock_close_depends(int time_select, int res) {
   }
 }
 
-void get_popen_result(const char *mes, int **res_code, int *size)
-{ 
-  //get popen results
+/* Per-phase execution timing. Phases nest (the socket restore runs inside
+   the CRIU restore, predicates are built inside the sends), and each span is
+   charged its own time only, so the phases of an exec add up to the time
+   spent in them and the cumulative figures can be compared directly. The
+   clock is the TSC where there is one, scaled by a factor measured at
+   startup. Per-span times in ns go into a latency sketch for p50/p99. */
 
-  char buf[4096];
-  
-  FILE *fp;
-  if ((fp = popen(mes, "r")) == NULL) {
-    PFATAL("error execute ps -ef");
-  }
-  int fp_fd = fileno(fp);
+enum {
+  /* 00 */ PH_RESTORE,         /* CRIU or fork snapshot restore           */
+  /* 01 */ PH_SOCK_RESTORE,    /* libsoccr restore of the AFL socket      */
+  /* 02 */ PH_DUMP,            /* taking the snapshot                     */
+  /* 03 */ PH_SEND_M1,         /* M1 send/recv, before the snapshot       */
+  /* 04 */ PH_SEND_M23,        /* M2/M3 send/recv, from the snapshot      */
+  /* 05 */ PH_SEND_ALL,        /* whole session send/recv, no snapshot    */
+  /* 06 */ PH_PREDICATES,      /* adapter predicate building              */
+  /* 07 */ PH_MONITOR_EMIT,    /* handing events to the monitor           */
+  /* 08 */ PH_MONITOR_WAIT,    /* monitor_end_session()                   */
+  /* 09 */ PH_BITMAP,          /* hit-count classification                */
+  PH_COUNT
+};
 
-  #ifdef SNAPSHOT_DEBUG
-  SNAPSHOT_LOG("%s\n",mes);
-  #endif
-  int n = read(fp_fd,buf,4096);
-  pclose(fp);
-
-  int ret = 0;
-  if(n>0){
-    buf[n-1]='\0'; // remove the last \n, avoiding memory overflow
-    char* token;
-    char* tmp = buf;
-    while ((token = strsep(&tmp, "\n")) != NULL) {
-      #ifdef SNAPSHOT_DEBUG
-      SNAPSHOT_LOG("  %-.100s\n", token);
-      #endif
+static const u8* phase_names[PH_COUNT] = {
+  "restore", "sock_restore", "dump", "send_m1", "send_m23", "send_all",
+  "predicates", "monitor_emit", "monitor_wait", "bitmap"
+};
+
+static struct {
+  u64 ticks;                /* own time of all spans                      */
+  u64 count;                /* completed spans                            */
+  lat_sketch_t ns;          /* own time of recent spans, ns (saturating)  */
+} phase_stats[PH_COUNT];
+
+static struct {
+  u8  phase;
+  u64 start;                /* when it last became the innermost span     */
+  u64 own;                  /* own time before that                       */
+} phase_stack[PHASE_MAX_DEPTH];
+
+static u32 phase_depth;
+static double phase_ns_per_tick = 1;
+
+static inline u64 phase_ticks(void) {
+
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+
+}
+
+/* Measure the tick rate against the monotonic clock. */
+
+static void setup_phase_timing(void) {
+
+#if defined(__x86_64__) || defined(__i386__)
+
+  struct timespec t0, t1;
+  u64 c0, c1;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  c0 = phase_ticks();
+  usleep(PHASE_CALIBRATE_MS * 1000);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  c1 = phase_ticks();
+
+  if (c1 > c0)
+    phase_ns_per_tick = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / (c1 - c0);
+
+#endif
+
+}
+
+static inline void phase_enter(u8 phase) {
+
+  u64 now = phase_ticks();
+
+  if (phase_depth && phase_depth <= PHASE_MAX_DEPTH)
+    phase_stack[phase_depth - 1].own += now - phase_stack[phase_depth - 1].start;
+
+  if (phase_depth++ >= PHASE_MAX_DEPTH) return;
+
+  phase_stack[phase_depth - 1].phase = phase;
+  phase_stack[phase_depth - 1].start = now;
+  phase_stack[phase_depth - 1].own = 0;
+
+}
+
+static inline void phase_leave(void) {
+
+  u64 now = phase_ticks(), own, ns;
+
+  if (!phase_depth) return;
+
+  if (phase_depth-- <= PHASE_MAX_DEPTH) {
+
+    own = phase_stack[phase_depth].own + now - phase_stack[phase_depth].start;
+    phase_stats[phase_stack[phase_depth].phase].ticks += own;
+    phase_stats[phase_stack[phase_depth].phase].count++;
+
+    ns = own * phase_ns_per_tick;
+    lat_sketch_add(&phase_stats[phase_stack[phase_depth].phase].ns, MIN(ns, 0xffffffff));
 
-      ret ++;
-      *res_code = (int *) ck_realloc(*res_code, ret * sizeof(int));
-      (*res_code)[ret-1] = atoi(token);
-    }
-  }else{
-    #ifdef SNAPSHOT_DEBUG
-    SNAPSHOT_LOG("  none found\n");
-    #endif
   }
-  *size = ret;
+
+  if (phase_depth && phase_depth <= PHASE_MAX_DEPTH)
+    phase_stack[phase_depth - 1].start = now;
+
 }
 
-int get_popen_result_no_return(const char *mes)
-{ 
-  //get popen results
-  char buf[4096];
-  
-  FILE *fp;
-  if ((fp = popen(mes, "r")) == NULL) {
-    PFATAL("error execute ps -ef");
+/* Drop spans left open by an aborted exec */
+
+static inline void phase_reset(void) {
+
+  phase_depth = 0;
+
+}
+
+/* Total own time of a phase, in ms */
+
+static inline u64 phase_total_ms(u8 phase) {
+
+  return phase_stats[phase].ticks * phase_ns_per_tick / 1e6;
+
+}
+
+/* pidfd of child_pid while it is the process the fork server handed us or
+   the one CRIU restored, -1 otherwise (then clear_child() goes by PID). */
+
+static s32 child_pidfd = -1;
+
+static void track_child(pid_t pid) {
+
+  if (child_pidfd >= 0) close(child_pidfd);
+  child_pidfd = pid > 0 ? snap_pidfd_open(pid) : -1;
+
+}
+
+/* Port block around libsoccr pause / restore: nftables rules sent over
+   netlink when nf_tables is available, the iptables commands otherwise. */
+
+static u8 use_nft;
+
+static void block_afl_port(void) {
+
+  if (use_nft) snap_nft_block(); else system(iptables_add);
+
+}
+
+static void unblock_afl_port(void) {
+
+  if (use_nft) snap_nft_unblock(); else system(iptables_del);
+
+}
+
+static void flush_afl_port(void) {
+
+  if (use_nft) {
+    snap_nft_unblock();
+  } else {
+    system("iptables -t filter -F OUTPUT");
+    system("iptables -t filter -F INPUT");
   }
-  int fp_fd = fileno(fp);
+
+}
+
+/* Fork snapshots: afl-fuzz end of the control socket shared with
+   fork_snapshot_rt.so, the parked target serving forks (0 = none), and
+   the runtime preloaded into the target. */
+
+static s32 fsnap_fd = -1;
+static s32 fsnap_server_pid;
+static u8* fsnap_rt;
+
+/* One message from the parked target, with the descriptor it carries if
+   fd is not NULL. Waits at most tmout ms (-1 = until it arrives). A
+   restore timeout (is_restoring == 2) ends the wait. */
+
+static s32 fork_snapshot_recv(u32* val, s32* fd, s32 tmout) {
+
+  struct pollfd pfd = { fsnap_fd, POLLIN, 0 };
+  struct msghdr msg;
+  struct iovec iov = { val, sizeof(u32) };
+  char cbuf[CMSG_SPACE(sizeof(s32))];
+  struct cmsghdr* c;
+  s32 res;
+
+  while ((res = poll(&pfd, 1, tmout)) < 0)
+    if (errno != EINTR || is_restoring == 2) return -1;
+
+  if (!res) return -1;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov        = &iov;
+  msg.msg_iovlen     = 1;
+  msg.msg_control    = cbuf;
+  msg.msg_controllen = sizeof(cbuf);
+
+  if (recvmsg(fsnap_fd, &msg, MSG_CMSG_CLOEXEC) != sizeof(u32)) return -1;
+
+  c = CMSG_FIRSTHDR(&msg);
+
+  if (c && c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS) {
+
+    s32 got;
+    memcpy(&got, CMSG_DATA(c), sizeof(s32));
+
+    if (fd) *fd = got; else close(got);
+
+  } else if (fd) *fd = -1;
+
+  return 0;
+
+}
+
+/* Kill the parked target, if any, and collect its status from the fork
+   server, which is waiting on it. */
+
+static void fork_snapshot_drop(void) {
+
+  s32 status, res;
+  u32 stale;
+
+  if (!fsnap_server_pid) return;
 
   #ifdef SNAPSHOT_DEBUG
-  SNAPSHOT_LOG("%s\n",mes);
+  SNAPSHOT_LOG("drop fork snapshot server %d\n", fsnap_server_pid);
   #endif
-  int n = read(fp_fd,buf,4096);
-  pclose(fp);
-
-  int ret = 0;
-  if(n>0){
-    buf[n-1]='\0'; // remove the last \n, avoiding memory overflow
-    char* token;
-    char* tmp = buf;
-    while ((token = strsep(&tmp, "\n")) != NULL) {
-      #ifdef SNAPSHOT_DEBUG
-      SNAPSHOT_LOG("  %-.100s\n", token);
-      #endif
-      ret ++;
-    }
-  }else{
-    #ifdef SNAPSHOT_DEBUG
-    SNAPSHOT_LOG("  none found\n");
-    #endif
+
+  kill(fsnap_server_pid, SIGKILL);
+  fsnap_server_pid = 0;
+
+  if ((res = read(fsrv_st_fd, &status, 4)) != 4) {
+    RPFATAL(res, "Unable to communicate with fork server (OOM?)");
   }
-  return ret;
+
+  while (recv(fsnap_fd, &stale, sizeof(stale), MSG_DONTWAIT) > 0);
+
 }
 
+#ifdef SNAPSHOT_DEBUG
+static void log_pids(const pid_t* pids, s32 n) {
+  s32 i;
+  if (n <= 0) SNAPSHOT_LOG("  none found\n");
+  for (i = 0; i < n && i < 64; i++) SNAPSHOT_LOG("  pid %d\n", pids[i]);
+}
+
+static void log_meminfo(void) {
+  char buf[512];
+  s32 fd = open("/proc/meminfo", O_RDONLY), n = 0, lines = 0, i;
+  if (fd >= 0) {
+    n = read(fd, buf, sizeof(buf));
+    close(fd);
+  }
+  for (i = 0; i < n && lines < 3; i++) if (buf[i] == '\n') lines++;
+  SNAPSHOT_LOG("%.*s", i, buf);
+}
+#endif
+
 int check_target_process(){
   #ifdef SNAPSHOT_DEBUG
   SNAPSHOT_LOG("now check all target process...\n");
   #endif
-  char* ttt = alloc_printf("ps -ef | grep %s| grep -v grep| grep -v afl-fuzz | grep -E '%d|%d'",use_banner, getpid(), forksrv_pid);
-
-  int ret = get_popen_result_no_return(ttt);
-  ck_free(ttt);
+  snap_proc_filter_t f = { .pid_a = getpid(), .pid_b = forksrv_pid,
+                           .skip = getpid(), .cmdline = (char*)use_banner };
+  pid_t pids[64];
+  s32 ret = snap_proc_scan(&f, pids, 64);
+  #ifdef SNAPSHOT_DEBUG
+  log_pids(pids, ret);
+  #endif
   return ret;
 }
 
@@ -1438,44 +1889,29 @@ int check_zombies() {
   #ifdef SNAPSHOT_DEBUG
   SNAPSHOT_LOG("now check all zombies...\n");
   #endif
-  char* ttt = alloc_printf("ps -ef | grep \"<defunct>\" | grep -v grep | grep -E '%d|%d'", getpid(), forksrv_pid);
-  int ret = get_popen_result_no_return(ttt);
-  ck_free(ttt);
-  return ret;
+  snap_proc_filter_t f = { .pid_a = getpid(), .pid_b = forksrv_pid, .zombies = 1 };
+  return snap_proc_scan(&f, NULL, 0);
 }
 
 void clear_zombies() {
   #ifdef SNAPSHOT_DEBUG
   SNAPSHOT_LOG("call clear_zombies...\n");
   #endif
-  if(check_zombies()){                  //If there is a zombie process
+  snap_proc_filter_t f = { .pid_a = getpid(), .pid_b = forksrv_pid, .zombies = 1 };
+  pid_t zombies[64];
+  s32 n = snap_proc_scan(&f, zombies, 64), i;
+
+  if(n > 0){                            //If there is a zombie process
     #ifdef SNAPSHOT_DEBUG
     SNAPSHOT_LOG("exist, try waitpid\n");
     #endif
-    /* get zombie Pid */
-    char* _x= alloc_printf("ps -ef | grep \"<defunct>\" | grep -v grep | grep -E '%d|%d' | awk '{ print $2 }'", getpid(), forksrv_pid);
-    FILE *fp;
-    if ((fp = popen(_x, "r")) == NULL) {
-      PFATAL("error execute ps -ef");
-    }
-    ck_free(_x);
-    char buf[1024];                     // It must be ensured that the total length of the result of 'ps' is not greater than 1024 (high probability)
-    int buf_len = read(fileno(fp),buf,1024);
-    pclose(fp);
-
     /* use waitpid for all zombie processes */
-    if(buf_len>0){
-      buf[buf_len-1]='\0';
-      char* dunfunct_pid;
-      char* p_buf = buf;
-      while((dunfunct_pid=strsep(&p_buf,"\n"))!=NULL){
-        #ifdef SNAPSHOT_DEBUG
-        SNAPSHOT_LOG("zombie pid:%s\n", dunfunct_pid);
-        #endif
-        int criu_defunct_pid = atoi(dunfunct_pid);
-        if (waitpid(criu_defunct_pid, NULL, 0) < 0) {
-          PFATAL("waitpid error!");
-        }
+    for (i = 0; i < n && i < 64; i++) {
+      #ifdef SNAPSHOT_DEBUG
+      SNAPSHOT_LOG("zombie pid:%d\n", zombies[i]);
+      #endif
+      if (waitpid(zombies[i], NULL, 0) < 0) {
+        PFATAL("waitpid error!");
       }
     }
 
@@ -1495,11 +1931,14 @@ void clear_child() {
   #ifdef SNAPSHOT_DEBUG
     SNAPSHOT_LOG("call clear_child...\n");
   #endif
-  if(!kill(child_pid,0)){            // if the child process is still alive
+  u8 alive = child_pidfd >= 0 ? !snap_pidfd_signal(child_pidfd, 0)
+                              : !kill(child_pid, 0);
+  if(alive){                         // if the child process is still alive
     #ifdef SNAPSHOT_DEBUG
     SNAPSHOT_LOG("exist, try kill(%d,SIGKILL)\n",child_pid);
     #endif
-    kill(child_pid,SIGKILL);
+    if (child_pidfd >= 0) snap_pidfd_signal(child_pidfd, SIGKILL);
+    else kill(child_pid,SIGKILL);
   }else{
     #ifdef SNAPSHOT_DEBUG
     SNAPSHOT_LOG("none child\n");
@@ -1508,19 +1947,15 @@ void clear_child() {
 }
 
 void check_process() {
-  char* ttt;
   #ifdef SNAPSHOT_DEBUG
+  snap_proc_filter_t f = { .skip = getpid(), .cmdline = (char*)use_banner };
+  snap_proc_filter_t z = { .zombies = 1 };
+  pid_t pids[64];
   SNAPSHOT_LOG("now check all target process...\n");
-  #endif
-  ttt = alloc_printf("ps -ef | grep %s| grep -v grep| grep -v afl-fuzz",use_banner);
-  get_popen_result_no_return(ttt);
-  ck_free(ttt);
-  #ifdef SNAPSHOT_DEBUG
+  log_pids(pids, snap_proc_scan(&f, pids, 64));
   SNAPSHOT_LOG("now check all zombies...\n");
+  log_pids(pids, snap_proc_scan(&z, pids, 64));
   #endif
-  ttt = alloc_printf("ps -ef | grep \"<defunct>\" | grep -v grep");
-  get_popen_result_no_return(ttt);
-  ck_free(ttt);
 }
 
 void what_err_ret_mean(int ret)
@@ -1569,7 +2004,7 @@ int dump_afl_socket() {
   sres res = OK;
   // libsoccr requires that no packets flow in during the entire P/R process, so block iptables before suspending afl-socket
   // Accordingly, remember to unblock when exiting
-  system(iptables_add);
+  block_afl_port();
   #ifdef SNAPSHOT_DEBUG
   SNAPSHOT_LOG("forbid iptables\n");
   #endif
@@ -1593,7 +2028,7 @@ int dump_afl_socket() {
   #ifdef SNAPSHOT_DEBUG
   SNAPSHOT_LOG("save afl-socket OK\n");
   #endif
-  system(iptables_del);
+  unblock_afl_port();
   #ifdef SNAPSHOT_DEBUG
   SNAPSHOT_LOG("free iptables\n");
   #endif
@@ -1604,7 +2039,7 @@ int dump_afl_socket() {
 int restore_afl_socket() {
   if(net_protocol == PRO_UDP) return OK;
 
-  system(iptables_add);
+  block_afl_port();
   #ifdef SNAPSHOT_DEBUG
   SNAPSHOT_LOG("forbid iptables\n");
   #endif
@@ -1615,6 +2050,11 @@ int restore_afl_socket() {
   setsockopt(socket_fd,SOL_SOCKET,SO_REUSEADDR,&yes,sizeof(yes));
   setsockopt(socket_fd,SOL_SOCKET,SO_REUSEPORT,&yes,sizeof(yes));
 
+  struct timeval timeout;
+  timeout.tv_sec = 0;
+  timeout.tv_usec = socket_timeout_usecs;
+  setsockopt(socket_fd, SOL_SOCKET, SO_SNDTIMEO, (char *)&timeout, sizeof(timeout));
+
   so_rst = libsoccr_pause(socket_fd);
 
   // Set the local and peer addresses of the socket
@@ -1648,20 +2088,41 @@ int restore_afl_socket() {
   SNAPSHOT_LOG("restore afl-socket ok\n");
   #endif
 
-  system(iptables_del);
+  unblock_afl_port();
   #ifdef SNAPSHOT_DEBUG
   SNAPSHOT_LOG("free iptables\n");
   #endif
   return OK;
 err_out:
   close(socket_fd);
-  system(iptables_del);
+  unblock_afl_port();
   #ifdef SNAPSHOT_DEBUG
   SNAPSHOT_LOG("free iptables\n");
   #endif
   return RESTORE_AFL_FAILED;
 }
 
+/* Monitor BitVector state that belongs with the snapshot of the current
+   target state; saved before every dump, put back after every restore. */
+
+static void monitor_snapshot_restore(void) {
+
+  if (g_monitor && target_state_id < MAX_SNAPSHOTS && 
+      snapshot_metadata[target_state_id].valid) {
+      
+      SNAPSHOT_LOG("Restoring monitor state for snapshot %d\n", target_state_id);
+      if (monitor_restore_bitvectors(g_monitor, target_state_id))
+        SNAPSHOT_LOG("WARNING: Monitor has no state for snapshot %d\n", target_state_id);
+      
+      SNAPSHOT_LOG("Monitor state restored: message_count=%u, timestamp=%llu\n",
+                  snapshot_metadata[target_state_id].message_count,
+                  snapshot_metadata[target_state_id].timestamp);
+  } else {
+      SNAPSHOT_LOG("WARNING: No valid monitor state for snapshot %d\n", target_state_id);
+  }
+
+}
+
 s32 self_criu_restore()
 {
   #ifdef SNAPSHOT_DEBUG
@@ -1671,11 +2132,18 @@ s32 self_criu_restore()
   try_restore_count_current++;
   s32 fork_pid;
 
+  /* The dumped process is gone; whatever holds child_pid from here on is
+     CRIU's, so failure paths go by PID. */
+
+  track_child(0);
+
   #ifdef SNAPSHOT_DEBUG
   SNAPSHOT_LOG("Step I: try restore afl-socket\n");
   #endif
 
+  phase_enter(PH_SOCK_RESTORE);
   sres __res = restore_afl_socket();
+  phase_leave();
 
   if(__res>0){
     #ifdef SNAPSHOT_DEBUG
@@ -1697,98 +2165,297 @@ s32 self_criu_restore()
 
   /* Open image file */
   int img_fd;
-  u8 *temp = alloc_printf("snapshot_dir/state%d_images", target_state_id);
+  u8 *temp = snapshot_img_dir(target_state_id);
   img_fd = open(temp, O_DIRECTORY);
   if (img_fd < 0) {
     PFATAL("Can't open %s", temp);
   }
-  ck_free(temp);
+  ck_free(temp);
+
+    // Set the RESOTRE parameter
+    criu_init_opts();
+    criu_set_shell_job(true);
+    criu_set_log_level(CRIU_LOG_LEVEL);
+    criu_set_log_file("rst.log");
+    if (net_protocol == PRO_TCP) criu_set_tcp_established(true);
+    criu_set_images_dir_fd(img_fd);
+    criu_set_ext_unix_sk(true); 
+
+    #ifdef SNAPSHOT_DEBUG
+    SNAPSHOT_LOG("Step II: try criu_restore_child(), target state: %d\n",target_state_id);
+    #endif
+    is_restoring = 1;
+    fork_pid = criu_restore_child();
+    close(img_fd);
+
+    // Timeout failure
+    if(is_restoring==2){
+      #ifdef SNAPSHOT_DEBUG
+      SNAPSHOT_LOG("Timeout Fault\n");
+      #endif
+      #ifdef SNAPSHOT_DEBUG
+      SNAPSHOT_LOG("try kill -9 %d\n",child_pid);
+      #endif
+      clear_child();
+      clear_zombies();
+      if(!kill(child_pid,0)){
+        PFATAL("undead child!");
+      }
+      is_restoring = 0;
+      flush_afl_port();
+      #ifdef SNAPSHOT_DEBUG
+      SNAPSHOT_LOG("free iptables\n");
+      #endif
+      #ifdef SNAPSHOT_DEBUG
+      SNAPSHOT_LOG_LEAVE("self_criu_restore(Timeout Fault)");
+      #endif
+      return RESTORE_TIMEOUT;
+    }
+    is_restoring = 0;
+
+    // restore failure
+    if (fork_pid <= 0) {
+      #ifdef SNAPSHOT_DEBUG
+      SNAPSHOT_LOG("Restore Failed Fault\n");
+      #endif
+      what_err_ret_mean(fork_pid);
+      clear_child();
+      clear_zombies();
+      if(!kill(child_pid,0)){
+        PFATAL("undead child!");
+      }
+      flush_afl_port();
+      #ifdef SNAPSHOT_DEBUG
+      SNAPSHOT_LOG("free iptables\n");
+      #endif
+    #ifdef SNAPSHOT_DEBUG
+    SNAPSHOT_LOG_LEAVE("self_criu_restore(Restore Failed Fault)");
+    #endif
+    return RESTORE_FAILED;
+}
+
+  #ifdef SNAPSHOT_DEBUG
+  SNAPSHOT_LOG("restore child ok\n");
+  #endif
+  track_child(child_pid);
+  monitor_snapshot_restore();
+  restore_ok_count++;
+  restore_ok_count_current++;
+  #ifdef SNAPSHOT_DEBUG
+  SNAPSHOT_LOG_LEAVE("self_criu_restore()");
+  #endif
+  return OK;
+}
+
+static void add_trace_ref(u8 src, u32 idx, u32 off, u32 len) {
+
+  if (trace_refs_cnt == trace_refs_size) {
+    trace_refs_size = trace_refs_size ? trace_refs_size * 2 : 64;
+    trace_refs = ck_realloc(trace_refs, trace_refs_size * sizeof(struct trace_ref));
+  }
+
+  trace_refs[trace_refs_cnt].src = src;
+  trace_refs[trace_refs_cnt].idx = idx;
+  trace_refs[trace_refs_cnt].off = off;
+  trace_refs[trace_refs_cnt].len = len;
+  trace_refs_cnt++;
+
+}
+
+
+/* Bytes behind a trace_ref, from the buffers of the current execution. */
+
+static const u8* resolve_trace_ref(const struct trace_ref* r, u32* len) {
+
+  klist_t(lms)* list = NULL;
+  const char* buf = NULL;
+  u32 buf_size = 0;
+
+  switch (r->src) {
+    case TRACE_SRC_MSG:      list = kl_messages; break;
+    case TRACE_SRC_MSG_M1:   list = kl_messages_m1; break;
+    case TRACE_SRC_MSG_M23:  list = kl_messages_m2_m3; break;
+    case TRACE_SRC_RESP:     buf = response_buf; buf_size = response_buf_size; break;
+    case TRACE_SRC_RESP_M1:  buf = response_buf_m1; buf_size = response_buf_size_m1; break;
+    case TRACE_SRC_RESP_M23: buf = response_buf_m23; buf_size = response_buf_size_m23; break;
+  }
+
+  if (list) {
+    kliter_t(lms) *it;
+    u32 i = 0;
+    for (it = kl_begin(list); it != kl_end(list); it = kl_next(it), i++) {
+      if (i == r->idx) {
+        *len = kl_val(it)->msize;
+        return (const u8*)kl_val(it)->mdata;
+      }
+    }
+    return NULL;
+  }
+
+  if (!buf || r->off + r->len > buf_size) return NULL;
+  *len = r->len;
+  return (const u8*)buf + r->off;
+
+}
+
+
+/* Feed one message to the monitor, as a binary pred_record_t when the
+   adapter was generated against the spec and as a k=v line otherwise.
+   src/idx say where the message lives, for LTL_TRACE_REF. */
+
+static void emit_request_predicate(u8 src, u32 idx, const u8* buf, u32 len) {
+
+  if (!g_monitor_initialized || !g_monitor || !pred_adapter) return;
+
+  if (trace_by_ref) add_trace_ref(src, idx, 0, len);
+
+  if (pred_adapter->build_request_record) {
+    pred_record_t rec;
+    phase_enter(PH_PREDICATES);
+    pred_adapter->build_request_record(pred_ctx, buf, len, &rec);
+    phase_leave();
+    phase_enter(PH_MONITOR_EMIT);
+    monitor_emit_record(g_monitor, &rec);
+    phase_leave();
+  } else {
+    char pred_line[2048];
+    phase_enter(PH_PREDICATES);
+    pred_adapter->build_request(pred_ctx, buf, len, pred_line, sizeof(pred_line));
+    phase_leave();
+    phase_enter(PH_MONITOR_EMIT);
+    monitor_emit_line(g_monitor, pred_line);
+    phase_leave();
+  }
+
+}
+
+
+static void emit_response_message(u8 src, const u8* buf, u32 off, u32 len) {
+
+  if (trace_by_ref) add_trace_ref(src, 0, off, len);
+
+  if (pred_adapter->build_response_record) {
+    pred_record_t rec;
+    phase_enter(PH_PREDICATES);
+    pred_adapter->build_response_record(pred_ctx, buf, len, &rec);
+    phase_leave();
+    phase_enter(PH_MONITOR_EMIT);
+    monitor_emit_record(g_monitor, &rec);
+    phase_leave();
+  } else {
+    char pred_line[2048];
+    phase_enter(PH_PREDICATES);
+    pred_adapter->build_response(pred_ctx, buf, len, pred_line, sizeof(pred_line));
+    phase_leave();
+    phase_enter(PH_MONITOR_EMIT);
+    monitor_emit_line(g_monitor, pred_line);
+    phase_leave();
+  }
+
+}
+
+
+/* Feed the bytes one net_recv() appended at resp + off to the monitor, one
+   event per complete server message as framed by the adapter. A message
+   still incomplete at the end of the window waits for the next one. */
+
+static void emit_response_predicate(u8 src, const char* resp, u32 off, u32 len) {
+
+  const u8* msg;
+  u32 msg_len;
+  uint64_t msg_off;
+
+  if (!g_monitor_initialized || !g_monitor || !pred_adapter) return;
+
+  if (pred_adapter->response_framing == PRED_FRAME_NONE) {
+    emit_response_message(src, (const u8*)resp + off, off, len);
+    return;
+  }
+
+  pred_stream_feed(&resp_stream, (const u8*)resp + off, len);
+  while (pred_stream_next(&resp_stream, &msg, &msg_len, &msg_off))
+    emit_response_message(src, msg, msg_off, msg_len);
+
+}
+
+
+/* End of a connection: whatever partial message is left goes out as is. */
+
+static void flush_response_predicates(u8 src) {
+
+  const u8* msg;
+  u32 msg_len;
+  uint64_t msg_off;
+
+  if (!g_monitor_initialized || !g_monitor || !pred_adapter) return;
+
+  if (pred_stream_flush(&resp_stream, &msg, &msg_len, &msg_off))
+    emit_response_message(src, msg, msg_off, msg_len);
+
+}
+
+/* Adaptive response waits. The first-byte wait of each net_recv() comes
+   from the latency sketches of the state the server is in (as its last
+   response said) and of the message position; see LAT_* in config.h. */
+
+static u8 adaptive_wait = 1;                  /* off with AFL_NO_ADAPTIVE_WAIT */
+static lat_sketch_t pos_latency[LAT_POSITIONS];
+static u32 recv_state, recv_state_m1;         /* server state, after M1     */
+static u32 recv_waits;
+
+static int net_recv_adaptive(int sockfd, struct timeval timeout, u32 pos,
+                             char **buf, unsigned int *len) {
+
+  lat_sketch_t *ps = &pos_latency[MIN(pos, LAT_POSITIONS - 1)], *ss = NULL;
+  u32 wait = poll_wait_msecs, start = *len, q = 0, state_count;
+  unsigned int *state_sequence;
+  u8 probe;
+  state_info_t *state;
+  int res;
+
+  if (!adaptive_wait)
+    return net_recv(sockfd, timeout, poll_wait_msecs, buf, len);
+
+  state = get_state(recv_state);
+  if (state) ss = &state->latency;
+
+  probe = !(++recv_waits % LAT_PROBE_EVERY) ||
+          (ps->count < LAT_MIN_SAMPLES && (!ss || ss->count < LAT_MIN_SAMPLES));
+
+  if (!probe) {
+    if (ps->count >= LAT_MIN_SAMPLES) q = lat_sketch_quantile(ps, LAT_QUANTILE_PCT);
+    if (ss && ss->count >= LAT_MIN_SAMPLES)
+      q = MAX(q, lat_sketch_quantile(ss, LAT_QUANTILE_PCT));
+    wait = MIN(wait, (u64)q * LAT_MARGIN / 1000 + 1);
+  }
 
-    // Set the RESOTRE parameter
-    criu_init_opts();
-    criu_set_shell_job(true);
-    criu_set_log_level(4);
-    criu_set_log_file("rst.log");
-    if (net_protocol == PRO_TCP) criu_set_tcp_established(true);
-    criu_set_images_dir_fd(img_fd);
-    criu_set_ext_unix_sk(true); 
+  res = net_recv(sockfd, timeout, wait, buf, len);
 
-    #ifdef SNAPSHOT_DEBUG
-    SNAPSHOT_LOG("Step II: try criu_restore_child(), target state: %d\n",target_state_id);
-    #endif
-    is_restoring = 1;
-    fork_pid = criu_restore_child();
-    close(img_fd);
+  /* Nothing within the learned cut: the server may just be slower than the
+     quantile says. Wait out the rest of the full budget before giving up,
+     and let the sketches see how late it was. */
 
-    // Timeout failure
-    if(is_restoring==2){
-      #ifdef SNAPSHOT_DEBUG
-      SNAPSHOT_LOG("Timeout Fault\n");
-      #endif
-      #ifdef SNAPSHOT_DEBUG
-      SNAPSHOT_LOG("try kill -9 %d\n",child_pid);
-      #endif
-      clear_child();
-      clear_zombies();
-      if(!kill(child_pid,0)){
-        PFATAL("undead child!");
-      }
-      is_restoring = 0;
-      system("iptables -t filter -F OUTPUT");
-      system("iptables -t filter -F INPUT");
-      #ifdef SNAPSHOT_DEBUG
-      SNAPSHOT_LOG("free iptables\n");
-      #endif
-      #ifdef SNAPSHOT_DEBUG
-      SNAPSHOT_LOG_LEAVE("self_criu_restore(Timeout Fault)");
-      #endif
-      return RESTORE_TIMEOUT;
+  if (!res && *len == start && wait < poll_wait_msecs) {
+    res = net_recv(sockfd, timeout, poll_wait_msecs - wait, buf, len);
+    if (net_recv_first_us != UINT32_MAX) {
+      net_recv_first_us += wait * 1000;
+      probe = 1;
     }
-    is_restoring = 0;
+  }
 
-    // restore failure
-    if (fork_pid <= 0) {
-      #ifdef SNAPSHOT_DEBUG
-      SNAPSHOT_LOG("Restore Failed Fault\n");
-      #endif
-      what_err_ret_mean(fork_pid);
-      clear_child();
-      clear_zombies();
-      if(!kill(child_pid,0)){
-        PFATAL("undead child!");
-      }
-      system("iptables -t filter -F OUTPUT");
-      system("iptables -t filter -F INPUT");
-      #ifdef SNAPSHOT_DEBUG
-      SNAPSHOT_LOG("free iptables\n");
-      #endif
-    #ifdef SNAPSHOT_DEBUG
-    SNAPSHOT_LOG_LEAVE("self_criu_restore(Restore Failed Fault)");
-    #endif
-    return RESTORE_FAILED;
-}
+  if (*len <= start) return res;
 
-  #ifdef SNAPSHOT_DEBUG
-  SNAPSHOT_LOG("restore child ok\n");
-  #endif
-  if (g_monitor && target_state_id < MAX_SNAPSHOTS && 
-      snapshot_metadata[target_state_id].valid) {
-      
-      SNAPSHOT_LOG("Restoring monitor state for snapshot %d\n", target_state_id);
-      monitor_restore_bitvectors(g_monitor, target_state_id);
-      
-      SNAPSHOT_LOG("Monitor state restored: message_count=%u, timestamp=%llu\n",
-                  snapshot_metadata[target_state_id].message_count,
-                  snapshot_metadata[target_state_id].timestamp);
-  } else {
-      SNAPSHOT_LOG("WARNING: No valid monitor state for snapshot %d\n", target_state_id);
+  if (probe && net_recv_first_us != UINT32_MAX) {
+    lat_sketch_add(ps, net_recv_first_us);
+    if (ss) lat_sketch_add(ss, net_recv_first_us);
   }
-  restore_ok_count++;
-  restore_ok_count_current++;
-  #ifdef SNAPSHOT_DEBUG
-  SNAPSHOT_LOG_LEAVE("self_criu_restore()");
-  #endif
-  return OK;
+
+  state_sequence = (*extract_response_codes)((u8 *)*buf + start, *len - start, &state_count);
+  if (state_count > 1) recv_state = state_sequence[state_count - 1];
+  ck_free(state_sequence);
+
+  return res;
+
 }
 
 int send_over_network_m1()
@@ -1820,6 +2487,9 @@ int send_over_network_m1()
     response_bytes = NULL;
   }
 
+  trace_refs_cnt = 0;
+  pred_stream_reset(&resp_stream, 0);
+
   //Clear the response buffer and reset the response buffer size
   if (response_buf_m1) {
     ck_free(response_buf_m1);
@@ -1932,16 +2602,12 @@ int send_over_network_m1()
   #endif
 
   //retrieve early server response if needed
-  if (net_recv(sockfd, timeout, poll_wait_msecs, &response_buf_m1, &response_buf_size_m1)) PFATAL("send_over_network_m1 retrieve early server response error");
+  recv_state = 0;
+  if (net_recv_adaptive(sockfd, timeout, 0, &response_buf_m1, &response_buf_size_m1)) PFATAL("send_over_network_m1 retrieve early server response error");
   //retrieve early server response if needed
    // Emit predicate for server banner/greeting
-    if (g_monitor_initialized && g_monitor && build_response_pred_line
-        && response_buf_size_m1 > 0) {
-        char pred_line[2048];
-        build_response_pred_line(
-            (const unsigned char *)response_buf_m1, response_buf_size_m1,
-            pred_line, sizeof(pred_line));
-        monitor_emit_line(g_monitor, pred_line);
+    if (response_buf_size_m1 > 0) {
+        emit_response_predicate(TRACE_SRC_RESP_M1, response_buf_m1, 0, response_buf_size_m1);
     }
   #ifdef SNAPSHOT_DEBUG
   SNAPSHOT_LOG("retrieve early server response finished\n");
@@ -1956,12 +2622,7 @@ int send_over_network_m1()
     for (it = kl_begin(kl_messages_m1); it != kl_end(kl_messages_m1); it = kl_next(it)) {
 
     // Emit request predicate BEFORE sending
-    if (g_monitor_initialized && g_monitor && build_request_pred_line) {
-        char pred_line[2048];
-        build_request_pred_line(kl_val(it)->mdata, kl_val(it)->msize,
-                                pred_line, sizeof(pred_line));
-        monitor_emit_line(g_monitor, pred_line);
-    }
+    emit_request_predicate(TRACE_SRC_MSG_M1, messages_sent_m1, kl_val(it)->mdata, kl_val(it)->msize);
 
     n = net_send(sockfd, timeout, kl_val(it)->mdata, kl_val(it)->msize);
     messages_sent_m1++;
@@ -1982,7 +2643,7 @@ int send_over_network_m1()
     // Track previous size BEFORE recv
     u32 prev_buf_size_m1 = response_buf_size_m1;           // ← uncommented, correct variable
 
-    if (net_recv(sockfd, timeout, poll_wait_msecs, &response_buf_m1, &response_buf_size_m1)) {
+    if (net_recv_adaptive(sockfd, timeout, messages_sent_m1, &response_buf_m1, &response_buf_size_m1)) {
       #ifdef SNAPSHOT_DEBUG
       SNAPSHOT_LOG("send_over_network_m1 recv error\n");
       #endif
@@ -1994,19 +2655,17 @@ int send_over_network_m1()
     #endif
 
     // Emit response predicate AFTER receiving
-    if (g_monitor_initialized && g_monitor && build_response_pred_line
-        && response_buf_size_m1 > prev_buf_size_m1) {      // ← m1 buffers
-        char pred_line[2048];
-        build_response_pred_line(
-            (const unsigned char *)response_buf_m1 + prev_buf_size_m1,  // ← m1 buffer
-            response_buf_size_m1 - prev_buf_size_m1,                    // ← m1 size
-            pred_line, sizeof(pred_line));
-        monitor_emit_line(g_monitor, pred_line);
+    if (response_buf_size_m1 > prev_buf_size_m1) {      // ← m1 buffers
+        emit_response_predicate(TRACE_SRC_RESP_M1, response_buf_m1, prev_buf_size_m1,  // ← m1 buffer
+                                response_buf_size_m1 - prev_buf_size_m1);              // ← m1 size
     }
 
     response_bytes_m1[messages_sent_m1 - 1] = response_buf_size_m1;
   }
 
+  flush_response_predicates(TRACE_SRC_RESP_M1);
+  recv_state_m1 = recv_state;
+
   // zero-recovery failure
   if(response_buf_size_m1==0){
     #ifdef SNAPSHOT_DEBUG
@@ -2054,6 +2713,7 @@ int send_over_network_m1()
   response_bytes = (u32 *)ck_realloc(response_bytes, messages_sent_m1 * sizeof(u32));
   return OK;
 HANDLE_RESPONSES_M1:
+  flush_response_predicates(TRACE_SRC_RESP_M1);
 
   net_recv(sockfd, timeout, poll_wait_msecs, &response_buf_m1, &response_buf_size_m1);
 
@@ -2078,10 +2738,8 @@ HANDLE_RESPONSES_M1:
   response_bytes = (u32 *)ck_realloc(response_bytes, messages_sent_m1 * sizeof(u32));
 
   //wait a bit letting the server to complete its remaining task(s)
-  memset(session_virgin_bits, 255, MAP_SIZE);
-  while (1) {
-    if (has_new_bits(session_virgin_bits) != 2) break;
-  }
+  if (bm_ops.reset_virgin(trace_bits, session_virgin_bits, MAP_SIZE) == 2)
+    while (has_new_bits(session_virgin_bits) == 2);
 
   if (terminate_child && (child_pid > 0)) {
     #ifdef SNAPSHOT_DEBUG
@@ -2163,6 +2821,12 @@ int send_over_network_m23()
     response_bytes = NULL;
   }
 
+  //Events of the previous M2/M3 run are gone, the M1 prefix was restored
+  while (trace_refs_cnt &&
+         trace_refs[trace_refs_cnt - 1].src != TRACE_SRC_MSG_M1 &&
+         trace_refs[trace_refs_cnt - 1].src != TRACE_SRC_RESP_M1)
+    trace_refs_cnt--;
+
   //Clear the response buffer and reset the response buffer size
   if (response_buf_m23) {
     ck_free(response_buf_m23);
@@ -2189,6 +2853,7 @@ int send_over_network_m23()
   #ifdef SNAPSHOT_DEBUG
   SNAPSHOT_LOG("response_buf_size_m23 = response_buf_size_m1;\n");
   #endif
+  pred_stream_reset(&resp_stream, response_buf_size_m23);
 
   response_bytes_m23 = (u32 *)ck_realloc(response_bytes_m23, messages_sent_m1 * sizeof(u32));
 
@@ -2201,14 +2866,10 @@ int send_over_network_m23()
   SNAPSHOT_LOG("start to write request messages and recv response\n");
   #endif
   int m23_count = 0;
+  recv_state = recv_state_m1;
   for (it = kl_begin(kl_messages_m2_m3); it != kl_end(kl_messages_m2_m3); it = kl_next(it)) {
     m23_count++;
-      if (g_monitor_initialized && g_monitor && build_request_pred_line) {
-        char pred_line[2048];
-        build_request_pred_line(kl_val(it)->mdata, kl_val(it)->msize,
-                                pred_line, sizeof(pred_line));
-        monitor_emit_line(g_monitor, pred_line);
-    }
+    emit_request_predicate(TRACE_SRC_MSG_M23, m23_count - 1, kl_val(it)->mdata, kl_val(it)->msize);
     n = net_send(sockfd, timeout, kl_val(it)->mdata, kl_val(it)->msize);
     // #ifdef SNAPSHOT_DEBUG
     // SNAPSHOT_LOG("send message mdata:%s, msize:%d \n",kl_val(it)->mdata, kl_val(it)->msize);
@@ -2231,7 +2892,7 @@ int send_over_network_m23()
 
     //retrieve server response
     u32 prev_buf_size = response_buf_size_m23;
-    if (net_recv(sockfd, timeout, poll_wait_msecs, &response_buf_m23, &response_buf_size_m23)) {
+    if (net_recv_adaptive(sockfd, timeout, messages_sent_m23, &response_buf_m23, &response_buf_size_m23)) {
       #ifdef SNAPSHOT_DEBUG
       SNAPSHOT_LOG("recv response %d error\n",messages_sent_m23);
       #endif
@@ -2240,14 +2901,9 @@ int send_over_network_m23()
     #ifdef SNAPSHOT_DEBUG
     SNAPSHOT_LOG("recv response %d ok\n",messages_sent_m23);
     #endif
-    if (g_monitor_initialized && g_monitor && build_response_pred_line
-        && response_buf_size_m23 > prev_buf_size) {
-        char pred_line[2048];
-        build_response_pred_line(
-            (const unsigned char *)response_buf_m23 + prev_buf_size,
-            response_buf_size_m23 - prev_buf_size,
-            pred_line, sizeof(pred_line));
-        monitor_emit_line(g_monitor, pred_line);
+    if (response_buf_size_m23 > prev_buf_size) {
+        emit_response_predicate(TRACE_SRC_RESP_M23, response_buf_m23, prev_buf_size,
+                                response_buf_size_m23 - prev_buf_size);
     }
     //Update accumulated response buffer size
     response_bytes_m23[messages_sent_m23 - 1] = response_buf_size_m23;
@@ -2273,10 +2929,11 @@ HANDLE_RESPONSES:
   #ifdef SNAPSHOT_DEBUG
   SNAPSHOT_LOG("now HANDLE_RESPONSES\n");
   #endif
+  flush_response_predicates(TRACE_SRC_RESP_M23);
 
-  net_recv(sockfd, timeout, poll_wait_msecs, &response_buf_m23, &response_buf_size_m23);
+  net_recv_adaptive(sockfd, timeout, messages_sent_m23, &response_buf_m23, &response_buf_size_m23);
   #ifdef SNAPSHOT_DEBUG
-  SNAPSHOT_LOG("net_recv(sockfd, timeout, poll_wait_msecs, &response_buf_m23, &response_buf_size_m23); OK\n");
+  SNAPSHOT_LOG("net_recv_adaptive(sockfd, timeout, messages_sent_m23, &response_buf_m23, &response_buf_size_m23); OK\n");
   #endif
 
   if (messages_sent_m23 > 0 && response_bytes_m23 != NULL) {
@@ -2303,17 +2960,23 @@ HANDLE_RESPONSES:
   messages_sent = messages_sent_m23;
 
   //wait a bit letting the server to complete its remaining task(s)
-  memset(session_virgin_bits, 255, MAP_SIZE);
-  while (1) {
-    if (has_new_bits(session_virgin_bits) != 2) break;
-  }
+  if (bm_ops.reset_virgin(trace_bits, session_virgin_bits, MAP_SIZE) == 2)
+    while (has_new_bits(session_virgin_bits) == 2);
 
   #ifdef SNAPSHOT_DEBUG
   check_process();
   #endif
 
   int status = 0;
-  if (likely_buggy && false_negative_reduction) {
+  if (fork_snapshot) {
+    /* The child belongs to the parked target, which reports its status. */
+    if (!(likely_buggy && false_negative_reduction) && terminate_child && (child_pid > 0))
+      kill(child_pid, SIGTERM);
+    if (fork_snapshot_recv((u32*)&status, NULL, -1)) {
+      status = 0;
+      fork_snapshot_drop();
+    }
+  } else if (likely_buggy && false_negative_reduction) {
     #ifdef SNAPSHOT_DEBUG
     SNAPSHOT_LOG("likely_buggy && false_negative_reduction, so I'll waitpid(child_pid, &status, 0)\n");
     #endif
@@ -2379,6 +3042,9 @@ int send_over_network()
     response_bytes = NULL;
   }
 
+  trace_refs_cnt = 0;
+  pred_stream_reset(&resp_stream, 0);
+
   #ifdef SNAPSHOT_DEBUG
   SNAPSHOT_LOG("clear the response buffer and reset the response buffer size\n");
   #endif
@@ -2450,20 +3116,16 @@ int send_over_network()
   #endif
 
   //retrieve early server response if needed
-  if (net_recv(sockfd, timeout, poll_wait_msecs, &response_buf, &response_buf_size)) {
+  recv_state = 0;
+  if (net_recv_adaptive(sockfd, timeout, 0, &response_buf, &response_buf_size)) {
     #ifdef SNAPSHOT_DEBUG
     SNAPSHOT_LOG("retrieve early server response error\n");
     #endif
     goto HANDLE_RESPONSES;
   }
-  if (g_monitor_initialized && g_monitor && build_response_pred_line
-        && response_buf_size > 0) {
-        char pred_line[2048];
-        build_response_pred_line(
-            (const unsigned char *)response_buf, response_buf_size,
-            pred_line, sizeof(pred_line));
-        monitor_emit_line(g_monitor, pred_line);
-    }
+  if (response_buf_size > 0) {
+      emit_response_predicate(TRACE_SRC_RESP, response_buf, 0, response_buf_size);
+  }
   //write the request messages
   kliter_t(lms) *it;
   messages_sent = 0;
@@ -2474,12 +3136,7 @@ int send_over_network()
   for (it = kl_begin(kl_messages); it != kl_end(kl_messages); it = kl_next(it)) {
 
     // Emit request predicate BEFORE sending
-    if (g_monitor_initialized && g_monitor && build_request_pred_line) {
-        char pred_line[2048];
-        build_request_pred_line(kl_val(it)->mdata, kl_val(it)->msize,
-                                pred_line, sizeof(pred_line));
-        monitor_emit_line(g_monitor, pred_line);
-    }
+    emit_request_predicate(TRACE_SRC_MSG, messages_sent, kl_val(it)->mdata, kl_val(it)->msize);
 
     n = net_send(sockfd, timeout, kl_val(it)->mdata, kl_val(it)->msize);
     messages_sent++;
@@ -2497,7 +3154,7 @@ int send_over_network()
 
     //retrieve server response
     u32 prev_buf_size = response_buf_size;
-    if (net_recv(sockfd, timeout, poll_wait_msecs, &response_buf, &response_buf_size)) {
+    if (net_recv_adaptive(sockfd, timeout, messages_sent, &response_buf, &response_buf_size)) {
       goto HANDLE_RESPONSES;
     }
     #ifdef SNAPSHOT_DEBUG
@@ -2505,14 +3162,9 @@ int send_over_network()
     #endif
 
     // Emit response predicate AFTER receiving
-    if (g_monitor_initialized && g_monitor && build_response_pred_line
-        && response_buf_size > prev_buf_size) {
-        char pred_line[2048];
-        build_response_pred_line(
-            (const unsigned char *)response_buf + prev_buf_size,
-            response_buf_size - prev_buf_size,
-            pred_line, sizeof(pred_line));
-        monitor_emit_line(g_monitor, pred_line);
+    if (response_buf_size > prev_buf_size) {
+        emit_response_predicate(TRACE_SRC_RESP, response_buf, prev_buf_size,
+                                response_buf_size - prev_buf_size);
     }
 
     //Update accumulated response buffer size
@@ -2525,9 +3177,10 @@ int send_over_network()
   }
 
 HANDLE_RESPONSES:
-  net_recv(sockfd, timeout, poll_wait_msecs, &response_buf, &response_buf_size);
+  flush_response_predicates(TRACE_SRC_RESP);
+  net_recv_adaptive(sockfd, timeout, messages_sent, &response_buf, &response_buf_size);
   #ifdef SNAPSHOT_DEBUG
-  SNAPSHOT_LOG("net_recv(sockfd, timeout, poll_wait_msecs, &response_buf, &response_buf_size); OK\n");
+  SNAPSHOT_LOG("net_recv_adaptive(sockfd, timeout, messages_sent, &response_buf, &response_buf_size); OK\n");
   #endif
 
   if (messages_sent > 0 && response_bytes != NULL) {
@@ -2535,10 +3188,8 @@ HANDLE_RESPONSES:
   }
  
   //wait a bit letting the server to complete its remaining task(s)
-  memset(session_virgin_bits, 255, MAP_SIZE);
-  while(1) {
-    if (has_new_bits(session_virgin_bits) != 2) break;
-  }
+  if (bm_ops.reset_virgin(trace_bits, session_virgin_bits, MAP_SIZE) == 2)
+    while (has_new_bits(session_virgin_bits) == 2);
 
   close(sockfd);
   #ifdef SNAPSHOT_DEBUG
@@ -2871,6 +3522,37 @@ static u8* DF(double val) {
 }
 
 
+/* Describe a duration in nanoseconds. */
+
+static u8* DNS(u64 val) {
+
+  static u8 tmp[12][16];
+  static u8 cur;
+
+  cur = (cur + 1) % 12;
+
+  /* 0-999 ns */
+  CHK_FORMAT(1, 1000, "%llu ns", u64);
+
+  /* 1.0 us - 99.9 us */
+  CHK_FORMAT(1000, 99.95, "%0.01f us", double);
+
+  /* 100 us - 999 us */
+  CHK_FORMAT(1000, 1000, "%llu us", u64);
+
+  /* 1.0 ms - 99.9 ms */
+  CHK_FORMAT(1000 * 1000, 99.95, "%0.01f ms", double);
+
+  /* 100 ms - 999 ms */
+  CHK_FORMAT(1000 * 1000, 1000, "%llu ms", u64);
+
+  /* 1.0 s+ */
+  sprintf(tmp[cur], "%0.01f s", ((double)val) / 1e9);
+  return tmp[cur];
+
+}
+
+
 /* Describe integer as memory size. */
 
 static u8* DMS(u64 val) {
@@ -3162,12 +3844,7 @@ static void add_to_queue(u8* fname, u32 len, u8 passed_det) {
   last_path_time = get_cur_time();
 
   //Add a new column to the was_fuzzed map
-  if (fuzzed_map_states) {
-    expand_was_fuzzed_map(0, 1);
-  } else {
-    //Also add a new row (for state 0) if needed
-    expand_was_fuzzed_map(1, 1);
-  }
+  expand_was_fuzzed_map(state_ids_count, queued_paths);
 }
 
 
@@ -3199,24 +3876,19 @@ EXP_ST void destroy_queue(void) {
 // show every state infomation
 void show_states_info(void)
 {
-  khint_t k;
   state_info_t *state;
   int i;
   for (i = 0; i < state_ids_count; i++) {
-    u32 state_id = state_ids[i];
-    k = kh_get(hms, khms_states, state_id);
-    if (k != kh_end(khms_states)) {
-      state = kh_val(khms_states, k);
-      ACTF("Now the state is %d", state_id);
-      ACTF("\t is_covered:%d", state->is_covered);
-      ACTF("\t paths:%d", state->paths);
-      ACTF("\t paths_discovered:%d", state->paths_discovered);
-      ACTF("\t selected_times:%d", state->selected_times);
-      ACTF("\t fuzzs:%d", state->fuzzs);
-      ACTF("\t score:%d", state->score);
-      ACTF("\t selected_seed_index:%d", state->selected_seed_index);
-      ACTF("\t seeds_count:%d", state->seeds_count);
-    }
+    state = &state_table[i];
+    ACTF("Now the state is %d", state->id);
+    ACTF("\t is_covered:%d", state->is_covered);
+    ACTF("\t paths:%d", state->paths);
+    ACTF("\t paths_discovered:%d", state->paths_discovered);
+    ACTF("\t selected_times:%d", state->selected_times);
+    ACTF("\t fuzzs:%d", state->fuzzs);
+    ACTF("\t score:%d", state->score);
+    ACTF("\t selected_seed_index:%d", state->selected_seed_index);
+    ACTF("\t seeds_count:%d", state->seeds_count);
   }
 }
 
@@ -3232,362 +3904,128 @@ EXP_ST void write_bitmap(void) {
   if (!bitmap_changed) return;
   bitmap_changed = 0;
 
-  fname = alloc_printf("%s/fuzz_bitmap", out_dir);
-  fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC, 0600);
-
-  if (fd < 0) PFATAL("Unable to open '%s'", fname);
-
-  ck_write(fd, virgin_bits, MAP_SIZE, fname);
-
-  close(fd);
-  ck_free(fname);
-
-}
-
-
-/* Read bitmap from file. This is for the -B option again. */
-
-EXP_ST void read_bitmap(u8* fname) {
-
-  s32 fd = open(fname, O_RDONLY);
-
-  if (fd < 0) PFATAL("Unable to open '%s'", fname);
-
-  ck_read(fd, virgin_bits, MAP_SIZE, fname);
-
-  close(fd);
-
-}
-
-
-/* Check if the current execution path brings anything new to the table.
-   Update virgin bits to reflect the finds. Returns 1 if the only change is
-   the hit-count for a particular tuple; 2 if there are new tuples seen.
-   Updates the map, so subsequent calls will always return 0.
-
-   This function is called after every exec() on a fairly large buffer, so
-   it needs to be fast. We do this in 32-bit and 64-bit flavors. */
-
-static inline u8 has_new_bits(u8* virgin_map) {
-
-#ifdef WORD_SIZE_64
-
-  u64* current = (u64*)trace_bits;
-  u64* virgin  = (u64*)virgin_map;
-
-  u32  i = (MAP_SIZE >> 3);
-
-#else
-
-  u32* current = (u32*)trace_bits;
-  u32* virgin  = (u32*)virgin_map;
-
-  u32  i = (MAP_SIZE >> 2);
-
-#endif /* ^WORD_SIZE_64 */
-
-  u8   ret = 0;
-
-  while (i--) {
-
-    /* Optimize for (*current & *virgin) == 0 - i.e., no bits in current bitmap
-       that have not been already cleared from the virgin map - since this will
-       almost always be the case. */
-
-    if (unlikely(*current) && unlikely(*current & *virgin)) {
-
-      if (likely(ret < 2)) {
-
-        u8* cur = (u8*)current;
-        u8* vir = (u8*)virgin;
-
-        /* Looks like we have not found any new bytes yet; see if any non-zero
-           bytes in current[] are pristine in virgin[]. */
-
-#ifdef WORD_SIZE_64
-
-        if ((cur[0] && vir[0] == 0xff) || (cur[1] && vir[1] == 0xff) ||
-          (cur[2] && vir[2] == 0xff) || (cur[3] && vir[3] == 0xff) ||
-          (cur[4] && vir[4] == 0xff) || (cur[5] && vir[5] == 0xff) ||
-          (cur[6] && vir[6] == 0xff) || (cur[7] && vir[7] == 0xff)) ret = 2;
-        else ret = 1;
-
-#else
-
-        if ((cur[0] && vir[0] == 0xff) || (cur[1] && vir[1] == 0xff) ||
-          (cur[2] && vir[2] == 0xff) || (cur[3] && vir[3] == 0xff)) ret = 2;
-        else ret = 1;
-
-#endif /* ^WORD_SIZE_64 */
-
-      }
-
-      *virgin &= ~*current;
-
-    }
-
-    current++;
-    virgin++;
-
-  }
-
-  if (ret && virgin_map == virgin_bits) bitmap_changed = 1;
-
-  return ret;
-
-}
-
-
-/* Count the number of bits set in the provided bitmap. Used for the status
-   screen several times every second, does not have to be fast. */
-
-static u32 count_bits(u8* mem) {
-
-  u32* ptr = (u32*)mem;
-  u32  i   = (MAP_SIZE >> 2);
-  u32  ret = 0;
-
-  while (i--) {
-
-    u32 v = *(ptr++);
-
-    /* This gets called on the inverse, virgin bitmap; optimize for sparse
-       data. */
-
-    if (v == 0xffffffff) {
-      ret += 32;
-      continue;
-    }
-
-    v -= ((v >> 1) & 0x55555555);
-    v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
-    ret += (((v + (v >> 4)) & 0xF0F0F0F) * 0x01010101) >> 24;
-
-  }
-
-  return ret;
-
-}
-
-
-#define FF(_b)  (0xff << ((_b) << 3))
-
-/* Count the number of bytes set in the bitmap. Called fairly sporadically,
-   mostly to update the status screen or calibrate and examine confirmed
-   new paths. */
-
-static u32 count_bytes(u8* mem) {
-
-  u32* ptr = (u32*)mem;
-  u32  i   = (MAP_SIZE >> 2);
-  u32  ret = 0;
-
-  while (i--) {
-
-    u32 v = *(ptr++);
-
-    if (!v) continue;
-    if (v & FF(0)) ret++;
-    if (v & FF(1)) ret++;
-    if (v & FF(2)) ret++;
-    if (v & FF(3)) ret++;
-
-  }
-
-  return ret;
-
-}
-
-
-/* Count the number of non-255 bytes set in the bitmap. Used strictly for the
-   status screen, several calls per second or so. */
-
-static u32 count_non_255_bytes(u8* mem) {
-
-  u32* ptr = (u32*)mem;
-  u32  i   = (MAP_SIZE >> 2);
-  u32  ret = 0;
-
-  while (i--) {
-
-    u32 v = *(ptr++);
-
-    /* This is called on the virgin bitmap, so optimize for the most likely
-       case. */
-
-    if (v == 0xffffffff) continue;
-    if ((v & FF(0)) != FF(0)) ret++;
-    if ((v & FF(1)) != FF(1)) ret++;
-    if ((v & FF(2)) != FF(2)) ret++;
-    if ((v & FF(3)) != FF(3)) ret++;
-
-  }
-
-  return ret;
-
-}
-
-
-/* Destructively simplify trace by eliminating hit count information
-   and replacing it with 0x80 or 0x01 depending on whether the tuple
-   is hit or not. Called on every new crash or timeout, should be
-   reasonably fast. */
-
-static const u8 simplify_lookup[256] = {
-
-  [0]         = 1,
-  [1 ... 255] = 128
-
-};
+  fname = alloc_printf("%s/fuzz_bitmap", out_dir);
+  fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC, 0600);
 
-#ifdef WORD_SIZE_64
+  if (fd < 0) PFATAL("Unable to open '%s'", fname);
 
-static void simplify_trace(u64* mem) {
+  ck_write(fd, virgin_bits, MAP_SIZE, fname);
 
-  u32 i = MAP_SIZE >> 3;
+  close(fd);
+  ck_free(fname);
 
-  while (i--) {
+}
 
-    /* Optimize for sparse bitmaps. */
 
-    if (unlikely(*mem)) {
+/* Read bitmap from file. This is for the -B option again. */
 
-      u8* mem8 = (u8*)mem;
+EXP_ST void read_bitmap(u8* fname) {
 
-      mem8[0] = simplify_lookup[mem8[0]];
-      mem8[1] = simplify_lookup[mem8[1]];
-      mem8[2] = simplify_lookup[mem8[2]];
-      mem8[3] = simplify_lookup[mem8[3]];
-      mem8[4] = simplify_lookup[mem8[4]];
-      mem8[5] = simplify_lookup[mem8[5]];
-      mem8[6] = simplify_lookup[mem8[6]];
-      mem8[7] = simplify_lookup[mem8[7]];
+  s32 fd = open(fname, O_RDONLY);
 
-    } else *mem = 0x0101010101010101ULL;
+  if (fd < 0) PFATAL("Unable to open '%s'", fname);
 
-    mem++;
+  ck_read(fd, virgin_bits, MAP_SIZE, fname);
 
-  }
+  close(fd);
 
 }
 
-#else
-
-static void simplify_trace(u32* mem) {
 
-  u32 i = MAP_SIZE >> 2;
+/* Check if the current execution path brings anything new to the table.
+   Update virgin bits to reflect the finds. Returns 1 if the only change is
+   the hit-count for a particular tuple; 2 if there are new tuples seen.
+   Updates the map, so subsequent calls will always return 0.
 
-  while (i--) {
+   This function is called after every exec() on a fairly large buffer, so
+   it needs to be fast. The sweep is one of the bm_ops kernels; for
+   virgin_bits, classify_counts() has already told us whether there is
+   anything left to find. */
 
-    /* Optimize for sparse bitmaps. */
+static inline u8 has_new_bits(u8* virgin_map) {
 
-    if (unlikely(*mem)) {
+  u8 ret;
 
-      u8* mem8 = (u8*)mem;
+  if (virgin_map == virgin_bits && !trace_hits_virgin) return 0;
 
-      mem8[0] = simplify_lookup[mem8[0]];
-      mem8[1] = simplify_lookup[mem8[1]];
-      mem8[2] = simplify_lookup[mem8[2]];
-      mem8[3] = simplify_lookup[mem8[3]];
+  ret = bm_ops.has_new_bits(trace_bits, virgin_map, MAP_SIZE);
 
-    } else *mem = 0x01010101;
+  if (ret && virgin_map == virgin_bits) bitmap_changed = 1;
 
-    mem++;
-  }
+  return ret;
 
 }
 
-#endif /* ^WORD_SIZE_64 */
 
+/* Same as has_new_bits(), but for the property-automaton map the LTL monitor
+   fills in (see monitor_bridge.h). Only new edges count; hit-count changes
+   of known ones are too noisy to keep inputs for. */
 
-/* Destructively classify execution counts in a trace. This is used as a
-   preprocessing step for any newly acquired traces. Called on every exec,
-   must be fast. */
+static inline u8 has_new_monitor_bits(void) {
 
-static const u8 count_class_lookup8[256] = {
+  u8* cov = monitor_coverage(g_monitor);
 
-  [0]           = 0,
-  [1]           = 1,
-  [2]           = 2,
-  [3]           = 4,
-  [4 ... 7]     = 8,
-  [8 ... 15]    = 16,
-  [16 ... 31]   = 32,
-  [32 ... 127]  = 64,
-  [128 ... 255] = 128
+  if (!g_monitor_initialized || !cov) return 0;
 
-};
+  return bm_ops.has_new_bits(cov, virgin_monitor, MONITOR_MAP_SIZE) == 2;
 
-static u16 count_class_lookup16[65536];
+}
 
 
-EXP_ST void init_count_class16(void) {
+/* Count the number of bits set in the provided bitmap. Used for the status
+   screen several times every second, does not have to be fast. */
 
-  u32 b1, b2;
+static u32 count_bits(u8* mem) {
 
-  for (b1 = 0; b1 < 256; b1++)
-    for (b2 = 0; b2 < 256; b2++)
-      count_class_lookup16[(b1 << 8) + b2] =
-      (count_class_lookup8[b1] << 8) |
-      count_class_lookup8[b2];
+  return bm_ops.count_bits(mem, MAP_SIZE);
 
 }
 
 
-#ifdef WORD_SIZE_64
-
-static inline void classify_counts(u64* mem) {
-
-  u32 i = MAP_SIZE >> 3;
-
-  while (i--) {
+/* Count the number of bytes set in the bitmap. Called fairly sporadically,
+   mostly to update the status screen or calibrate and examine confirmed
+   new paths. */
 
-    /* Optimize for sparse bitmaps. */
+static u32 count_bytes(u8* mem) {
 
-    if (unlikely(*mem)) {
+  return bm_ops.count_bytes(mem, MAP_SIZE);
 
-      u16* mem16 = (u16*)mem;
+}
 
-      mem16[0] = count_class_lookup16[mem16[0]];
-      mem16[1] = count_class_lookup16[mem16[1]];
-      mem16[2] = count_class_lookup16[mem16[2]];
-      mem16[3] = count_class_lookup16[mem16[3]];
 
-    }
+/* Count the number of non-255 bytes set in the bitmap. Used strictly for the
+   status screen, several calls per second or so. */
 
-    mem++;
+static u32 count_non_255_bytes(u8* mem) {
 
-  }
+  return bm_ops.count_non_255_bytes(mem, MAP_SIZE);
 
 }
 
-#else
-
-static inline void classify_counts(u32* mem) {
-
-  u32 i = MAP_SIZE >> 2;
 
-  while (i--) {
+/* Destructively simplify trace by eliminating hit count information
+   and replacing it with 0x80 or 0x01 depending on whether the tuple
+   is hit or not. Called on every new crash or timeout, should be
+   reasonably fast. */
 
-    /* Optimize for sparse bitmaps. */
+static void simplify_trace(u8* mem) {
 
-    if (unlikely(*mem)) {
+  bm_ops.simplify(mem, MAP_SIZE);
 
-      u16* mem16 = (u16*)mem;
+}
 
-      mem16[0] = count_class_lookup16[mem16[0]];
-      mem16[1] = count_class_lookup16[mem16[1]];
 
-    }
+/* Destructively classify execution counts in a trace. This is used as a
+   preprocessing step for any newly acquired traces. Called on every exec,
+   must be fast. The same sweep checks the result against virgin_bits, so
+   has_new_bits() can skip its own in the common nothing-new case. */
 
-    mem++;
+static inline void classify_counts(u8* mem) {
 
-  }
+  trace_hits_virgin = bm_ops.classify(mem, virgin_bits, MAP_SIZE);
 
 }
 
-#endif /* ^WORD_SIZE_64 */
-
 
 /* Get rid of shared memory (atexit handler). */
 
@@ -3740,7 +4178,7 @@ static void cull_queue(void) {
 
       //if (!top_rated[i]->was_fuzzed) pending_favored++;
       /* AFLNet takes into account more information to make this decision */
-      if ((top_rated[i]->generating_state_id == target_state_id || top_rated[i]->is_initial_seed) && (was_fuzzed_map[get_state_index(target_state_id)][top_rated[i]->index] == 0)) pending_favored++;
+      if ((top_rated[i]->generating_state_id == target_state_id || top_rated[i]->is_initial_seed) && seed_is_pending(get_state_index(target_state_id), top_rated[i]->index)) pending_favored++;
 
     }
 
@@ -3763,6 +4201,7 @@ EXP_ST void setup_shm(void) {
 
   memset(virgin_tmout, 255, MAP_SIZE);
   memset(virgin_crash, 255, MAP_SIZE);
+  memset(virgin_monitor, 255, MONITOR_MAP_SIZE);
 
 
   /* generate random file name for multi instance */
@@ -3803,6 +4242,7 @@ EXP_ST void setup_shm(void) {
 
   memset(virgin_tmout, 255, MAP_SIZE);
   memset(virgin_crash, 255, MAP_SIZE);
+  memset(virgin_monitor, 255, MONITOR_MAP_SIZE);
 
   shm_id = shmget(IPC_PRIVATE, MAP_SIZE, IPC_CREAT | IPC_EXCL | 0600);
 
@@ -4439,7 +4879,7 @@ static void destroy_extras(void) {
 EXP_ST void init_forkserver(char** argv) {
 
   static struct itimerval it;
-  int st_pipe[2], ctl_pipe[2];
+  int st_pipe[2], ctl_pipe[2], fsnap_sk[2];
   int status;
   s32 rlen;
 
@@ -4447,6 +4887,10 @@ EXP_ST void init_forkserver(char** argv) {
 
   if (pipe(st_pipe) || pipe(ctl_pipe)) PFATAL("pipe() failed");
 
+  if (fork_snapshot &&
+      socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fsnap_sk))
+    PFATAL("socketpair() failed");
+
   forksrv_pid = fork();
 
   if (forksrv_pid < 0) PFATAL("fork() failed");
@@ -4565,6 +5009,14 @@ EXP_ST void init_forkserver(char** argv) {
       }
     }
 
+    if (fork_snapshot) {
+      char *val = getenv("LD_PRELOAD");
+      char *env_tmp = val ? alloc_printf("%s:%s", fsnap_rt, val) : ck_strdup(fsnap_rt);
+      if (dup2(fsnap_sk[1], FORK_SNAPSHOT_FD) < 0) PFATAL("dup2() failed");
+      setenv("LD_PRELOAD", env_tmp, 1);
+      ck_free(env_tmp);
+    }
+
     execv(target_path, argv);
 
     /* Use a distinctive bitmap signature to tell the parent about execv()
@@ -4583,6 +5035,11 @@ EXP_ST void init_forkserver(char** argv) {
   fsrv_ctl_fd = ctl_pipe[1];
   fsrv_st_fd  = st_pipe[0];
 
+  if (fork_snapshot) {
+    close(fsnap_sk[1]);
+    fsnap_fd = fsnap_sk[0];
+  }
+
   /* Wait for the fork server to come up, but don't wait too long. */
 
   it.it_value.tv_sec = ((exec_tmout * FORK_WAIT_MULT) / 1000);
@@ -4734,6 +5191,39 @@ EXP_ST void init_forkserver(char** argv) {
 
 }
 
+/* The save request goes out before the target is dumped and its ack is
+   collected afterwards, so the evaluator copies its state while CRIU works. */
+
+static u32 monitor_save_seq;
+
+static void monitor_snapshot_save(void) {
+
+  if (g_monitor && target_state_id < MAX_SNAPSHOTS) {
+      SNAPSHOT_LOG("Saving monitor state for snapshot %d\n", target_state_id);
+      snapshot_metadata[target_state_id].valid = 0;
+      monitor_save_seq = monitor_post_save(g_monitor, target_state_id);
+  }
+
+}
+
+static void monitor_snapshot_saved(void) {
+
+  if (!monitor_save_seq) return;
+
+  if (monitor_wait_ack(g_monitor, monitor_save_seq)) {
+      SNAPSHOT_LOG("WARNING: Monitor did not save state for snapshot %d\n", target_state_id);
+  } else {
+      // Record metadata
+      snapshot_metadata[target_state_id].snapshot_id = target_state_id;
+      snapshot_metadata[target_state_id].message_count = messages_sent_total; // assuming this exists
+      snapshot_metadata[target_state_id].timestamp = get_cur_time_us();
+      snapshot_metadata[target_state_id].valid = 1;
+  }
+
+  monitor_save_seq = 0;
+
+}
+
 int self_criu_dump()
 {
   #ifdef SNAPSHOT_DEBUG
@@ -4762,16 +5252,15 @@ int self_criu_dump()
 
   /* reset files */
   DIR *dirptr = NULL;
-  u8 *dir_name = alloc_printf("snapshot_dir/state%d_images", target_state_id);
+  u8 *dir_name = snapshot_img_dir(target_state_id);
+  snapshot_store_replace(target_state_id);
   dirptr = opendir(dir_name);
   if (dirptr == NULL) {
     if (mkdir(dir_name, 0755) == -1) PFATAL("mkdir %s error", dir_name);
   } else {
     closedir(dirptr);
   }
-  u8 *rm_dir_name = alloc_printf("cd %s && rm -rf ./*", dir_name);
-  system(rm_dir_name);
-  ck_free(rm_dir_name);
+  if (snap_clear_dir(dir_name)) PFATAL("Unable to clear %s", dir_name);
 
   int return_code;
   if (strcmp(use_banner, "forked-daapd")!=0) {
@@ -4780,12 +5269,11 @@ int self_criu_dump()
     if (img_fd < 0) {
       PFATAL("Can't open %s", dir_name);
     }
-    ck_free(dir_name);
 
     criu_init_opts();
     criu_set_pid(child_pid);
     criu_set_shell_job(true);
-    criu_set_log_level(4);
+    criu_set_log_level(CRIU_LOG_LEVEL);
     criu_set_log_file("dump.log");
     if (net_protocol == PRO_TCP) criu_set_tcp_established(true);
     criu_set_images_dir_fd(img_fd);
@@ -4795,30 +5283,20 @@ int self_criu_dump()
     SNAPSHOT_LOG("target_state_id:%d, try criu_dump: %d\n", target_state_id, child_pid);
     #endif
     // NEW: Save monitor BitVector state BEFORE CRIU dump
-    if (g_monitor && target_state_id < MAX_SNAPSHOTS) {
-        SNAPSHOT_LOG("Saving monitor state for snapshot %d\n", target_state_id);
-        monitor_save_bitvectors(g_monitor, target_state_id);
-        
-        // Record metadata
-        snapshot_metadata[target_state_id].snapshot_id = target_state_id;
-        snapshot_metadata[target_state_id].message_count = messages_sent_total; // assuming this exists
-        snapshot_metadata[target_state_id].timestamp = get_cur_time_us();
-        snapshot_metadata[target_state_id].valid = 1;
-    }
+    monitor_snapshot_save();
 
     return_code = criu_dump();
     close(img_fd);
+    monitor_snapshot_saved();
   }
   // The "forked-daapd" program cannot use the CRIU DUMP C API, only in command line mode
   else {
     #ifdef SNAPSHOT_DEBUG
     SNAPSHOT_LOG("--------------no API-----------------");
     #endif
-    char *xx = alloc_printf("netstat -nxp | grep %d |awk '{ print $7 }'", child_pid);
-    int *res_code = NULL;
-    int res_code_size = 0;
-    get_popen_result(xx, &res_code, &res_code_size);
-    ck_free(xx);
+    u32 res_code[32];
+    s32 res_code_size = snap_unix_socket_inodes(child_pid, res_code, 32);
+    if (res_code_size < 0) res_code_size = 0;
     // ACTF("res_code_size:%d", res_code_size);
     char temp[512];
 
@@ -4827,7 +5305,7 @@ int self_criu_dump()
       child_pid, dir_name);
     int count_i;
     for (count_i = 0; count_i < res_code_size; count_i++) {
-      sp_cout += sprintf(temp+sp_cout, "--external unix[%d] ", res_code[count_i]);
+      sp_cout += sprintf(temp+sp_cout, "--external unix[%u] ", res_code[count_i]);
     }
     if (sp_cout >= 512) {
       PFATAL("sp_cout:%d", sp_cout);
@@ -4847,7 +5325,6 @@ int self_criu_dump()
       pclose(fp);
     }
     
-    ck_free(res_code);
     return_code = 0;
   }
   /* dump failed 故障 */
@@ -4869,12 +5346,12 @@ int self_criu_dump()
     SNAPSHOT_LOG("read(fsrv_st_fd, &status, 4) OK\n");
     #endif
 
-    system("iptables -t filter -F OUTPUT");
-    system("iptables -t filter -F INPUT");
+    flush_afl_port();
     #ifdef SNAPSHOT_DEBUG
     SNAPSHOT_LOG("free iptables\n");
     #endif
 
+    ck_free(dir_name);
     #ifdef SNAPSHOT_DEBUG
     SNAPSHOT_LOG_LEAVE("self_criu_dump(Dump Failed Fault)");
     #endif
@@ -4895,12 +5372,140 @@ int self_criu_dump()
   SNAPSHOT_LOG("record child pid after dump: child_pid_snapshot = %d;\n",child_pid);
   #endif
 
+  ck_free(dir_name);
+
   #ifdef SNAPSHOT_DEBUG
   SNAPSHOT_LOG_LEAVE("self_criu_dump()");
   #endif
   return OK;
 }
 
+/* Fork snapshots (AFL_FORK_SNAPSHOT): instead of CRIU dumping the target
+   after M1, fork_snapshot_rt.so parks it as a snapshot server on
+   FORK_SNAPSHOT_FD and every restore is a fork() of that process. */
+
+/* Counterpart of self_criu_dump(): park the child that has just seen M1. */
+
+int fork_snapshot_take()
+{
+  #ifdef SNAPSHOT_DEBUG
+  SNAPSHOT_LOG_ENTER("fork_snapshot_take()");
+  #endif
+
+  u32 msg = 0, waited;
+  s32 status = 0, res;
+
+  monitor_snapshot_save();
+
+  /* The signal only takes effect once the server blocks on a socket read,
+     so repeat it until the target reports in. */
+
+  for (waited = 0; waited < restore_tms; waited += 20) {
+
+    struct pollfd pfd = { fsnap_fd, POLLIN, 0 };
+
+    if (kill(child_pid, FORK_SNAPSHOT_SIG)) break;
+    if (poll(&pfd, 1, 20) > 0) {
+      if (fork_snapshot_recv(&msg, NULL, 0)) msg = 0;
+      break;
+    }
+
+  }
+
+  monitor_snapshot_saved();
+
+  if(net_protocol==PRO_TCP)
+    close(socket_fd);
+
+  if (msg != FORK_SNAPSHOT_READY) {
+    #ifdef SNAPSHOT_DEBUG
+    SNAPSHOT_LOG("target %d did not park\n", child_pid);
+    #endif
+    clear_child();
+    if ((res = read(fsrv_st_fd, &status, 4)) != 4) {
+      RPFATAL(res, "Unable to communicate with fork server (OOM?)");
+    }
+    while (recv(fsnap_fd, &msg, sizeof(msg), MSG_DONTWAIT) > 0);
+    #ifdef SNAPSHOT_DEBUG
+    SNAPSHOT_LOG_LEAVE("fork_snapshot_take(Park Fault)");
+    #endif
+    return DUMP_FAILED_ERR;
+  }
+
+  fsnap_server_pid = child_pid;
+  child_pid_snapshot = child_pid;
+
+  #ifdef SNAPSHOT_DEBUG
+  SNAPSHOT_LOG_LEAVE("fork_snapshot_take()");
+  #endif
+  return OK;
+}
+
+/* Counterpart of self_criu_restore(): fork a fresh copy of the parked
+   target. For TCP, the copy comes with its own connection. */
+
+s32 fork_snapshot_restore()
+{
+  #ifdef SNAPSHOT_DEBUG
+  SNAPSHOT_LOG_ENTER("fork_snapshot_restore()");
+  #endif
+  try_restore_count++;
+  try_restore_count_current++;
+
+  u32 cmd = FORK_SNAPSHOT_FORK, pid = 0;
+  s32 fd = -1;
+
+  if (!fsnap_server_pid) return RESTORE_FAILED;
+
+  /* Late replies of the previous run would be read as this run's. */
+
+  if (net_protocol == PRO_UDP) {
+    u8 junk[512];
+    while (recv(socket_fd, junk, sizeof(junk), MSG_DONTWAIT) >= 0);
+  }
+
+  is_restoring = 1;
+
+  if (send(fsnap_fd, &cmd, sizeof(cmd), MSG_NOSIGNAL) != sizeof(cmd) ||
+      fork_snapshot_recv(&pid, &fd, -1) || !pid) {
+
+    s32 timed_out = is_restoring == 2;
+
+    is_restoring = 0;
+    if (fd >= 0) close(fd);
+    fork_snapshot_drop();
+    #ifdef SNAPSHOT_DEBUG
+    SNAPSHOT_LOG_LEAVE("fork_snapshot_restore(Fork Fault)");
+    #endif
+    return timed_out ? RESTORE_TIMEOUT : RESTORE_FAILED;
+
+  }
+
+  is_restoring = 0;
+
+  child_pid = pid;
+  track_child(child_pid);
+
+  if (net_protocol == PRO_TCP) {
+
+    struct timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = socket_timeout_usecs;
+
+    socket_fd = fd;
+    setsockopt(socket_fd, SOL_SOCKET, SO_SNDTIMEO, (char *)&timeout, sizeof(timeout));
+
+  } else if (fd >= 0) close(fd);
+
+  monitor_snapshot_restore();
+  restore_ok_count++;
+  restore_ok_count_current++;
+  #ifdef SNAPSHOT_DEBUG
+  SNAPSHOT_LOG_LEAVE("fork_snapshot_restore()");
+  #endif
+  return OK;
+}
+
 /* Execute target application, monitoring for timeouts. Return status
    information. The called program will update trace_bits[]. */
 
@@ -4910,11 +5515,13 @@ static u8 run_target(char** argv, u32 timeout) {
   #endif
   run_target_count++;
   run_target_count_current++;
+  trace_hits_virgin = 1;
+  phase_reset();
   #ifdef SNAPSHOT_DEBUG
-  get_popen_result_no_return("cat /proc/meminfo | head -n 3 ");
+  log_meminfo();
   #endif
   #ifdef SNAPSHOT_DEBUG
-  if(check_target_process()!=1) PFATAL("error target process num!");
+  if(check_target_process()!=1+(fsnap_server_pid>0)) PFATAL("error target process num!");
   if(check_zombies()) PFATAL("zombies ate your brain\n");
   #endif
 
@@ -5034,6 +5641,10 @@ static u8 run_target(char** argv, u32 timeout) {
 
       s32 res;
 
+      /* The fork server is still waiting on a parked target. */
+
+      if (fsnap_server_pid) fork_snapshot_drop();
+
       /* In non-dumb mode, we have the fork server up and running, so simply
          tell it to have at it, and then read back PID. */
       
@@ -5066,6 +5677,7 @@ static u8 run_target(char** argv, u32 timeout) {
       }
       
       if (child_pid <= 0) FATAL("Fork server is misbehaving (OOM?)");
+      if (use_snapshot) track_child(child_pid);
       #ifdef SNAPSHOT_DEBUG
       SNAPSHOT_LOG("forkserver return child pid %d\n",child_pid);
       check_target_process();
@@ -5095,7 +5707,9 @@ static u8 run_target(char** argv, u32 timeout) {
 
       timer_start(&it_rst,restore_tms);
       clock_start();
-      __res = self_criu_restore();
+      phase_enter(PH_RESTORE);
+      __res = fork_snapshot ? fork_snapshot_restore() : self_criu_restore();
+      phase_leave();
       clock_close_depends(2,__res);
       timer_close(&it_rst);
 
@@ -5119,7 +5733,9 @@ static u8 run_target(char** argv, u32 timeout) {
       // Send m1 message sequence
       timer_start(&it,timeout);
       clock_start();
+      phase_enter(PH_SEND_M1);
       __res = send_over_network_m1();
+      phase_leave();
       clock_close_depends(0,__res);
       timer_close(&it);
 
@@ -5144,7 +5760,9 @@ static u8 run_target(char** argv, u32 timeout) {
       #endif
 
       clock_start();
-      __res = self_criu_dump();
+      phase_enter(PH_DUMP);
+      __res = fork_snapshot ? fork_snapshot_take() : self_criu_dump();
+      phase_leave();
       clock_close_depends(3,__res);
 
       if (__res>0) {
@@ -5168,7 +5786,9 @@ static u8 run_target(char** argv, u32 timeout) {
       // restore child
       timer_start(&it_rst,restore_tms);
       clock_start();
-      __res = self_criu_restore();
+      phase_enter(PH_RESTORE);
+      __res = fork_snapshot ? fork_snapshot_restore() : self_criu_restore();
+      phase_leave();
       clock_close_depends(2,__res);
       timer_close(&it_rst);
 
@@ -5200,7 +5820,9 @@ static u8 run_target(char** argv, u32 timeout) {
     
     timer_start(&it,timeout);
     clock_start();
+    phase_enter(PH_SEND_M23);
     status = send_over_network_m23();
+    phase_leave();
     clock_close(1);
 
 
@@ -5223,7 +5845,11 @@ static u8 run_target(char** argv, u32 timeout) {
       #ifdef SNAPSHOT_DEBUG
       SNAPSHOT_LOG("dump_mode==1 and no_forkserver\n");
       #endif
-      if (use_net) send_over_network();
+      if (use_net) {
+        phase_enter(PH_SEND_ALL);
+        send_over_network();
+        phase_leave();
+      }
       if (waitpid(child_pid, &status, 0) <= 0) PFATAL("waitpid() failed");
 
     } else {
@@ -5232,7 +5858,9 @@ static u8 run_target(char** argv, u32 timeout) {
       #endif
 
       if (use_net) {
+        phase_enter(PH_SEND_ALL);
         send_over_network();
+        phase_leave();
         #ifdef SNAPSHOT_DEBUG
         SNAPSHOT_LOG("send_over_network() OK\n");
         #endif
@@ -5293,11 +5921,9 @@ static u8 run_target(char** argv, u32 timeout) {
 
   tb4 = *(u32*)trace_bits;
 
-#ifdef WORD_SIZE_64
-  classify_counts((u64*)trace_bits);
-#else
-  classify_counts((u32*)trace_bits);
-#endif /* ^WORD_SIZE_64 */
+  phase_enter(PH_BITMAP);
+  classify_counts(trace_bits);
+  phase_leave();
 
   prev_timed_out = child_timed_out;
 
@@ -5627,8 +6253,11 @@ static void perform_dry_run(char** argv) {
 
     close(fd);
 
+    /* From here on the seed is read from the pack */
+    pack_queue_entry(q, use_mem);
+
     /* AFLNet construct the kl_messages linked list for this queue entry*/
-    kl_messages = construct_kl_messages(q->fname, q->regions, q->region_count);
+    kl_messages = construct_kl_messages_buf(use_mem, q->len, q->regions, q->region_count);
 
     res = calibrate_case(argv, q, use_mem, 0, 1);
     ck_free(use_mem);
@@ -5636,10 +6265,8 @@ static void perform_dry_run(char** argv) {
     /* Update state-aware variables (e.g., state machine, regions and their annotations */
     if (state_aware_mode) update_state_aware_variables(q, 1);
 
-    /* save the seed to file for replaying */
-    u8 *fn_replay = alloc_printf("%s/replayable-queue/%s", out_dir, basename(q->fname));
-    save_kl_messages_to_file(kl_messages, fn_replay, 1, messages_sent);
-    ck_free(fn_replay);
+    /* save the seed for replaying */
+    save_replayable(PACK_REPLAY_QUEUE, basename(q->fname), kl_messages, messages_sent);
 
     /* AFLNet delete the kl_messages */
     delete_kl_messages(kl_messages);
@@ -5976,6 +6603,7 @@ static u8* describe_op(u8 hnb) {
   }
 
   if (hnb == 2) strcat(ret, ",+cov");
+  if (monitor_new_bits) strcat(ret, ",+mon");
 
   return ret;
 
@@ -6049,7 +6677,9 @@ static u8 save_if_interesting(char** argv, void* mem, u32 len, u8 fault) {
     /* Keep only if there are new bits in the map, add to queue for
        future fuzzing, etc. */
 
-    if (!(hnb = has_new_bits(virgin_bits))) {
+    /* Inputs that only reach a new property-automaton edge are kept too. */
+
+    if (!(hnb = has_new_bits(virgin_bits)) && !monitor_new_bits) {
       if (crash_mode) total_crashes++;
       #ifdef SNAPSHOT_DEBUG
       SNAPSHOT_LOG_LEAVE("save_if_interesting");
@@ -6068,23 +6698,34 @@ static u8 save_if_interesting(char** argv, void* mem, u32 len, u8 fault) {
 
 #endif /* ^!SIMPLE_FILES */
 
-    u32 full_len = save_kl_messages_to_file(kl_messages, fn, 0, messages_sent);
+    u32 full_len;
+    u8 *full_mem = kl_messages_to_buf(kl_messages, 0, messages_sent, &full_len);
+
+    s32 fd = open(fn, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) PFATAL("Unable to create '%s'", fn);
+    ck_write(fd, full_mem, full_len, fn);
+    close(fd);
 
     /* We use the actual length of all messages (full_len), not the len of the mutated message subsequence (len)*/
     add_to_queue(fn, full_len, 0);
+    pack_queue_entry(queue_top, full_mem);
+    ck_free(full_mem);
 
     if (state_aware_mode) update_state_aware_variables(queue_top, 0);
 
-    /* save the seed to file for replaying */
-    u8 *fn_replay = alloc_printf("%s/replayable-queue/%s", out_dir, basename(queue_top->fname));
-    save_kl_messages_to_file(kl_messages, fn_replay, 1, messages_sent);
-    ck_free(fn_replay);
+    /* save the seed for replaying */
+    save_replayable(PACK_REPLAY_QUEUE, basename(queue_top->fname), kl_messages, messages_sent);
 
     if (hnb == 2) {
       queue_top->has_new_cov = 1;
       queued_with_cov++;
     }
 
+    if (monitor_new_bits) {
+      queue_top->has_new_monitor_cov = 1;
+      queued_with_monitor_cov++;
+    }
+
     queue_top->exec_cksum = hash32(trace_bits, MAP_SIZE, HASH_CONST);
 
     /* Try to calibrate inline; this also calls update_bitmap_score() when
@@ -6123,11 +6764,7 @@ static u8 save_if_interesting(char** argv, void* mem, u32 len, u8 fault) {
     } 
     if (!dumb_mode) {
 
-#ifdef WORD_SIZE_64
-      simplify_trace((u64*)trace_bits);
-#else
-      simplify_trace((u32*)trace_bits);
-#endif /* ^WORD_SIZE_64 */
+      simplify_trace(trace_bits);
 
       if (!has_new_bits(virgin_tmout)) {
         #ifdef SNAPSHOT_DEBUG
@@ -6200,11 +6837,7 @@ static u8 save_if_interesting(char** argv, void* mem, u32 len, u8 fault) {
     } 
     if (!dumb_mode) {
 
-#ifdef WORD_SIZE_64
-      simplify_trace((u64*)trace_bits);
-#else
-      simplify_trace((u32*)trace_bits);
-#endif /* ^WORD_SIZE_64 */
+      simplify_trace(trace_bits);
 
       if (!has_new_bits(virgin_crash)) {
         #ifdef SNAPSHOT_DEBUG
@@ -6246,11 +6879,7 @@ static u8 save_if_interesting(char** argv, void* mem, u32 len, u8 fault) {
     if (unique_violations >= KEEP_UNIQUE_VIOLATIONS) return keeping;
     
     if (!dumb_mode) {
-  #ifdef WORD_SIZE_64
-      simplify_trace((u64*)trace_bits);
-  #else
-      simplify_trace((u32*)trace_bits);
-  #endif
+      simplify_trace(trace_bits);
       if (!has_new_bits(virgin_violations)) return keeping;
     }
     
@@ -6304,6 +6933,36 @@ static u8 save_if_interesting(char** argv, void* mem, u32 len, u8 fault) {
     }
     ck_free(fn);
 
+    // =========================================================
+    // SAVE 3b: Packets behind each monitor event (LTL_TRACE_REF),
+    // one "<event> <len> <hex>" line per event, in session order
+    // =========================================================
+    if (trace_by_ref && trace_refs_cnt) {
+        fn = alloc_printf("%s/violations-traces/id:%06llu.packets", out_dir,
+                          unique_violations);
+
+        FILE *pkt_file = fopen(fn, "w");
+        if (pkt_file) {
+            u32 i;
+            for (i = 0; i < trace_refs_cnt; i++) {
+                u32 plen = 0;
+                const u8* pkt = resolve_trace_ref(&trace_refs[i], &plen);
+                if (!pkt) {
+                    fprintf(pkt_file, "%u %s -\n", i + 1,
+                            trace_refs[i].src < TRACE_SRC_RESP ? "C2S" : "S2C");
+                    continue;
+                }
+                u8* hex = ck_alloc(2 * plen + 1);
+                pred_hex_encode((char*)hex, pkt, plen);
+                fprintf(pkt_file, "%u %s %s\n", i + 1,
+                        trace_refs[i].src < TRACE_SRC_RESP ? "C2S" : "S2C", hex);
+                ck_free(hex);
+            }
+            fclose(pkt_file);
+        }
+        ck_free(fn);
+    }
+
     // =========================================================
     // SAVE 4: Coverage bitmap
     // =========================================================
@@ -6350,6 +7009,8 @@ static u8 save_if_interesting(char** argv, void* mem, u32 len, u8 fault) {
         fprintf(meta_file, "  Original test case: violations/id:%06llu\n", unique_violations);
         fprintf(meta_file, "  Replayable messages: replayable-violations/id:%06llu\n", unique_violations);
         fprintf(meta_file, "  Response trace: violations-traces/id:%06llu.trace\n", unique_violations);
+        if (trace_by_ref)
+          fprintf(meta_file, "  Event packets: violations-traces/id:%06llu.packets\n", unique_violations);
         fprintf(meta_file, "  Coverage bitmap: violations-traces/id:%06llu.bitmap\n", unique_violations);
         fprintf(meta_file, "  State sequence: violations-traces/id:%06llu.states\n", unique_violations);
         
@@ -6468,6 +7129,7 @@ static void write_stats_file(double bitmap_cvg, double stability, double eps) {
 
   static double last_bcvg, last_stab, last_eps;
   static struct rusage usage;
+  u32 i;
 
   u8* fn = alloc_printf("%s/fuzzer_stats", out_dir);
   s32 fd;
@@ -6525,7 +7187,8 @@ static void write_stats_file(double bitmap_cvg, double stability, double eps) {
     "target_mode       : %s%s%s%s%s%s%s\n"
     "command_line      : %s\n"
     "slowest_exec_ms   : %llu\n"
-    "send_msg_total    : %u\n",
+    "send_msg_total    : %u\n"
+    "paths_monitor_cov : %u\n",
     start_time / 1000, get_cur_time() / 1000, getpid(),
     queue_cycle ? (queue_cycle - 1) : 0, total_execs, eps,
     queued_paths, queued_favored, queued_discovered, queued_imported,
@@ -6539,7 +7202,26 @@ static void write_stats_file(double bitmap_cvg, double stability, double eps) {
     persistent_mode ? "persistent " : "", deferred_mode ? "deferred " : "",
     (qemu_mode || dumb_mode || no_forkserver || crash_mode ||
       persistent_mode || deferred_mode) ? "" : "default",
-    orig_cmdline, slowest_exec_ms, messages_sent_total);
+    orig_cmdline, slowest_exec_ms, messages_sent_total,
+    queued_with_monitor_cov);
+
+  /* Execution phases: total own time, spans, and p50/p99 of recent spans */
+
+  for (i = 0; i < PH_COUNT; i++) {
+
+    u8 key[32];
+
+    sprintf(key, "phase_%s_ms", phase_names[i]);
+    fprintf(f, "%-18s: %llu\n", key, phase_total_ms(i));
+    sprintf(key, "phase_%s_count", phase_names[i]);
+    fprintf(f, "%-18s: %llu\n", key, phase_stats[i].count);
+    sprintf(key, "phase_%s_p50_us", phase_names[i]);
+    fprintf(f, "%-18s: %0.01f\n", key, lat_sketch_quantile(&phase_stats[i].ns, 50) / 1000.0);
+    sprintf(key, "phase_%s_p99_us", phase_names[i]);
+    fprintf(f, "%-18s: %0.01f\n", key, lat_sketch_quantile(&phase_stats[i].ns, 99) / 1000.0);
+
+  }
+
   /* ignore errors */
 /* Get rss value from the children
    We must have killed the forkserver process and called waitpid
@@ -6567,6 +7249,7 @@ static void maybe_update_plot_file(double bitmap_cvg, double eps) {
 
   static u32 prev_qp, prev_pf, prev_pnf, prev_ce, prev_md;
   static u64 prev_qc, prev_uc, prev_uh;
+  u32 i;
 
   if (prev_qp == queued_paths && prev_pf == pending_favored &&
     prev_pnf == pending_not_fuzzed && prev_ce == current_entry &&
@@ -6586,14 +7269,20 @@ static void maybe_update_plot_file(double bitmap_cvg, double eps) {
 
      unix_time, cycles_done, cur_path, paths_total, paths_not_fuzzed,
      favored_not_fuzzed, unique_crashes, unique_hangs, max_depth,
-     execs_per_sec */
+     execs_per_sec, total_execs, then the total ms of each execution
+     phase */
 
   fprintf(plot_file,
-         "%llu, %llu, %u, %u, %u, %u, %0.02f%%, %llu, %llu, %u, %0.02f, %llu\n",
+         "%llu, %llu, %u, %u, %u, %u, %0.02f%%, %llu, %llu, %u, %0.02f, %llu",
           get_cur_time() / 1000, queue_cycle - 1, current_entry, queued_paths,
           pending_not_fuzzed, pending_favored, bitmap_cvg, unique_crashes,
           unique_hangs, max_depth, eps, total_execs); /* ignore errors */
 
+  for (i = 0; i < PH_COUNT; i++)
+    fprintf(plot_file, ", %llu", phase_total_ms(i));
+
+  fputc('\n', plot_file);
+
   fflush(plot_file);
 
 }
@@ -6950,6 +7639,11 @@ static void maybe_delete_out_dir(void) {
   if (delete_files(fn, "")) goto dir_cleanup_failed;
   ck_free(fn);
 
+  /* And the corpus pack */
+  fn = alloc_printf("%s/corpus.pack", out_dir);
+  if (unlink(fn) && errno != ENOENT) goto dir_cleanup_failed;
+  ck_free(fn);
+
   /* And now, for some finishing touches. */
 
   fn = alloc_printf("%s/.cur_input", out_dir);
@@ -7007,7 +7701,8 @@ static void show_stats(void) {
   u64 cur_ms;
   u32 t_bytes, t_bits;
 
-  u32 banner_len, banner_pad;
+  u32 banner_len, banner_pad, i;
+  u64 phase_ticks_all;
   u8  tmp[256];
 
   cur_ms = get_cur_time();
@@ -7070,6 +7765,7 @@ static void show_stats(void) {
     write_stats_file(t_byte_ratio, stab_ratio, avg_exec);
     save_auto();
     write_bitmap();
+    write_ipsm_dot();
 
   }
 
@@ -7449,6 +8145,33 @@ static void show_stats(void) {
   messages_sent_total_last = messages_sent_total;
   sprintf(tmp, "%-.2f msg/sec", avg_message_sent);
   SAYF(bSTG bV bSTOP " msg sending speed : " "%s" "%-56s " bSTG bV bSTOP"\n", avg_message_sent>avg_exec*10?cLGN:cRST, tmp);
+
+  /* Where the exec time goes: each phase's share of the time spent in all
+     phases, and its average, p50 and p99 per span */
+
+  for (i = 0, phase_ticks_all = 0; i < PH_COUNT; i++)
+    phase_ticks_all += phase_stats[i].ticks;
+
+  if (phase_ticks_all) {
+
+    SAYF(bSTG bVR bH cCYA bSTOP " execution phases " bSTG bH20 bH20 bH10 bH5 bH2 bH2 bVL bSTOP "\n");
+
+    for (i = 0; i < PH_COUNT; i++) {
+
+      if (!phase_stats[i].count) continue;
+
+      sprintf(tmp, "%5.01f%%   avg %-9s p50 %-9s p99 %s",
+              ((double)phase_stats[i].ticks) * 100 / phase_ticks_all,
+              DNS(phase_stats[i].ticks * phase_ns_per_tick / phase_stats[i].count),
+              DNS(lat_sketch_quantile(&phase_stats[i].ns, 50)),
+              DNS(lat_sketch_quantile(&phase_stats[i].ns, 99)));
+
+      SAYF(bSTG bV bSTOP "%18s : " cRST "%-56s " bSTG bV bSTOP "\n", phase_names[i], tmp);
+
+    }
+
+  }
+
   SAYF(bSTG bLB bH20 bH20 bH20 bH10 bH5 bH2 bH bRB bSTOP cGRA "\n");  
 
   /* Provide some CPU utilization stats. */
@@ -7498,19 +8221,13 @@ static void show_stats(void) {
     SAYF(cRST "\n\nMax_seed_region_count: %-4s, current_kl_messages_size: %-4s\n\n", DI(max_seed_region_count), DI(kl_messages->size));
     SAYF(cRST "State IDs and its #selected_times,"cCYA  "#fuzzs,"cLRD "#discovered_paths,"cGRA "#excersing_paths:\n");
 
-    khint_t k;
     state_info_t *state;
     u32 i = 0;
 
     for(i = 0; i < state_ids_count; i++) {
-      u32 state_id = state_ids[i];
-
-      k = kh_get(hms, khms_states, state_id);
-      if (k != kh_end(khms_states)) {
-        state = kh_val(khms_states, k);
-        SAYF(cRST "S%-3s:%-4s,"cCYA "%-5s,"cLRD "%-5s,"cGRA "%-5s",  DI(state->id), DI(state->selected_times), DI(state->fuzzs), DI(state->paths_discovered), DI(state->paths));
-        if ((i + 1) % 3 == 0) SAYF("\n");
-      }
+      state = &state_table[i];
+      SAYF(cRST "S%-3s:%-4s,"cCYA "%-5s,"cLRD "%-5s,"cGRA "%-5s",  DI(state->id), DI(state->selected_times), DI(state->fuzzs), DI(state->paths_discovered), DI(state->paths));
+      if ((i + 1) % 3 == 0) SAYF("\n");
     }
   }
 
@@ -7637,7 +8354,7 @@ EXP_ST u8 common_fuzz_stuff(char** argv, u8* out_buf, u32 len) {
   #ifdef SNAPSHOT_DEBUG
   SNAPSHOT_LOG_ENTER("common_fuzz_stuff()");
   #endif
-  u8 fault;
+  u8 fault, acked;
 
   if (post_handler) {
 
@@ -7746,6 +8463,8 @@ EXP_ST u8 common_fuzz_stuff(char** argv, u8* out_buf, u32 len) {
 
   }
 
+  if (g_monitor_initialized) monitor_clear_coverage(g_monitor);
+
   fault = run_target(argv, exec_tmout);
 
   //Update fuzz count, no matter whether the generated test is interesting or not
@@ -7755,14 +8474,23 @@ EXP_ST u8 common_fuzz_stuff(char** argv, u8* out_buf, u32 len) {
     if (use_snapshot && (mca_algo == MCA_SMART) && (current_choose_position != -1)) queue_cur->regions_scores[current_choose_position].fuzzs++;
   }
 
+  monitor_new_bits = 0;
+  monitor_near = 0;
+
   if (use_net && g_monitor_initialized && g_monitor) {
-      monitor_end_session(g_monitor);
+      phase_enter(PH_MONITOR_WAIT);
+      acked = !monitor_end_session(g_monitor);
+      phase_leave();
+      /* Without the ack the evaluator may still be writing this session's
+         edges; they would be credited to whatever input runs next */
+      if (acked) monitor_new_bits = has_new_monitor_bits();
+      monitor_near = monitor_session_near(g_monitor);
       if (monitor_check_violation(g_monitor)) {
           monitor_clear_violation(g_monitor);
           g_last_violation_detected = 1;
           // Inject the violation into the fault code
           if (fault == FAULT_NONE) fault = FAULT_VIOLATION;
-          predicate_reset_session();
+          if (pred_adapter) pred_adapter->reset(pred_ctx);
       }
   }
 
@@ -7970,6 +8698,11 @@ static u32 calculate_score(struct queue_entry* q) {
 
   }
 
+  /* Inputs that moved the LTL monitor into a new automaton configuration
+     are closer to a violation than their code coverage suggests. */
+
+  if (q->has_new_monitor_cov) perf_score *= 2;
+
   /* Make sure that we don't go over limit. */
 
   if (perf_score > HAVOC_MAX_MULT * 100) perf_score = HAVOC_MAX_MULT * 100;
@@ -8173,12 +8906,7 @@ static u8 fuzz_one(char** argv) {
   #ifdef SNAPSHOT_DEBUG
   SNAPSHOT_LOG_ENTER("fuzz_one()");
   #endif
-  if (g_monitor_initialized) {
-    ftp_predicate_reset_session();
-    dnsmasq_predicate_reset_session();
-    dtls_predicate_reset_session();
-    ssh_predicate_reset_session();   // <-- add SSH
-}
+  if (g_monitor_initialized && pred_adapter) pred_adapter->reset(pred_ctx);
   run_target_count_current =0 ;
   total_execs_current = 0;
   try_restore_count_current = 0;
@@ -8186,7 +8914,7 @@ static u8 fuzz_one(char** argv) {
   backstep_count = 0;
   serious_err_count = 0;
 
-  s32 len, fd, temp_len, i, j;
+  s32 len, temp_len, i, j;
   u8  *in_buf = NULL, *out_buf, *orig_in, *ex_tmp, *eff_map = 0;
   u64 havoc_queued,  orig_hit_cnt, new_hit_cnt;
   u32 splice_cycle = 0, perf_score = 100, orig_perf, prev_cksum, eff_cnt = 1, M2_len;
@@ -8435,7 +9163,9 @@ AFLNET_REGIONS_SELECTION:;
   }
 
   /* Construct the kl_messages linked list and identify boundary pointers (M2_prev and M2_next) */
-  kl_messages = construct_kl_messages(queue_cur->fname, queue_cur->regions, queue_cur->region_count);
+  const u8 *packed = queue_entry_data(queue_cur);
+  kl_messages = packed ? construct_kl_messages_buf(packed, queue_cur->len, queue_cur->regions, queue_cur->region_count)
+                       : construct_kl_messages(queue_cur->fname, queue_cur->regions, queue_cur->region_count);
 
   kliter_t(lms) *it;
 
@@ -10083,15 +10813,10 @@ retry_splicing:
 
     /* Read the testcase into a new buffer. */
 
-    fd = open(target->fname, O_RDONLY);
-
-    if (fd < 0) PFATAL("Unable to open '%s'", target->fname);
-
     new_buf = ck_alloc_nozero(target->len);
 
-    ck_read(fd, new_buf, target->len, target->fname);
-
-    close(fd);
+    if (read_queue_entry(target, new_buf, 0, target->len) != target->len)
+      FATAL("Short read from '%s'", target->fname);
 
     /* Find a suitable splicing location, somewhere between the first and
        the last differing byte. Bail out if the difference is just a single
@@ -10135,7 +10860,7 @@ abandon_entry:
 
   if (!stop_soon && !queue_cur->cal_failed && !queue_cur->was_fuzzed) {
     queue_cur->was_fuzzed = 1;
-    was_fuzzed_map[get_state_index(target_state_id)][queue_cur->index] = 1;
+    set_seed_fuzzed(get_state_index(target_state_id), queue_cur->index);
     pending_not_fuzzed--;
     if (queue_cur->favored) pending_favored--;
   }
@@ -10333,6 +11058,7 @@ static void handle_stop_sig(int sig) {
   stop_soon = 1;
 
   if (child_pid > 0) kill(child_pid, SIGKILL);
+  if (fsnap_server_pid > 0) kill(fsnap_server_pid, SIGKILL);
   if (forksrv_pid > 0) kill(forksrv_pid, SIGKILL);
 
 }
@@ -10358,7 +11084,13 @@ static void handle_timeout(int sig) {
     SNAPSHOT_LOG("is restoring...So I'll kill criu and clear all iptables and reset timer\n");
     #endif
     is_restoring = 2;
-    system("kill -9 `pidof criu`");
+
+    /* pidof criu, without forking from a signal handler */
+
+    snap_proc_filter_t f = { .comm = "criu" };
+    pid_t criu_pids[16];
+    s32 n = snap_proc_scan(&f, criu_pids, 16), i;
+    for (i = 0; i < n && i < 16; i++) kill(criu_pids[i], SIGKILL);
   }
   else{
     if (child_pid > 0) {
@@ -10626,6 +11358,22 @@ static void check_term_size(void) {
 }
 
 
+/* Pick the predicate adapter for -P and allocate its session context. */
+
+static void select_predicate_adapter(const predicate_adapter_t* ad) {
+
+  if (pred_adapter) pred_adapter->destroy(pred_ctx);
+
+  pred_adapter = ad;
+  pred_ctx = ad->create();
+  if (!pred_ctx) FATAL("Unable to create %s predicate adapter", ad->name);
+
+  pred_stream_free(&resp_stream);
+  pred_stream_init(&resp_stream, ad->response_framing);
+
+}
+
+
 
 /* Display usage hints. */
 
@@ -10691,6 +11439,7 @@ EXP_ST void setup_dirs_fds(void) {
 
   u8* tmp;
   s32 fd;
+  u32 i;
 
   ACTF("Setting up output directories...");
 
@@ -10800,6 +11549,15 @@ EXP_ST void setup_dirs_fds(void) {
   if (mkdir(tmp, 0700)) PFATAL("Unable to create '%s'", tmp);
   ck_free(tmp);
 
+  /* The packed corpus store, if asked for; the two directories above then
+     stay empty (afl-pack-export fills them in). */
+
+  if (getenv("AFL_CORPUS_PACK")) {
+    tmp = alloc_printf("%s/corpus.pack", out_dir);
+    if (pack_create(&corpus_pack, tmp)) PFATAL("Unable to create '%s'", tmp);
+    ck_free(tmp);
+  }
+
   /* Generally useful file descriptors. */
 
   dev_null_fd = open("/dev/null", O_RDWR);
@@ -10820,7 +11578,12 @@ EXP_ST void setup_dirs_fds(void) {
 
   fprintf(plot_file, "# unix_time, cycles_done, cur_path, paths_total, "
     "pending_total, pending_favs, map_size, unique_crashes, "
-    "unique_hangs, max_depth, execs_per_sec, total_execs\n");
+    "unique_hangs, max_depth, execs_per_sec, total_execs");
+
+  for (i = 0; i < PH_COUNT; i++)
+    fprintf(plot_file, ", %s_ms", phase_names[i]);
+
+  fputc('\n', plot_file);
   /* ignore errors */
 
 }
@@ -11620,6 +12383,7 @@ int main(int argc, char** argv) {
         }
         extract_requests = &extract_requests_rtsp;
         extract_response_codes = &extract_response_codes_rtsp;
+        response_complete = &response_complete_rtsp;
         
       } else if (!strcmp(optarg, "FTP")) {
         // Initialize monitor for FTP
@@ -11638,9 +12402,8 @@ int main(int argc, char** argv) {
         }
         extract_requests = &extract_requests_ftp;
         extract_response_codes = &extract_response_codes_ftp;
-        build_request_pred_line = &ftp_build_command_pred_line;    // NEW
-        build_response_pred_line = &ftp_build_response_pred_line;  // NEW
-        predicate_reset_session = &ftp_predicate_reset_session;    // NEW
+        response_complete = &response_complete_ftp;
+        select_predicate_adapter(&ftp_predicate_adapter);
             
       } else if (!strcmp(optarg, "SSH")) {
         // Initialize monitor for SSH
@@ -11677,9 +12440,8 @@ int main(int argc, char** argv) {
         }
         extract_requests = &extract_requests_dtls12;
         extract_response_codes = &extract_response_codes_dtls12;
-        build_request_pred_line = &dtls_build_request_pred_line;
-        build_response_pred_line = &dtls_build_response_pred_line;
-        predicate_reset_session = &dtls_predicate_reset_session;   // NEW
+        response_complete = &response_complete_dtls12;
+        select_predicate_adapter(&dtls_predicate_adapter);
         
       } else if (!strcmp(optarg, "DNS")) {
         // Initialize monitor for DNS
@@ -11698,18 +12460,34 @@ int main(int argc, char** argv) {
         }
         extract_requests = &extract_requests_dns;
         extract_response_codes = &extract_response_codes_dns;
-        build_request_pred_line = &dnsmasq_build_request_pred_line;
-        build_response_pred_line = &dnsmasq_build_response_pred_line;
-        predicate_reset_session = &dnsmasq_predicate_reset_session; 
+        response_complete = &response_complete_dns;
+        select_predicate_adapter(&dnsmasq_predicate_adapter);
       } else if (!strcmp(optarg, "DICOM")) {
         extract_requests = &extract_requests_dicom;
         extract_response_codes = &extract_response_codes_dicom;
       } else if (!strcmp(optarg, "SMTP")) {
+        // Initialize monitor for SMTP (generated adapter, see smtp.adapter)
+        if (!g_monitor_initialized) {
+          const char *eval_path = getenv("LTL_EVAL_PATH");
+          const char *spec_path = getenv("LTL_SPEC_PATH");
+          if (!eval_path) eval_path = "./formula_parser";
+          if (!spec_path) spec_path = "./monitor-bin/smtp.ltl";
+          g_monitor = monitor_start(eval_path, spec_path, "smtp");
+          if (g_monitor) {
+            g_monitor_initialized = 1;
+            OKF("LTL evaluator started: %s %s smtp", eval_path, spec_path);
+          } else {
+            WARNF("Could not start LTL evaluator, semantic monitoring disabled.");
+          }
+        }
         extract_requests = &extract_requests_smtp;
         extract_response_codes = &extract_response_codes_smtp;
+        response_complete = &response_complete_smtp;
+        select_predicate_adapter(&smtp_predicate_adapter);
       } else if (!strcmp(optarg, "TLS")) {
         extract_requests = &extract_requests_tls;
         extract_response_codes = &extract_response_codes_tls;
+        response_complete = &response_complete_tls;
       } else if (!strcmp(optarg, "SIP")) {
         if (!g_monitor_initialized) {
           const char *eval_path = getenv("LTL_EVAL_PATH");
@@ -11724,9 +12502,11 @@ int main(int argc, char** argv) {
         }
         extract_requests = &extract_requests_sip;
         extract_response_codes = &extract_response_codes_sip;
+        response_complete = &response_complete_sip;
       } else if (!strcmp(optarg, "HTTP")) {
         extract_requests = &extract_requests_http;
         extract_response_codes = &extract_response_codes_http;
+        response_complete = &response_complete_http;
       } else if (!strcmp(optarg, "IPP")) {
         extract_requests = &extract_requests_ipp;
         extract_response_codes = &extract_response_codes_ipp;
@@ -11806,7 +12586,11 @@ int main(int argc, char** argv) {
 
   if (use_snapshot) {
     if (!use_net) FATAL("-b must be used with -N");
-  }
+    if (getenv("AFL_FORK_SNAPSHOT")) {
+      if (dumb_mode || no_forkserver) FATAL("AFL_FORK_SNAPSHOT needs the fork server");
+      fork_snapshot = 1;
+    }
+  } else if (getenv("AFL_FORK_SNAPSHOT")) FATAL("AFL_FORK_SNAPSHOT must be used with -b");
 
   setup_signal_handlers();
   check_asan_opts();
@@ -11828,12 +12612,34 @@ int main(int argc, char** argv) {
   if (getenv("AFL_NO_ARITH"))      no_arith         = 1;
   if (getenv("AFL_SHUFFLE_QUEUE")) shuffle_queue    = 1;
   if (getenv("AFL_FAST_CAL"))      fast_cal         = 1;
+  if (getenv("AFL_NO_ADAPTIVE_WAIT")) adaptive_wait = 0;
 
   if (getenv("AFL_HANG_TMOUT")) {
     hang_tmout = atoi(getenv("AFL_HANG_TMOUT"));
     if (!hang_tmout) FATAL("Invalid value of AFL_HANG_TMOUT");
   }
 
+  if (getenv("LTL_DNS_QUERY_CAP") || getenv("LTL_DNS_QUERY_AGE")) {
+    s32 cap = getenv("LTL_DNS_QUERY_CAP") ? atoi(getenv("LTL_DNS_QUERY_CAP")) : 0;
+    s32 age = getenv("LTL_DNS_QUERY_AGE") ? atoi(getenv("LTL_DNS_QUERY_AGE")) : 0;
+    if (cap < 0 || age < 0) FATAL("Invalid value of LTL_DNS_QUERY_CAP / LTL_DNS_QUERY_AGE");
+    dnsmasq_adapter_set_query_limits(cap, age);
+
+    /* -P DNS already created the context with the default limits */
+
+    if (pred_adapter == &dnsmasq_predicate_adapter)
+      select_predicate_adapter(pred_adapter);
+  }
+
+  if (getenv("LTL_TRACE_REF")) {
+    trace_by_ref = 1;
+    pred_trace_set_mode(PRED_TRACE_REF);
+  }
+
+  if ((state_selection_algo == NEAR_VIOLATION || seed_selection_algo == NEAR_VIOLATION) &&
+      !g_monitor_initialized)
+    WARNF("NEAR_VIOLATION selection without the LTL monitor is FAVOR / weighted random");
+
   if (dumb_mode == 2 && no_forkserver)
     FATAL("AFL_DUMB_FORKSRV and AFL_NO_FORKSRV are mutually exclusive");
 
@@ -11850,8 +12656,18 @@ int main(int argc, char** argv) {
   if (use_snapshot) {
     // save_program_name(argc, argv);
     setup_snapshot_dir();
+    if (fork_snapshot) {
+      u8* tmp = getenv("AFL_PATH");
+      fsnap_rt = tmp ? alloc_printf("%s/fork_snapshot_rt.so", tmp) :
+                       ck_strdup("/usr/local/lib/fork_snapshot_rt.so");
+      if (access(fsnap_rt, R_OK)) FATAL("Unable to find '%s'", fsnap_rt);
+    } else snapshot_store_setup();
     iptables_add = alloc_printf("iptables -t filter -A OUTPUT -p tcp --sport %u -j DROP; iptables -t filter -A INPUT -p tcp --sport %u -j DROP; iptables -t filter -A OUTPUT -p tcp --dport %u -j DROP; iptables -t filter -A INPUT -p tcp --dport %u -j DROP", net_port, net_port, net_port, net_port);
     iptables_del = alloc_printf("iptables -t filter -D OUTPUT -p tcp --sport %u -j DROP; iptables -t filter -D INPUT -p tcp --sport %u -j DROP; iptables -t filter -D OUTPUT -p tcp --dport %u -j DROP; iptables -t filter -D INPUT -p tcp --dport %u -j DROP", net_port, net_port, net_port, net_port);
+    if (net_protocol == PRO_TCP && !fork_snapshot) {
+      use_nft = !snap_nft_init(net_port);
+      if (!use_nft) WARNF("nf_tables unavailable (%s), blocking the port with iptables", strerror(errno));
+    }
     #ifdef SNAPSHOT_DEBUG
     libsoccr_set_log(SOCCR_LOG_DBG,snapshot_log);
     #endif
@@ -11872,7 +12688,8 @@ int main(int argc, char** argv) {
 
   setup_post();
   setup_shm();
-  init_count_class16();
+  OKF("Coverage bitmap kernels: %s", bitmap_ops_init(getenv("AFL_BITMAP_OPS")));
+  setup_phase_timing();
 
   setup_ipsm();
 
@@ -11937,10 +12754,8 @@ int main(int argc, char** argv) {
         cull_queue();
 
         /* Update number of times a state has been selected for targeted fuzzing */
-        khint_t k = kh_get(hms, khms_states, target_state_id);
-        if (k != kh_end(khms_states)) {
-          kh_val(khms_states, k)->selected_times++;
-        }
+        state_info_t *state = get_state(target_state_id);
+        if (state) state->selected_times++;
 
         if (use_snapshot) {
           // has_snapshot_flag = check_state_snapshot();
@@ -12057,6 +12872,7 @@ int main(int argc, char** argv) {
      If we stopped manually, this is done by the signal handler. */
   if (stop_soon == 2) {
     if (child_pid > 0) kill(child_pid, SIGKILL);
+    if (fsnap_server_pid > 0) kill(fsnap_server_pid, SIGKILL);
     if (forksrv_pid > 0) kill(forksrv_pid, SIGKILL);
   }
   /* Now that we've killed the forkserver, we wait for it to be able to get rusage stats. */
@@ -12067,6 +12883,7 @@ int main(int argc, char** argv) {
   write_bitmap();
   write_stats_file(0, 0, 0);
   save_auto();
+  write_ipsm_dot();
 
 stop_fuzzing:
 
@@ -12095,12 +12912,21 @@ stop_fuzzing:
       g_monitor = NULL;
       g_monitor_initialized = 0;
   }
+  if (pred_adapter) {
+      pred_adapter->destroy(pred_ctx);
+      pred_ctx = NULL;
+  }
+  pred_stream_free(&resp_stream);
+  ck_free(trace_refs);
   destroy_queue();
   destroy_extras();
   ck_free(target_path);
   ck_free(sync_id);
   ck_free(iptables_add);
   ck_free(iptables_del);
+  snap_nft_fini();
+  track_child(0);
+  if (use_snapshot) snapshot_store_destroy();
 
   destroy_ipsm();
 
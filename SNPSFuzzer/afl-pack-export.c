@@ -0,0 +1,120 @@
+/*
+   SNPSFuzzer - corpus pack export
+   -------------------------------
+
+   Turns out_dir/corpus.pack back into one file per record, laid out as
+   afl-fuzz wrote them before the pack existed:
+
+     afl-pack-export out/corpus.pack out
+
+   fills out/replayable-queue/ and out/replayable-new-ipsm-paths/, ready for
+   aflnet-replay and afl-replay. The queue entries in the pack duplicate
+   out/queue/ and are skipped unless -a is given. Without a target
+   directory, the records are listed instead.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "types.h"
+#include "debug.h"
+#include "alloc-inl.h"
+#include "corpus_pack.h"
+
+
+static void usage(u8* argv0) {
+
+  SAYF("Usage: %s [ -a ] pack_file [ out_dir ]\n\n"
+       "  -a       - also export the queue entries (a copy of out_dir/queue)\n\n"
+       "Without out_dir, lists the records in the pack.\n", argv0);
+  exit(1);
+
+}
+
+
+int main(int argc, char** argv) {
+
+  corpus_pack_t pack;
+  pack_rec_t rec;
+  u64 off = 0, name_off, data_off;
+  u32 count = 0, skipped = 0;
+  u8 all = 0, made[PACK_KINDS] = { 0 };
+  u8 *pack_file, *out_dir;
+  s32 opt;
+
+  while ((opt = getopt(argc, argv, "a")) > 0)
+    switch (opt) {
+      case 'a': all = 1; break;
+      default:  usage(argv[0]);
+    }
+
+  if (optind != argc - 1 && optind != argc - 2) usage(argv[0]);
+
+  pack_file = argv[optind];
+  out_dir   = argv[optind + 1];
+
+  if (pack_open(&pack, pack_file)) PFATAL("Unable to open '%s'", pack_file);
+
+  while ((off = pack_next(&pack, off, &rec, &name_off, &data_off))) {
+
+    u8* name = ck_alloc(rec.name_len + 1);
+    u8* fn;
+    s32 fd;
+
+    memcpy(name, pack_data(&pack, name_off, rec.name_len), rec.name_len);
+
+    if (!out_dir) {
+
+      printf("%s/%s %u\n", pack_kind_dirs[rec.kind], name, rec.len);
+      ck_free(name);
+      count++;
+      continue;
+
+    }
+
+    if (!rec.name_len || strchr(name, '/') || !strcmp(name, ".") || !strcmp(name, ".."))
+      FATAL("Record at offset %llu has a bad name", (u64)(name_off - sizeof(rec)));
+
+    if (rec.kind == PACK_QUEUE && !all) {
+      ck_free(name);
+      skipped++;
+      continue;
+    }
+
+    if (!made[rec.kind]) {
+      fn = alloc_printf("%s/%s", out_dir, pack_kind_dirs[rec.kind]);
+      if (mkdir(fn, 0700) && errno != EEXIST) PFATAL("Unable to create '%s'", fn);
+      ck_free(fn);
+      made[rec.kind] = 1;
+    }
+
+    /* Later records of the same name win, as rewrites of the file did */
+
+    fn = alloc_printf("%s/%s/%s", out_dir, pack_kind_dirs[rec.kind], name);
+    fd = open(fn, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) PFATAL("Unable to create '%s'", fn);
+    ck_write(fd, pack_data(&pack, data_off, rec.len), rec.len, fn);
+    close(fd);
+
+    ck_free(fn);
+    ck_free(name);
+    count++;
+
+  }
+
+  if (errno == EILSEQ)
+    WARNF("Pack is torn or corrupt after %u records, the rest is lost", count + skipped);
+
+  if (out_dir)
+    OKF("Exported %u records to '%s' (%u queue entries skipped).", count, out_dir, skipped);
+
+  pack_close(&pack);
+  return 0;
+
+}
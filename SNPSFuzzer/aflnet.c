@@ -2,7 +2,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <fcntl.h>
@@ -1551,6 +1554,31 @@ klist_t(lms) *construct_kl_messages_mx(klist_t(lms) *kl_messages, kliter_t(lms)
 
 // kl_messages manipulating functions
 
+klist_t(lms) *construct_kl_messages_buf(const u8* buf, u32 buf_len, region_t *regions, u32 region_count)
+{
+  klist_t(lms) *kl_messages = kl_init(lms);
+  u32 i, pos = 0;
+
+  for (i = 0; i < region_count; i++) {
+    //Identify region size
+    u32 len = regions[i].end_byte - regions[i].start_byte + 1;
+
+    //Create a new message
+    message_t *m = (message_t *) ck_alloc(sizeof(message_t));
+    m->mdata = (char *) ck_alloc(len);
+    m->msize = len;
+
+    //Like a short read from the seed file, a region past the end stays zeroed
+    if (pos < buf_len) memcpy(m->mdata, buf + pos, MIN(len, buf_len - pos));
+    pos += len;
+
+    //Insert the message to the linked list
+    *kl_pushp(lms, kl_messages) = m;
+  }
+
+  return kl_messages;
+}
+
 klist_t(lms) *construct_kl_messages(u8* fname, region_t *regions, u32 region_count)
 {
   FILE *fseed = NULL;
@@ -1608,39 +1636,49 @@ kliter_t(lms) *get_last_message(klist_t(lms) *kl_messages)
 }
 
 
-u32 save_kl_messages_to_file(klist_t(lms) *kl_messages, u8 *fname, u8 replay_enabled, u32 max_count)
+u8 *kl_messages_to_buf(klist_t(lms) *kl_messages, u8 replay_enabled, u32 max_count, u32 *len_ref)
 {
-  u8 *mem = NULL;
-  u32 len = 0, message_size = 0;
+  u8 *mem = NULL, *pos;
+  u32 len = 0, message_size = 0, message_count = 0;
   kliter_t(lms) *it;
 
-  s32 fd = open(fname, O_WRONLY | O_CREAT, 0600);
-  if (fd < 0) PFATAL("Unable to create file '%s'", fname);
+  //Size everything up first, so the buffer is allocated once
+  for (it = kl_begin(kl_messages); it != kl_end(kl_messages) && message_count < max_count; it = kl_next(it)) {
+    len += kl_val(it)->msize + (replay_enabled ? 4 : 0);
+    message_count++;
+  }
 
-  u32 message_count = 0;
+  if (len) mem = ck_alloc_nozero(len);
+  pos = mem;
+
+  message_count = 0;
   //Iterate through all messages in the linked list
   for (it = kl_begin(kl_messages); it != kl_end(kl_messages) && message_count < max_count; it = kl_next(it)) {
     message_size = kl_val(it)->msize;
     if (replay_enabled) {
-		  mem = (u8 *)ck_realloc(mem, 4 + len + message_size);
-
       //Save packet size first
-      u32 *psize = (u32*)&mem[len];
-      *psize = message_size;
-
-      //Save packet content
-      memcpy(&mem[len + 4], kl_val(it)->mdata, message_size);
-      len = 4 + len + message_size;
-    } else {
-      mem = (u8 *)ck_realloc(mem, len + message_size);
-
-      //Save packet content
-      memcpy(&mem[len], kl_val(it)->mdata, message_size);
-      len = len + message_size;
+      memcpy(pos, &message_size, 4);
+      pos += 4;
     }
+
+    //Save packet content
+    memcpy(pos, kl_val(it)->mdata, message_size);
+    pos += message_size;
     message_count++;
   }
 
+  *len_ref = len;
+  return mem;
+}
+
+u32 save_kl_messages_to_file(klist_t(lms) *kl_messages, u8 *fname, u8 replay_enabled, u32 max_count)
+{
+  u32 len;
+  u8 *mem = kl_messages_to_buf(kl_messages, replay_enabled, max_count, &len);
+
+  s32 fd = open(fname, O_WRONLY | O_CREAT, 0600);
+  if (fd < 0) PFATAL("Unable to create file '%s'", fname);
+
   //Write everything to file & close the file
   ck_write(fd, mem, len, fname);
   close(fd);
@@ -1680,73 +1718,251 @@ region_t* convert_kl_messages_to_regions(klist_t(lms) *kl_messages, u32* region_
 
 // Network communication functions
 
+/* Set by the fuzzer for protocols whose replies can be recognised as
+   complete; NULL makes net_recv() wait for the server to go quiet. */
+u8 (*response_complete)(unsigned char* buf, unsigned int buf_size) = NULL;
+
+u32 net_recv_first_us;
+
+/* SO_SNDTIMEO is set once, when the socket is created */
 int net_send(int sockfd, struct timeval timeout, char *mem, unsigned int len) {
   unsigned int byte_count = 0;
   int n;
-  struct pollfd pfd[1];
-  pfd[0].fd = sockfd;
-  pfd[0].events = POLLOUT;
-  int rv = poll(pfd, 1, 1);
-
-  setsockopt(sockfd, SOL_SOCKET, SO_SNDTIMEO, (char *)&timeout, sizeof(timeout));
-  if (rv > 0) {
-    if (pfd[0].revents & POLLOUT) {
-      while (byte_count < len) {
-        usleep(10);
-        n = send(sockfd, &mem[byte_count], len - byte_count, MSG_NOSIGNAL);
-        if (n == 0) return byte_count;
-        if (n == -1) return -1;
-        byte_count += n;
-      }
-    }
+
+  while (byte_count < len) {
+    n = send(sockfd, &mem[byte_count], len - byte_count, MSG_NOSIGNAL);
+    if (n == 0) return byte_count;
+    if (n == -1) return -1;
+    byte_count += n;
   }
   return byte_count;
 }
 
+/* Make room for at least need bytes in a ck_alloc'd buffer, doubling its
+   size so that a long response costs a logarithmic number of reallocs */
+static void grow_response_buf(char **buf, unsigned int need) {
+  unsigned int size = *buf ? ALLOC_S(*buf) : 0;
+
+  if (need <= size) return;
+  if (need < size * 2) need = size * 2;
+  *buf = (char *)ck_realloc(*buf, need);
+}
+
+/* Wait up to poll_w ms for the response to start, then keep draining the
+   socket until the response is complete or the server has been quiet for
+   timeout. Appends to *response_buf, which stays NUL-terminated */
 int net_recv(int sockfd, struct timeval timeout, int poll_w, char **response_buf, unsigned int *len) {
-  char temp_buf[1000];
-  int n;
-  struct pollfd pfd[1];
-  pfd[0].fd = sockfd;
-  pfd[0].events = POLLIN;
-  int rv; 
-POLL_AGAIN:  
-  rv = poll(pfd, 1, poll_w);
-
-  setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, (char *)&timeout, sizeof(timeout));
-  // data received
-  if (rv > 0) {
-    if (pfd[0].revents & POLLIN) {
-      n = recv(sockfd, temp_buf, sizeof(temp_buf), 0);
-      if ((n < 0) && (errno != EAGAIN) && (errno != EINTR)) {
-        return 1;
-      }
-      while (n > 0) {
-        usleep(10);
-        *response_buf = (unsigned char *)ck_realloc(*response_buf, *len + n + 1);
-        memcpy(&(*response_buf)[*len], temp_buf, n);
-        (*response_buf)[(*len) + n] = '\0';
+  static int epfd = -1;
+  struct epoll_event ev;
+  unsigned int start = *len;
+  int wait_ms = poll_w;
+  int rv, n;
+  struct timespec t0, t1;
+
+  if (epfd < 0 && (epfd = epoll_create1(EPOLL_CLOEXEC)) < 0) return 1;
+
+  // registrations vanish when a socket is closed, its fd number may be reused
+  ev.events = EPOLLIN;
+  ev.data.fd = sockfd;
+  if (epoll_ctl(epfd, EPOLL_CTL_ADD, sockfd, &ev) && errno != EEXIST) return 1;
+
+  net_recv_first_us = UINT32_MAX;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+
+  while (1) {
+    rv = epoll_wait(epfd, &ev, 1, wait_ms);
+    if (rv < 0) {
+      if (errno == EINTR) continue;
+      return 1;
+    }
+    // poll timeout, or the server went quiet
+    if (rv == 0) return 0;
+
+    if (net_recv_first_us == UINT32_MAX) {
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      net_recv_first_us = (t1.tv_sec - t0.tv_sec) * 1000000 + (t1.tv_nsec - t0.tv_nsec) / 1000;
+    }
+
+    do {
+      grow_response_buf(response_buf, *len + NET_RECV_CHUNK + 1);
+      n = recv(sockfd, &(*response_buf)[*len], ALLOC_S(*response_buf) - *len - 1, MSG_DONTWAIT);
+      if (n > 0) {
         *len = *len + n;
-        n = recv(sockfd, temp_buf, sizeof(temp_buf), 0);
-        if ((n < 0) && (errno != EAGAIN) && (errno != EINTR)) {
-          return 1;
-        }
+        (*response_buf)[*len] = '\0';
       }
+    } while (n > 0);
+
+    if ((n < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) return 1;
+    if (n == 0) return 0;
+
+    if (response_complete && (*len > start) &&
+        response_complete((unsigned char *)&(*response_buf)[start], *len - start))
+      return 0;
+
+    wait_ms = timeout.tv_sec * 1000 + (timeout.tv_usec + 999) / 1000;
+  }
+}
+
+// Response completion predicates, over the bytes of one net_recv() call
+
+/* FTP, SMTP: the last line is a final reply line ("ddd " or "ddd\r\n").
+   1yz replies are preliminary (FTP "150 Opening data connection"): the
+   final one is still to come, so keep reading */
+static u8 reply_line_complete(unsigned char* buf, unsigned int buf_size) {
+  unsigned int i;
+
+  if (buf_size < 5 || buf[buf_size - 2] != 0x0D || buf[buf_size - 1] != 0x0A) return 0;
+
+  // start of the last line
+  for (i = buf_size - 2; i > 0 && buf[i - 1] != 0x0A; i--);
+
+  if (buf_size - i < 5) return 0;
+  if (!isdigit(buf[i]) || !isdigit(buf[i + 1]) || !isdigit(buf[i + 2])) return 0;
+  if (buf[i] == '1') return 0;
+  return buf[i + 3] == ' ' || buf[i + 3] == 0x0D;
+}
+
+u8 response_complete_ftp(unsigned char* buf, unsigned int buf_size) {
+  return reply_line_complete(buf, buf_size);
+}
+
+u8 response_complete_smtp(unsigned char* buf, unsigned int buf_size) {
+  return reply_line_complete(buf, buf_size);
+}
+
+/* DNS over UDP: one datagram is one message, anything past the header */
+u8 response_complete_dns(unsigned char* buf, unsigned int buf_size) {
+  return buf_size >= 12;
+}
+
+/* TLS: whole records only, 5 bytes of header with the length at 3..4 */
+u8 response_complete_tls(unsigned char* buf, unsigned int buf_size) {
+  unsigned int byte_count = 0;
+
+  while (byte_count + 5 <= buf_size)
+    byte_count += 5 + read_bytes_to_uint32(buf, byte_count + 3, 2);
+
+  return byte_count == buf_size;
+}
+
+/* DTLS 1.2: whole records only, 13 bytes of header with the length at 11..12 */
+u8 response_complete_dtls12(unsigned char* buf, unsigned int buf_size) {
+  unsigned int byte_count = 0;
+
+  while (byte_count + 13 <= buf_size)
+    byte_count += 13 + read_bytes_to_uint32(buf, byte_count + 11, 2);
+
+  return byte_count == buf_size;
+}
+
+/* RTSP, SIP, HTTP: length of the complete message at buf (header block
+   and as many body bytes as Content-Length announces), 0 if it has not
+   all arrived */
+static unsigned int text_message_len(unsigned char* buf, unsigned int buf_size) {
+  unsigned char *end = NULL, *cl;
+  unsigned int body = 0, i;
+
+  for (i = 0; i + 4 <= buf_size; i++) {
+    if (!memcmp(&buf[i], "\r\n\r\n", 4)) {
+      end = &buf[i];
+      break;
     }
-  } else
-    if ((rv < 0) && (errno != EINTR)) // an error was returned
-      return 1;
-    else 
-    if((rv < 0) && (errno == EINTR)) 
-    {
-      // ACTF("Poll again 1741");
-      goto POLL_AGAIN; 
+  }
+
+  if (!end) return 0;
+
+  for (cl = buf; cl + 15 < end; cl++) {
+    if ((cl == buf || cl[-1] == 0x0A) && !strncasecmp((char *)cl, "Content-Length:", 15)) {
+      for (i = 15; cl + i < end && cl[i] == ' '; i++);
+      body = (unsigned int) atoi((char *)cl + i);
+      break;
     }
-  
-  // rv == 0 poll timeout or all data pending after poll has been received successfully
+  }
+
+  if (buf_size - (end + 4 - buf) < body) return 0;
+  return (end + 4 - buf) + body;
+}
+
+/* "<proto>/<version> 1dd ..." status line: a provisional response (SIP
+   "100 Trying", "180 Ringing", HTTP/RTSP "100 Continue") */
+static u8 provisional_status(unsigned char* buf, unsigned int buf_size) {
+  unsigned int i;
+  u8 slash = 0;
+
+  for (i = 0; i < buf_size && buf[i] != ' ' && buf[i] != 0x0D; i++)
+    if (buf[i] == '/') slash = 1;
+
+  if (!slash || i + 4 > buf_size || buf[i] != ' ') return 0;
+  return buf[i + 1] == '1' && isdigit(buf[i + 2]) && isdigit(buf[i + 3]);
+}
+
+/* Complete once a message that is not a provisional response has fully
+   arrived; provisional ones are followed by the final response */
+static u8 headers_complete(unsigned char* buf, unsigned int buf_size) {
+  unsigned int off = 0, len;
+
+  while ((len = text_message_len(buf + off, buf_size - off))) {
+    if (!provisional_status(buf + off, len)) return 1;
+    off += len;
+  }
+
   return 0;
 }
 
+u8 response_complete_rtsp(unsigned char* buf, unsigned int buf_size) {
+  return headers_complete(buf, buf_size);
+}
+
+u8 response_complete_sip(unsigned char* buf, unsigned int buf_size) {
+  return headers_complete(buf, buf_size);
+}
+
+u8 response_complete_http(unsigned char* buf, unsigned int buf_size) {
+  return headers_complete(buf, buf_size);
+}
+
+// Latency sketch functions
+
+static u32 lat_bucket(u32 usecs) {
+  u32 b;
+
+  if (usecs < 2) return usecs;
+  b = 31 - __builtin_clz(usecs);
+  return 2 * b + ((usecs >> (b - 1)) & 1);
+}
+
+void lat_sketch_add(lat_sketch_t *s, u32 usecs) {
+  u32 i;
+
+  if (s->count >= LAT_DECAY) {
+    s->count = 0;
+    for (i = 0; i < LAT_BUCKETS; i++) {
+      s->bucket[i] >>= 1;
+      s->count += s->bucket[i];
+    }
+  }
+
+  s->bucket[lat_bucket(usecs)]++;
+  s->count++;
+}
+
+u32 lat_sketch_quantile(lat_sketch_t *s, u32 pct) {
+  u64 target = ((u64)s->count * pct + 99) / 100, seen = 0;
+  u32 i, b;
+
+  if (!s->count) return 0;
+
+  for (i = 0; i < LAT_BUCKETS - 1; i++) {
+    seen += s->bucket[i];
+    if (seen >= target) break;
+  }
+
+  // the largest value that falls in bucket i
+  if (i < 2) return i;
+  b = i / 2;
+  return (1U << b) + ((i & 1) + 1) * (1U << (b - 1)) - 1;
+}
+
 // Utility function
 
 void save_regions_to_file(region_t *regions, unsigned int region_count, unsigned char *fname)
@@ -29,6 +29,16 @@ typedef struct {
   int msize;   /* Message size */
 } message_t;
 
+/* Streaming sketch of response latencies (us): half-octave buckets, enough
+   for a tail quantile without keeping samples. Counts are halved every
+   LAT_DECAY samples so the sketch follows the server's current behaviour. */
+#define LAT_BUCKETS 64
+
+typedef struct {
+  u32 count;
+  u32 bucket[LAT_BUCKETS];
+} lat_sketch_t;
+
 typedef struct {
   u32 id;                     /* state id */
   u8 is_covered;              /* has this state been covered */
@@ -40,8 +50,25 @@ typedef struct {
   u32 selected_seed_index;    /* the recently selected seed index */
   void **seeds;               /* keeps all seeds reaching this state -- can be casted to struct queue_entry* */
   u32 seeds_count;            /* total number of seeds, it must be equal the size of the seeds array */
+  lat_sketch_t latency;       /* first-byte latencies of responses received in this state */
+  u8 ipsm_node;               /* IPSM_NONE until the state is part of the state machine */
+  u32 mark;                   /* last state sequence that counted this state */
+  u16 monitor_near;           /* closest a seed reaching this state came to a violation (1/1000) */
 } state_info_t;
 
+/* How a state or transition entered the implemented state machine */
+enum {
+  /* 00 */ IPSM_NONE,
+  /* 01 */ IPSM_SEED,       /* while running the initial seeds */
+  /* 02 */ IPSM_FUZZ        /* while fuzzing */
+};
+
+typedef struct {
+  u32 from, to;               /* state ids */
+  u32 hits;                   /* times seen in interesting state sequences */
+  u8 found;                   /* IPSM_SEED or IPSM_FUZZ */
+} ipsm_edge_t;
+
 enum {
   /* 00 */ PRO_TCP,
   /* 01 */ PRO_UDP
@@ -51,7 +78,8 @@ enum {
   /* 00 */ INVALID_SELECTION,
   /* 01 */ RANDOM_SELECTION,
   /* 02 */ ROUND_ROBIN,
-  /* 03 */ FAVOR
+  /* 03 */ FAVOR,
+  /* 04 */ NEAR_VIOLATION   /* FAVOR, weighted by the LTL monitor's closeness */
 };
 
 enum {
@@ -71,6 +99,9 @@ KHASH_SET_INIT_INT(hs32)
 //ljq
 KHASH_MAP_INIT_INT(m32, u32)
 
+// IPSM transitions, (from << 32 | to) -> index
+KHASH_MAP_INIT_INT64(m64, u32)
+
 // Initialize a hash table with int key and value is of type state_info_t
 KHASH_INIT(hms, khint32_t, state_info_t *, 1, kh_int_hash_func, kh_int_hash_equal)
 
@@ -111,10 +142,36 @@ extern region_t* (*extract_requests)(unsigned char* buf, unsigned int buf_size,
 int net_send(int sockfd, struct timeval timeout, char *mem, unsigned int len);
 int net_recv(int sockfd, struct timeval timeout, int poll_w, char **response_buf, unsigned int *len);
 
+/* Response completion predicates: does buf hold a complete server reply? net_recv() stops
+   waiting as soon as the one in response_complete says so. Preliminary 1xx replies do not
+   count; the final reply that follows them does */
+u8 response_complete_ftp(unsigned char* buf, unsigned int buf_size);
+u8 response_complete_smtp(unsigned char* buf, unsigned int buf_size);
+u8 response_complete_dns(unsigned char* buf, unsigned int buf_size);
+u8 response_complete_tls(unsigned char* buf, unsigned int buf_size);
+u8 response_complete_dtls12(unsigned char* buf, unsigned int buf_size);
+u8 response_complete_rtsp(unsigned char* buf, unsigned int buf_size);
+u8 response_complete_sip(unsigned char* buf, unsigned int buf_size);
+u8 response_complete_http(unsigned char* buf, unsigned int buf_size);
+extern u8 (*response_complete)(unsigned char* buf, unsigned int buf_size);
+
+/* Microseconds the last net_recv() waited for the first byte, UINT32_MAX if nothing came */
+extern u32 net_recv_first_us;
+
+// Latency sketch functions
+
+/* Record one latency */
+void lat_sketch_add(lat_sketch_t *s, u32 usecs);
+
+/* Upper bound of the pct-th percentile of the recorded latencies, 0 if there are none */
+u32 lat_sketch_quantile(lat_sketch_t *s, u32 pct);
+
 // kl_messages manipulating functions
 
 /* Construct a new linked list to store all messages from a list of regions */
 klist_t(lms) *construct_kl_messages(u8* fname, region_t *regions, u32 region_count);
+/* Same, from the seed's contents already in memory */
+klist_t(lms) *construct_kl_messages_buf(const u8* buf, u32 buf_len, region_t *regions, u32 region_count);
 klist_t(lms) *construct_kl_messages_mx(klist_t(lms) *kl_messages, kliter_t(lms) *M2_prev, u8 flag);
 
 /* Free all items and delete kl_messages */
@@ -126,6 +183,9 @@ kliter_t(lms) *get_last_message(klist_t(lms) *kl_messages);
 /* Save a list of messages to a file. If replay_enabled is set, the file will be structured for replaying. Otherwise, just save the raw data */
 u32 save_kl_messages_to_file(klist_t(lms) *kl_messages, u8 *fname, u8 replay_enabled, u32 max_count);
 
+/* The contents save_kl_messages_to_file() would write, in a ck_alloc'd buffer (NULL if empty) */
+u8 *kl_messages_to_buf(klist_t(lms) *kl_messages, u8 replay_enabled, u32 max_count, u32 *len_ref);
+
 /* Convert back a linked list of messages to regions to maintain the message sequence structure as much as possible */
 region_t* convert_kl_messages_to_regions(klist_t(lms) *kl_messages, u32* region_count_ref, u32 max_count);
 
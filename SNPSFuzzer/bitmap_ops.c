@@ -0,0 +1,705 @@
+/*
+   SNPSFuzzer - coverage bitmap kernels
+   ------------------------------------
+
+   See bitmap_ops.h. The vector flavors are compiled with per-function
+   target attributes, so the rest of the build keeps its baseline flags and
+   a binary built here still runs on CPUs without them.
+
+*/
+
+#include "bitmap_ops.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  define BM_X86 1
+#  include <immintrin.h>
+#endif
+
+bitmap_ops_t bm_ops;
+
+
+/* ---------- Scalar (the classic AFL loops) ---------- */
+
+static const u8 count_class_lookup8[256] = {
+
+  [0]           = 0,
+  [1]           = 1,
+  [2]           = 2,
+  [3]           = 4,
+  [4 ... 7]     = 8,
+  [8 ... 15]    = 16,
+  [16 ... 31]   = 32,
+  [32 ... 127]  = 64,
+  [128 ... 255] = 128
+
+};
+
+static u16 count_class_lookup16[65536];
+
+static const u8 simplify_lookup[256] = {
+
+  [0]         = 1,
+  [1 ... 255] = 128
+
+};
+
+static void init_count_class16(void) {
+
+  u32 b1, b2;
+
+  for (b1 = 0; b1 < 256; b1++)
+    for (b2 = 0; b2 < 256; b2++)
+      count_class_lookup16[(b1 << 8) + b2] =
+      (count_class_lookup8[b1] << 8) |
+      count_class_lookup8[b2];
+
+}
+
+static u8 has_new_bits_scalar(const u8* trace, u8* virgin_map, u32 len) {
+
+  const u64* current = (const u64*)trace;
+  u64* virgin = (u64*)virgin_map;
+  u32  i = len >> 3;
+  u8   ret = 0;
+
+  while (i--) {
+
+    /* Optimize for (*current & *virgin) == 0 - i.e., no bits in current bitmap
+       that have not been already cleared from the virgin map - since this will
+       almost always be the case. */
+
+    if (unlikely(*current) && unlikely(*current & *virgin)) {
+
+      if (likely(ret < 2)) {
+
+        const u8* cur = (const u8*)current;
+        u8* vir = (u8*)virgin;
+
+        if ((cur[0] && vir[0] == 0xff) || (cur[1] && vir[1] == 0xff) ||
+          (cur[2] && vir[2] == 0xff) || (cur[3] && vir[3] == 0xff) ||
+          (cur[4] && vir[4] == 0xff) || (cur[5] && vir[5] == 0xff) ||
+          (cur[6] && vir[6] == 0xff) || (cur[7] && vir[7] == 0xff)) ret = 2;
+        else ret = 1;
+
+      }
+
+      *virgin &= ~*current;
+
+    }
+
+    current++;
+    virgin++;
+
+  }
+
+  return ret;
+
+}
+
+static u8 classify_scalar(u8* trace, const u8* virgin_map, u32 len) {
+
+  u64* mem = (u64*)trace;
+  const u64* virgin = (const u64*)virgin_map;
+  u32 i = len >> 3;
+  u64 hit = 0;
+
+  while (i--) {
+
+    /* Optimize for sparse bitmaps. */
+
+    if (unlikely(*mem)) {
+
+      u16* mem16 = (u16*)mem;
+
+      mem16[0] = count_class_lookup16[mem16[0]];
+      mem16[1] = count_class_lookup16[mem16[1]];
+      mem16[2] = count_class_lookup16[mem16[2]];
+      mem16[3] = count_class_lookup16[mem16[3]];
+
+      if (virgin) hit |= *mem & *virgin;
+
+    }
+
+    mem++;
+    if (virgin) virgin++;
+
+  }
+
+  return !!hit;
+
+}
+
+static void simplify_scalar(u8* trace, u32 len) {
+
+  u64* mem = (u64*)trace;
+  u32 i = len >> 3;
+
+  while (i--) {
+
+    /* Optimize for sparse bitmaps. */
+
+    if (unlikely(*mem)) {
+
+      u8* mem8 = (u8*)mem;
+
+      mem8[0] = simplify_lookup[mem8[0]];
+      mem8[1] = simplify_lookup[mem8[1]];
+      mem8[2] = simplify_lookup[mem8[2]];
+      mem8[3] = simplify_lookup[mem8[3]];
+      mem8[4] = simplify_lookup[mem8[4]];
+      mem8[5] = simplify_lookup[mem8[5]];
+      mem8[6] = simplify_lookup[mem8[6]];
+      mem8[7] = simplify_lookup[mem8[7]];
+
+    } else *mem = 0x0101010101010101ULL;
+
+    mem++;
+
+  }
+
+}
+
+static u8 reset_virgin_scalar(const u8* trace, u8* virgin_map, u32 len) {
+
+  const u64* current = (const u64*)trace;
+  u64* virgin = (u64*)virgin_map;
+  u32 i = len >> 3;
+  u64 any = 0;
+
+  while (i--) {
+    any |= *current;
+    *(virgin++) = ~*(current++);
+  }
+
+  return any ? 2 : 0;
+
+}
+
+static u32 count_bits_scalar(const u8* mem, u32 len) {
+
+  const u32* ptr = (const u32*)mem;
+  u32  i   = len >> 2;
+  u32  ret = 0;
+
+  while (i--) {
+
+    u32 v = *(ptr++);
+
+    /* This gets called on the inverse, virgin bitmap; optimize for sparse
+       data. */
+
+    if (v == 0xffffffff) {
+      ret += 32;
+      continue;
+    }
+
+    v -= ((v >> 1) & 0x55555555);
+    v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+    ret += (((v + (v >> 4)) & 0xF0F0F0F) * 0x01010101) >> 24;
+
+  }
+
+  return ret;
+
+}
+
+#define FF(_b)  (0xff << ((_b) << 3))
+
+static u32 count_bytes_scalar(const u8* mem, u32 len) {
+
+  const u32* ptr = (const u32*)mem;
+  u32  i   = len >> 2;
+  u32  ret = 0;
+
+  while (i--) {
+
+    u32 v = *(ptr++);
+
+    if (!v) continue;
+    if (v & FF(0)) ret++;
+    if (v & FF(1)) ret++;
+    if (v & FF(2)) ret++;
+    if (v & FF(3)) ret++;
+
+  }
+
+  return ret;
+
+}
+
+static u32 count_non_255_bytes_scalar(const u8* mem, u32 len) {
+
+  const u32* ptr = (const u32*)mem;
+  u32  i   = len >> 2;
+  u32  ret = 0;
+
+  while (i--) {
+
+    u32 v = *(ptr++);
+
+    /* This is called on the virgin bitmap, so optimize for the most likely
+       case. */
+
+    if (v == 0xffffffff) continue;
+    if ((v & FF(0)) != FF(0)) ret++;
+    if ((v & FF(1)) != FF(1)) ret++;
+    if ((v & FF(2)) != FF(2)) ret++;
+    if ((v & FF(3)) != FF(3)) ret++;
+
+  }
+
+  return ret;
+
+}
+
+#undef FF
+
+
+#ifdef BM_X86
+
+/* Classification without the lookup table: a byte with a non-zero high
+   nibble maps to 32, 64 or 128 by that nibble alone, one below 16 by its
+   low nibble to at most 16. Both nibbles go through a 16-entry byte
+   shuffle and the larger result wins. */
+
+#define BM_LO_LUT 0, 1, 2, 4, 8, 8, 8, 8, 16, 16, 16, 16, 16, 16, 16, 16
+#define BM_HI_LUT 0, 32, 64, 64, 64, 64, 64, 64, \
+                  (char)128, (char)128, (char)128, (char)128, \
+                  (char)128, (char)128, (char)128, (char)128
+
+/* The counts are only status screen material; one popcnt per word. */
+
+__attribute__((target("popcnt")))
+static u32 count_bits_popcnt(const u8* mem, u32 len) {
+
+  u32 i, ret = 0;
+  u64 v;
+
+  for (i = 0; i < len; i += 8) {
+    memcpy(&v, mem + i, 8);
+    ret += __builtin_popcountll(v);
+  }
+
+  return ret;
+
+}
+
+
+/* ---------- SSSE3, 16 bytes at a time ---------- */
+
+__attribute__((target("ssse3")))
+static u8 has_new_bits_ssse3(const u8* trace, u8* virgin, u32 len) {
+
+  const __m128i zero = _mm_setzero_si128(), ff = _mm_set1_epi8(-1);
+  u32 i;
+  u8 ret = 0;
+
+  for (i = 0; i < len; i += 16) {
+
+    __m128i c = _mm_loadu_si128((const __m128i*)(trace + i));
+    __m128i v = _mm_loadu_si128((const __m128i*)(virgin + i));
+
+    if (likely(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(c, v), zero)) == 0xffff))
+      continue;
+
+    /* A non-zero byte of the trace over a 0xff byte of the virgin map is a
+       new tuple. */
+
+    if (likely(ret < 2)) {
+      u32 hit = ~_mm_movemask_epi8(_mm_cmpeq_epi8(c, zero)) &
+                _mm_movemask_epi8(_mm_cmpeq_epi8(v, ff));
+      ret = (hit & 0xffff) ? 2 : 1;
+    }
+
+    _mm_storeu_si128((__m128i*)(virgin + i), _mm_andnot_si128(c, v));
+
+  }
+
+  return ret;
+
+}
+
+__attribute__((target("ssse3")))
+static u8 classify_ssse3(u8* trace, const u8* virgin, u32 len) {
+
+  const __m128i lo_lut = _mm_setr_epi8(BM_LO_LUT), hi_lut = _mm_setr_epi8(BM_HI_LUT);
+  const __m128i nib = _mm_set1_epi8(0x0f), zero = _mm_setzero_si128();
+  __m128i hit = zero;
+  u32 i;
+
+  for (i = 0; i < len; i += 16) {
+
+    __m128i c = _mm_loadu_si128((const __m128i*)(trace + i));
+
+    if (likely(_mm_movemask_epi8(_mm_cmpeq_epi8(c, zero)) == 0xffff)) continue;
+
+    c = _mm_max_epu8(_mm_shuffle_epi8(lo_lut, _mm_and_si128(c, nib)),
+                     _mm_shuffle_epi8(hi_lut, _mm_and_si128(_mm_srli_epi16(c, 4), nib)));
+    _mm_storeu_si128((__m128i*)(trace + i), c);
+
+    if (virgin)
+      hit = _mm_or_si128(hit, _mm_and_si128(c, _mm_loadu_si128((const __m128i*)(virgin + i))));
+
+  }
+
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(hit, zero)) != 0xffff;
+
+}
+
+__attribute__((target("ssse3")))
+static void simplify_ssse3(u8* trace, u32 len) {
+
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi8(1), top = _mm_set1_epi8((char)0x80);
+  u32 i;
+
+  for (i = 0; i < len; i += 16) {
+    __m128i z = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(trace + i)), zero);
+    _mm_storeu_si128((__m128i*)(trace + i),
+                     _mm_or_si128(_mm_and_si128(z, one), _mm_andnot_si128(z, top)));
+  }
+
+}
+
+__attribute__((target("ssse3")))
+static u8 reset_virgin_ssse3(const u8* trace, u8* virgin, u32 len) {
+
+  const __m128i zero = _mm_setzero_si128(), ff = _mm_set1_epi8(-1);
+  __m128i any = zero;
+  u32 i;
+
+  for (i = 0; i < len; i += 16) {
+    __m128i c = _mm_loadu_si128((const __m128i*)(trace + i));
+    any = _mm_or_si128(any, c);
+    _mm_storeu_si128((__m128i*)(virgin + i), _mm_xor_si128(c, ff));
+  }
+
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(any, zero)) != 0xffff ? 2 : 0;
+
+}
+
+__attribute__((target("ssse3,popcnt")))
+static u32 count_bytes_ssse3(const u8* mem, u32 len) {
+
+  const __m128i zero = _mm_setzero_si128();
+  u32 i, ret = 0;
+
+  for (i = 0; i < len; i += 16)
+    ret += 16 - __builtin_popcount(_mm_movemask_epi8(
+             _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(mem + i)), zero)));
+
+  return ret;
+
+}
+
+__attribute__((target("ssse3,popcnt")))
+static u32 count_non_255_bytes_ssse3(const u8* mem, u32 len) {
+
+  const __m128i ff = _mm_set1_epi8(-1);
+  u32 i, ret = 0;
+
+  for (i = 0; i < len; i += 16)
+    ret += 16 - __builtin_popcount(_mm_movemask_epi8(
+             _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(mem + i)), ff)));
+
+  return ret;
+
+}
+
+
+/* ---------- AVX2, 32 bytes at a time ---------- */
+
+__attribute__((target("avx2")))
+static u8 has_new_bits_avx2(const u8* trace, u8* virgin, u32 len) {
+
+  const __m256i zero = _mm256_setzero_si256(), ff = _mm256_set1_epi8(-1);
+  u32 i;
+  u8 ret = 0;
+
+  for (i = 0; i < len; i += 32) {
+
+    __m256i c = _mm256_loadu_si256((const __m256i*)(trace + i));
+    __m256i v = _mm256_loadu_si256((const __m256i*)(virgin + i));
+
+    if (likely(_mm256_testz_si256(c, v))) continue;
+
+    if (likely(ret < 2)) {
+      __m256i nw = _mm256_andnot_si256(_mm256_cmpeq_epi8(c, zero), _mm256_cmpeq_epi8(v, ff));
+      ret = _mm256_testz_si256(nw, nw) ? 1 : 2;
+    }
+
+    _mm256_storeu_si256((__m256i*)(virgin + i), _mm256_andnot_si256(c, v));
+
+  }
+
+  return ret;
+
+}
+
+__attribute__((target("avx2")))
+static u8 classify_avx2(u8* trace, const u8* virgin, u32 len) {
+
+  const __m256i lo_lut = _mm256_setr_epi8(BM_LO_LUT, BM_LO_LUT);
+  const __m256i hi_lut = _mm256_setr_epi8(BM_HI_LUT, BM_HI_LUT);
+  const __m256i nib = _mm256_set1_epi8(0x0f);
+  __m256i hit = _mm256_setzero_si256();
+  u32 i;
+
+  for (i = 0; i < len; i += 32) {
+
+    __m256i c = _mm256_loadu_si256((const __m256i*)(trace + i));
+
+    if (likely(_mm256_testz_si256(c, c))) continue;
+
+    c = _mm256_max_epu8(_mm256_shuffle_epi8(lo_lut, _mm256_and_si256(c, nib)),
+                        _mm256_shuffle_epi8(hi_lut, _mm256_and_si256(_mm256_srli_epi16(c, 4), nib)));
+    _mm256_storeu_si256((__m256i*)(trace + i), c);
+
+    if (virgin)
+      hit = _mm256_or_si256(hit, _mm256_and_si256(c, _mm256_loadu_si256((const __m256i*)(virgin + i))));
+
+  }
+
+  return !_mm256_testz_si256(hit, hit);
+
+}
+
+__attribute__((target("avx2")))
+static void simplify_avx2(u8* trace, u32 len) {
+
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one = _mm256_set1_epi8(1), top = _mm256_set1_epi8((char)0x80);
+  u32 i;
+
+  for (i = 0; i < len; i += 32) {
+    __m256i z = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(trace + i)), zero);
+    _mm256_storeu_si256((__m256i*)(trace + i), _mm256_blendv_epi8(top, one, z));
+  }
+
+}
+
+__attribute__((target("avx2")))
+static u8 reset_virgin_avx2(const u8* trace, u8* virgin, u32 len) {
+
+  const __m256i ff = _mm256_set1_epi8(-1);
+  __m256i any = _mm256_setzero_si256();
+  u32 i;
+
+  for (i = 0; i < len; i += 32) {
+    __m256i c = _mm256_loadu_si256((const __m256i*)(trace + i));
+    any = _mm256_or_si256(any, c);
+    _mm256_storeu_si256((__m256i*)(virgin + i), _mm256_xor_si256(c, ff));
+  }
+
+  return _mm256_testz_si256(any, any) ? 0 : 2;
+
+}
+
+__attribute__((target("avx2,popcnt")))
+static u32 count_bytes_avx2(const u8* mem, u32 len) {
+
+  const __m256i zero = _mm256_setzero_si256();
+  u32 i, ret = 0;
+
+  for (i = 0; i < len; i += 32)
+    ret += 32 - __builtin_popcount(_mm256_movemask_epi8(
+             _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(mem + i)), zero)));
+
+  return ret;
+
+}
+
+__attribute__((target("avx2,popcnt")))
+static u32 count_non_255_bytes_avx2(const u8* mem, u32 len) {
+
+  const __m256i ff = _mm256_set1_epi8(-1);
+  u32 i, ret = 0;
+
+  for (i = 0; i < len; i += 32)
+    ret += 32 - __builtin_popcount(_mm256_movemask_epi8(
+             _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(mem + i)), ff)));
+
+  return ret;
+
+}
+
+
+/* ---------- AVX-512BW, 64 bytes at a time ---------- */
+
+__attribute__((target("avx512f,avx512bw")))
+static u8 has_new_bits_avx512(const u8* trace, u8* virgin, u32 len) {
+
+  const __m512i ff = _mm512_set1_epi8(-1);
+  u32 i;
+  u8 ret = 0;
+
+  for (i = 0; i < len; i += 64) {
+
+    __m512i c = _mm512_loadu_si512(trace + i);
+    __m512i v = _mm512_loadu_si512(virgin + i);
+
+    if (likely(!_mm512_test_epi64_mask(c, v))) continue;
+
+    if (likely(ret < 2))
+      ret = (_mm512_test_epi8_mask(c, c) & _mm512_cmpeq_epi8_mask(v, ff)) ? 2 : 1;
+
+    _mm512_storeu_si512(virgin + i, _mm512_andnot_si512(c, v));
+
+  }
+
+  return ret;
+
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static u8 classify_avx512(u8* trace, const u8* virgin, u32 len) {
+
+  const __m512i lo_lut = _mm512_broadcast_i32x4(_mm_setr_epi8(BM_LO_LUT));
+  const __m512i hi_lut = _mm512_broadcast_i32x4(_mm_setr_epi8(BM_HI_LUT));
+  const __m512i nib = _mm512_set1_epi8(0x0f);
+  __m512i hit = _mm512_setzero_si512();
+  u32 i;
+
+  for (i = 0; i < len; i += 64) {
+
+    __m512i c = _mm512_loadu_si512(trace + i);
+
+    if (likely(!_mm512_test_epi64_mask(c, c))) continue;
+
+    c = _mm512_max_epu8(_mm512_shuffle_epi8(lo_lut, _mm512_and_si512(c, nib)),
+                        _mm512_shuffle_epi8(hi_lut, _mm512_and_si512(_mm512_srli_epi16(c, 4), nib)));
+    _mm512_storeu_si512(trace + i, c);
+
+    if (virgin)
+      hit = _mm512_or_si512(hit, _mm512_and_si512(c, _mm512_loadu_si512(virgin + i)));
+
+  }
+
+  return !!_mm512_test_epi64_mask(hit, hit);
+
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void simplify_avx512(u8* trace, u32 len) {
+
+  const __m512i one = _mm512_set1_epi8(1), top = _mm512_set1_epi8((char)0x80);
+  u32 i;
+
+  for (i = 0; i < len; i += 64) {
+    __m512i c = _mm512_loadu_si512(trace + i);
+    _mm512_storeu_si512(trace + i, _mm512_mask_blend_epi8(_mm512_test_epi8_mask(c, c), one, top));
+  }
+
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static u8 reset_virgin_avx512(const u8* trace, u8* virgin, u32 len) {
+
+  const __m512i ff = _mm512_set1_epi8(-1);
+  __m512i any = _mm512_setzero_si512();
+  u32 i;
+
+  for (i = 0; i < len; i += 64) {
+    __m512i c = _mm512_loadu_si512(trace + i);
+    any = _mm512_or_si512(any, c);
+    _mm512_storeu_si512(virgin + i, _mm512_xor_si512(c, ff));
+  }
+
+  return _mm512_test_epi64_mask(any, any) ? 2 : 0;
+
+}
+
+__attribute__((target("avx512f,avx512bw,popcnt")))
+static u32 count_bytes_avx512(const u8* mem, u32 len) {
+
+  u32 i, ret = 0;
+
+  for (i = 0; i < len; i += 64) {
+    __m512i c = _mm512_loadu_si512(mem + i);
+    ret += __builtin_popcountll(_mm512_test_epi8_mask(c, c));
+  }
+
+  return ret;
+
+}
+
+__attribute__((target("avx512f,avx512bw,popcnt")))
+static u32 count_non_255_bytes_avx512(const u8* mem, u32 len) {
+
+  const __m512i ff = _mm512_set1_epi8(-1);
+  u32 i, ret = 0;
+
+  for (i = 0; i < len; i += 64)
+    ret += 64 - __builtin_popcountll(_mm512_cmpeq_epi8_mask(_mm512_loadu_si512(mem + i), ff));
+
+  return ret;
+
+}
+
+#endif /* BM_X86 */
+
+
+/* ---------- Selection ---------- */
+
+static const bitmap_ops_t bm_flavors[] = {
+
+  { "scalar", has_new_bits_scalar, classify_scalar, simplify_scalar,
+    reset_virgin_scalar, count_bits_scalar, count_bytes_scalar,
+    count_non_255_bytes_scalar },
+
+#ifdef BM_X86
+
+  { "ssse3", has_new_bits_ssse3, classify_ssse3, simplify_ssse3,
+    reset_virgin_ssse3, count_bits_popcnt, count_bytes_ssse3,
+    count_non_255_bytes_ssse3 },
+
+  { "avx2", has_new_bits_avx2, classify_avx2, simplify_avx2,
+    reset_virgin_avx2, count_bits_popcnt, count_bytes_avx2,
+    count_non_255_bytes_avx2 },
+
+  { "avx512", has_new_bits_avx512, classify_avx512, simplify_avx512,
+    reset_virgin_avx512, count_bits_popcnt, count_bytes_avx512,
+    count_non_255_bytes_avx512 },
+
+#endif /* BM_X86 */
+
+};
+
+/* Index of the widest flavor the CPU (and the kernel, for the vector
+   register state) supports */
+
+static u32 bm_best_flavor(void) {
+
+#ifdef BM_X86
+
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("popcnt"))
+    return 3;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+    return 2;
+  if (__builtin_cpu_supports("ssse3") && __builtin_cpu_supports("popcnt"))
+    return 1;
+
+#endif /* BM_X86 */
+
+  return 0;
+
+}
+
+const char* bitmap_ops_init(const char* want) {
+
+  u32 best = bm_best_flavor(), pick = best, i;
+
+  init_count_class16();
+
+  if (want)
+    for (i = 0; i <= best; i++)
+      if (!strcmp(want, bm_flavors[i].name)) pick = i;
+
+  bm_ops = bm_flavors[pick];
+  return bm_ops.name;
+
+}
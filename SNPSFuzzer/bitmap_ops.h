@@ -0,0 +1,67 @@
+/*
+   SNPSFuzzer - coverage bitmap kernels
+   ------------------------------------
+
+   The per-execution passes over the coverage map (hit-count classification,
+   virgin map comparison, trace simplification and the status screen counts)
+   in scalar, SSSE3, AVX2 and AVX-512BW flavors. bitmap_ops_init() picks the
+   widest one the CPU supports and fills in bm_ops; everything else calls
+   through it.
+
+   Two of the passes are fused:
+
+     - classify() also reports whether the classified trace has any bit left
+       in a virgin map, which is exactly when has_new_bits() on that map can
+       return non-zero. Callers use it to skip the second sweep;
+     - reset_virgin() is memset(virgin, 255) followed by has_new_bits() on
+       it, in a single sweep.
+
+   Lengths must be multiples of 64 bytes. Maps need no particular alignment.
+
+*/
+
+#ifndef _HAVE_BITMAP_OPS_H
+#define _HAVE_BITMAP_OPS_H
+
+#include "types.h"
+
+typedef struct bitmap_ops {
+
+  const char* name;
+
+  /* AFL's has_new_bits(): 2 if the trace has tuples still pristine in the
+     virgin map, 1 if only hit counts are new, 0 otherwise. Clears the
+     trace's bits from the virgin map. */
+
+  u8 (*has_new_bits)(const u8* trace, u8* virgin, u32 len);
+
+  /* Bucket the hit counts of a raw trace in place. Returns 1 if any
+     classified bit is still set in virgin (NULL: returns 0). */
+
+  u8 (*classify)(u8* trace, const u8* virgin, u32 len);
+
+  /* Hit / not hit as 0x80 / 0x01, for the crash and timeout maps */
+
+  void (*simplify)(u8* trace, u32 len);
+
+  /* virgin = ~trace; 2 if the trace has any tuple, 0 otherwise */
+
+  u8 (*reset_virgin)(const u8* trace, u8* virgin, u32 len);
+
+  /* Set bits, non-zero bytes and non-255 bytes */
+
+  u32 (*count_bits)(const u8* mem, u32 len);
+  u32 (*count_bytes)(const u8* mem, u32 len);
+  u32 (*count_non_255_bytes)(const u8* mem, u32 len);
+
+} bitmap_ops_t;
+
+extern bitmap_ops_t bm_ops;
+
+/* Select the kernels. want names a flavor ("scalar", "ssse3", "avx2",
+   "avx512"), NULL for the best available; a flavor the CPU lacks falls
+   back to the best one it has. Returns the name of the selection. */
+
+const char* bitmap_ops_init(const char* want);
+
+#endif /* ! _HAVE_BITMAP_OPS_H */
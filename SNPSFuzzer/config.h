@@ -130,6 +130,15 @@
 #define SKIP_NFAV_OLD_PROB  95 /* ...no new favs, cur entry already fuzzed */
 #define SKIP_NFAV_NEW_PROB  75 /* ...no new favs, cur entry not fuzzed yet */
 
+/* NEAR_VIOLATION state and seed selection (-q 4, -s 4). The monitor rates
+   each session by how close it came to violating a property, from 0 to 1000.
+   A state's FAVOR score is multiplied by 2^(NEAR_STATE_BOOST * near / 1000);
+   a seed is drawn with weight NEAR_SEED_BASE + near, doubled while it has
+   not been fuzzed from the target state. */
+
+#define NEAR_STATE_BOOST    3
+#define NEAR_SEED_BASE      100
+
 /* Splicing cycle count: */
 
 #define SPLICE_CYCLES       15
@@ -259,6 +268,20 @@
    100663045,    /* Large positive number (endian-agnostic) */ \
    2147483647    /* Overflow signed 32-bit when incremented */
 
+/* Snapshot mode: CRIU image sets go to a per-run directory on this tmpfs
+   mount (AFL_SNAPSHOT_STORE overrides it): */
+
+#define SNAPSHOT_STORE_DIR  "/dev/shm"
+
+/* CRIU log level for the dump.log / rst.log kept with the images: full
+   debug output in SNAPSHOT_DEBUG builds, errors only otherwise: */
+
+#ifdef SNAPSHOT_DEBUG
+#  define CRIU_LOG_LEVEL    4
+#else
+#  define CRIU_LOG_LEVEL    1
+#endif /* ^SNAPSHOT_DEBUG */
+
 /***********************************************************
  *                                                         *
  *  Really exotic stuff you probably don't want to touch:  *
@@ -303,6 +326,44 @@
 
 #define FORKSRV_FD          198
 
+/* Fork snapshots (AFL_FORK_SNAPSHOT): descriptor of the control socket
+   shared with fork_snapshot_rt.so in the target, the signal that parks the
+   target after M1, and the control messages: */
+
+#define FORK_SNAPSHOT_FD    (FORKSRV_FD - 2)
+#define FORK_SNAPSHOT_SIG   (SIGRTMAX - 1)
+
+#define FORK_SNAPSHOT_READY 0x534e5053      /* target -> afl-fuzz: parked */
+#define FORK_SNAPSHOT_FORK  1               /* afl-fuzz -> target         */
+
+/* Free space net_recv() makes sure the response buffer has before each
+   recv(); the buffer itself grows by doubling: */
+
+#define NET_RECV_CHUNK      4096
+
+/* Adaptive response waits (unless AFL_NO_ADAPTIVE_WAIT is set): the wait
+   for a response is the LAT_QUANTILE_PCT-th percentile of the first-byte
+   latencies seen in the server's state and at the message's position,
+   times LAT_MARGIN, capped by -W. A latency sketch needs LAT_MIN_SAMPLES
+   before it is trusted; every LAT_PROBE_EVERY-th wait runs to the full -W
+   and only those are sampled, so the tail beyond the deadline stays
+   visible. A cut wait that sees nothing goes on for the rest of -W, and a
+   late reply is sampled too. LAT_POSITIONS message positions are told apart, and sketches
+   halve their counts every LAT_DECAY samples: */
+
+#define LAT_QUANTILE_PCT    99
+#define LAT_MARGIN          2
+#define LAT_MIN_SAMPLES     32
+#define LAT_PROBE_EVERY     16
+#define LAT_POSITIONS       64
+#define LAT_DECAY           4096
+
+/* Per-phase execution timing: how deep phases may nest, and how long the
+   TSC is timed against the monotonic clock at startup: */
+
+#define PHASE_MAX_DEPTH     8
+#define PHASE_CALIBRATE_MS  20
+
 /* Fork server init timeout multiplier: we'll wait the user-selected
    timeout plus this much for the fork server to spin up. */
 
@@ -0,0 +1,213 @@
+/*
+   SNPSFuzzer - packed corpus store
+   --------------------------------
+
+   See corpus_pack.h.
+
+*/
+
+#define _GNU_SOURCE
+
+#include "corpus_pack.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+/* The mapping is sized in powers of two from here. Pages past the end of
+   the file are never touched; they become readable as the file grows. */
+
+#define PACK_MAP_MIN (64ULL << 20)
+
+#define PACK_ALIGN(_x) (((_x) + 7) & ~7ULL)
+
+const char* pack_kind_dirs[PACK_KINDS] = {
+  [PACK_NONE]         = NULL,
+  [PACK_QUEUE]        = "queue",
+  [PACK_REPLAY_QUEUE] = "replayable-queue",
+  [PACK_REPLAY_IPSM]  = "replayable-new-ipsm-paths"
+};
+
+
+/* Make [0, need) mapped. */
+
+static s32 pack_map(corpus_pack_t* p, u64 need) {
+
+  u64 len = p->map_len ? p->map_len : PACK_MAP_MIN;
+  u8* map;
+
+  if (need <= p->map_len) return 0;
+  while (len < need) len <<= 1;
+
+  if (p->map)
+    map = mremap(p->map, p->map_len, len, MREMAP_MAYMOVE);
+  else
+    map = mmap(NULL, len, PROT_READ, MAP_SHARED, p->fd, 0);
+
+  if (map == MAP_FAILED) return -1;
+
+  p->map = map;
+  p->map_len = len;
+  return 0;
+
+}
+
+
+s32 pack_create(corpus_pack_t* p, const char* path) {
+
+  memset(p, 0, sizeof(*p));
+
+  p->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (p->fd < 0) return -1;
+
+  if (write(p->fd, PACK_SIGNATURE, 8) != 8 || pack_map(p, 8)) {
+    s32 err = errno;
+    pack_close(p);
+    errno = err;
+    return -1;
+  }
+
+  p->end = 8;
+  return 0;
+
+}
+
+
+s32 pack_open(corpus_pack_t* p, const char* path) {
+
+  struct stat st;
+
+  memset(p, 0, sizeof(*p));
+
+  p->fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (p->fd < 0) return -1;
+
+  if (fstat(p->fd, &st)) goto fail;
+  p->end = st.st_size;
+
+  if (p->end < 8) { errno = EINVAL; goto fail; }
+  if (pack_map(p, p->end)) goto fail;
+  if (memcmp(p->map, PACK_SIGNATURE, 8)) { errno = EINVAL; goto fail; }
+
+  return 0;
+
+fail:
+
+  {
+    s32 err = errno;
+    pack_close(p);
+    errno = err;
+  }
+  return -1;
+
+}
+
+
+u64 pack_append(corpus_pack_t* p, u8 kind, const char* name,
+                const void* data, u32 len) {
+
+  static const u8 zero[8];
+
+  pack_rec_t rec;
+  struct iovec iov[4];
+  u64 rec_len, data_off;
+  size_t name_len = name ? strlen(name) : 0;
+
+  if (p->fd < 0 || name_len > 0xffff) { errno = EINVAL; return 0; }
+
+  rec.magic    = PACK_REC_MAGIC;
+  rec.len      = len;
+  rec.name_len = name_len;
+  rec.kind     = kind;
+  rec.reserved = 0;
+
+  data_off = p->end + sizeof(rec) + name_len;
+  rec_len  = PACK_ALIGN(sizeof(rec) + name_len + len);
+
+  iov[0].iov_base = &rec;
+  iov[0].iov_len  = sizeof(rec);
+  iov[1].iov_base = (void*)name;
+  iov[1].iov_len  = name_len;
+  iov[2].iov_base = (void*)data;
+  iov[2].iov_len  = len;
+  iov[3].iov_base = (void*)zero;
+  iov[3].iov_len  = rec_len - (sizeof(rec) + name_len + len);
+
+  errno = 0;
+
+  if (pwritev(p->fd, iov, 4, p->end) != (ssize_t)rec_len) {
+
+    /* Cut off whatever part made it; the next record goes in its place.
+       Should that fail too, readers stop at the torn record. */
+
+    s32 err = errno ? errno : EIO;
+    if (ftruncate(p->fd, p->end)) err = errno;
+    errno = err;
+    return 0;
+
+  }
+
+  p->end += rec_len;
+  return data_off;
+
+}
+
+
+const u8* pack_data(corpus_pack_t* p, u64 off, u32 len) {
+
+  if (off + len > p->end || pack_map(p, off + len)) return NULL;
+  return p->map + off;
+
+}
+
+
+u64 pack_next(corpus_pack_t* p, u64 off, pack_rec_t* rec,
+              u64* name_off, u64* data_off) {
+
+  const u8* hdr;
+  u64 next;
+
+  errno = 0;
+
+  if (!off) off = 8;
+  if (off == p->end) return 0;
+
+  if (off + sizeof(*rec) > p->end) {
+    errno = EILSEQ;
+    return 0;
+  }
+
+  hdr = pack_data(p, off, sizeof(*rec));
+  if (!hdr) return 0;
+  memcpy(rec, hdr, sizeof(*rec));
+
+  next = off + PACK_ALIGN(sizeof(*rec) + rec->name_len + (u64)rec->len);
+
+  if (rec->magic != PACK_REC_MAGIC || rec->kind == PACK_NONE ||
+      rec->kind >= PACK_KINDS || next > p->end) {
+    errno = EILSEQ;
+    return 0;
+  }
+
+  *name_off = off + sizeof(*rec);
+  *data_off = *name_off + rec->name_len;
+  return next;
+
+}
+
+
+void pack_close(corpus_pack_t* p) {
+
+  if (p->map) munmap(p->map, p->map_len);
+  if (p->fd >= 0) close(p->fd);
+
+  p->map = NULL;
+  p->map_len = 0;
+  p->fd = -1;
+  p->end = 0;
+
+}
@@ -0,0 +1,87 @@
+/*
+   SNPSFuzzer - packed corpus store
+   --------------------------------
+
+   One append-only file in place of a directory of small files per test
+   case. Each record carries a kind, a name (what the file would have been
+   called) and the data:
+
+     pack header:  "SNPSPACK" (8 bytes)
+     record:       pack_rec_t, name, data, zero padding to 8 bytes
+
+   Records are never rewritten. A later record with the same kind and name
+   supersedes an earlier one, as overwriting the file would have.
+
+   The writer maps the file shared and reads record data straight from the
+   mapping, so a stored test case costs no open() or read() to get back.
+   afl-pack-export turns a pack back into one file per record.
+
+*/
+
+#ifndef _HAVE_CORPUS_PACK_H
+#define _HAVE_CORPUS_PACK_H
+
+#include "types.h"
+
+#define PACK_SIGNATURE "SNPSPACK"
+#define PACK_REC_MAGIC 0x4b504e53 /* "SNPK" */
+
+/* Record kinds, named after the directories they replace */
+
+enum {
+  /* 00 */ PACK_NONE,
+  /* 01 */ PACK_QUEUE,            /* queue/                     */
+  /* 02 */ PACK_REPLAY_QUEUE,     /* replayable-queue/          */
+  /* 03 */ PACK_REPLAY_IPSM,      /* replayable-new-ipsm-paths/ */
+  /* 04 */ PACK_KINDS
+};
+
+extern const char* pack_kind_dirs[PACK_KINDS];
+
+typedef struct pack_rec {
+  u32 magic;                      /* PACK_REC_MAGIC                     */
+  u32 len;                        /* data bytes                         */
+  u16 name_len;                   /* name bytes, right after the header */
+  u8  kind;
+  u8  reserved;
+} pack_rec_t;
+
+typedef struct corpus_pack {
+  s32 fd;                         /* -1 when closed                     */
+  u64 end;                        /* bytes in the file                  */
+  u8* map;                        /* shared mapping, map_len bytes      */
+  u64 map_len;
+} corpus_pack_t;
+
+/* Create path (truncating it) for appending. 0 on success, -1 with errno
+   set. */
+
+s32 pack_create(corpus_pack_t* p, const char* path);
+
+/* Open an existing pack read-only. -1 with errno set on failure, EINVAL if
+   it has no pack header. */
+
+s32 pack_open(corpus_pack_t* p, const char* path);
+
+/* Append a record. Returns the offset of its data in the pack, 0 on
+   failure (errno set). */
+
+u64 pack_append(corpus_pack_t* p, u8 kind, const char* name,
+                const void* data, u32 len);
+
+/* len bytes at off, or NULL if that is past the end. The pointer stays
+   valid until the next pack_data() or pack_next() call. */
+
+const u8* pack_data(corpus_pack_t* p, u64 off, u32 len);
+
+/* Walk the records: pass off = 0 for the first. Fills rec and the offsets
+   of the name and the data; returns the offset of the next record. 0 ends
+   the walk, with errno 0 at the end of the pack and EILSEQ at a torn or
+   corrupt record. */
+
+u64 pack_next(corpus_pack_t* p, u64 off, pack_rec_t* rec,
+              u64* name_off, u64* data_off);
+
+void pack_close(corpus_pack_t* p);
+
+#endif /* ! _HAVE_CORPUS_PACK_H */
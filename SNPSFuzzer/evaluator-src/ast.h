@@ -1,11 +1,15 @@
 #ifndef AST_H_
 #define AST_H_
 
+#include <cstdint>
+#include <deque>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 // Forward declarations
-enum ASTNodeKind {
+enum ASTNodeKind : uint8_t {
     AST_SPEC,
     AST_ENUM,
     AST_INT_TYPE,
@@ -26,7 +30,10 @@ enum ASTNodeKind {
     AST_O,
     AST_H,
     AST_S,
-    AST_Y
+    AST_Y,
+    AST_O_BOUNDED,
+    AST_H_BOUNDED,
+    AST_Y_BOUNDED
 };
 
 // TypeAnnotation class
@@ -49,42 +56,91 @@ public:
     std::string bool_type_name;
 };
 
-// Forward declaration of ASTNode
-class ASTNode;
+// Index of a node inside the AST arena
+typedef uint32_t ASTIndex;
+static const ASTIndex AST_NONE = UINT32_MAX;
+
+// Bounds of a metric past operator. O[lo,hi] / H[lo,hi] count events back
+// from the current one; with a clock they are measured on that int variable
+// instead. Y^n is the one-step window lo = hi = n.
+struct ASTWindow {
+    int lo;
+    int hi;
+    int clock = -1;     // interned symbol id of the timestamp variable, or -1
+};
 
 // ASTNode class
+//
+// Nodes are small tagged records stored contiguously in the AST arena.
+// Children are arena indices and identifiers are interned symbol ids, so a
+// node is the same size regardless of kind.
 class ASTNode {
 public:
     ASTNodeKind kind;
+    bool processed ; 
+    int serial_number = 0 ; 
     
     // Constructor
     ASTNode(ASTNodeKind k) : kind(k), processed(false), serial_number(-1) {}
     ~ASTNode() = default;
     
-    // Data for specification
-    std::vector<TypeAnnotation> spec_type_annotations;
-    std::vector<ASTNode*> spec_formulas;
-    
-    // Data for binary operations
-    ASTNode* binary_left = nullptr;
-    ASTNode* binary_right = nullptr;
-    
-    // Data for unary operations
-    ASTNode* unary_child = nullptr;
-    
-    // Data for identifier
-    std::string id_name;
-    
-    // Data for integer value
-    int int_value = 0;
-    
-    // Data for boolean value
-    bool bool_value = false;
-    bool processed ; 
-    int serial_number = 0 ; 
+    // Unary child or left operand, and right operand
+    ASTIndex lhs = AST_NONE;
+    ASTIndex rhs = AST_NONE;
     
+    // Integer value, boolean value or interned symbol id, depending on kind
+    int value = 0;
+
+    ASTNode* binary_left() const;
+    ASTNode* binary_right() const;
+    ASTNode* unary_child() const;
+    const std::string& id_name() const;
+    const ASTWindow& window() const;
+    int window_id() const { return value; }
+    int int_value() const { return value; }
+    bool bool_value() const { return value != 0; }
+};
+
+// ASTArena class
+//
+// Bump allocator for parse-time nodes plus the string table identifiers are
+// interned into. Nodes are only ever appended while parsing, so indices stay
+// valid; pointers are stable once parsing is done. Tearing a spec down is a
+// single release() instead of a recursive walk.
+class ASTArena {
+public:
+    ASTIndex alloc(ASTNodeKind k);
+    ASTIndex alloc_unary(ASTNodeKind k, ASTIndex child);
+    ASTIndex alloc_binary(ASTNodeKind k, ASTIndex left, ASTIndex right);
+    ASTIndex alloc_window(ASTNodeKind k, ASTIndex child, int lo, int hi, int clock = -1);
+    ASTNode* at(ASTIndex i) { return i == AST_NONE ? nullptr : &nodes[i]; }
+    size_t size() const { return nodes.size(); }
+
+    int intern(const char* s, size_t len);
+    const std::string& symbol(int id) const { return symbols[id]; }
+    size_t symbol_count() const { return symbols.size(); }
+
+    const ASTWindow& window(int id) const { return windows[id]; }
+    size_t window_count() const { return windows.size(); }
+
+    void release();
+
+private:
+    std::vector<ASTNode> nodes;
+    std::vector<ASTWindow> windows;
+    // deque keeps interned strings in place, so the views used as keys stay valid
+    std::deque<std::string> symbols;
+    std::unordered_map<std::string_view, int> symbol_ids;
 };
 
+extern ASTArena ast_arena;
+
+inline ASTNode* ASTNode::binary_left() const { return ast_arena.at(lhs); }
+inline ASTNode* ASTNode::binary_right() const { return ast_arena.at(rhs); }
+inline ASTNode* ASTNode::unary_child() const { return ast_arena.at(lhs); }
+inline const std::string& ASTNode::id_name() const { return ast_arena.symbol(value); }
+inline const ASTWindow& ASTNode::window() const { return ast_arena.window(value); }
+
 // The root of our AST will be a pair of vectors
 using Spec = std::pair<std::vector<TypeAnnotation>, std::vector<ASTNode*>>;
 
@@ -15,56 +15,66 @@ std::string ASTPrinter::printStuff(const ASTNode*node)
     switch (node->kind)
     {
         case AST_ID:
-            return  node->id_name ;
+            return  node->id_name() ;
             // break;
         case AST_INT:
-            return std::to_string(node->int_value);
+            return std::to_string(node->int_value());
             // break;
         case AST_BOOL:
-            return (node->bool_value ? "true" : "false");
+            return (node->bool_value() ? "true" : "false");
             // std::cout << "Boolean: " << (node->bool_value ? "true" : "false") << std::endl;
             // break;
         case AST_H:
-            return "H(" + printStuff(node->unary_child) + ")";
+            return "H(" + printStuff(node->unary_child()) + ")";
             // break;
         case AST_ARROW:
-            return  printStuff(node->binary_left) + " -> " + printStuff(node->binary_right)  ;
+            return  printStuff(node->binary_left()) + " -> " + printStuff(node->binary_right())  ;
             // break;
         case AST_O:
-            return "O(" + printStuff(node->unary_child) + ")";
+            return "O(" + printStuff(node->unary_child()) + ")";
             // break;
         case AST_Y:
-            return "Y(" + printStuff(node->unary_child) + ")";
+            return "Y(" + printStuff(node->unary_child()) + ")";
             // break;
         case AST_S:
-            return "(" + printStuff(node->binary_left) + " S " + printStuff(node->binary_right) + ")";
+            return "(" + printStuff(node->binary_left()) + " S " + printStuff(node->binary_right()) + ")";
             // break;
+        case AST_O_BOUNDED:
+        case AST_H_BOUNDED:
+        {
+            const ASTWindow& w = node->window();
+            std::string op = (node->kind == AST_O_BOUNDED ? "O[" : "H[") + std::to_string(w.lo) + "," + std::to_string(w.hi) + "]";
+            if (w.clock >= 0) op += "@" + ast_arena.symbol(w.clock);
+            return op + "(" + printStuff(node->unary_child()) + ")";
+        }
+        case AST_Y_BOUNDED:
+            return "Y^" + std::to_string(node->window().hi) + "(" + printStuff(node->unary_child()) + ")";
         case AST_AND:
-            return  printStuff(node->binary_left) + " & " + printStuff(node->binary_right) ;
+            return  printStuff(node->binary_left()) + " & " + printStuff(node->binary_right()) ;
             // break;
         case AST_OR:
-            return printStuff(node->binary_left) + " | " + printStuff(node->binary_right) ;
+            return printStuff(node->binary_left()) + " | " + printStuff(node->binary_right()) ;
             // break;
         case AST_NOT:
-            return "!(" + printStuff(node->unary_child) + ")";
+            return "!(" + printStuff(node->unary_child()) + ")";
             // break;
         case AST_EQ:
-            return  printStuff(node->binary_left) + "==" + printStuff(node->binary_right) ;
+            return  printStuff(node->binary_left()) + "==" + printStuff(node->binary_right()) ;
             // break;
         case AST_NEQ:
-            return  printStuff(node->binary_left) + " != " + printStuff(node->binary_right)  ;
+            return  printStuff(node->binary_left()) + " != " + printStuff(node->binary_right())  ;
             // break;
         case AST_GT:
-            return "(" + printStuff(node->binary_left) + " > " + printStuff(node->binary_right) + ")";
+            return "(" + printStuff(node->binary_left()) + " > " + printStuff(node->binary_right()) + ")";
             // break;
         case AST_GTE:
-            return "(" + printStuff(node->binary_left) + " >= " + printStuff(node->binary_right) + ")";
+            return "(" + printStuff(node->binary_left()) + " >= " + printStuff(node->binary_right()) + ")";
             // break;
         case AST_LT:
-            return "(" + printStuff(node->binary_left) + " < " + printStuff(node->binary_right) + ")";
+            return "(" + printStuff(node->binary_left()) + " < " + printStuff(node->binary_right()) + ")";
             // break;
         case AST_LTE:
-            return "(" + printStuff(node->binary_left) + " <= " + printStuff(node->binary_right) + ")";
+            return "(" + printStuff(node->binary_left()) + " <= " + printStuff(node->binary_right()) + ")";
             // break;
         default:
             std::cerr << "Error: Unknown node type encountered during printing." << std::endl;
@@ -99,14 +109,17 @@ void traverser(ASTNode* node, std::map<int, std::string>& result) {
         case AST_NOT:
         case AST_O:
         case AST_Y:
-            traverser(node->unary_child, result);
+        case AST_O_BOUNDED:
+        case AST_H_BOUNDED:
+        case AST_Y_BOUNDED:
+            traverser(node->unary_child(), result);
             break;
         case AST_ARROW:
         case AST_AND:
         case AST_OR:
         case AST_S:
-            traverser(node->binary_left, result);
-            traverser(node->binary_right, result);
+            traverser(node->binary_left(), result);
+            traverser(node->binary_right(), result);
             break;
         default: 
             std::cerr << "Error: Unknown node type encountered during traversal." << std::endl;
@@ -137,6 +150,9 @@ std::string ASTPrinter::getNodeTypeStr(const ASTNode* node) {
         case AST_O: return "O_OPERATOR";
         case AST_Y: return "Y_OPERATOR";
         case AST_S: return "S_OPERATOR";
+        case AST_O_BOUNDED: return "O_BOUNDED_OPERATOR";
+        case AST_H_BOUNDED: return "H_BOUNDED_OPERATOR";
+        case AST_Y_BOUNDED: return "Y_BOUNDED_OPERATOR";
         case AST_AND: return "AND";
         case AST_OR: return "OR";
         case AST_NOT: return "NOT";
@@ -209,31 +225,22 @@ void ASTPrinter::printAST(const ASTNode* node, int indent) {
     switch (node->kind) {
         case AST_ID:
             printIndentation(indent + 1);
-            std::cout << "Identifier: " << node->id_name << std::endl;
+            std::cout << "Identifier: " << node->id_name() << std::endl;
             printIndentation(indent + 1);
             std::cout << "Serial Number: " << node->serial_number << std::endl;
             break;
         case AST_INT:
             printIndentation(indent + 1);
-            std::cout << "Value: " << node->int_value << std::endl;
+            std::cout << "Value: " << node->int_value() << std::endl;
             printIndentation(indent + 1);
             std::cout << "Serial Number: " << node->serial_number << std::endl;
             break;
         case AST_BOOL:
             printIndentation(indent + 1);
-            std::cout << "Value: " << (node->bool_value ? "true" : "false") << std::endl;
+            std::cout << "Value: " << (node->bool_value() ? "true" : "false") << std::endl;
             printIndentation(indent + 1);
             std::cout << "Serial Number: " << node->serial_number << std::endl;
             break;
-        case AST_SPEC:
-            printIndentation(indent + 1);
-            std::cout << "Type Annotations:" << std::endl;
-            printTypeAnnotations(node->spec_type_annotations, indent + 2);
-            
-            printIndentation(indent + 1);
-            std::cout << "Formulas:" << std::endl;
-            printFormulas(node->spec_formulas, indent + 2);
-            break;
         case AST_NOT:
         case AST_H:
         case AST_O:
@@ -242,9 +249,25 @@ void ASTPrinter::printAST(const ASTNode* node, int indent) {
             std::cout << "Serial Number: " << node->serial_number << std::endl;
             printIndentation(indent + 1);
             std::cout << "Child:" << std::endl;
-            printAST(node->unary_child, indent + 2);
+            printAST(node->unary_child(), indent + 2);
 
             break;
+        case AST_O_BOUNDED:
+        case AST_H_BOUNDED:
+        case AST_Y_BOUNDED:
+        {
+            const ASTWindow& w = node->window();
+            printIndentation(indent + 1);
+            std::cout << "Serial Number: " << node->serial_number << std::endl;
+            printIndentation(indent + 1);
+            std::cout << "Window: [" << w.lo << "," << w.hi << "]";
+            if (w.clock >= 0) std::cout << " @" << ast_arena.symbol(w.clock);
+            std::cout << std::endl;
+            printIndentation(indent + 1);
+            std::cout << "Child:" << std::endl;
+            printAST(node->unary_child(), indent + 2);
+            break;
+        }
         case AST_ARROW:
         case AST_AND:
         case AST_OR:
@@ -259,11 +282,11 @@ void ASTPrinter::printAST(const ASTNode* node, int indent) {
             std::cout << "Serial Number: " << node->serial_number << std::endl;
             printIndentation(indent + 1);
             std::cout << "Left:" << std::endl;
-            printAST(node->binary_left, indent + 2);
+            printAST(node->binary_left(), indent + 2);
             
             printIndentation(indent + 1);
             std::cout << "Right:" << std::endl;
-            printAST(node->binary_right, indent + 2);
+            printAST(node->binary_right(), indent + 2);
             break;
         default:
             printIndentation(indent + 1);
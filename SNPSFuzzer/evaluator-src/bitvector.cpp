@@ -96,4 +96,13 @@ void BitVector::clear_bv() {
 
 unsigned int BitVector::get_size() {
     return sz;
-}
\ No newline at end of file
+}
+
+unsigned int BitVector::hash() const {
+    // FNV-1a over the words; used to fingerprint an automaton configuration
+    unsigned int h = 2166136261u;
+    for(unsigned int i = 0; i < whole_sz; ++i) {
+        h = (h ^ bv[i]) * 16777619u;
+    }
+    return h;
+}
@@ -25,6 +25,7 @@ public:
     bool test(unsigned int index);
     void clear_bv();
     unsigned int get_size();
+    unsigned int hash() const;
 };
 
 #endif 
\ No newline at end of file
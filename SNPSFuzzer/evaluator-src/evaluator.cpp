@@ -8,6 +8,8 @@ Evaluator::Evaluator(vector<ASTNode*> &formulas, vector<int> &snums)
     this->formulas = formulas;
     this->serial_numbers = snums;
     index = 0;
+    cov_map = nullptr;
+    cov_mask = 0;
     // Tchecker = tc ; 
     
     // Preallocate vector capacity to avoid reallocations
@@ -24,10 +26,51 @@ Evaluator::Evaluator(vector<ASTNode*> &formulas, vector<int> &snums)
         new_bv.back().clear_bv();
         old_bv.back().clear_bv();
     }
+    windows.assign(ast_arena.window_count(), WindowState());
+
+    session_near = 0;
+    near_miss.resize(formulas.size());
+    for (size_t i = 0; i < formulas.size(); ++i)
+    {
+        NearMiss& nm = near_miss[i];
+        ASTNode* body = formulas[i]->kind == AST_H ? formulas[i]->unary_child() : nullptr;
+        if (!body) continue;
+
+        nm.scored = true;
+        // H(!(a1 & ... & an)) is H(a1 & ... & an -> false): no consequent
+        if (body->kind == AST_ARROW || body->kind == AST_NOT)
+        {
+            vector<ASTNode*> todo{body->kind == AST_ARROW ? body->binary_left() : body->unary_child()};
+            while (!todo.empty())
+            {
+                ASTNode* n = todo.back();
+                todo.pop_back();
+                if (n->kind == AST_AND) { todo.push_back(n->binary_right()); todo.push_back(n->binary_left()); }
+                else nm.antecedent.push_back(n);
+            }
+            if (body->kind == AST_ARROW) nm.consequent = body->binary_right();
+        }
+        else nm.consequent = body;
+
+        vector<ASTNode*> todo{body};
+        while (!todo.empty())
+        {
+            ASTNode* n = todo.back();
+            todo.pop_back();
+            if (n->kind == AST_S) nm.since.push_back(n);
+            // operands of a predicate are leaves
+            if (n->kind < AST_BOOL || n->kind > AST_NEQ)
+            {
+                if (n->lhs != AST_NONE) todo.push_back(n->binary_left());
+                if (n->rhs != AST_NONE) todo.push_back(n->binary_right());
+            }
+        }
+    }
 }
 
 void Evaluator::reset_evaluator() {
     this->index = 0;
+    this->session_near = 0;
     
     // Clear existing vectors (this will properly call destructors)
     new_bv.clear();
@@ -47,6 +90,7 @@ void Evaluator::reset_evaluator() {
         new_bv.back().clear_bv();
         old_bv.back().clear_bv();
     }
+    windows.assign(ast_arena.window_count(), WindowState());
 }
 
 inline std::string boolToString(bool value) {
@@ -88,7 +132,7 @@ bool Evaluator::EvaluatePredicate(ASTNode* node, State *state)
     }
 
     // assert(LEFT_CHILD_FIXED_TYPE(node, AST_ID));
-    std::string varname = node->binary_left->id_name;
+    std::string varname = node->binary_left()->id_name();
     int l_int_val ; 
     int r_int_val ; 
     std::string r_string_val ; 
@@ -101,18 +145,18 @@ bool Evaluator::EvaluatePredicate(ASTNode* node, State *state)
         case AST_LT:
         case AST_LTE:
             // assert(RIGHT_CHILD_FIXED_TYPE(node, AST_INT));
-            if(node->binary_right->kind == AST_INT){
-                r_int_val = node->binary_right->int_value;
+            if(node->binary_right()->kind == AST_INT){
+                r_int_val = node->binary_right()->int_value();
             }
-            else if(node->binary_right->kind == AST_ID){
-                r_int_val = stoi(state->getLabel(node->binary_right->id_name));    
+            else if(node->binary_right()->kind == AST_ID){
+                r_int_val = stoi(state->getLabel(node->binary_right()->id_name()));    
             }
             else assert(0);
-            if(node->binary_left->kind == AST_INT){
-                l_int_val = node->binary_left->int_value;
+            if(node->binary_left()->kind == AST_INT){
+                l_int_val = node->binary_left()->int_value();
             }
-            else if(node->binary_left->kind == AST_ID){
-                l_int_val = stoi(state->getLabel(node->binary_left->id_name));    
+            else if(node->binary_left()->kind == AST_ID){
+                l_int_val = stoi(state->getLabel(node->binary_left()->id_name()));    
             }
             else assert(0);
             // r_int_val = node->binary_right->int_value;
@@ -121,31 +165,31 @@ bool Evaluator::EvaluatePredicate(ASTNode* node, State *state)
         case AST_EQ:
         case AST_NEQ:
             
-            switch(node->binary_left->kind)
+            switch(node->binary_left()->kind)
             {
                 case AST_INT:
-                    l_string_val = to_string(node->binary_left->int_value);
+                    l_string_val = to_string(node->binary_left()->int_value());
                     break; 
                 case AST_BOOL:
-                    l_string_val = boolToString(node->binary_left->bool_value);
+                    l_string_val = boolToString(node->binary_left()->bool_value());
                     break; 
                 case AST_ID:
-                    l_string_val = state->getLabel(node->binary_left->id_name);
+                    l_string_val = state->getLabel(node->binary_left()->id_name());
                     break; 
                 default: 
                     assert(0);
                 break ; 
             }
-            switch(node->binary_right->kind)
+            switch(node->binary_right()->kind)
             {
                 case AST_INT:
-                    r_string_val = to_string(node->binary_right->int_value);
+                    r_string_val = to_string(node->binary_right()->int_value());
                     break; 
                 case AST_BOOL:
-                    r_string_val = boolToString(node->binary_right->bool_value);
+                    r_string_val = boolToString(node->binary_right()->bool_value());
                     break; 
                 case AST_ID:
-                    r_string_val = state->getLabel(node->binary_right->id_name);
+                    r_string_val = state->getLabel(node->binary_right()->id_name());
                     break; 
                 default: 
                     assert(0);
@@ -207,6 +251,38 @@ bool Evaluator::EvaluatePredicate(ASTNode* node, State *state)
 
 
 
+bool Evaluator::EvaluateWindow(ASTNode* node, bool child, State *state)
+{
+    const ASTWindow& w = node->window();
+    WindowState& ws = windows[node->window_id()];
+    // O and Y^n look for a step where the child held, H for one where it did
+    // not. Y^n has lo = hi = n, so only the step exactly n back counts
+    bool want = node->kind != AST_H_BOUNDED;
+    bool hit ;
+
+    if (w.clock < 0)
+    {
+        long i = index ;
+        ws.delay.push_back(child);
+        if (ws.delay.size() > (size_t)w.lo)
+        {
+            if (ws.delay.front() == want) ws.last_hit = i - w.lo;
+            ws.delay.pop_front();
+        }
+        hit = ws.last_hit >= 0 && i - ws.last_hit <= w.hi;
+    }
+    else
+    {
+        long t = stol(state->getLabel(ast_arena.symbol(w.clock)));
+        if (child == want && (ws.stamps.empty() || ws.stamps.back() != t))
+            ws.stamps.push_back(t);
+        while (!ws.stamps.empty() && ws.stamps.front() < t - w.hi)
+            ws.stamps.pop_front();
+        hit = !ws.stamps.empty() && ws.stamps.front() <= t - w.lo;
+    }
+    return node->kind == AST_H_BOUNDED ? !hit : hit;
+}
+
 bool Evaluator::EvaluateFormula(ASTNode* node, State *state, size_t iter)
 {
     assert(NODE_NOT_NULL(node));
@@ -214,34 +290,34 @@ bool Evaluator::EvaluateFormula(ASTNode* node, State *state, size_t iter)
     {
         case AST_NOT:
         {
-            bool r = !EvaluateFormula(node->unary_child, state, iter);
+            bool r = !EvaluateFormula(node->unary_child(), state, iter);
             if(r) new_bv[iter].set(node->serial_number);    
             return r ;
         }             
         case AST_AND:
         {
-            bool r1 = EvaluateFormula(node->binary_left, state,iter) ; 
-            bool r2 = EvaluateFormula(node->binary_right, state,iter);
+            bool r1 = EvaluateFormula(node->binary_left(), state,iter) ; 
+            bool r2 = EvaluateFormula(node->binary_right(), state,iter);
             if(r1 && r2) new_bv[iter].set(node->serial_number);
             return (r1 && r2);  
         }
         case AST_OR:
         {
-            bool r1 = EvaluateFormula(node->binary_left, state,iter) ; 
-            bool r2 = EvaluateFormula(node->binary_right, state,iter);
+            bool r1 = EvaluateFormula(node->binary_left(), state,iter) ; 
+            bool r2 = EvaluateFormula(node->binary_right(), state,iter);
             if(r1 || r2) new_bv[iter].set(node->serial_number);
             return r1 || r2;
         }
         case AST_ARROW:
         {
-            bool r1 = (!EvaluateFormula(node->binary_left, state,iter));
-            bool r2 = EvaluateFormula(node->binary_right, state,iter);
+            bool r1 = (!EvaluateFormula(node->binary_left(), state,iter));
+            bool r2 = EvaluateFormula(node->binary_right(), state,iter);
             if(r1|| r2) new_bv[iter].set(node->serial_number);
             return r1 || r2;
         }
         case AST_ID:
         {
-            std::string varname = node->id_name;
+            std::string varname = node->id_name();
             std::string val = state->getLabel(varname);
             bool r ; 
             if(val == "true") r = true ;
@@ -255,8 +331,8 @@ bool Evaluator::EvaluateFormula(ASTNode* node, State *state, size_t iter)
         }
         case AST_S:
         {
-            bool r1 = EvaluateFormula(node->binary_left, state,iter);
-            bool r2 = EvaluateFormula(node->binary_right, state,iter);
+            bool r1 = EvaluateFormula(node->binary_left(), state,iter);
+            bool r2 = EvaluateFormula(node->binary_right(), state,iter);
             bool r3 = false ;
             if(old_bv[iter].test(node->serial_number)) r3 = true; 
             if(r2 || (r1 && r3))
@@ -267,7 +343,7 @@ bool Evaluator::EvaluateFormula(ASTNode* node, State *state, size_t iter)
         }
         case AST_O:
         {
-            bool r1 = EvaluateFormula(node->unary_child, state,iter);
+            bool r1 = EvaluateFormula(node->unary_child(), state,iter);
             bool r2 = false ; 
             if(old_bv[iter].test(node->serial_number)) r2 = true ;
             if(r1 || r2)
@@ -278,7 +354,7 @@ bool Evaluator::EvaluateFormula(ASTNode* node, State *state, size_t iter)
         }
         case AST_H:
         {
-            bool r1 = EvaluateFormula(node->unary_child, state,iter);
+            bool r1 = EvaluateFormula(node->unary_child(), state,iter);
             bool r2 = index == 0 ? true :  old_bv[iter].test(node->serial_number); 
             if(r1 && r2) new_bv[iter].set(node->serial_number);
             return (r1 && r2);
@@ -286,10 +362,10 @@ bool Evaluator::EvaluateFormula(ASTNode* node, State *state, size_t iter)
             
         case AST_Y:
         {
-            EvaluateFormula(node->unary_child, state,iter);
+            EvaluateFormula(node->unary_child(), state,iter);
             if(index != 0)
             {
-                if(old_bv[iter].test((node->unary_child)->serial_number)){ 
+                if(old_bv[iter].test((node->unary_child())->serial_number)){ 
                      new_bv[iter].set(node->serial_number);
                     return true ;
                 }
@@ -298,6 +374,16 @@ bool Evaluator::EvaluateFormula(ASTNode* node, State *state, size_t iter)
 
         }
 
+        case AST_O_BOUNDED:
+        case AST_H_BOUNDED:
+        case AST_Y_BOUNDED:
+        {
+            bool r1 = EvaluateFormula(node->unary_child(), state,iter);
+            bool r = EvaluateWindow(node, r1, state);
+            if(r) new_bv[iter].set(node->serial_number);
+            return r ;
+        }
+
         default:
             return EvaluatePredicate(node, state);
     }
@@ -308,7 +394,60 @@ bool Evaluator::EvaluateFormula(ASTNode* node, State *state, size_t iter)
 
 
 
-vector<bool> Evaluator::EvaluateOneStep(State *state)
+void Evaluator::RecordCoverage(size_t iter)
+{
+    // AFL-style edge between the previous and the current configuration of
+    // formula `iter`. The previous one is still in old_bv, so restoring a
+    // snapshot needs no extra state here.
+    unsigned int salt = (unsigned int)(iter + 1) * 0x9E3779B1u;
+    unsigned int prev = old_bv[iter].hash() ^ salt;
+    unsigned int cur = new_bv[iter].hash() ^ salt;
+    unsigned char &slot = cov_map[((prev >> 1) ^ cur) & cov_mask];
+    if (slot != 0xff) ++slot;
+}
+
+// Truth of a subformula at the step being evaluated. Everything but the
+// predicates leaves its value in new_bv; predicates are pure, so they are
+// simply evaluated again.
+bool Evaluator::Holds(ASTNode* node, State *state, size_t iter)
+{
+    switch (node->kind)
+    {
+        case AST_GT:
+        case AST_GTE:
+        case AST_LT:
+        case AST_LTE:
+        case AST_EQ:
+        case AST_NEQ:
+            return EvaluatePredicate(node, state);
+        case AST_BOOL:
+            return node->bool_value();
+        default:
+            return new_bv[iter].test(node->serial_number);
+    }
+}
+
+// Thousandths of the way from nothing to a violation of formula `iter` at
+// this step: the share of the violation's conjuncts (see NearMiss) that hold,
+// plus p/(p+1) of one more for p pending S obligations.
+unsigned int Evaluator::Closeness(size_t iter, State *state)
+{
+    const NearMiss& nm = near_miss[iter];
+    unsigned int parts = nm.antecedent.size() + (nm.consequent ? 1 : 0);
+    unsigned int held = 0, pending = 0;
+
+    for (ASTNode* a : nm.antecedent)
+        if (Holds(a, state, iter)) ++held;
+    if (nm.consequent && !Holds(nm.consequent, state, iter)) ++held;
+    if (held == parts) return 1000;
+
+    for (ASTNode* s : nm.since)
+        if (new_bv[iter].test(s->serial_number) && !Holds(s->binary_right(), state, iter)) ++pending;
+
+    return (1000 * held + 1000 * pending / (pending + 1)) / parts;
+}
+
+vector<bool> Evaluator::EvaluateOneStep(State *state, bool count_near)
 {
     vector<bool> result;
     size_t iter = 0;
@@ -323,6 +462,9 @@ vector<bool> Evaluator::EvaluateOneStep(State *state)
             // monitor_report_violation(formula_str, snapshot, index);
         }
 
+        if (cov_map) RecordCoverage(iter);
+        if (count_near && near_miss[iter].scored && session_near < 1000)
+            session_near = max(session_near, Closeness(iter, state));
         old_bv[iter] = new_bv[iter];
         new_bv[iter].clear_bv();
         ++iter;
@@ -330,3 +472,15 @@ vector<bool> Evaluator::EvaluateOneStep(State *state)
     ++index;
     return result;
 }
+
+// Steps only formula `prop`. The other formulas' bitvectors are left behind,
+// so this is for callers that track a single property (e.g. the minimizer).
+bool Evaluator::EvaluateOneStep(State *state, size_t prop)
+{
+    assert(prop < formulas.size());
+    bool res = EvaluateFormula(formulas[prop], state, prop);
+    old_bv[prop] = new_bv[prop];
+    new_bv[prop].clear_bv();
+    ++index;
+    return res;
+}
@@ -9,6 +9,7 @@
 # include <algorithm>
 # include <map>
 # include <set>
+# include <deque>
 # include "ast.h"
 # include "typechecker.h"
 # include "state.h"
@@ -18,9 +19,49 @@
 using namespace std ;
 
 # define NODE_NOT_NULL(node) ((node) != NULL)
-# define BOTH_CHILD_PRESENT(node) (NODE_NOT_NULL(node->binary_left)  && NODE_NOT_NULL((node)->binary_right))
-# define LEFT_CHILD_FIXED_TYPE(node, type) ((node)->binary_left->kind == type)
-# define RIGHT_CHILD_FIXED_TYPE(node, type) ((node)->binary_right->kind == type)
+# define BOTH_CHILD_PRESENT(node) (NODE_NOT_NULL(node->binary_left())  && NODE_NOT_NULL((node)->binary_right()))
+# define LEFT_CHILD_FIXED_TYPE(node, type) ((node)->binary_left()->kind == type)
+# define RIGHT_CHILD_FIXED_TYPE(node, type) ((node)->binary_right()->kind == type)
+
+// Per-node state of a bounded past operator (O[a,b], H[a,b], Y^n).
+//
+// Count windows delay the child's value by `lo` steps through `delay` and
+// remember the last step at or before i-lo where the child was true (O) or
+// false (H); membership in [i-hi, i-lo] is then one comparison. Timestamp
+// windows keep a monotonic deque of the clock values at such steps and drop
+// entries from the front once they are older than hi.
+struct WindowState
+{
+    deque<bool> delay ;
+    long last_hit = -1 ;
+    deque<long> stamps ;
+};
+
+// Evaluator position after some prefix of a session. new_bv is always clear
+// between steps, so index, old_bv and the window states are the whole
+// temporal state; near is the session's closeness so far.
+struct EvaluatorSnapshot
+{
+    int index ;
+    vector<BitVector> old_bv ;
+    vector<WindowState> windows ;
+    unsigned int near ;
+};
+
+// Shape of an H(a1 & ... & an -> b) formula for measuring how close a step
+// comes to violating it: the violation is a1 & ... & an & !b, and every
+// conjunct of that which holds brings it closer. S nodes that hold only
+// because of earlier steps are obligations a single event can break; they
+// count as partial progress. H(!(a1 & ... & an)) is read as
+// a1 & ... & an -> false, so there is no !b to count. Formulas of another
+// shape are not scored.
+struct NearMiss
+{
+    bool scored = false ;
+    vector<ASTNode*> antecedent ;
+    ASTNode* consequent = nullptr ;     // none for H(!(...))
+    vector<ASTNode*> since ;
+};
 
 class Evaluator
 {
@@ -30,15 +71,27 @@ private:
     vector<ASTNode*> formulas ;
     vector<int> serial_numbers ;
     // TypeChecker *Tchecker ;
+    vector<WindowState> windows ;
+    unsigned char *cov_map ;
+    unsigned int cov_mask ;
+    vector<NearMiss> near_miss ;
+    unsigned int session_near ;
     int index ; 
     bool EvaluateFormula(ASTNode* node, State *state, size_t iter);
     bool EvaluatePredicate(ASTNode* node, State *state);
+    bool EvaluateWindow(ASTNode* node, bool child, State *state);
+    void RecordCoverage(size_t iter);
+    bool Holds(ASTNode* node, State *state, size_t iter);
+    unsigned int Closeness(size_t iter, State *state);
     // void Bootstrap(ASTNode * f, int iter) ; 
 
 public:
     Evaluator(vector<ASTNode*> &formulas, vector<int> &snums);
     void reset_evaluator();
-    vector<bool> EvaluateOneStep(State *state);
+    // count_near: the step may count toward the session's closeness (the
+    // spec's guard accepts the event)
+    vector<bool> EvaluateOneStep(State *state, bool count_near = true);
+    bool EvaluateOneStep(State *state, size_t prop);
     int get_index() const { return index; }
     void set_index(int idx) { index = idx; }
     
@@ -48,6 +101,16 @@ public:
     void set_old_bv(const vector<BitVector>& bv) { old_bv = bv; }
     void set_new_bv(const vector<BitVector>& bv) { new_bv = bv; }
 
+    // Shared map (size a power of two) that RecordCoverage() bumps per step
+    void set_coverage_map(unsigned char *map, unsigned int size) { cov_map = map; cov_mask = size - 1; }
+
+    // Closest any step of the session came to violating a property, in
+    // thousandths: 1000 is a violation, 0 nothing of one
+    unsigned int get_session_near() const { return session_near; }
+
+    EvaluatorSnapshot snapshot() const { return EvaluatorSnapshot{index, old_bv, windows, session_near}; }
+    void restore(const EvaluatorSnapshot& snap) { index = snap.index; old_bv = snap.old_bv; windows = snap.windows; session_near = snap.near; }
+
 };
 
 #endif 
\ No newline at end of file
@@ -0,0 +1,148 @@
+# include "guard.h"
+# include <cassert>
+
+Guard::Guard(const vector<ASTNode*>& guards, TypeChecker *tc) : tc(tc)
+{
+    for (size_t i = 0; i < guards.size(); ++i)
+    {
+        if (!tc->CheckGuard(guards[i])) {
+            std::cerr << "Error: Guard " << i << " does not type check: "
+                      << ASTPrinter::printStuff(guards[i]) << std::endl;
+            assert(0);
+        }
+        Compile(guards[i]);
+        if (i > 0) prog.push_back(Op{G_AND, AST_AND, false, -1, {}, {}});
+    }
+    slots.resize(slot_names.size());
+    stack.reserve(prog.size());
+}
+
+int Guard::Slot(const std::string& name)
+{
+    for (size_t i = 0; i < slot_names.size(); ++i) {
+        if (slot_names[i] == name) return (int)i;
+    }
+    slot_names.push_back(name);
+    return (int)slot_names.size() - 1;
+}
+
+Guard::Operand Guard::MakeOperand(ASTNode* node)
+{
+    // Same renderings EvaluatePredicate compares against
+    Operand o;
+    switch (node->kind)
+    {
+        case AST_INT:
+            o.int_const = node->int_value();
+            o.str_const = to_string(node->int_value());
+            break;
+        case AST_BOOL:
+            o.str_const = node->bool_value() ? "true" : "false";
+            break;
+        case AST_ID:
+            if (tc->IsConstant(node->id_name())) o.str_const = node->id_name();
+            else o.slot = Slot(node->id_name());
+            break;
+        default:
+            assert(0);
+    }
+    return o;
+}
+
+void Guard::Compile(ASTNode* node)
+{
+    switch (node->kind)
+    {
+        case AST_BOOL:
+            prog.push_back(Op{G_CONST, node->kind, node->bool_value(), -1, {}, {}});
+            break;
+        case AST_ID:
+            prog.push_back(Op{G_VAR, node->kind, false, Slot(node->id_name()), {}, {}});
+            break;
+        case AST_NOT:
+            Compile(node->unary_child());
+            prog.push_back(Op{G_NOT, node->kind, false, -1, {}, {}});
+            break;
+        case AST_AND:
+        case AST_OR:
+        case AST_ARROW:
+            Compile(node->binary_left());
+            Compile(node->binary_right());
+            prog.push_back(Op{node->kind == AST_AND ? G_AND : node->kind == AST_OR ? G_OR : G_ARROW,
+                              node->kind, false, -1, {}, {}});
+            break;
+        default:
+        {
+            Op op{G_CMP, node->kind, false, -1, {}, {}};
+            op.lhs = MakeOperand(node->binary_left());
+            op.rhs = MakeOperand(node->binary_right());
+            prog.push_back(op);
+        }
+    }
+}
+
+bool Guard::Compare(const Op& op) const
+{
+    const std::string* l = op.lhs.slot < 0 ? &op.lhs.str_const : slots[op.lhs.slot];
+    const std::string* r = op.rhs.slot < 0 ? &op.rhs.str_const : slots[op.rhs.slot];
+    if (!l || !r) return false;
+
+    switch (op.cmp)
+    {
+        case AST_EQ:  return *l == *r;
+        case AST_NEQ: return *l != *r;
+        default: break;
+    }
+
+    int li = op.lhs.slot < 0 ? op.lhs.int_const : stoi(*l);
+    int ri = op.rhs.slot < 0 ? op.rhs.int_const : stoi(*r);
+    switch (op.cmp)
+    {
+        case AST_GT:  return li > ri;
+        case AST_GTE: return li >= ri;
+        case AST_LT:  return li < ri;
+        case AST_LTE: return li <= ri;
+        default:
+            assert(0);
+    }
+    return false;
+}
+
+bool Guard::Holds(const std::unordered_map<std::string, std::string>& kv)
+{
+    if (prog.empty()) return true;
+
+    for (size_t i = 0; i < slot_names.size(); ++i) {
+        auto it = kv.find(slot_names[i]);
+        slots[i] = (it == kv.end()) ? nullptr : &it->second;
+    }
+
+    stack.clear();
+    for (const Op& op : prog)
+    {
+        switch (op.code)
+        {
+            case G_CONST:
+                stack.push_back(op.value);
+                break;
+            case G_VAR:
+                stack.push_back(slots[op.slot] && *slots[op.slot] == "true");
+                break;
+            case G_CMP:
+                stack.push_back(Compare(op));
+                break;
+            case G_NOT:
+                stack.back() = !stack.back();
+                break;
+            default:
+            {
+                bool r = stack.back();
+                stack.pop_back();
+                bool l = stack.back();
+                stack.back() = op.code == G_AND ? (l && r) : op.code == G_OR ? (l || r) : (!l || r);
+            }
+        }
+    }
+    assert(stack.size() == 1);
+    return stack.back();
+}
@@ -0,0 +1,56 @@
+#ifndef GUARD_H_
+#define GUARD_H_
+
+# include <string>
+# include <vector>
+# include <unordered_map>
+# include "ast.h"
+# include "typechecker.h"
+using namespace std ;
+
+// Response-validity guard from the spec's `guard` section.
+//
+// Violations are only reported on events the guard accepts, which is how a
+// spec keeps timeouts and garbage responses from counting. All guard lines
+// are ANDed and flattened once into a postfix program over variable slots:
+// per event each referenced variable is looked up once, then the program
+// runs on slot indices. A comparison against a variable the event does not
+// carry is false.
+class Guard
+{
+private:
+    enum OpCode : uint8_t { G_CONST, G_VAR, G_CMP, G_NOT, G_AND, G_OR, G_ARROW };
+    // One side of a comparison: a variable slot, or a constant (slot -1)
+    struct Operand
+    {
+        int slot = -1 ;
+        int int_const = 0 ;
+        std::string str_const ;
+    };
+    struct Op
+    {
+        OpCode code ;
+        ASTNodeKind cmp ;       // G_CMP: AST_GT ... AST_NEQ
+        bool value ;            // G_CONST
+        int slot ;              // G_VAR
+        Operand lhs, rhs ;      // G_CMP
+    };
+
+    vector<Op> prog ;
+    vector<std::string> slot_names ;
+    vector<const std::string*> slots ;
+    vector<char> stack ;
+    TypeChecker *tc ;
+
+    int Slot(const std::string& name);
+    Operand MakeOperand(ASTNode* node);
+    void Compile(ASTNode* node);
+    bool Compare(const Op& op) const;
+
+public:
+    Guard(const vector<ASTNode*>& guards, TypeChecker *tc);
+    bool empty() const { return prog.empty(); }
+    bool Holds(const std::unordered_map<std::string, std::string>& kv);
+};
+
+#endif
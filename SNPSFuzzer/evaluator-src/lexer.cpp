@@ -355,8 +355,8 @@ static void yynoreturn yy_fatal_error ( const char* msg  );
 	(yy_hold_char) = *yy_cp; \
 	*yy_cp = '\0'; \
 	(yy_c_buf_p) = yy_cp;
-#define YY_NUM_RULES 32
-#define YY_END_OF_BUFFER 33
+#define YY_NUM_RULES 37
+#define YY_END_OF_BUFFER 38
 /* This struct is not used in this scanner,
    but its presence is necessary. */
 struct yy_trans_info
@@ -364,110 +364,362 @@ struct yy_trans_info
 	flex_int32_t yy_verify;
 	flex_int32_t yy_nxt;
 	};
-static const flex_int16_t yy_accept[61] =
+static const flex_int16_t yy_accept[70] =
     {   0,
-        0,    0,   33,   31,    1,    1,   16,   17,    9,   10,
-       14,   31,   31,   30,   13,   24,   27,   23,   29,   20,
-       19,   21,   22,   29,   29,   29,   29,   29,   11,   18,
-       12,    1,   28,   30,   15,    0,    2,   26,   25,   29,
-       29,   29,   29,   29,   29,    0,    0,    2,   29,   29,
-       29,    5,   29,    3,    6,    4,   29,    7,    8,    0
+       0,    0,   38,   36,    1,    1,   21,   22,   10,   11,
+      15,   36,   36,   35,   14,   29,   32,   28,   19,   34,
+      25,   24,   26,   27,   16,   17,   18,   34,   34,   34,
+      34,   34,   34,   12,   23,   13,   33,   35,   20,    0,
+       2,   31,   30,   34,   34,   34,   34,   34,   34,   34,
+       0,    0,    2,   34,   34,   34,   34,    5,   34,    0,
+       3,    6,    4,   34,   34,    7,    8,    9,    0
     } ;
 
 static const YY_CHAR yy_ec[256] =
     {   0,
-        1,    1,    1,    1,    1,    1,    1,    1,    2,    3,
-        1,    1,    2,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    2,    4,    1,    1,    1,    1,    5,    1,    6,
-        7,    8,    1,    9,   10,    1,   11,   12,   12,   12,
-       12,   12,   12,   12,   12,   12,   12,    1,   13,   14,
-       15,   16,    1,    1,   17,   17,   17,   17,   17,   17,
-       17,   18,   17,   17,   17,   17,   17,   17,   19,   17,
-       17,   17,   20,   17,   17,   17,   17,   17,   21,   17,
-        1,    1,    1,    1,   17,    1,   22,   23,   17,   17,
-
-       24,   25,   17,   17,   26,   17,   17,   27,   28,   29,
-       30,   17,   17,   31,   32,   33,   34,   17,   17,   17,
-       17,   17,   35,   36,   37,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1
+       1,    1,    1,    1,    1,    1,    1,    1,    2,    3,
+       1,    1,    2,    1,    1,    1,    1,    1,    1,    1,
+       1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+       1,    2,    4,    1,    1,    1,    1,    5,    1,    6,
+       7,    8,    1,    9,   10,    1,   11,   12,   12,   12,
+      12,   12,   12,   12,   12,   12,   12,    1,   13,   14,
+      15,   16,    1,   17,   18,   18,   18,   18,   18,   18,
+      18,   19,   18,   18,   18,   18,   18,   18,   20,   18,
+      18,   18,   21,   18,   18,   18,   18,   18,   22,   18,
+      23,    1,   24,   25,   18,    1,   26,   27,   18,   28,
+
+      29,   30,   31,   18,   32,   18,   18,   33,   34,   35,
+      36,   18,   18,   37,   38,   39,   40,   18,   18,   18,
+      18,   18,   41,   42,   43,    1,    1,    1,    1,    1,
+       1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+       1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+       1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+       1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+       1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+       1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+       1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+
+       1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+       1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+       1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+       1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+       1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+       1,    1,    1,    1,    1
     } ;
 
-static const YY_CHAR yy_meta[38] =
+static const YY_CHAR yy_meta[44] =
     {   0,
-        1,    1,    2,    1,    1,    1,    1,    1,    1,    1,
-        1,    3,    1,    1,    1,    1,    3,    3,    3,    3,
-        3,    3,    3,    3,    3,    3,    3,    3,    3,    3,
-        3,    3,    3,    3,    1,    1,    1
+       1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+       1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+       1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+       1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+       1,    1,    1
     } ;
 
-static const flex_int16_t yy_base[64] =
+static const flex_int16_t yy_base[70] =
     {   0,
-        0,    0,   77,   78,   36,   38,   61,   78,   78,   78,
-       78,   30,   36,   63,   78,   59,   78,   58,    0,    0,
-        0,    0,    0,   42,   42,   48,   40,   37,   78,   78,
-       78,   46,   78,   55,   78,   58,    0,   78,   78,    0,
-       35,   30,   36,   29,   27,   52,   48,    0,   31,   29,
-       24,    0,   30,   78,    0,    0,   21,    0,    0,   78,
-       40,   49,   52
+       0,    0, 1213, 1213,   42,   44,   33, 1213, 1213, 1213,
+    1213,   37,   43,   38, 1213,   37, 1213,   40, 1213,   44,
+      73,  102,  131,  160, 1213, 1213, 1213,  189,  218,  247,
+     276,  305,  334, 1213, 1213, 1213, 1213,   45, 1213,  374,
+     417, 1213, 1213,  449,  478,  507,  536,  565,  594,  623,
+     663,  706,  749,  781,  810,  839,  868,  897,  926,  966,
+    1213,  998, 1027, 1056, 1085, 1114, 1143, 1172, 1213
     } ;
 
-static const flex_int16_t yy_def[64] =
+static const flex_int16_t yy_def[70] =
     {   0,
-       60,    1,   60,   60,   60,   60,   60,   60,   60,   60,
-       60,   60,   60,   60,   60,   60,   60,   60,   61,   61,
-       61,   61,   61,   61,   61,   61,   61,   61,   60,   60,
-       60,   60,   60,   60,   60,   62,   63,   60,   60,   61,
-       61,   61,   61,   61,   61,   62,   62,   63,   61,   61,
-       61,   61,   61,   60,   61,   61,   61,   61,   61,    0,
-       60,   60,   60
+      69,    1,   69,   69,   69,   69,   69,   69,   69,   69,
+      69,   69,   69,   69,   69,   69,   69,   69,   69,   69,
+      69,   69,   69,   69,   69,   69,   69,   69,   69,   69,
+      69,   69,   69,   69,   69,   69,   69,   69,   69,   69,
+      69,   69,   69,   69,   69,   69,   69,   69,   69,   69,
+      69,   69,   69,   69,   69,   69,   69,   69,   69,   69,
+      69,   69,   69,   69,   69,   69,   69,   69,    0
     } ;
 
-static const flex_int16_t yy_nxt[116] =
+static const flex_int16_t yy_nxt[1257] =
     {   0,
-        4,    5,    6,    7,    8,    9,   10,    4,   11,   12,
-       13,   14,   15,   16,   17,   18,   19,   20,   21,   22,
-       23,   19,   24,   25,   26,   27,   19,   19,   19,   19,
-       19,   19,   28,   19,   29,   30,   31,   32,   32,   32,
-       32,   34,   40,   36,   59,   35,   37,   32,   32,   46,
-       46,   46,   48,   58,   48,   57,   56,   55,   54,   47,
-       53,   52,   51,   50,   49,   47,   34,   45,   44,   43,
-       42,   41,   39,   38,   34,   33,   60,    3,   60,   60,
-       60,   60,   60,   60,   60,   60,   60,   60,   60,   60,
-       60,   60,   60,   60,   60,   60,   60,   60,   60,   60,
-
-       60,   60,   60,   60,   60,   60,   60,   60,   60,   60,
-       60,   60,   60,   60,   60
+       4,    5,    6,    7,    8,    9,   10,    4,   11,   12,
+      13,   14,   15,   16,   17,   18,   19,   20,   21,   22,
+      23,   24,   25,   26,   27,   20,   28,   20,   29,   30,
+      31,   32,   20,   20,   20,   20,   20,   20,   33,   20,
+      34,   35,   36,    6,    6,    6,    6,   37,   38,   38,
+      40,   42,   39,   41,   43,   44,   38,    0,    0,    0,
+       0,   44,   44,   44,   44,   44,    0,    0,    0,   44,
+      44,   44,   44,   44,   44,   44,   44,   44,   44,   44,
+      44,   44,   44,   44,   44,    0,    0,    0,    0,    0,
+      44,   44,   44,   44,   44,    0,    0,    0,   44,   44,
+
+      44,   44,   44,   44,   44,   44,   44,   44,   44,   44,
+      44,   44,   44,   44,    0,    0,    0,    0,    0,   44,
+      44,   44,   44,   44,    0,    0,    0,   44,   44,   44,
+      44,   44,   44,   44,   44,   44,   44,   44,   44,   44,
+      44,   44,   44,    0,    0,    0,    0,    0,   44,   44,
+      44,   44,   44,    0,    0,    0,   44,   44,   44,   44,
+      44,   44,   44,   44,   44,   44,   44,   44,   44,   44,
+      44,   44,    0,    0,    0,    0,    0,   44,   44,   44,
+      44,   44,    0,    0,    0,   44,   44,   44,   44,   44,
+      44,   44,   44,   44,   44,   44,   44,   44,   44,   44,
+
+      44,    0,    0,    0,    0,    0,   44,   44,   44,   44,
+      44,    0,    0,    0,   44,   44,   44,   44,   44,   44,
+      44,   44,   44,   44,   45,   44,   44,   44,   44,   44,
+       0,    0,    0,    0,    0,   44,   44,   44,   44,   44,
+       0,    0,    0,   44,   44,   44,   44,   44,   44,   44,
+      44,   44,   46,   44,   44,   44,   44,   44,   44,    0,
+       0,    0,    0,    0,   44,   44,   44,   44,   44,    0,
+       0,    0,   47,   44,   44,   44,   44,   44,   44,   44,
+      44,   44,   44,   44,   44,   44,   44,   44,    0,    0,
+       0,    0,    0,   44,   44,   44,   44,   44,    0,    0,
+
+       0,   44,   44,   44,   44,   44,   44,   44,   44,   44,
+      44,   44,   44,   44,   44,   48,   44,    0,    0,    0,
+       0,    0,   44,   44,   44,   44,   44,    0,    0,    0,
+      44,   44,   44,   44,   44,   44,   44,   44,   44,   49,
+      44,   44,   44,   44,   44,   44,    0,    0,    0,    0,
+       0,   44,   44,   44,   44,   44,    0,    0,    0,   44,
+      44,   44,   44,   44,   44,   44,   44,   44,   44,   44,
+      50,   44,   44,   44,   51,   51,   51,   51,   51,   51,
+      51,   52,   51,   51,   51,   51,   51,   51,   51,   51,
+      51,   51,   51,   51,   51,   51,   51,   51,   51,   51,
+
+      51,   51,   51,   51,   51,   51,   51,   51,   51,   51,
+      51,   51,   51,   51,   51,   51,   51,   53,   53,    0,
+      53,   53,   53,   53,   53,   53,   53,   53,   53,   53,
+      53,   53,   53,   53,   53,   53,   53,   53,   53,   53,
+      53,   53,   53,   53,   53,   53,   53,   53,   53,   53,
+      53,   53,   53,   53,   53,   53,   53,   53,   53,   53,
+      44,    0,    0,    0,    0,    0,   44,   44,   44,   44,
+      44,    0,    0,    0,   44,   44,   44,   44,   44,   44,
+      44,   44,   44,   44,   44,   44,   44,   44,   44,   44,
+       0,    0,    0,    0,    0,   44,   44,   44,   44,   44,
+
+       0,    0,    0,   44,   44,   44,   44,   44,   44,   44,
+      44,   44,   44,   54,   44,   44,   44,   44,   44,    0,
+       0,    0,    0,    0,   44,   44,   44,   44,   44,    0,
+       0,    0,   44,   44,   44,   44,   44,   44,   44,   44,
+      44,   44,   44,   44,   44,   44,   55,   44,    0,    0,
+       0,    0,    0,   44,   44,   44,   44,   44,    0,    0,
+       0,   44,   44,   44,   44,   44,   44,   44,   56,   44,
+      44,   44,   44,   44,   44,   44,   44,    0,    0,    0,
+       0,    0,   44,   44,   44,   44,   44,    0,    0,    0,
+      57,   44,   44,   44,   44,   44,   44,   44,   44,   44,
+
+      44,   44,   44,   44,   44,   44,    0,    0,    0,    0,
+       0,   44,   44,   44,   44,   44,    0,    0,    0,   44,
+      44,   44,   44,   44,   44,   44,   44,   44,   44,   44,
+      44,   44,   58,   44,   44,    0,    0,    0,    0,    0,
+      44,   44,   44,   44,   44,    0,    0,    0,   44,   44,
+      44,   44,   44,   44,   44,   44,   44,   44,   44,   44,
+      44,   44,   59,   51,   51,   51,   51,   51,   51,   51,
+      52,   51,   51,   51,   51,   51,   51,   51,   51,   51,
+      51,   51,   51,   51,   51,   51,   51,   51,   51,   51,
+      51,   51,   51,   51,   51,   51,   51,   51,   51,   51,
+
+      51,   51,   51,   51,   51,   51,   60,   60,   60,   60,
+      60,   60,   60,   60,   60,   60,   61,   60,   60,   60,
+      60,   60,   60,   60,   60,   60,   60,   60,   60,   60,
+      60,   60,   60,   60,   60,   60,   60,   60,   60,   60,
+      60,   60,   60,   60,   60,   60,   60,   60,   60,   53,
+      53,    0,   53,   53,   53,   53,   53,   53,   53,   53,
+      53,   53,   53,   53,   53,   53,   53,   53,   53,   53,
+      53,   53,   53,   53,   53,   53,   53,   53,   53,   53,
+      53,   53,   53,   53,   53,   53,   53,   53,   53,   53,
+      53,   53,   44,    0,    0,    0,    0,    0,   44,   44,
+
+      44,   44,   44,    0,    0,    0,   44,   44,   44,   44,
+      44,   44,   44,   62,   44,   44,   44,   44,   44,   44,
+      44,   44,    0,    0,    0,    0,    0,   44,   44,   44,
+      44,   44,    0,    0,    0,   44,   44,   44,   44,   44,
+      44,   44,   44,   63,   44,   44,   44,   44,   44,   44,
+      44,    0,    0,    0,    0,    0,   44,   44,   44,   44,
+      44,    0,    0,    0,   44,   44,   44,   44,   44,   44,
+      44,   44,   44,   44,   44,   44,   64,   44,   44,   44,
+       0,    0,    0,    0,    0,   44,   44,   44,   44,   44,
+       0,    0,    0,   44,   44,   44,   44,   44,   44,   44,
+
+      44,   44,   44,   44,   65,   44,   44,   44,   44,    0,
+       0,    0,    0,    0,   44,   44,   44,   44,   44,    0,
+       0,    0,   44,   44,   44,   44,   44,   44,   44,   44,
+      44,   44,   44,   44,   44,   44,   44,   44,    0,    0,
+       0,    0,    0,   44,   44,   44,   44,   44,    0,    0,
+       0,   44,   44,   44,   66,   44,   44,   44,   44,   44,
+      44,   44,   44,   44,   44,   44,   51,   51,   51,   51,
+      51,   51,   51,   52,   51,   51,   51,   51,   51,   51,
+      51,   51,   51,   51,   51,   51,   51,   51,   51,   51,
+      51,   51,   51,   51,   51,   51,   51,   51,   51,   51,
+
+      51,   51,   51,   51,   51,   51,   51,   51,   51,   44,
+       0,    0,    0,    0,    0,   44,   44,   44,   44,   44,
+       0,    0,    0,   44,   44,   44,   44,   44,   44,   44,
+      44,   44,   44,   44,   44,   44,   44,   44,   44,    0,
+       0,    0,    0,    0,   44,   44,   44,   44,   44,    0,
+       0,    0,   44,   44,   44,   44,   44,   44,   44,   44,
+      44,   44,   44,   44,   44,   44,   44,   44,    0,    0,
+       0,    0,    0,   44,   44,   44,   44,   44,    0,    0,
+       0,   44,   44,   44,   67,   44,   44,   44,   44,   44,
+      44,   44,   44,   44,   44,   44,   44,    0,    0,    0,
+
+       0,    0,   44,   44,   44,   44,   44,    0,    0,    0,
+      44,   44,   68,   44,   44,   44,   44,   44,   44,   44,
+      44,   44,   44,   44,   44,   44,    0,    0,    0,    0,
+       0,   44,   44,   44,   44,   44,    0,    0,    0,   44,
+      44,   44,   44,   44,   44,   44,   44,   44,   44,   44,
+      44,   44,   44,   44,   44,    0,    0,    0,    0,    0,
+      44,   44,   44,   44,   44,    0,    0,    0,   44,   44,
+      44,   44,   44,   44,   44,   44,   44,   44,   44,   44,
+      44,   44,   44,   44,    0,    0,    0,    0,    0,   44,
+      44,   44,   44,   44,    0,    0,    0,   44,   44,   44,
+
+      44,   44,   44,   44,   44,   44,   44,   44,   44,   44,
+      44,   44,    3,   69,   69,   69,   69,   69,   69,   69,
+      69,   69,   69,   69,   69,   69,   69,   69,   69,   69,
+      69,   69,   69,   69,   69,   69,   69,   69,   69,   69,
+      69,   69,   69,   69,   69,   69,   69,   69,   69,   69,
+      69,   69,   69,   69,   69,   69
     } ;
 
-static const flex_int16_t yy_chk[116] =
+static const flex_int16_t yy_chk[1257] =
     {   0,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    5,    5,    6,
-        6,   12,   61,   13,   57,   12,   13,   32,   32,   62,
-       62,   62,   63,   53,   63,   51,   50,   49,   47,   46,
-       45,   44,   43,   42,   41,   36,   34,   28,   27,   26,
-       25,   24,   18,   16,   14,    7,    3,   60,   60,   60,
-       60,   60,   60,   60,   60,   60,   60,   60,   60,   60,
-       60,   60,   60,   60,   60,   60,   60,   60,   60,   60,
-
-       60,   60,   60,   60,   60,   60,   60,   60,   60,   60,
-       60,   60,   60,   60,   60
+       1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+       1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+       1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+       1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+       1,    1,    1,    5,    5,    6,    6,    7,   12,   14,
+      13,   16,   12,   13,   18,   20,   38,    0,    0,    0,
+       0,   20,   20,   20,   20,   20,    0,    0,    0,   20,
+      20,   20,   20,   20,   20,   20,   20,   20,   20,   20,
+      20,   20,   20,   20,   21,    0,    0,    0,    0,    0,
+      21,   21,   21,   21,   21,    0,    0,    0,   21,   21,
+
+      21,   21,   21,   21,   21,   21,   21,   21,   21,   21,
+      21,   21,   21,   22,    0,    0,    0,    0,    0,   22,
+      22,   22,   22,   22,    0,    0,    0,   22,   22,   22,
+      22,   22,   22,   22,   22,   22,   22,   22,   22,   22,
+      22,   22,   23,    0,    0,    0,    0,    0,   23,   23,
+      23,   23,   23,    0,    0,    0,   23,   23,   23,   23,
+      23,   23,   23,   23,   23,   23,   23,   23,   23,   23,
+      23,   24,    0,    0,    0,    0,    0,   24,   24,   24,
+      24,   24,    0,    0,    0,   24,   24,   24,   24,   24,
+      24,   24,   24,   24,   24,   24,   24,   24,   24,   24,
+
+      28,    0,    0,    0,    0,    0,   28,   28,   28,   28,
+      28,    0,    0,    0,   28,   28,   28,   28,   28,   28,
+      28,   28,   28,   28,   28,   28,   28,   28,   28,   29,
+       0,    0,    0,    0,    0,   29,   29,   29,   29,   29,
+       0,    0,    0,   29,   29,   29,   29,   29,   29,   29,
+      29,   29,   29,   29,   29,   29,   29,   29,   30,    0,
+       0,    0,    0,    0,   30,   30,   30,   30,   30,    0,
+       0,    0,   30,   30,   30,   30,   30,   30,   30,   30,
+      30,   30,   30,   30,   30,   30,   30,   31,    0,    0,
+       0,    0,    0,   31,   31,   31,   31,   31,    0,    0,
+
+       0,   31,   31,   31,   31,   31,   31,   31,   31,   31,
+      31,   31,   31,   31,   31,   31,   32,    0,    0,    0,
+       0,    0,   32,   32,   32,   32,   32,    0,    0,    0,
+      32,   32,   32,   32,   32,   32,   32,   32,   32,   32,
+      32,   32,   32,   32,   32,   33,    0,    0,    0,    0,
+       0,   33,   33,   33,   33,   33,    0,    0,    0,   33,
+      33,   33,   33,   33,   33,   33,   33,   33,   33,   33,
+      33,   33,   33,   33,   40,   40,   40,   40,   40,   40,
+      40,   40,   40,   40,   40,   40,   40,   40,   40,   40,
+      40,   40,   40,   40,   40,   40,   40,   40,   40,   40,
+
+      40,   40,   40,   40,   40,   40,   40,   40,   40,   40,
+      40,   40,   40,   40,   40,   40,   40,   41,   41,    0,
+      41,   41,   41,   41,   41,   41,   41,   41,   41,   41,
+      41,   41,   41,   41,   41,   41,   41,   41,   41,   41,
+      41,   41,   41,   41,   41,   41,   41,   41,   41,   41,
+      41,   41,   41,   41,   41,   41,   41,   41,   41,   41,
+      44,    0,    0,    0,    0,    0,   44,   44,   44,   44,
+      44,    0,    0,    0,   44,   44,   44,   44,   44,   44,
+      44,   44,   44,   44,   44,   44,   44,   44,   44,   45,
+       0,    0,    0,    0,    0,   45,   45,   45,   45,   45,
+
+       0,    0,    0,   45,   45,   45,   45,   45,   45,   45,
+      45,   45,   45,   45,   45,   45,   45,   45,   46,    0,
+       0,    0,    0,    0,   46,   46,   46,   46,   46,    0,
+       0,    0,   46,   46,   46,   46,   46,   46,   46,   46,
+      46,   46,   46,   46,   46,   46,   46,   47,    0,    0,
+       0,    0,    0,   47,   47,   47,   47,   47,    0,    0,
+       0,   47,   47,   47,   47,   47,   47,   47,   47,   47,
+      47,   47,   47,   47,   47,   47,   48,    0,    0,    0,
+       0,    0,   48,   48,   48,   48,   48,    0,    0,    0,
+      48,   48,   48,   48,   48,   48,   48,   48,   48,   48,
+
+      48,   48,   48,   48,   48,   49,    0,    0,    0,    0,
+       0,   49,   49,   49,   49,   49,    0,    0,    0,   49,
+      49,   49,   49,   49,   49,   49,   49,   49,   49,   49,
+      49,   49,   49,   49,   50,    0,    0,    0,    0,    0,
+      50,   50,   50,   50,   50,    0,    0,    0,   50,   50,
+      50,   50,   50,   50,   50,   50,   50,   50,   50,   50,
+      50,   50,   50,   51,   51,   51,   51,   51,   51,   51,
+      51,   51,   51,   51,   51,   51,   51,   51,   51,   51,
+      51,   51,   51,   51,   51,   51,   51,   51,   51,   51,
+      51,   51,   51,   51,   51,   51,   51,   51,   51,   51,
+
+      51,   51,   51,   51,   51,   51,   52,   52,   52,   52,
+      52,   52,   52,   52,   52,   52,   52,   52,   52,   52,
+      52,   52,   52,   52,   52,   52,   52,   52,   52,   52,
+      52,   52,   52,   52,   52,   52,   52,   52,   52,   52,
+      52,   52,   52,   52,   52,   52,   52,   52,   52,   53,
+      53,    0,   53,   53,   53,   53,   53,   53,   53,   53,
+      53,   53,   53,   53,   53,   53,   53,   53,   53,   53,
+      53,   53,   53,   53,   53,   53,   53,   53,   53,   53,
+      53,   53,   53,   53,   53,   53,   53,   53,   53,   53,
+      53,   53,   54,    0,    0,    0,    0,    0,   54,   54,
+
+      54,   54,   54,    0,    0,    0,   54,   54,   54,   54,
+      54,   54,   54,   54,   54,   54,   54,   54,   54,   54,
+      54,   55,    0,    0,    0,    0,    0,   55,   55,   55,
+      55,   55,    0,    0,    0,   55,   55,   55,   55,   55,
+      55,   55,   55,   55,   55,   55,   55,   55,   55,   55,
+      56,    0,    0,    0,    0,    0,   56,   56,   56,   56,
+      56,    0,    0,    0,   56,   56,   56,   56,   56,   56,
+      56,   56,   56,   56,   56,   56,   56,   56,   56,   57,
+       0,    0,    0,    0,    0,   57,   57,   57,   57,   57,
+       0,    0,    0,   57,   57,   57,   57,   57,   57,   57,
+
+      57,   57,   57,   57,   57,   57,   57,   57,   58,    0,
+       0,    0,    0,    0,   58,   58,   58,   58,   58,    0,
+       0,    0,   58,   58,   58,   58,   58,   58,   58,   58,
+      58,   58,   58,   58,   58,   58,   58,   59,    0,    0,
+       0,    0,    0,   59,   59,   59,   59,   59,    0,    0,
+       0,   59,   59,   59,   59,   59,   59,   59,   59,   59,
+      59,   59,   59,   59,   59,   59,   60,   60,   60,   60,
+      60,   60,   60,   60,   60,   60,   60,   60,   60,   60,
+      60,   60,   60,   60,   60,   60,   60,   60,   60,   60,
+      60,   60,   60,   60,   60,   60,   60,   60,   60,   60,
+
+      60,   60,   60,   60,   60,   60,   60,   60,   60,   62,
+       0,    0,    0,    0,    0,   62,   62,   62,   62,   62,
+       0,    0,    0,   62,   62,   62,   62,   62,   62,   62,
+      62,   62,   62,   62,   62,   62,   62,   62,   63,    0,
+       0,    0,    0,    0,   63,   63,   63,   63,   63,    0,
+       0,    0,   63,   63,   63,   63,   63,   63,   63,   63,
+      63,   63,   63,   63,   63,   63,   63,   64,    0,    0,
+       0,    0,    0,   64,   64,   64,   64,   64,    0,    0,
+       0,   64,   64,   64,   64,   64,   64,   64,   64,   64,
+      64,   64,   64,   64,   64,   64,   65,    0,    0,    0,
+
+       0,    0,   65,   65,   65,   65,   65,    0,    0,    0,
+      65,   65,   65,   65,   65,   65,   65,   65,   65,   65,
+      65,   65,   65,   65,   65,   66,    0,    0,    0,    0,
+       0,   66,   66,   66,   66,   66,    0,    0,    0,   66,
+      66,   66,   66,   66,   66,   66,   66,   66,   66,   66,
+      66,   66,   66,   66,   67,    0,    0,    0,    0,    0,
+      67,   67,   67,   67,   67,    0,    0,    0,   67,   67,
+      67,   67,   67,   67,   67,   67,   67,   67,   67,   67,
+      67,   67,   67,   68,    0,    0,    0,    0,    0,   68,
+      68,   68,   68,   68,    0,    0,    0,   68,   68,   68,
+
+      68,   68,   68,   68,   68,   68,   68,   68,   68,   68,
+      68,   68,   69,   69,   69,   69,   69,   69,   69,   69,
+      69,   69,   69,   69,   69,   69,   69,   69,   69,   69,
+      69,   69,   69,   69,   69,   69,   69,   69,   69,   69,
+      69,   69,   69,   69,   69,   69,   69,   69,   69,   69,
+      69,   69,   69,   69,   69,   69
     } ;
 
 static yy_state_type yy_last_accepting_state;
@@ -487,14 +739,13 @@ char *yytext;
 #line 1 "evaluator-src/lexer.l"
 #line 2 "evaluator-src/lexer.l"
 #include <string>
-#include <cstring>  // For strdup
 #include "ast.h"
 #include "parser.hpp" // Generated by Bison
 
 // Define yylval
 extern YYSTYPE yylval;
-#line 497 "evaluator-src/lexer.cpp"
-#line 498 "evaluator-src/lexer.cpp"
+#line 748 "evaluator-src/lexer.cpp"
+#line 749 "evaluator-src/lexer.cpp"
 
 #define INITIAL 0
 
@@ -711,10 +962,10 @@ YY_DECL
 		}
 
 	{
-#line 13 "evaluator-src/lexer.l"
+#line 12 "evaluator-src/lexer.l"
 
 
-#line 718 "evaluator-src/lexer.cpp"
+#line 969 "evaluator-src/lexer.cpp"
 
 	while ( /*CONSTCOND*/1 )		/* loops until end-of-file is reached */
 		{
@@ -741,13 +992,13 @@ yy_match:
 			while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 				{
 				yy_current_state = (int) yy_def[yy_current_state];
-				if ( yy_current_state >= 61 )
+				if ( yy_current_state >= 70 )
 					yy_c = yy_meta[yy_c];
 				}
 			yy_current_state = yy_nxt[yy_base[yy_current_state] + yy_c];
 			++yy_cp;
 			}
-		while ( yy_base[yy_current_state] != 78 );
+		while ( yy_base[yy_current_state] != 1213 );
 
 yy_find_action:
 		yy_act = yy_accept[yy_current_state];
@@ -774,172 +1025,197 @@ do_action:	/* This label is used only to access EOF actions. */
 case 1:
 /* rule 1 can match eol */
 YY_RULE_SETUP
-#line 15 "evaluator-src/lexer.l"
+#line 14 "evaluator-src/lexer.l"
 /* ignore whitespace */
 	YY_BREAK
 case 2:
 YY_RULE_SETUP
-#line 16 "evaluator-src/lexer.l"
+#line 15 "evaluator-src/lexer.l"
 /* ignore single-line comments */
 	YY_BREAK
 case 3:
 /* rule 3 can match eol */
 YY_RULE_SETUP
-#line 17 "evaluator-src/lexer.l"
+#line 16 "evaluator-src/lexer.l"
 /* ignore multi-line comments */
 	YY_BREAK
 case 4:
 YY_RULE_SETUP
-#line 19 "evaluator-src/lexer.l"
+#line 18 "evaluator-src/lexer.l"
 { return ENUM; }
 	YY_BREAK
 case 5:
 YY_RULE_SETUP
-#line 20 "evaluator-src/lexer.l"
+#line 19 "evaluator-src/lexer.l"
 { return INT_TYPE; }
 	YY_BREAK
 case 6:
 YY_RULE_SETUP
-#line 21 "evaluator-src/lexer.l"
+#line 20 "evaluator-src/lexer.l"
 { return BOOL_TYPE; }
 	YY_BREAK
 case 7:
 YY_RULE_SETUP
-#line 22 "evaluator-src/lexer.l"
+#line 21 "evaluator-src/lexer.l"
 { return TRUE; }
 	YY_BREAK
 case 8:
 YY_RULE_SETUP
-#line 23 "evaluator-src/lexer.l"
+#line 22 "evaluator-src/lexer.l"
 { return FALSE; }
 	YY_BREAK
 case 9:
 YY_RULE_SETUP
+#line 23 "evaluator-src/lexer.l"
+{ return GUARD; }
+	YY_BREAK
+case 10:
+YY_RULE_SETUP
 #line 25 "evaluator-src/lexer.l"
 { return LPAREN; }
 	YY_BREAK
-case 10:
+case 11:
 YY_RULE_SETUP
 #line 26 "evaluator-src/lexer.l"
 { return RPAREN; }
 	YY_BREAK
-case 11:
+case 12:
 YY_RULE_SETUP
 #line 27 "evaluator-src/lexer.l"
 { return LBRACE; }
 	YY_BREAK
-case 12:
+case 13:
 YY_RULE_SETUP
 #line 28 "evaluator-src/lexer.l"
 { return RBRACE; }
 	YY_BREAK
-case 13:
+case 14:
 YY_RULE_SETUP
 #line 29 "evaluator-src/lexer.l"
 { return SEMICOLON; }
 	YY_BREAK
-case 14:
+case 15:
 YY_RULE_SETUP
 #line 30 "evaluator-src/lexer.l"
 { return COMMA; }
 	YY_BREAK
-case 15:
+case 16:
+YY_RULE_SETUP
+#line 31 "evaluator-src/lexer.l"
+{ return LBRACKET; }
+	YY_BREAK
+case 17:
 YY_RULE_SETUP
 #line 32 "evaluator-src/lexer.l"
-{ return ARROW; }
+{ return RBRACKET; }
 	YY_BREAK
-case 16:
+case 18:
 YY_RULE_SETUP
 #line 33 "evaluator-src/lexer.l"
-{ return NOT; }
+{ return CARET; }
 	YY_BREAK
-case 17:
+case 19:
 YY_RULE_SETUP
 #line 34 "evaluator-src/lexer.l"
+{ return AT; }
+	YY_BREAK
+case 20:
+YY_RULE_SETUP
+#line 36 "evaluator-src/lexer.l"
+{ return ARROW; }
+	YY_BREAK
+case 21:
+YY_RULE_SETUP
+#line 37 "evaluator-src/lexer.l"
+{ return NOT; }
+	YY_BREAK
+case 22:
+YY_RULE_SETUP
+#line 38 "evaluator-src/lexer.l"
 { return AND; }
 	YY_BREAK
-case 18:
+case 23:
 YY_RULE_SETUP
-#line 35 "evaluator-src/lexer.l"
+#line 39 "evaluator-src/lexer.l"
 { return OR; }
 	YY_BREAK
-case 19:
+case 24:
 YY_RULE_SETUP
-#line 36 "evaluator-src/lexer.l"
+#line 40 "evaluator-src/lexer.l"
 { return O; }
 	YY_BREAK
-case 20:
+case 25:
 YY_RULE_SETUP
-#line 37 "evaluator-src/lexer.l"
+#line 41 "evaluator-src/lexer.l"
 { return H; }
 	YY_BREAK
-case 21:
+case 26:
 YY_RULE_SETUP
-#line 38 "evaluator-src/lexer.l"
+#line 42 "evaluator-src/lexer.l"
 { return S; }
 	YY_BREAK
-case 22:
+case 27:
 YY_RULE_SETUP
-#line 39 "evaluator-src/lexer.l"
+#line 43 "evaluator-src/lexer.l"
 { return Y; }
 	YY_BREAK
-case 23:
+case 28:
 YY_RULE_SETUP
-#line 41 "evaluator-src/lexer.l"
+#line 45 "evaluator-src/lexer.l"
 { return GT; }
 	YY_BREAK
-case 24:
+case 29:
 YY_RULE_SETUP
-#line 42 "evaluator-src/lexer.l"
+#line 46 "evaluator-src/lexer.l"
 { return LT; }
 	YY_BREAK
-case 25:
+case 30:
 YY_RULE_SETUP
-#line 43 "evaluator-src/lexer.l"
+#line 47 "evaluator-src/lexer.l"
 { return GTE; }
 	YY_BREAK
-case 26:
+case 31:
 YY_RULE_SETUP
-#line 44 "evaluator-src/lexer.l"
+#line 48 "evaluator-src/lexer.l"
 { return LTE; }
 	YY_BREAK
-case 27:
+case 32:
 YY_RULE_SETUP
-#line 45 "evaluator-src/lexer.l"
+#line 49 "evaluator-src/lexer.l"
 { return EQ; }
 	YY_BREAK
-case 28:
+case 33:
 YY_RULE_SETUP
-#line 46 "evaluator-src/lexer.l"
+#line 50 "evaluator-src/lexer.l"
 { return NEQ; }
 	YY_BREAK
-case 29:
+case 34:
 YY_RULE_SETUP
-#line 48 "evaluator-src/lexer.l"
-{ 
-                           yylval.str = strdup(yytext);  // Use strdup
+#line 52 "evaluator-src/lexer.l"
+{
+                           yylval.sym = ast_arena.intern(yytext, yyleng);
                            return ID; 
                         }
 	YY_BREAK
-case 30:
+case 35:
 YY_RULE_SETUP
-#line 52 "evaluator-src/lexer.l"
-{ 
+#line 56 "evaluator-src/lexer.l"
+{
                            yylval.val = std::stoi(yytext);
                            return INT; 
                         }
 	YY_BREAK
-case 31:
+case 36:
 YY_RULE_SETUP
-#line 57 "evaluator-src/lexer.l"
+#line 61 "evaluator-src/lexer.l"
 { /* ignore unrecognized characters */ }
 	YY_BREAK
-case 32:
+case 37:
 YY_RULE_SETUP
-#line 59 "evaluator-src/lexer.l"
+#line 63 "evaluator-src/lexer.l"
 ECHO;
 	YY_BREAK
-#line 943 "evaluator-src/lexer.cpp"
+#line 1219 "evaluator-src/lexer.cpp"
 case YY_STATE_EOF(INITIAL):
 	yyterminate();
 
@@ -1236,7 +1512,7 @@ static int yy_get_next_buffer (void)
 		while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 			{
 			yy_current_state = (int) yy_def[yy_current_state];
-			if ( yy_current_state >= 61 )
+			if ( yy_current_state >= 70 )
 				yy_c = yy_meta[yy_c];
 			}
 		yy_current_state = yy_nxt[yy_base[yy_current_state] + yy_c];
@@ -1264,11 +1540,11 @@ static int yy_get_next_buffer (void)
 	while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 		{
 		yy_current_state = (int) yy_def[yy_current_state];
-		if ( yy_current_state >= 61 )
+		if ( yy_current_state >= 70 )
 			yy_c = yy_meta[yy_c];
 		}
 	yy_current_state = yy_nxt[yy_base[yy_current_state] + yy_c];
-	yy_is_jam = (yy_current_state == 60);
+	yy_is_jam = (yy_current_state == 69);
 
 		return yy_is_jam ? 0 : yy_current_state;
 }
@@ -1944,5 +2220,5 @@ void yyfree (void * ptr )
 
 #define YYTABLES_NAME "yytables"
 
-#line 59 "evaluator-src/lexer.l"
+#line 63 "evaluator-src/lexer.l"
 
@@ -0,0 +1,794 @@
+// ltl_adaptergen.cpp - Generate a predicate adapter from a *.adapter description
+//
+// A description says how a protocol's messages map onto a spec's variables:
+//
+//   protocol smtp                 # names the files and symbols
+//   prefix   SMTP                 # id prefix of <proto>_pred_spec.h (ltl_predgen)
+//   framing  ftp_reply            # none | dtls | text | ftp_reply (pred_stream.h)
+//
+//   request                       # client-to-server fields
+//     is_request   = true
+//     smtp_command = token 0 nocase map { HELO -> cmdHELO, * -> cmdNotSet }
+//   response                      # server-to-client fields
+//     smtp_command = request      # value the latest request produced
+//     reply_code   = digits 0 3 map { - -> 0 }
+//
+// Sources: a constant; `token N` (Nth word of the first line); `digits OFF N`;
+// `u8|u16|u32 OFF [& MASK] [>> SHIFT]` (big-endian); `header "Name"`;
+// `length`; `request`. A map translates the raw value; `-` is the value
+// when the field is absent from the message and `*` the value for any key
+// not listed. Variables a direction does not mention are sent as 0 / false
+// / the enum's first value.
+//
+// Every variable and enum value is checked against the spec. The output is
+// <proto>_predicate_adapter.{c,h}, built on pred_gen_rt.h and the
+// <proto>_pred_spec.h header ltl_predgen writes for the same spec: string
+// maps become collision-free hash tables and small numeric maps direct
+// lookup tables, so a message costs one pass per field and no strstr().
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ast.h"
+#include "memory_manager.h"
+#include "predicate_schema.h"
+
+extern FILE *yyin;
+extern int yyparse();
+extern Spec root;
+
+namespace {
+
+struct Token
+{
+    std::string text;
+    bool quoted;
+    int line;
+};
+
+enum class Src { Const, Token, Digits, Uint, Header, Length, Request };
+
+struct MapEntry
+{
+    enum { Key, Absent, Default } kind;
+    std::string skey;               // string sources (upper-cased if nocase)
+    long nkey;                      // numeric sources
+    int32_t value;
+};
+
+struct Field
+{
+    int var;
+    Src src;
+    long a = 0, b = 0;              // token index / offset, digit count / width
+    uint32_t mask = 0xffffffffu;
+    int shift = 0;
+    bool nocase = false;
+    std::string header;
+    int32_t value = 0;              // Src::Const
+    bool has_map = false;
+    std::vector<MapEntry> map;
+    int line;
+};
+
+struct Desc
+{
+    std::string proto, prefix, framing;
+    std::vector<Field> req, resp;
+};
+
+[[noreturn]] void fail(int line, const std::string& msg)
+{
+    throw std::runtime_error("line " + std::to_string(line) + ": " + msg);
+}
+
+std::vector<Token> tokenize(const std::string& text)
+{
+    std::vector<Token> toks;
+    int line = 1;
+    size_t i = 0;
+
+    while (i < text.size())
+    {
+        char c = text[i];
+        if (c == '\n') { line++; i++; continue; }
+        if (isspace((unsigned char)c)) { i++; continue; }
+        if (c == '#') { while (i < text.size() && text[i] != '\n') i++; continue; }
+
+        if (c == '"')
+        {
+            size_t end = text.find('"', i + 1);
+            if (end == std::string::npos) fail(line, "unterminated string");
+            toks.push_back({ text.substr(i + 1, end - i - 1), true, line });
+            i = end + 1;
+        }
+        else if (text.compare(i, 2, "->") == 0 || text.compare(i, 2, ">>") == 0)
+        {
+            toks.push_back({ text.substr(i, 2), false, line });
+            i += 2;
+        }
+        else if (std::string("{},=*&").find(c) != std::string::npos)
+        {
+            toks.push_back({ std::string(1, c), false, line });
+            i++;
+        }
+        else
+        {
+            size_t start = i;
+            while (i < text.size() && !isspace((unsigned char)text[i]) &&
+                   std::string("{},=*&\"#").find(text[i]) == std::string::npos &&
+                   text.compare(i, 2, "->") != 0)
+                i++;
+            toks.push_back({ text.substr(start, i - start), false, line });
+        }
+    }
+    return toks;
+}
+
+class Parser
+{
+public:
+    Parser(std::vector<Token> toks, const PredicateSchema& schema)
+        : toks_(std::move(toks)), schema_(schema) {}
+
+    Desc Parse()
+    {
+        Desc d;
+        std::vector<Field>* section = nullptr;
+
+        while (pos_ < toks_.size())
+        {
+            const Token& t = Next();
+            if (t.text == "protocol") d.proto = Next().text;
+            else if (t.text == "prefix") d.prefix = Next().text;
+            else if (t.text == "framing") d.framing = Next().text;
+            else if (t.text == "request") section = &d.req;
+            else if (t.text == "response") section = &d.resp;
+            else if (section) section->push_back(ParseField(t));
+            else fail(t.line, "expected protocol/prefix/framing/request/response, got '" + t.text + "'");
+        }
+
+        if (d.proto.empty() || d.prefix.empty()) fail(0, "protocol and prefix are required");
+        if (d.framing.empty()) d.framing = "none";
+        if (d.framing != "none" && d.framing != "dtls" && d.framing != "text" && d.framing != "ftp_reply")
+            fail(0, "unknown framing '" + d.framing + "'");
+
+        for (const Field& f : d.resp)
+        {
+            if (f.src != Src::Request) continue;
+            bool found = false;
+            for (const Field& r : d.req) found |= (r.var == f.var);
+            if (!found) fail(f.line, schema_.Name(f.var) + " = request, but the request section does not set it");
+        }
+        return d;
+    }
+
+private:
+    const Token& Next()
+    {
+        if (pos_ >= toks_.size()) fail(toks_.empty() ? 0 : toks_.back().line, "unexpected end of description");
+        return toks_[pos_++];
+    }
+
+    bool Accept(const char* text)
+    {
+        if (pos_ < toks_.size() && !toks_[pos_].quoted && toks_[pos_].text == text) { pos_++; return true; }
+        return false;
+    }
+
+    void Expect(const char* text)
+    {
+        const Token& t = Next();
+        if (t.quoted || t.text != text) fail(t.line, std::string("expected '") + text + "', got '" + t.text + "'");
+    }
+
+    long Number(const Token& t)
+    {
+        char* end;
+        long v = strtol(t.text.c_str(), &end, 0);
+        if (t.text.empty() || *end) fail(t.line, "expected a number, got '" + t.text + "'");
+        return v;
+    }
+
+    // Constant or map value for variable `var`, checked against its kind
+    int32_t Value(int var, const Token& t)
+    {
+        switch (schema_.Kind(var))
+        {
+            case PRED_KIND_BOOL:
+                if (t.text == "true") return 1;
+                if (t.text == "false") return 0;
+                fail(t.line, schema_.Name(var) + " is bool, got '" + t.text + "'");
+            case PRED_KIND_INT:
+                return (int32_t)Number(t);
+            default:
+            {
+                int v = schema_.FindValue(var, t.text);
+                if (v < 0) fail(t.line, "enum " + schema_.Name(var) + " has no value '" + t.text + "'");
+                return v;
+            }
+        }
+    }
+
+    Field ParseField(const Token& name)
+    {
+        Field f;
+        f.line = name.line;
+        f.var = schema_.FindVar(name.text);
+        if (f.var < 0) fail(name.line, "spec has no variable '" + name.text + "'");
+        Expect("=");
+
+        const Token& s = Next();
+        if (s.text == "token") { f.src = Src::Token; f.a = Number(Next()); }
+        else if (s.text == "digits") { f.src = Src::Digits; f.a = Number(Next()); f.b = Number(Next()); }
+        else if (s.text == "u8" || s.text == "u16" || s.text == "u32")
+        {
+            f.src = Src::Uint;
+            f.a = Number(Next());
+            f.b = s.text == "u8" ? 1 : s.text == "u16" ? 2 : 4;
+            if (Accept("&")) f.mask = (uint32_t)Number(Next());
+            if (Accept(">>")) f.shift = (int)Number(Next());
+        }
+        else if (s.text == "header")
+        {
+            f.src = Src::Header;
+            f.header = Next().text;
+        }
+        else if (s.text == "length") f.src = Src::Length;
+        else if (s.text == "request") f.src = Src::Request;
+        else { f.src = Src::Const; f.value = Value(f.var, s); }
+
+        if (Accept("nocase")) f.nocase = true;
+        if (Accept("map")) ParseMap(f);
+
+        bool string_src = f.src == Src::Token || f.src == Src::Header;
+        if (schema_.Kind(f.var) == PRED_KIND_ENUM && !f.has_map &&
+            f.src != Src::Const && f.src != Src::Request)
+            fail(f.line, "enum " + schema_.Name(f.var) + " needs a map");
+        if (f.nocase && !string_src) fail(f.line, "nocase only applies to token/header sources");
+        if (f.has_map && (f.src == Src::Const || f.src == Src::Request))
+            fail(f.line, "constants and request values take no map");
+        return f;
+    }
+
+    void ParseMap(Field& f)
+    {
+        bool string_src = f.src == Src::Token || f.src == Src::Header;
+        f.has_map = true;
+        Expect("{");
+        while (!Accept("}"))
+        {
+            MapEntry e;
+            const Token& k = Next();
+            if (!k.quoted && k.text == "*") e.kind = MapEntry::Default;
+            else if (!k.quoted && k.text == "-") e.kind = MapEntry::Absent;
+            else
+            {
+                e.kind = MapEntry::Key;
+                if (string_src)
+                {
+                    e.skey = k.text;
+                    if (f.nocase) for (auto& c : e.skey) c = (char)toupper((unsigned char)c);
+                    if (e.skey.size() > 255) fail(k.line, "key longer than 255 bytes");
+                }
+                else e.nkey = Number(k);
+            }
+            Expect("->");
+            e.value = Value(f.var, Next());
+            f.map.push_back(e);
+            Accept(",");
+        }
+    }
+
+    std::vector<Token> toks_;
+    size_t pos_ = 0;
+    const PredicateSchema& schema_;
+};
+
+// --- Emitter ---
+
+uint32_t pg_hash(const std::string& s, uint32_t seed)
+{
+    uint32_t h = 2166136261u ^ seed;
+    for (unsigned char c : s) h = (h ^ c) * 16777619u;
+    return h;
+}
+
+class Emitter
+{
+public:
+    Emitter(const Desc& d, const PredicateSchema& schema, const std::string& desc_path)
+        : d_(d), schema_(schema), desc_path_(desc_path)
+    {
+        lower_ = d.proto;
+        upper_ = d.proto;
+        for (auto& c : upper_) c = (char)toupper((unsigned char)c);
+    }
+
+    void WriteHeader(std::ostream& os) const
+    {
+        const std::string& p = d_.proto;
+        os << "// " << p << "_predicate_adapter.h - generated by ltl_adaptergen from " << desc_path_ << "\n"
+           << "// Do not edit; regenerate when the description or the spec changes.\n"
+           << "#ifndef " << upper_ << "_PREDICATE_ADAPTER_H\n"
+           << "#define " << upper_ << "_PREDICATE_ADAPTER_H\n\n"
+           << "#include <stddef.h>\n\n"
+           << "#include \"predicate_adapter.h\"\n\n"
+           << "#ifdef __cplusplus\nextern \"C\" {\n#endif\n\n"
+           << "typedef struct " << p << "_adapter_ctx " << p << "_adapter_ctx_t;\n\n"
+           << p << "_adapter_ctx_t *" << p << "_adapter_create(void);\n"
+           << "void " << p << "_adapter_reset(" << p << "_adapter_ctx_t *ctx);\n"
+           << "void " << p << "_adapter_destroy(" << p << "_adapter_ctx_t *ctx);\n\n";
+        for (const char* dir : { "request", "response" })
+        {
+            os << "void " << p << "_build_" << dir << "_pred_line(" << p << "_adapter_ctx_t *ctx,\n"
+               << "    const unsigned char *buf, unsigned int len, char *out, size_t out_sz);\n";
+        }
+        for (const char* dir : { "request", "response" })
+        {
+            os << "void " << p << "_build_" << dir << "_record(" << p << "_adapter_ctx_t *ctx,\n"
+               << "    const unsigned char *buf, unsigned int len, pred_record_t *rec);\n";
+        }
+        os << "\nextern const predicate_adapter_t " << p << "_predicate_adapter;\n\n"
+           << "#ifdef __cplusplus\n}\n#endif\n\n"
+           << "#endif /* " << upper_ << "_PREDICATE_ADAPTER_H */\n";
+    }
+
+    void WriteSource(std::ostream& os)
+    {
+        const std::string& p = d_.proto;
+        os << "// " << p << "_predicate_adapter.c - generated by ltl_adaptergen from " << desc_path_ << "\n"
+           << "// Do not edit; regenerate when the description or the spec changes.\n"
+           << "#include \"" << p << "_predicate_adapter.h\"\n"
+           << "#include \"" << p << "_pred_spec.h\"\n"
+           << "#include \"pred_gen_rt.h\"\n"
+           << "#include \"pred_trace.h\"\n";
+        if (UsesHeaders(d_.req) || UsesHeaders(d_.resp)) os << "#include \"header_index.h\"\n";
+        os << "\n#include <stdlib.h>\n#include <string.h>\n\n";
+
+        os << "struct " << p << "_adapter_ctx {\n"
+           << "    unsigned int msg_id;\n";
+        for (const Field& f : d_.resp)
+            if (f.src == Src::Request) os << "    int32_t req_" << schema_.Name(f.var) << ";\n";
+        os << "};\n\n";
+
+        os << p << "_adapter_ctx_t *" << p << "_adapter_create(void)\n{\n"
+           << "    return calloc(1, sizeof(" << p << "_adapter_ctx_t));\n}\n\n"
+           << "void " << p << "_adapter_reset(" << p << "_adapter_ctx_t *ctx)\n{\n"
+           << "    memset(ctx, 0, sizeof(*ctx));\n}\n\n"
+           << "void " << p << "_adapter_destroy(" << p << "_adapter_ctx_t *ctx)\n{\n"
+           << "    free(ctx);\n}\n\n";
+
+        WriteTables(os, d_.req, "req");
+        WriteTables(os, d_.resp, "resp");
+        WriteBuilder(os, d_.req, "request", "req");
+        WriteBuilder(os, d_.resp, "response", "resp");
+
+        for (const char* dir : { "request", "response" })
+        {
+            bool req = dir[2] == 'q';
+            os << "void " << p << "_build_" << dir << "_pred_line(" << p << "_adapter_ctx_t *ctx,\n"
+               << "    const unsigned char *buf, unsigned int len, char *out, size_t out_sz)\n{\n"
+               << "    pred_record_t rec;\n\n"
+               << "    if (!out || out_sz == 0) return;\n"
+               << "    " << p << "_build_" << dir << "_record(ctx, buf, len, &rec);\n"
+               << "    pred_record_format(&rec, &" << lower_ << "_pred_schema, out, out_sz);\n"
+               << "    pred_append_packet_trace(out, out_sz, ++ctx->msg_id, \"" << (req ? "C2S" : "S2C")
+               << "\", buf, len);\n}\n\n";
+        }
+
+        os << "PREDICATE_ADAPTER_DEFINE_TYPED(" << p << ", " << p << "_adapter_ctx_t,\n"
+           << "                               " << p << "_build_request_pred_line,\n"
+           << "                               " << p << "_build_response_pred_line,\n"
+           << "                               " << p << "_build_request_record,\n"
+           << "                               " << p << "_build_response_record,\n"
+           << "                               " << FramingEnum() << ");\n";
+    }
+
+private:
+    static bool UsesHeaders(const std::vector<Field>& fields)
+    {
+        for (const Field& f : fields) if (f.src == Src::Header) return true;
+        return false;
+    }
+
+    std::string FramingEnum() const
+    {
+        if (d_.framing == "dtls") return "PRED_FRAME_DTLS";
+        if (d_.framing == "text") return "PRED_FRAME_TEXT";
+        if (d_.framing == "ftp_reply") return "PRED_FRAME_FTP_REPLY";
+        return "PRED_FRAME_NONE";
+    }
+
+    std::string ValueExpr(int var, int32_t v) const
+    {
+        if (schema_.Kind(var) == PRED_KIND_ENUM)
+            return d_.prefix + "_" + schema_.Name(var) + "_" + schema_.Value(var, v);
+        if (schema_.Kind(var) == PRED_KIND_BOOL) return v ? "1" : "0";
+        return std::to_string(v);
+    }
+
+    static const MapEntry* Find(const Field& f, int kind)
+    {
+        for (const MapEntry& e : f.map) if (e.kind == kind) return &e;
+        return nullptr;
+    }
+
+    std::string TableName(const Field& f, const char* dir) const
+    {
+        return lower_ + "_" + dir + "_" + schema_.Name(f.var);
+    }
+
+    void WriteTables(std::ostream& os, const std::vector<Field>& fields, const char* dir)
+    {
+        for (const Field& f : fields)
+        {
+            if (!f.has_map) continue;
+            std::vector<const MapEntry*> keys;
+            for (const MapEntry& e : f.map) if (e.kind == MapEntry::Key) keys.push_back(&e);
+            if (keys.empty()) continue;
+
+            if (f.src == Src::Token || f.src == Src::Header)
+                WriteHashTable(os, f, dir, keys);
+            else if (DenseKeys(keys))
+                WriteDenseTable(os, f, dir, keys);
+        }
+    }
+
+    // Numeric maps with many keys in 0..255 get a 256-entry table; the rest
+    // become a switch, which the compiler lays out itself
+    static bool DenseKeys(const std::vector<const MapEntry*>& keys)
+    {
+        if (keys.size() < 8) return false;
+        for (const MapEntry* e : keys) if (e->nkey < 0 || e->nkey > 255) return false;
+        return true;
+    }
+
+    void WriteHashTable(std::ostream& os, const Field& f, const char* dir,
+                        const std::vector<const MapEntry*>& keys)
+    {
+        // Smallest power-of-two table (>= 2 slots per key) with a seed that
+        // puts every key in its own slot
+        uint32_t size = 2, seed = 0;
+        while (size < 2 * keys.size()) size <<= 1;
+        for (bool found = false; !found; size <<= 1)
+        {
+            for (seed = 0; seed < 4096 && !found; ++seed)
+            {
+                std::vector<bool> used(size);
+                found = true;
+                for (const MapEntry* e : keys)
+                {
+                    uint32_t s = pg_hash(e->skey, seed) & (size - 1);
+                    if (used[s]) { found = false; break; }
+                    used[s] = true;
+                }
+            }
+            if (found) { --seed; break; }
+            if (size > (1u << 16)) fail(f.line, "could not build a hash table for the map");
+        }
+
+        std::string name = TableName(f, dir);
+        hash_params_[name] = { size - 1, seed };
+
+        std::vector<const MapEntry*> slots(size);
+        for (const MapEntry* e : keys) slots[pg_hash(e->skey, seed) & (size - 1)] = e;
+
+        os << "/* " << schema_.Name(f.var) << " (" << dir << "): " << keys.size() << " keys */\n"
+           << "static const pg_key_t " << name << "[" << size << "] = {\n";
+        for (uint32_t s = 0; s < size; ++s)
+        {
+            if (!slots[s]) continue;
+            os << "    [" << s << "] = { \"" << Escape(slots[s]->skey) << "\", " << slots[s]->skey.size()
+               << ", " << ValueExpr(f.var, slots[s]->value) << " },\n";
+        }
+        os << "};\n\n";
+    }
+
+    void WriteDenseTable(std::ostream& os, const Field& f, const char* dir,
+                         const std::vector<const MapEntry*>& keys)
+    {
+        const MapEntry* dflt = Find(f, MapEntry::Default);
+        std::vector<std::string> cells(256);
+        for (int k = 0; k < 256; ++k)
+            cells[k] = dflt ? ValueExpr(f.var, dflt->value) : Identity(f.var, k);
+        for (const MapEntry* e : keys) cells[e->nkey] = ValueExpr(f.var, e->value);
+
+        os << "/* " << schema_.Name(f.var) << " (" << dir << ") */\n"
+           << "static const int32_t " << TableName(f, dir) << "[256] = {\n";
+        for (int k = 0; k < 256; ++k)
+        {
+            if (k % 4 == 0) os << "    ";
+            os << cells[k] << ",";
+            os << (k % 4 == 3 ? "\n" : " ");
+        }
+        os << "};\n\n";
+    }
+
+    // Value of an unmapped numeric key: the number itself for ints
+    std::string Identity(int var, long k) const
+    {
+        if (schema_.Kind(var) == PRED_KIND_BOOL) return k ? "1" : "0";
+        if (schema_.Kind(var) == PRED_KIND_INT) return std::to_string(k);
+        return ValueExpr(var, 0);
+    }
+
+    static std::string Escape(const std::string& s)
+    {
+        std::string out;
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\') out += '\\';
+            out += c;
+        }
+        return out;
+    }
+
+    // Expression for the value of a present field whose raw form is in `r`
+    // (numeric sources) or the span s/n (string sources)
+    std::string MappedExpr(const Field& f, const char* dir) const
+    {
+        const MapEntry* dflt = Find(f, MapEntry::Default);
+        std::string name = TableName(f, dir);
+        bool string_src = f.src == Src::Token || f.src == Src::Header;
+
+        bool has_keys = false;
+        for (const MapEntry& e : f.map) has_keys |= (e.kind == MapEntry::Key);
+
+        if (string_src)
+        {
+            std::string fallback = ValueExpr(f.var, dflt ? dflt->value : 0);
+            if (!f.has_map || !has_keys)
+            {
+                if (dflt) return fallback;
+                if (schema_.Kind(f.var) == PRED_KIND_INT) return "pg_atoi((const char *)s, n)";
+                return "1";
+            }
+            auto hp = hash_params_.at(name);
+            std::string span = f.src == Src::Header ? "(const unsigned char *)s, pg_value_token(s, n)" : "s, n";
+            return "pg_lookup(" + name + ", " + std::to_string(hp.first) + ", " + std::to_string(hp.second) +
+                   "u, " + (f.nocase ? "true" : "false") + ", " + span + ", " + fallback + ")";
+        }
+
+        std::string ident = schema_.Kind(f.var) == PRED_KIND_BOOL ? "(r != 0)" : "(int32_t)r";
+        std::string fallback = dflt ? ValueExpr(f.var, dflt->value) : ident;
+        if (!f.has_map || !has_keys) return fallback;
+
+        return "(r < 256 ? " + name + "[r] : " + fallback + ")";
+    }
+
+    // Whether a string source's value depends on its text, not just presence
+    bool NeedsSpan(const Field& f) const
+    {
+        for (const MapEntry& e : f.map) if (e.kind == MapEntry::Key) return true;
+        return !Find(f, MapEntry::Default) && schema_.Kind(f.var) == PRED_KIND_INT;
+    }
+
+    static bool Sparse(const Field& f)
+    {
+        if (f.src == Src::Token || f.src == Src::Header) return false;
+        std::vector<const MapEntry*> keys;
+        for (const MapEntry& e : f.map) if (e.kind == MapEntry::Key) keys.push_back(&e);
+        return !keys.empty() && !DenseKeys(keys);
+    }
+
+    void WriteSwitch(std::ostream& os, const Field& f) const
+    {
+        const MapEntry* dflt = Find(f, MapEntry::Default);
+        std::string ident = schema_.Kind(f.var) == PRED_KIND_BOOL ? "(r != 0)" : "(int32_t)r";
+        os << "            switch (r) {\n";
+        for (const MapEntry& e : f.map)
+        {
+            if (e.kind != MapEntry::Key) continue;
+            os << "                case " << e.nkey << "u: v = " << ValueExpr(f.var, e.value) << "; break;\n";
+        }
+        os << "                default: v = " << (dflt ? ValueExpr(f.var, dflt->value) : ident) << "; break;\n"
+           << "            }\n";
+    }
+
+    void WriteField(std::ostream& os, const Field& f, const char* dir) const
+    {
+        const MapEntry* absent = Find(f, MapEntry::Absent);
+        std::string missing = ValueExpr(f.var, absent ? absent->value : 0);
+
+        switch (f.src)
+        {
+            case Src::Const:
+                os << "    v = " << ValueExpr(f.var, f.value) << ";\n";
+                return;
+            case Src::Request:
+                os << "    v = ctx->req_" << schema_.Name(f.var) << ";\n";
+                return;
+            case Src::Token:
+                os << "    v = pg_token(buf, len, " << f.a << ", &s, &n)\n"
+                   << "            ? " << MappedExpr(f, dir) << "\n"
+                   << "            : " << missing << ";\n";
+                return;
+            case Src::Header:
+            {
+                std::string expr = MappedExpr(f, dir);
+                os << "    {\n"
+                   << "        int h = hdr_index_find(&ix, \"" << Escape(f.header) << "\");\n";
+                if (!NeedsSpan(f))
+                {
+                    os << "        v = h >= 0 ? " << expr << " : " << missing << ";\n"
+                       << "    }\n";
+                    return;
+                }
+                os << "        if (h >= 0) {\n"
+                   << "            const char *s;\n"
+                   << "            size_t n = hdr_index_value(&ix, h, &s);\n"
+                   << "            v = " << expr << ";\n"
+                   << "        } else {\n"
+                   << "            v = " << missing << ";\n"
+                   << "        }\n"
+                   << "    }\n";
+                return;
+            }
+            default:
+                break;
+        }
+
+        // Numeric sources
+        os << "    {\n";
+        if (f.src == Src::Length)
+            os << "        uint32_t r = len;\n"
+               << "        bool present = true;\n";
+        else if (f.src == Src::Digits)
+            os << "        int32_t d = 0;\n"
+               << "        bool present = pg_digits(buf, len, " << f.a << ", " << f.b << ", &d);\n"
+               << "        uint32_t r = (uint32_t)d;\n";
+        else
+        {
+            os << "        uint32_t r = 0;\n"
+               << "        bool present = pg_uint(buf, len, " << f.a << ", " << f.b << ", &r);\n";
+            if (f.mask != 0xffffffffu || f.shift)
+            {
+                char mask[16];
+                snprintf(mask, sizeof(mask), "0x%xu", f.mask);
+                os << "        r = (r & " << mask << ") >> " << f.shift << ";\n";
+            }
+        }
+
+        if (Sparse(f))
+        {
+            os << "        if (present) {\n";
+            WriteSwitch(os, f);
+            os << "        } else {\n"
+               << "            v = " << missing << ";\n"
+               << "        }\n";
+        }
+        else
+            os << "        v = present ? " << MappedExpr(f, dir) << " : " << missing << ";\n";
+        bool has_keys = false;
+        for (const MapEntry& e : f.map) has_keys |= (e.kind == MapEntry::Key);
+        if (!has_keys && Find(f, MapEntry::Default)) os << "        (void)r;\n";       // only presence matters
+        os << "    }\n";
+    }
+
+    void WriteBuilder(std::ostream& os, const std::vector<Field>& fields, const char* dir, const char* tag) const
+    {
+        const std::string& p = d_.proto;
+        bool req = std::string(dir) == "request";
+        bool tokens = false, reads_msg = false;
+        for (const Field& f : fields)
+        {
+            tokens |= (f.src == Src::Token);
+            reads_msg |= (f.src != Src::Const && f.src != Src::Request);
+        }
+
+        os << "void " << p << "_build_" << dir << "_record(" << p << "_adapter_ctx_t *ctx,\n"
+           << "    const unsigned char *buf, unsigned int len, pred_record_t *rec)\n{\n"
+           << "    int32_t v;\n";
+        if (tokens) os << "    const unsigned char *s;\n    uint32_t n;\n";
+        if (UsesHeaders(fields)) os << "    hdr_index_t ix;\n\n    hdr_index_build(&ix, buf, len);\n";
+        bool uses_ctx = false;
+        for (const Field& f : fields) uses_ctx |= req ? IsCarried(f.var) : f.src == Src::Request;
+        os << "\n";
+        if (!uses_ctx) os << "    (void)ctx;\n";
+        if (!reads_msg) os << "    (void)buf;\n    (void)len;\n";
+        os << "    pred_begin(rec, " << d_.prefix << "_PRED_SPEC_HASH);\n";
+
+        for (int var = 0; var < (int)schema_.size(); ++var)
+        {
+            const Field* f = nullptr;
+            for (const Field& x : fields) if (x.var == var) f = &x;
+
+            os << "\n";
+            if (f) WriteField(os, *f, tag);
+            else os << "    v = " << ValueExpr(var, 0) << ";\n";
+
+            if (req && IsCarried(var)) os << "    ctx->req_" << schema_.Name(var) << " = v;\n";
+
+            std::string id = d_.prefix + "_VAR_" + schema_.Name(var);
+            switch (schema_.Kind(var))
+            {
+                case PRED_KIND_BOOL: os << "    pred_set_bool(rec, " << id << ", v != 0);\n"; break;
+                case PRED_KIND_INT:  os << "    pred_set_int(rec, " << id << ", v);\n"; break;
+                default:             os << "    pred_set_enum(rec, " << id << ", (uint16_t)v);\n"; break;
+            }
+        }
+        os << "}\n\n";
+    }
+
+    bool IsCarried(int var) const
+    {
+        for (const Field& f : d_.resp) if (f.var == var && f.src == Src::Request) return true;
+        return false;
+    }
+
+    const Desc& d_;
+    const PredicateSchema& schema_;
+    std::string desc_path_, lower_, upper_;
+    std::map<std::string, std::pair<uint32_t, uint32_t>> hash_params_;
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " <proto.adapter> <spec.ltl> <out_dir>\n";
+        std::cerr << "  e.g. " << argv[0] << " monitor-src/smtp.adapter monitor-bin/smtp.ltl monitor-src\n";
+        return 1;
+    }
+
+    const char* desc_path = argv[1];
+    const char* spec_path = argv[2];
+    std::string out_dir = argv[3];
+
+    yyin = fopen(spec_path, "r");
+    if (!yyin) {
+        std::cerr << "Could not open spec: " << spec_path << std::endl;
+        return 1;
+    }
+    if (yyparse() != 0) {
+        std::cerr << "Parsing failed." << std::endl;
+        fclose(yyin);
+        return 1;
+    }
+    fclose(yyin);
+
+    PredicateSchema schema(root.first);
+    if (schema.size() > PRED_MAX_FIELDS) {
+        std::cerr << "Spec has " << schema.size() << " variables, records hold " << PRED_MAX_FIELDS << std::endl;
+        MemoryManager::freeSpec(root);
+        return 1;
+    }
+
+    std::ifstream in(desc_path);
+    if (!in) {
+        std::cerr << "Could not open description: " << desc_path << std::endl;
+        MemoryManager::freeSpec(root);
+        return 1;
+    }
+    std::stringstream text;
+    text << in.rdbuf();
+
+    int rc = 0;
+    try {
+        Desc desc = Parser(tokenize(text.str()), schema).Parse();
+        Emitter emitter(desc, schema, desc_path);
+
+        std::string base = out_dir + "/" + desc.proto + "_predicate_adapter";
+        std::ofstream h(base + ".h"), c(base + ".c");
+        if (!h || !c) throw std::runtime_error("could not open " + base + ".{c,h}");
+        emitter.WriteHeader(h);
+        emitter.WriteSource(c);
+
+        std::cerr << "[ltl_adaptergen] " << desc.req.size() << " request / " << desc.resp.size()
+                  << " response fields -> " << base << ".{c,h}" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << desc_path << ": " << e.what() << std::endl;
+        rc = 1;
+    }
+
+    MemoryManager::freeSpec(root);
+    return rc;
+}
@@ -0,0 +1,165 @@
+// ltl_minimize.cpp - Shrink a violating session to a minimal event sequence
+//
+// Reads either a monitor_violations.log (picks one "--- Violation #N" block,
+// the last one by default) or a file of raw adapter predicate lines, and
+// reduces it against one property with the in-process evaluator.
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "ast.h"
+#include "ast_printer.h"
+#include "memory_manager.h"
+#include "typechecker.h"
+#include "preprocess.h"
+#include "evaluator.h"
+#include "state.h"
+#include "guard.h"
+#include "minimizer.h"
+
+extern FILE *yyin;
+extern int yyparse();
+extern Spec root;
+extern std::vector<ASTNode*> root_guards;
+
+static inline std::string trim(const std::string& s) {
+    size_t a = s.find_first_not_of(" \t\r\n");
+    if (a == std::string::npos) return "";
+    size_t b = s.find_last_not_of(" \t\r\n");
+    return s.substr(a, b - a + 1);
+}
+
+static std::string format_event_kv(const MonitorEvent& kv) {
+    std::string out = "{";
+    bool first = true;
+    for (const auto& kvp : kv) {
+        if (!first) out += ", ";
+        first = false;
+        out += kvp.first + "=" + kvp.second;
+    }
+    return out + "}";
+}
+
+// Events of violation block `which` (0 = last) from a monitor_violations.log
+static bool load_violation_log(std::ifstream& in, long which, std::vector<MonitorEvent>& events) {
+    std::vector<MonitorEvent> block;
+    bool found = false, in_trace = false;
+    long current = 0;
+    std::string line;
+
+    while (std::getline(in, line)) {
+        if (line.rfind("--- Violation #", 0) == 0) {
+            if (found && (which == 0 || current == which)) events = block;
+            current = std::stol(line.substr(15));
+            block.clear();
+            found = true;
+            in_trace = false;
+            continue;
+        }
+        if (!found) continue;
+        if (line.rfind("Trace (", 0) == 0) { in_trace = true; continue; }
+        if (in_trace) {
+            std::string t = trim(line);
+            if (t.empty() || t[0] != '[') { in_trace = false; continue; }
+            block.push_back(ParseTraceEntry(t));
+        }
+    }
+    if (found && (which == 0 || current == which)) events = block;
+    return found;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " <spec.ltl> <property_index> <trace_file> [violation_number]\n";
+        std::cerr << "  trace_file: monitor_violations.log or one adapter predicate line per event\n";
+        return 1;
+    }
+
+    const char* spec_path = argv[1];
+    size_t prop = std::stoul(argv[2]);
+    const char* trace_path = argv[3];
+    long which = (argc > 4) ? std::stol(argv[4]) : 0;
+
+    yyin = fopen(spec_path, "r");
+    if (!yyin) {
+        std::cerr << "Could not open spec: " << spec_path << std::endl;
+        return 1;
+    }
+    if (yyparse() != 0) {
+        std::cerr << "Parsing failed." << std::endl;
+        fclose(yyin);
+        return 1;
+    }
+    fclose(yyin);
+
+    if (prop >= root.second.size()) {
+        std::cerr << "Property index " << prop << " out of range (spec has "
+                  << root.second.size() << " properties)" << std::endl;
+        MemoryManager::freeSpec(root);
+        return 1;
+    }
+
+    std::ifstream in(trace_path);
+    if (!in) {
+        std::cerr << "Could not open trace: " << trace_path << std::endl;
+        MemoryManager::freeSpec(root);
+        return 1;
+    }
+
+    std::vector<MonitorEvent> events;
+    if (!load_violation_log(in, which, events)) {
+        // Not a violation log: treat it as raw adapter output
+        in.clear();
+        in.seekg(0);
+        std::string line;
+        while (std::getline(in, line)) {
+            line = trim(line);
+            if (line.empty() || line.rfind("__", 0) == 0) continue;
+            events.push_back(ParseEventLine(line));
+        }
+    }
+
+    TypeChecker typeChecker(root);
+    Preprocessor preprocessor;
+    std::vector<int> serials = preprocessor.DoPreProcess(root.second);
+    Evaluator eval(root.second, serials);
+
+    Guard guard(root_guards, &typeChecker);
+    TraceMinimizer minimizer(eval, &typeChecker, guard, prop, events);
+
+    std::cout << "Property[" << prop << "]: " << ASTPrinter::printStuff(root.second[prop]) << "\n";
+    int first = minimizer.FirstViolation();
+    if (first < 0) {
+        std::cout << "Trace (" << events.size() << " events) does not violate the property\n";
+        MemoryManager::freeSpec(root);
+        return 2;
+    }
+
+    std::vector<size_t> kept = minimizer.Minimize();
+
+    std::cout << "Original trace: " << events.size() << " events, first violation at ["
+              << first << "]\n";
+    std::cout << "Minimized trace: " << kept.size() << " events ("
+              << minimizer.get_tests() << " candidates, "
+              << minimizer.get_steps() << " evaluator steps)\n";
+    for (size_t i : kept) {
+        std::cout << "  [" << i << "] " << format_event_kv(events[i]) << "\n";
+    }
+
+    std::cout << "Packet references:\n";
+    for (size_t i : kept) {
+        const MonitorEvent& ev = events[i];
+        auto tr = ev.find("trace");
+        if (tr == ev.end()) continue;
+        auto id = ev.find("msg_id");
+        auto dir = ev.find("dir");
+        std::cout << "  [" << i << "]"
+                  << " msg_id=" << (id == ev.end() ? "-" : id->second)
+                  << " dir=" << (dir == ev.end() ? "-" : dir->second)
+                  << " trace=" << tr->second << "\n";
+    }
+
+    MemoryManager::freeSpec(root);
+    return 0;
+}
@@ -0,0 +1,57 @@
+// ltl_predgen.cpp - Generate the adapter-side predicate id header for a spec
+//
+// Writes <prefix>_VAR_* variable ids, <prefix>_<enum>_<value> enum ids, the
+// spec hash and a pred_schema_t for one spec, so adapters can emit binary
+// pred_record_t events (see monitor-src/pred_record.h) instead of k=v text.
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include "ast.h"
+#include "memory_manager.h"
+#include "predicate_schema.h"
+
+extern FILE *yyin;
+extern int yyparse();
+extern Spec root;
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " <spec.ltl> <PREFIX> <out.h>\n";
+        std::cerr << "  e.g. " << argv[0] << " monitor-bin/dnsmasq.ltl DNSMASQ monitor-src/dnsmasq_pred_spec.h\n";
+        return 1;
+    }
+
+    const char* spec_path = argv[1];
+    std::string prefix = argv[2];
+    const char* out_path = argv[3];
+
+    yyin = fopen(spec_path, "r");
+    if (!yyin) {
+        std::cerr << "Could not open spec: " << spec_path << std::endl;
+        return 1;
+    }
+    if (yyparse() != 0) {
+        std::cerr << "Parsing failed." << std::endl;
+        fclose(yyin);
+        return 1;
+    }
+    fclose(yyin);
+
+    PredicateSchema schema(root.first);
+
+    std::ofstream out(out_path);
+    if (!out) {
+        std::cerr << "Could not open output: " << out_path << std::endl;
+        MemoryManager::freeSpec(root);
+        return 1;
+    }
+    schema.WriteHeader(out, prefix, spec_path);
+    out.close();
+
+    std::cerr << "[ltl_predgen] " << schema.size() << " variables, spec hash 0x"
+              << std::hex << schema.hash() << std::dec << " -> " << out_path << std::endl;
+
+    MemoryManager::freeSpec(root);
+    return 0;
+}
@@ -10,6 +10,9 @@
 #include <cctype>
 #include <cassert>
 #include <fstream>
+#include <cstdlib>
+#include <sys/ipc.h>
+#include <sys/shm.h>
 
 #include "ast.h"
 #include "ast_printer.h"
@@ -18,10 +21,13 @@
 #include "preprocess.h"
 #include "evaluator.h"
 #include "state.h"
+#include "guard.h"
+#include "predicate_schema.h"
 
 extern FILE *yyin;
 extern int yyparse();
 extern Spec root;
+extern std::vector<ASTNode*> root_guards;
 
 // ============================================================================
 // LOGGING CONFIGURATION
@@ -43,11 +49,9 @@ static const size_t TRACE_WINDOW = 20;
 
 // Global state storage
 struct EvaluatorState {
-    int index;
+    EvaluatorSnapshot eval;
     size_t event_count;
     size_t session_count;
-    std::vector<BitVector> old_bv;
-    std::vector<BitVector> new_bv;
 };
 
 std::unordered_map<unsigned int, EvaluatorState> saved_states;
@@ -121,6 +125,64 @@ parse_kv_line(const std::string& line) {
     return kv;
 }
 
+// Next input unit: a text line, or a binary pred_record_t decoded into
+// record_kv (line left empty). A record from another spec or with bad ids is
+// logged and comes back as an empty line. False at EOF.
+static bool read_input(std::istream& in, const PredicateSchema& schema,
+                       std::string& line,
+                       std::unordered_map<std::string,std::string>& record_kv) {
+    record_kv.clear();
+    if (in.peek() != PRED_RECORD_MAGIC) {
+        return (bool)std::getline(in, line);
+    }
+
+    pred_record_t rec;
+    const size_t head = offsetof(pred_record_t, fields);
+    in.get();
+    if (!in.read(reinterpret_cast<char*>(&rec), head)) return false;
+    if (rec.count > PRED_MAX_FIELDS) {
+        log_msg("[MONITOR] ERROR: predicate record with " + std::to_string(rec.count) +
+                " fields, input stream is out of sync", true);
+        return false;
+    }
+    if (!in.read(reinterpret_cast<char*>(rec.fields), rec.count * sizeof(pred_field_t))) return false;
+
+    line.clear();
+    if (!schema.Decode(rec, record_kv)) {
+        std::ostringstream oss;
+        oss << "[MONITOR] Dropped predicate record (spec hash 0x" << std::hex << rec.spec_hash
+            << ", expected 0x" << schema.hash() << std::dec << ")";
+        log_msg(oss.str(), true);
+    }
+    return true;
+}
+
+// Control requests end in a sequence number, echoed back in the ack once the
+// request is handled ("__ACK__ <seq> OK|ERR", see monitor-src/monitor_bridge.h).
+// Numeric arguments of a request, sequence number last.
+static std::vector<unsigned long> control_args(const std::string& line) {
+    std::vector<unsigned long> args;
+    std::istringstream iss(line);
+    std::string cmd;
+    unsigned long v;
+    iss >> cmd;
+    while (iss >> v) args.push_back(v);
+    return args;
+}
+
+// Requests without a sequence number (hand-written traces) get the old
+// "STATUS:<id>" reply instead. `extra` is appended to the ack as "k=v" words.
+static void send_ack(const std::vector<unsigned long>& args, size_t nargs,
+                     bool ok, const std::string& legacy_reply,
+                     const std::string& extra = "") {
+    if (args.size() > nargs) {
+        std::cout << "__ACK__ " << args.back() << (ok ? " OK" : " ERR")
+                  << (extra.empty() ? "" : " ") << extra << std::endl;
+    } else if (!legacy_reply.empty()) {
+        std::cout << legacy_reply << std::endl;
+    }
+}
+
 static inline std::string getOr(const std::unordered_map<std::string,std::string>& kv,
                                 const char* key) {
     auto it = kv.find(key);
@@ -347,6 +409,33 @@ static void dump_violation_trace(
     }
 }
 
+// Set by monitor_start() in monitor_bridge.c (MONITOR_SHM_ENV_VAR)
+#define MONITOR_SHM_ENV_VAR "__AFL_MONITOR_SHM_ID"
+
+// Attach the fuzzer's automaton coverage map, if there is one
+static void attach_coverage_map(Evaluator &eval) {
+    const char* id_str = getenv(MONITOR_SHM_ENV_VAR);
+    if (!id_str) return;
+
+    int shm_id = atoi(id_str);
+    struct shmid_ds ds;
+    if (shmctl(shm_id, IPC_STAT, &ds) < 0) {
+        log_msg("[MONITOR] WARNING: coverage map " + std::string(id_str) + " not found", true);
+        return;
+    }
+    // The evaluator masks indices, so only use a power-of-two prefix
+    unsigned int size = 1;
+    while (size * 2 <= ds.shm_segsz) size *= 2;
+
+    void* map = shmat(shm_id, NULL, 0);
+    if (map == (void*)-1) {
+        log_msg("[MONITOR] WARNING: could not attach coverage map " + std::string(id_str), true);
+        return;
+    }
+    eval.set_coverage_map((unsigned char*)map, size);
+    log_msg("[MONITOR] Automaton coverage map attached (" + std::to_string(size) + " bytes)", true);
+}
+
 int main(int argc, char **argv) {
     init_logging();
     log_msg("[MONITOR] Initializing multi-protocol evaluator (continuous mode)...", true);
@@ -386,6 +475,9 @@ int main(int argc, char **argv) {
     std::vector<int> serials = preprocessor.DoPreProcess(root.second);
     Evaluator eval(root.second, serials);
     State ltl_state(&typeChecker);
+    Guard guard(root_guards, &typeChecker);
+    PredicateSchema pred_schema(root.first);
+    attach_coverage_map(eval);
 
     // Build property texts: verdicts[i] corresponds to root.second[i] directly.
     // (serials[i] are internal preprocessor node IDs, NOT indices into root.second.)
@@ -408,6 +500,10 @@ int main(int argc, char **argv) {
     log_msg(std::string("[MONITOR] Loaded ") + std::to_string(prop_texts.size()) + 
            " LTL properties for protocol: " + proto_tag, true);
 
+    std::ostringstream hash_msg;
+    hash_msg << "[MONITOR] Predicate record spec hash: 0x" << std::hex << pred_schema.hash();
+    log_msg(hash_msg.str());
+
     log_msg("[MONITOR] Ready to receive events (continuous mode - won't exit on violations)", true);
 
     std::ios::sync_with_stdio(false);
@@ -421,45 +517,50 @@ int main(int argc, char **argv) {
     // Accumulated trace of events in the current session (for violation dumps).
     // Each entry is the compact KV string for one event, in order.
     std::vector<std::string> session_trace;
+    std::unordered_map<std::string,std::string> record_kv;
     
-    while (std::getline(std::cin, line)) {
+    while (read_input(std::cin, pred_schema, line, record_kv)) {
         line = trim(line);
-        if (line.empty()) continue;
+        if (line.empty() && record_kv.empty()) continue;
         
-        if (line.substr(0, 14) == "__SAVE_STATE__") {
-            unsigned int snap_id = std::stoul(line.substr(15));
+        if (line.compare(0, 14, "__SAVE_STATE__") == 0) {
+            std::vector<unsigned long> args = control_args(line);
+            if (args.empty()) {
+                log_msg("[MONITOR] ERROR: Malformed request: " + line, true);
+                continue;
+            }
+            unsigned int snap_id = args[0];
             
             EvaluatorState state;
-            state.index = eval.get_index();
+            state.eval = eval.snapshot();
             state.event_count = event_count;
             state.session_count = session_count;
-            state.old_bv = eval.get_old_bv();
-            state.new_bv = eval.get_new_bv();
             
             saved_states[snap_id] = state;
             log_msg("[MONITOR] Saved state for snapshot " + std::to_string(snap_id));
             
-            std::cout << "STATE_SAVED:" << snap_id << std::endl;
-            std::cout.flush();
+            send_ack(args, 1, true, "STATE_SAVED:" + std::to_string(snap_id));
             continue;
         }
         
-        if (line.substr(0, 17) == "__RESTORE_STATE__") {
-            unsigned int snap_id = std::stoul(line.substr(18));
+        if (line.compare(0, 17, "__RESTORE_STATE__") == 0) {
+            std::vector<unsigned long> args = control_args(line);
+            if (args.empty()) {
+                log_msg("[MONITOR] ERROR: Malformed request: " + line, true);
+                continue;
+            }
+            unsigned int snap_id = args[0];
             
             auto it = saved_states.find(snap_id);
             if (it == saved_states.end()) {
                 log_msg("[MONITOR] ERROR: No saved state for snapshot " + 
                         std::to_string(snap_id), true);
-                std::cout << "STATE_RESTORE_FAILED:" << snap_id << std::endl;
-                std::cout.flush();
+                send_ack(args, 1, false, "STATE_RESTORE_FAILED:" + std::to_string(snap_id));
                 continue;
             }
             
             EvaluatorState &state = it->second;
-            eval.set_index(state.index);
-            eval.set_old_bv(state.old_bv);
-            eval.set_new_bv(state.new_bv);
+            eval.restore(state.eval);
             event_count = state.event_count;
             session_count = state.session_count;
             
@@ -470,12 +571,13 @@ int main(int argc, char **argv) {
             
             log_msg("[MONITOR] Restored state from snapshot " + std::to_string(snap_id));
             
-            std::cout << "STATE_RESTORED:" << snap_id << std::endl;
-            std::cout.flush();
+            send_ack(args, 1, true, "STATE_RESTORED:" + std::to_string(snap_id));
             continue;
         }
         
-        if (line == "__END_SESSION__") {
+        if (line.compare(0, 15, "__END_SESSION__") == 0) {
+            std::vector<unsigned long> args = control_args(line);
+            unsigned int near = eval.get_session_near();
             session_count++;
             log_msg(std::string("[MONITOR] Session #") + std::to_string(session_count) + 
                    " ended. Events: " + std::to_string(event_count) +
@@ -484,10 +586,11 @@ int main(int argc, char **argv) {
             
             event_count = 0;
             session_trace.clear();  // Reset trace for next session
+            send_ack(args, 0, true, "", "near=" + std::to_string(near));
             continue;
         }
 
-        auto kv = parse_kv_line(line);
+        auto kv = record_kv.empty() ? parse_kv_line(line) : std::move(record_kv);
         
         // Track the most recent raw-packet trace references, if present.
         if (kv.count("msg_id") && kv.count("trace")) {
@@ -499,15 +602,6 @@ int main(int argc, char **argv) {
             if (g_recent_traces.size() > TRACE_WINDOW) g_recent_traces.pop_front();
         }
 
-        // IMPORTANT:
-        // The evaluator/state machine must only see predicates that are defined in the
-        // spec. We still *log* and *retain* extra metadata (msg_id/dir/trace) so we can
-        // join violations back to raw packet blobs, but we must NOT pass these keys to
-        // the LTL label state, otherwise the evaluator may throw on unknown predicates.
-        static const std::unordered_set<std::string> kMetaKeys = {
-            "msg_id", "dir", "trace"
-        };
-
         State ltl_state(&typeChecker);
 
         event_count++;
@@ -516,29 +610,13 @@ int main(int argc, char **argv) {
         // Record this event in the session trace (compact KV format)
         session_trace.push_back(format_event_kv(kv));
 
-        // Protocol-agnostic derived predicates
-        bool have_qid = false, have_respid = false;
-        long qid = 0, respid = 0;
-
-        for (const auto& kvp : kv) {
-            const std::string& k = kvp.first;
-            const std::string& v = kvp.second;
-            if (k == "q_id")    { have_qid = true;    qid = std::stol(v); }
-            if (k == "resp_id") { have_respid = true; respid = std::stol(v); }
-        }
-
-        if (!kv.count("id_mismatch") && have_qid && have_respid) {
-            kv["id_mismatch"] = (qid != respid) ? "true" : "false";
-        }
-
-        for (const auto& kvp : kv) {
-            if (kMetaKeys.find(kvp.first) != kMetaKeys.end()) continue;
-            if (kvp.first.empty() || kvp.second.empty()) continue;
-            ltl_state.addLabel(kvp.first, kvp.second);
-        }
+        // Drops metadata keys and adds derived predicates (id_mismatch)
+        ltl_state.loadEvent(kv);
 
         assert(ltl_state.IsSane());
-        std::vector<bool> verdicts = eval.EvaluateOneStep(&ltl_state);
+        // Events the guard rejects neither violate nor count as near misses
+        bool valid = guard.Holds(kv);
+        std::vector<bool> verdicts = eval.EvaluateOneStep(&ltl_state, valid);
         // ltl_state.clearState();
 
         std::vector<size_t> bad_idx;
@@ -547,48 +625,9 @@ int main(int argc, char **argv) {
         }
 
         if (!bad_idx.empty()) {
-            bool is_valid_response = false;
-            
-            if (proto_tag == "dnsmasq" || proto_tag == "dns") {
-                // DNS: response_valid=true means actual server response
-                is_valid_response = (kv.count("response_valid") && 
-                                    kv["response_valid"] == "true");
-                
-            } else if (proto_tag == "ssh") {
-                // SSH: encrypted=true & mac_ok=true
-                bool is_encrypted = (kv.count("encrypted") && kv["encrypted"] == "true");
-                bool mac_valid = (kv.count("mac_ok") && kv["mac_ok"] == "true");
-                is_valid_response = (is_encrypted && mac_valid);
-                
-            } else if (proto_tag == "rtsp") {
-                // RTSP: Valid response (not timeout, not malformed, has status)
-                bool not_timeout = (!kv.count("timeout") || kv["timeout"] == "false");
-                bool has_status = (kv.count("status_class") && kv["status_class"] != "scNotSet");
-                is_valid_response = (not_timeout && has_status);
-                
-            } else if (proto_tag == "dtls") {
-                // DTLS: encrypted=true & mac_ok=true
-                is_valid_response = (kv.count("response") && kv["response"] != "responseNotSet");
-                
-            } else if (proto_tag == "sip") {
-                // SIP: msg_type=response & not timeout
-                bool is_response = (kv.count("sip_msg_type") && kv["sip_msg_type"] == "response");
-                bool not_timeout = (!kv.count("timeout") || kv["timeout"] == "false");
-                is_valid_response = (is_response && not_timeout);
-                
-            } else if (proto_tag == "ftp") {
-                // FTP: Valid response (not timeout, not malformed, has status)
-                bool not_timeout = (!kv.count("timeout") || kv["timeout"] == "false");
-                bool has_status = (kv.count("ftp_status_class") && kv["ftp_status_class"] != "scNotSet");
-                is_valid_response = (not_timeout && has_status);
-                
-            } else {
-                // Generic protocol: report all violations
-                is_valid_response = true;
-            }
-            
-            // Skip violations on invalid/garbage responses
-            if (!is_valid_response) {
+            // Skip violations on invalid/garbage responses, as defined by
+            // the spec's guard section
+            if (!valid) {
                 if (g_verbose) {
                     std::ostringstream skip_msg;
                     skip_msg << "[MONITOR] Filtered violation on invalid response";
@@ -1,47 +1,56 @@
 #include "memory_manager.h"
 
-void MemoryManager::freeAST(ASTNode* node) {
-    if (!node) return;
-    
-    // Free children first
-    switch (node->kind) {
-        case AST_NOT:
-        case AST_H:
-        case AST_O:
-        case AST_Y:
-            freeAST(node->unary_child);
-            break;
-        case AST_ARROW:
-        case AST_AND:
-        case AST_OR:
-        case AST_S:
-        case AST_EQ:
-        case AST_NEQ:
-        case AST_GT:
-        case AST_GTE:
-        case AST_LT:
-        case AST_LTE:
-            freeAST(node->binary_left);
-            freeAST(node->binary_right);
-            break;
-        case AST_SPEC:
-            // Free formulas
-            for (auto formula : node->spec_formulas) {
-                freeAST(formula);
-            }
-            break;
-        default:
-            break;
-    }
-    
-    // Free the node itself
-    delete node;
+ASTArena ast_arena;
+
+ASTIndex ASTArena::alloc(ASTNodeKind k) {
+    nodes.emplace_back(k);
+    return static_cast<ASTIndex>(nodes.size() - 1);
+}
+
+ASTIndex ASTArena::alloc_unary(ASTNodeKind k, ASTIndex child) {
+    ASTIndex i = alloc(k);
+    nodes[i].lhs = child;
+    return i;
+}
+
+ASTIndex ASTArena::alloc_binary(ASTNodeKind k, ASTIndex left, ASTIndex right) {
+    ASTIndex i = alloc(k);
+    nodes[i].lhs = left;
+    nodes[i].rhs = right;
+    return i;
+}
+
+ASTIndex ASTArena::alloc_window(ASTNodeKind k, ASTIndex child, int lo, int hi, int clock) {
+    ASTIndex i = alloc_unary(k, child);
+    ASTWindow w;
+    w.lo = lo;
+    w.hi = hi;
+    w.clock = clock;
+    windows.push_back(w);
+    nodes[i].value = static_cast<int>(windows.size() - 1);
+    return i;
+}
+
+int ASTArena::intern(const char* s, size_t len) {
+    auto it = symbol_ids.find(std::string_view(s, len));
+    if (it != symbol_ids.end()) return it->second;
+
+    int id = static_cast<int>(symbols.size());
+    symbols.emplace_back(s, len);
+    symbol_ids.emplace(std::string_view(symbols.back()), id);
+    return id;
+}
+
+void ASTArena::release() {
+    // Every node and symbol of the spec lives here; drop them all at once
+    nodes.clear();
+    windows.clear();
+    symbol_ids.clear();
+    symbols.clear();
 }
 
 void MemoryManager::freeSpec(const Spec& spec) {
-    // Free formulas
-    for (auto formula : spec.second) {
-        freeAST(formula);
-    }
+    (void)spec;
+    ast_arena.release();
     // TypeAnnotations are not dynamically allocated in this version
 }
\ No newline at end of file
@@ -6,7 +6,6 @@
 
 class MemoryManager {
 public:
-    static void freeAST(ASTNode* node);
     static void freeSpec(const Spec& spec);
 };
 
@@ -0,0 +1,140 @@
+# include "minimizer.h"
+# include <sstream>
+# include <numeric>
+
+MonitorEvent ParseEventLine(const std::string& line)
+{
+    // Same k=v tokenisation the monitor applies to adapter lines
+    MonitorEvent kv;
+    std::istringstream iss(line);
+    std::string tok;
+    while (iss >> tok) {
+        auto eq = tok.find('=');
+        if (eq == std::string::npos) continue;
+        kv[tok.substr(0, eq)] = tok.substr(eq + 1);
+    }
+    return kv;
+}
+
+MonitorEvent ParseTraceEntry(const std::string& entry)
+{
+    // "{k=v, k=v}" as written to the violation log by format_event_kv
+    std::string body = entry;
+    size_t a = body.find('{');
+    size_t b = body.rfind('}');
+    if (a != std::string::npos && b != std::string::npos && b > a) {
+        body = body.substr(a + 1, b - a - 1);
+    }
+    for (auto& c : body) {
+        if (c == ',') c = ' ';
+    }
+    return ParseEventLine(body);
+}
+
+TraceMinimizer::TraceMinimizer(Evaluator &eval, TypeChecker *tc, Guard &guard, size_t prop, vector<MonitorEvent> &events)
+    : eval(eval), prop(prop), tests(0), steps(0)
+{
+    // Labels are built once per event; candidates only reorder references
+    states.reserve(events.size());
+    valid.reserve(events.size());
+    for (auto& ev : events) {
+        MonitorEvent kv = ev;
+        states.emplace_back(tc);
+        states.back().loadEvent(kv);
+        valid.push_back(guard.Holds(kv));
+    }
+    eval.reset_evaluator();
+    initial = eval.snapshot();
+}
+
+int TraceMinimizer::FirstViolation(const vector<size_t>& seq, size_t from, const EvaluatorSnapshot& start)
+{
+    eval.restore(start);
+    for (size_t i = from; i < seq.size(); ++i) {
+        ++steps;
+        bool ok = eval.EvaluateOneStep(&states[seq[i]], prop);
+        if (!ok && valid[seq[i]]) return (int)i;
+    }
+    return -1;
+}
+
+int TraceMinimizer::FirstViolation()
+{
+    vector<size_t> all(states.size());
+    std::iota(all.begin(), all.end(), 0);
+    return FirstViolation(all, 0, initial);
+}
+
+void TraceMinimizer::BuildPrefixes(const vector<size_t>& seq)
+{
+    // prefix[i] is the evaluator state right before seq[i]
+    prefix.clear();
+    prefix.reserve(seq.size());
+    eval.restore(initial);
+    for (size_t i = 0; i < seq.size(); ++i) {
+        prefix.push_back(eval.snapshot());
+        ++steps;
+        eval.EvaluateOneStep(&states[seq[i]], prop);
+    }
+}
+
+bool TraceMinimizer::Test(vector<size_t>& cand, const EvaluatorSnapshot& start, size_t from)
+{
+    ++tests;
+    int v = FirstViolation(cand, from, start);
+    if (v < 0) return false;
+    // Anything after the first violation cannot be needed
+    cand.resize(v + 1);
+    return true;
+}
+
+vector<size_t> TraceMinimizer::Minimize()
+{
+    vector<size_t> cur(states.size());
+    std::iota(cur.begin(), cur.end(), 0);
+
+    ++tests;
+    int v = FirstViolation(cur, 0, initial);
+    if (v < 0) return vector<size_t>();
+    cur.resize(v + 1);
+
+    // Invariant: cur violates at its last event and at no earlier one, so no
+    // strict prefix of cur needs testing.
+    size_t n = 2;
+    while (cur.size() >= 2) {
+        size_t len = cur.size();
+        if (n > len) n = len;
+        BuildPrefixes(cur);
+        bool reduced = false;
+
+        // Each chunk on its own (chunk 0 is a strict prefix)
+        for (size_t i = 1; i < n && !reduced; ++i) {
+            size_t s = i * len / n, e = (i + 1) * len / n;
+            vector<size_t> cand(cur.begin() + s, cur.begin() + e);
+            if (Test(cand, initial, 0)) {
+                cur = cand;
+                n = 2;
+                reduced = true;
+            }
+        }
+
+        // Each complement, resumed from the snapshot before the dropped chunk
+        // (dropping the last chunk leaves a strict prefix)
+        for (size_t i = 0; i + 1 < n && !reduced; ++i) {
+            size_t s = i * len / n, e = (i + 1) * len / n;
+            vector<size_t> cand(cur.begin(), cur.begin() + s);
+            cand.insert(cand.end(), cur.begin() + e, cur.end());
+            if (Test(cand, prefix[s], s)) {
+                cur = cand;
+                n = std::max<size_t>(n - 1, 2);
+                reduced = true;
+            }
+        }
+
+        if (!reduced) {
+            if (n >= len) break;
+            n = std::min(n * 2, len);
+        }
+    }
+    return cur;
+}
@@ -0,0 +1,50 @@
+#ifndef MINIMIZER_H_
+#define MINIMIZER_H_
+
+# include <string>
+# include <vector>
+# include <unordered_map>
+# include "evaluator.h"
+# include "state.h"
+# include "typechecker.h"
+# include "guard.h"
+using namespace std ;
+
+// One monitor event as the adapters send it (k=v pairs, metadata included)
+typedef std::unordered_map<std::string, std::string> MonitorEvent;
+
+MonitorEvent ParseEventLine(const std::string& line);
+MonitorEvent ParseTraceEntry(const std::string& entry);
+
+// Delta-debugging (ddmin) reduction of a violating session against a single
+// property, evaluated in-process. Evaluator snapshots are kept for every
+// prefix of the current configuration, so a candidate that drops a chunk is
+// only re-evaluated from the start of that chunk. As in the monitor, a failing
+// step only counts as a violation when the spec guard accepts that event.
+class TraceMinimizer
+{
+private:
+    Evaluator &eval ;
+    size_t prop ;
+    vector<State> states ;
+    vector<bool> valid ;    // guard verdict per event
+    vector<EvaluatorSnapshot> prefix ;
+    EvaluatorSnapshot initial ;
+    size_t tests ;
+    size_t steps ;
+
+    void BuildPrefixes(const vector<size_t>& seq);
+    int FirstViolation(const vector<size_t>& seq, size_t from, const EvaluatorSnapshot& start);
+    bool Test(vector<size_t>& cand, const EvaluatorSnapshot& start, size_t from);
+
+public:
+    TraceMinimizer(Evaluator &eval, TypeChecker *tc, Guard &guard, size_t prop, vector<MonitorEvent> &events);
+    // Index of the first guarded event at which the property fails, or -1
+    int FirstViolation();
+    // Indices (into the original events) of a 1-minimal violating subsequence
+    vector<size_t> Minimize();
+    size_t get_tests() const { return tests; }
+    size_t get_steps() const { return steps; }
+};
+
+#endif
@@ -78,8 +78,9 @@ void yyerror(const char *s);
 int yylex(void);
 extern FILE *yyin;
 Spec root;
+std::vector<ASTNode*> root_guards;
 
-#line 83 "evaluator-src/parser.cpp"
+#line 84 "evaluator-src/parser.cpp"
 
 # ifndef YY_CAST
 #  ifdef __cplusplus
@@ -117,35 +118,41 @@ enum yysymbol_kind_t
   YYSYMBOL_ENUM = 7,                       /* ENUM  */
   YYSYMBOL_INT_TYPE = 8,                   /* INT_TYPE  */
   YYSYMBOL_BOOL_TYPE = 9,                  /* BOOL_TYPE  */
-  YYSYMBOL_LPAREN = 10,                    /* LPAREN  */
-  YYSYMBOL_RPAREN = 11,                    /* RPAREN  */
-  YYSYMBOL_LBRACE = 12,                    /* LBRACE  */
-  YYSYMBOL_RBRACE = 13,                    /* RBRACE  */
-  YYSYMBOL_SEMICOLON = 14,                 /* SEMICOLON  */
-  YYSYMBOL_COMMA = 15,                     /* COMMA  */
-  YYSYMBOL_ARROW = 16,                     /* ARROW  */
-  YYSYMBOL_NOT = 17,                       /* NOT  */
-  YYSYMBOL_AND = 18,                       /* AND  */
-  YYSYMBOL_OR = 19,                        /* OR  */
-  YYSYMBOL_O = 20,                         /* O  */
-  YYSYMBOL_H = 21,                         /* H  */
-  YYSYMBOL_S = 22,                         /* S  */
-  YYSYMBOL_Y = 23,                         /* Y  */
-  YYSYMBOL_GT = 24,                        /* GT  */
-  YYSYMBOL_LT = 25,                        /* LT  */
-  YYSYMBOL_GTE = 26,                       /* GTE  */
-  YYSYMBOL_LTE = 27,                       /* LTE  */
-  YYSYMBOL_EQ = 28,                        /* EQ  */
-  YYSYMBOL_NEQ = 29,                       /* NEQ  */
-  YYSYMBOL_YYACCEPT = 30,                  /* $accept  */
-  YYSYMBOL_Spec = 31,                      /* Spec  */
-  YYSYMBOL_TypeAnnotationList = 32,        /* TypeAnnotationList  */
-  YYSYMBOL_TypeAnnotation = 33,            /* TypeAnnotation  */
-  YYSYMBOL_Formulas = 34,                  /* Formulas  */
-  YYSYMBOL_Formula = 35,                   /* Formula  */
-  YYSYMBOL_Predicates = 36,                /* Predicates  */
-  YYSYMBOL_comma_separated_id_list = 37,   /* comma_separated_id_list  */
-  YYSYMBOL_TERM = 38                       /* TERM  */
+  YYSYMBOL_GUARD = 10,                     /* GUARD  */
+  YYSYMBOL_LPAREN = 11,                    /* LPAREN  */
+  YYSYMBOL_RPAREN = 12,                    /* RPAREN  */
+  YYSYMBOL_LBRACE = 13,                    /* LBRACE  */
+  YYSYMBOL_RBRACE = 14,                    /* RBRACE  */
+  YYSYMBOL_SEMICOLON = 15,                 /* SEMICOLON  */
+  YYSYMBOL_COMMA = 16,                     /* COMMA  */
+  YYSYMBOL_LBRACKET = 17,                  /* LBRACKET  */
+  YYSYMBOL_RBRACKET = 18,                  /* RBRACKET  */
+  YYSYMBOL_CARET = 19,                     /* CARET  */
+  YYSYMBOL_AT = 20,                        /* AT  */
+  YYSYMBOL_ARROW = 21,                     /* ARROW  */
+  YYSYMBOL_NOT = 22,                       /* NOT  */
+  YYSYMBOL_AND = 23,                       /* AND  */
+  YYSYMBOL_OR = 24,                        /* OR  */
+  YYSYMBOL_O = 25,                         /* O  */
+  YYSYMBOL_H = 26,                         /* H  */
+  YYSYMBOL_S = 27,                         /* S  */
+  YYSYMBOL_Y = 28,                         /* Y  */
+  YYSYMBOL_GT = 29,                        /* GT  */
+  YYSYMBOL_LT = 30,                        /* LT  */
+  YYSYMBOL_GTE = 31,                       /* GTE  */
+  YYSYMBOL_LTE = 32,                       /* LTE  */
+  YYSYMBOL_EQ = 33,                        /* EQ  */
+  YYSYMBOL_NEQ = 34,                       /* NEQ  */
+  YYSYMBOL_YYACCEPT = 35,                  /* $accept  */
+  YYSYMBOL_Spec = 36,                      /* Spec  */
+  YYSYMBOL_TypeAnnotationList = 37,        /* TypeAnnotationList  */
+  YYSYMBOL_TypeAnnotation = 38,            /* TypeAnnotation  */
+  YYSYMBOL_Guards = 39,                    /* Guards  */
+  YYSYMBOL_Formulas = 40,                  /* Formulas  */
+  YYSYMBOL_Formula = 41,                   /* Formula  */
+  YYSYMBOL_Predicates = 42,                /* Predicates  */
+  YYSYMBOL_comma_separated_id_list = 43,   /* comma_separated_id_list  */
+  YYSYMBOL_TERM = 44                       /* TERM  */
 };
 typedef enum yysymbol_kind_t yysymbol_kind_t;
 
@@ -473,19 +480,19 @@ union yyalloc
 /* YYFINAL -- State number of the termination state.  */
 #define YYFINAL  10
 /* YYLAST -- Last index in YYTABLE.  */
-#define YYLAST   70
+#define YYLAST   147
 
 /* YYNTOKENS -- Number of terminals.  */
-#define YYNTOKENS  30
+#define YYNTOKENS  35
 /* YYNNTS -- Number of nonterminals.  */
-#define YYNNTS  9
+#define YYNNTS  10
 /* YYNRULES -- Number of rules.  */
-#define YYNRULES  33
+#define YYNRULES  40
 /* YYNSTATES -- Number of states.  */
-#define YYNSTATES  64
+#define YYNSTATES  90
 
 /* YYMAXUTOK -- Last valid token kind.  */
-#define YYMAXUTOK   284
+#define YYMAXUTOK   289
 
 
 /* YYTRANSLATE(TOKEN-NUM) -- Symbol number corresponding to TOKEN-NUM
@@ -527,17 +534,18 @@ static const yytype_int8 yytranslate[] =
        2,     2,     2,     2,     2,     2,     1,     2,     3,     4,
        5,     6,     7,     8,     9,    10,    11,    12,    13,    14,
       15,    16,    17,    18,    19,    20,    21,    22,    23,    24,
-      25,    26,    27,    28,    29
+      25,    26,    27,    28,    29,    30,    31,    32,    33,    34
 };
 
 #if YYDEBUG
 /* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
 static const yytype_int16 yyrline[] =
 {
-       0,    62,    62,    79,    84,    92,    99,   104,   112,   116,
-     123,   126,   132,   137,   143,   149,   154,   159,   162,   167,
-     172,   178,   186,   196,   206,   216,   226,   236,   249,   254,
-     262,   268,   273,   278
+       0,    65,    65,    94,    99,   107,   113,   117,   124,   127,
+     134,   138,   145,   148,   151,   154,   157,   160,   164,   168,
+     171,   174,   177,   180,   183,   186,   189,   192,   195,   201,
+     207,   213,   219,   225,   231,   240,   244,   251,   255,   259,
+     263
 };
 #endif
 
@@ -554,11 +562,12 @@ static const char *yysymbol_name (yysymbol_kind_t yysymbol) YY_ATTRIBUTE_UNUSED;
 static const char *const yytname[] =
 {
   "\"end of file\"", "error", "\"invalid token\"", "ID", "INT", "TRUE",
-  "FALSE", "ENUM", "INT_TYPE", "BOOL_TYPE", "LPAREN", "RPAREN", "LBRACE",
-  "RBRACE", "SEMICOLON", "COMMA", "ARROW", "NOT", "AND", "OR", "O", "H",
-  "S", "Y", "GT", "LT", "GTE", "LTE", "EQ", "NEQ", "$accept", "Spec",
-  "TypeAnnotationList", "TypeAnnotation", "Formulas", "Formula",
-  "Predicates", "comma_separated_id_list", "TERM", YY_NULLPTR
+  "FALSE", "ENUM", "INT_TYPE", "BOOL_TYPE", "GUARD", "LPAREN", "RPAREN",
+  "LBRACE", "RBRACE", "SEMICOLON", "COMMA", "LBRACKET", "RBRACKET",
+  "CARET", "AT", "ARROW", "NOT", "AND", "OR", "O", "H", "S", "Y", "GT",
+  "LT", "GTE", "LTE", "EQ", "NEQ", "$accept", "Spec", "TypeAnnotationList",
+  "TypeAnnotation", "Guards", "Formulas", "Formula", "Predicates",
+  "comma_separated_id_list", "TERM", YY_NULLPTR
 };
 
 static const char *
@@ -568,7 +577,7 @@ yysymbol_name (yysymbol_kind_t yysymbol)
 }
 #endif
 
-#define YYPACT_NINF (-15)
+#define YYPACT_NINF (-21)
 
 #define yypact_value_is_default(Yyn) \
   ((Yyn) == YYPACT_NINF)
@@ -582,13 +591,15 @@ yysymbol_name (yysymbol_kind_t yysymbol)
    STATE-NUM.  */
 static const yytype_int8 yypact[] =
 {
-      56,     3,     8,    12,    18,    11,    56,     7,     6,     9,
-     -15,    23,   -15,   -15,    11,    11,    11,    11,    11,   -15,
-      -9,   -15,   -15,    30,   -15,   -15,    55,    55,    55,    55,
-      55,    55,    19,   -15,   -15,     0,   -15,    11,    11,    11,
-      11,    11,    14,    31,   -15,   -15,   -15,   -15,   -15,   -15,
-     -15,   -15,   -15,   -15,   -15,   -15,    24,     0,   -10,    17,
-      30,    22,   -15,   -15
+      18,    -1,     2,     5,    14,     6,    18,    11,     4,    25,
+     -21,   112,   112,   -21,    38,   -21,   -21,   113,   -21,   -21,
+     112,   112,    17,    46,    74,    35,   -21,   -21,    67,    30,
+      33,    61,    61,    61,    61,    61,    61,    -6,   -21,    49,
+     -21,    50,    34,    56,   -21,     6,   112,   112,   112,   112,
+     112,    38,    58,   -21,   -21,   -21,   -21,   -21,   -21,   -21,
+     -21,   -21,   -21,   -21,    62,    65,   112,   -21,   -20,    34,
+      21,    68,   -21,   -21,   -21,    79,    85,   -21,    80,    86,
+      81,   105,    94,   -21,   102,    34,   112,   112,   -21,    34
 };
 
 /* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
@@ -596,25 +607,27 @@ static const yytype_int8 yypact[] =
    means the default is an error.  */
 static const yytype_int8 yydefact[] =
 {
-       0,     0,     0,     0,     0,     0,     3,     0,     0,     0,
-       1,     0,    15,    16,     0,     0,     0,     0,     0,     2,
-       0,    17,     4,     0,     6,     7,     0,     0,     0,     0,
-       0,     0,     0,    12,    18,    19,    21,     8,     0,     0,
-       0,     0,    28,     0,    30,    31,    32,    33,    22,    24,
-      23,    25,    26,    27,    10,     9,    11,    13,    14,    20,
-       0,     0,    29,     5
+       0,     0,     0,     0,     0,     8,     3,     0,     0,     0,
+       1,     0,     0,     4,     0,     6,     7,     0,    17,    18,
+       0,     0,     0,     0,     0,     0,    19,     2,     0,    35,
+       0,     0,     0,     0,     0,     0,     0,     0,    14,     0,
+      20,     0,    21,     0,    23,     8,     0,     0,     0,     0,
+      10,     0,     0,    37,    38,    39,    40,    29,    31,    30,
+      32,    33,    34,    12,     0,     0,     0,     9,    13,    15,
+      16,    22,    11,    36,     5,     0,     0,    28,     0,     0,
+       0,     0,     0,    24,     0,    26,     0,     0,    25,    27
 };
 
 /* YYPGOTO[NTERM-NUM].  */
 static const yytype_int8 yypgoto[] =
 {
-     -15,   -15,    39,   -15,    25,   -14,   -15,    10,    26
+     -21,   -21,   106,   -21,    69,    63,   -11,   -21,    70,    -3
 };
 
 /* YYDEFGOTO[NTERM-NUM].  */
 static const yytype_int8 yydefgoto[] =
 {
-       0,     4,     5,     6,    19,    20,    21,    43,    48
+       0,     4,     5,     6,    12,    27,    28,    26,    30,    57
 };
 
 /* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
@@ -622,57 +635,75 @@ static const yytype_int8 yydefgoto[] =
    number is the opposite.  If YYTABLE_NINF, syntax error.  */
 static const yytype_int8 yytable[] =
 {
-      32,    33,    34,    35,    36,    37,     7,    38,    39,    39,
-      40,     8,    41,    41,    11,     9,    12,    13,    10,    23,
-      24,    14,    41,    25,    56,    57,    58,    59,    15,    60,
-      54,    16,    17,    42,    18,    38,    63,    39,    40,    -1,
-      38,    41,    39,    40,    61,    22,    41,    26,    27,    28,
-      29,    30,    31,    49,    50,    51,    52,    53,    44,    45,
-      46,    47,    55,     1,     2,     3,     0,     0,     0,     0,
-      62
+      25,    46,     7,    47,    48,     8,    63,    49,     9,    37,
+      38,    40,    42,    44,    10,    46,    11,    47,    48,    15,
+      17,    49,    18,    19,    14,     1,     2,     3,    20,    58,
+      59,    60,    61,    62,    39,    68,    69,    70,    71,    21,
+      16,    29,    22,    23,    47,    24,    51,    52,    49,    17,
+      45,    18,    19,    64,    65,    77,    46,    20,    47,    48,
+      66,    49,    49,    41,    53,    54,    55,    56,    21,    83,
+      85,    22,    23,    74,    24,    88,    89,    17,    75,    18,
+      19,    76,    50,    78,    17,    20,    18,    19,    46,    79,
+      47,    48,    20,    43,    49,    -1,    21,    86,    80,    22,
+      23,    82,    24,    21,    81,    87,    22,    23,    17,    24,
+      18,    19,    13,    72,    67,    17,    20,    18,    19,     0,
+       0,    73,     0,    20,     0,    84,     0,    21,     0,     0,
+      22,    23,     0,    24,    21,     0,     0,    22,    23,     0,
+      24,     0,    31,    32,    33,    34,    35,    36
 };
 
 static const yytype_int8 yycheck[] =
 {
-      14,    15,    16,    17,    18,    14,     3,    16,    18,    18,
-      19,     3,    22,    22,     3,     3,     5,     6,     0,    12,
-      14,    10,    22,    14,    38,    39,    40,    41,    17,    15,
-      11,    20,    21,     3,    23,    16,    14,    18,    19,    22,
-      16,    22,    18,    19,    13,     6,    22,    24,    25,    26,
-      27,    28,    29,    27,    28,    29,    30,    31,     3,     4,
-       5,     6,    37,     7,     8,     9,    -1,    -1,    -1,    -1,
-      60
+      11,    21,     3,    23,    24,     3,    12,    27,     3,    20,
+      21,    22,    23,    24,     0,    21,    10,    23,    24,    15,
+       3,    27,     5,     6,    13,     7,     8,     9,    11,    32,
+      33,    34,    35,    36,    17,    46,    47,    48,    49,    22,
+      15,     3,    25,    26,    23,    28,    16,    14,    27,     3,
+      15,     5,     6,     4,     4,    66,    21,    11,    23,    24,
+       4,    27,    27,    17,     3,     4,     5,     6,    22,    80,
+      81,    25,    26,    15,    28,    86,    87,     3,    16,     5,
+       6,    16,    15,     4,     3,    11,     5,     6,    21,     4,
+      23,    24,    11,    19,    27,    27,    22,     3,    18,    25,
+      26,    20,    28,    22,    18,     3,    25,    26,     3,    28,
+       5,     6,     6,    50,    45,     3,    11,     5,     6,    -1,
+      -1,    51,    -1,    11,    -1,    20,    -1,    22,    -1,    -1,
+      25,    26,    -1,    28,    22,    -1,    -1,    25,    26,    -1,
+      28,    -1,    29,    30,    31,    32,    33,    34
 };
 
 /* YYSTOS[STATE-NUM] -- The symbol kind of the accessing symbol of
    state STATE-NUM.  */
 static const yytype_int8 yystos[] =
 {
-       0,     7,     8,     9,    31,    32,    33,     3,     3,     3,
-       0,     3,     5,     6,    10,    17,    20,    21,    23,    34,
-      35,    36,    32,    12,    14,    14,    24,    25,    26,    27,
-      28,    29,    35,    35,    35,    35,    35,    14,    16,    18,
-      19,    22,     3,    37,     3,     4,     5,     6,    38,    38,
-      38,    38,    38,    38,    11,    34,    35,    35,    35,    35,
-      15,    13,    37,    14
+       0,     7,     8,     9,    36,    37,    38,     3,     3,     3,
+       0,    10,    39,    37,    13,    15,    15,     3,     5,     6,
+      11,    22,    25,    26,    28,    41,    42,    40,    41,     3,
+      43,    29,    30,    31,    32,    33,    34,    41,    41,    17,
+      41,    17,    41,    19,    41,    15,    21,    23,    24,    27,
+      15,    16,    14,     3,     4,     5,     6,    44,    44,    44,
+      44,    44,    44,    12,     4,     4,     4,    39,    41,    41,
+      41,    41,    40,    43,    15,    16,    16,    41,     4,     4,
+      18,    18,    20,    41,    20,    41,     3,     3,    41,    41
 };
 
 /* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
 static const yytype_int8 yyr1[] =
 {
-       0,    30,    31,    32,    32,    33,    33,    33,    34,    34,
-      35,    35,    35,    35,    35,    35,    35,    35,    35,    35,
-      35,    35,    36,    36,    36,    36,    36,    36,    37,    37,
-      38,    38,    38,    38
+       0,    35,    36,    37,    37,    38,    38,    38,    39,    39,
+      40,    40,    41,    41,    41,    41,    41,    41,    41,    41,
+      41,    41,    41,    41,    41,    41,    41,    41,    41,    42,
+      42,    42,    42,    42,    42,    43,    43,    44,    44,    44,
+      44
 };
 
 /* YYR2[RULE-NUM] -- Number of symbols on the right-hand side of rule RULE-NUM.  */
 static const yytype_int8 yyr2[] =
 {
-       0,     2,     2,     1,     2,     6,     3,     3,     2,     3,
-       3,     3,     2,     3,     3,     1,     1,     1,     2,     2,
-       3,     2,     3,     3,     3,     3,     3,     3,     1,     3,
-       1,     1,     1,     1
+       0,     2,     3,     1,     2,     6,     3,     3,     0,     4,
+       2,     3,     3,     3,     2,     3,     3,     1,     1,     1,
+       2,     2,     3,     2,     7,     9,     7,     9,     4,     3,
+       3,     3,     3,     3,     3,     1,     3,     1,     1,     1,
+       1
 };
 
 
@@ -1135,368 +1166,381 @@ yyreduce:
   YY_REDUCE_PRINT (yyn);
   switch (yyn)
     {
-  case 2: /* Spec: TypeAnnotationList Formulas  */
-#line 62 "evaluator-src/parser.y"
-                                {
+  case 2: /* Spec: TypeAnnotationList Guards Formulas  */
+#line 65 "evaluator-src/parser.y"
+                                       {
         std::vector<TypeAnnotation> typeAnnotations;
-        for (const auto& ta : *(yyvsp[-1].type_list)) {
+        for (const auto& ta : *(yyvsp[-2].type_list)) {
             typeAnnotations.push_back(ta);
         }
         
-        (yyval.spec_val) = new Spec(typeAnnotations, *(yyvsp[0].ast_list));
+        // The arena is complete at this point, so node pointers are stable
+        std::vector<ASTNode*> formulas;
+        for (ASTIndex f : *(yyvsp[0].ast_list)) {
+            formulas.push_back(ast_arena.at(f));
+        }
+        
+        root_guards.clear();
+        for (ASTIndex g : *(yyvsp[-1].ast_list)) {
+            root_guards.push_back(ast_arena.at(g));
+        }
+        
+        (yyval.spec_val) = new Spec(typeAnnotations, formulas);
         root = *(yyval.spec_val);
         
         // Cleanup
-        delete (yyvsp[-1].type_list);
+        delete (yyvsp[-2].type_list);
+        delete (yyvsp[-1].ast_list);
         delete (yyvsp[0].ast_list);
         delete (yyval.spec_val);
     }
-#line 1155 "evaluator-src/parser.cpp"
+#line 1198 "evaluator-src/parser.cpp"
     break;
 
   case 3: /* TypeAnnotationList: TypeAnnotation  */
-#line 79 "evaluator-src/parser.y"
+#line 94 "evaluator-src/parser.y"
                    {
         (yyval.type_list) = new std::vector<TypeAnnotation>();
         (yyval.type_list)->push_back(*(yyvsp[0].type_ast));
         delete (yyvsp[0].type_ast);
     }
-#line 1165 "evaluator-src/parser.cpp"
+#line 1208 "evaluator-src/parser.cpp"
     break;
 
   case 4: /* TypeAnnotationList: TypeAnnotation TypeAnnotationList  */
-#line 84 "evaluator-src/parser.y"
+#line 99 "evaluator-src/parser.y"
                                         {
         (yyvsp[0].type_list)->push_back(*(yyvsp[-1].type_ast));
         (yyval.type_list) = (yyvsp[0].type_list);
         delete (yyvsp[-1].type_ast);
     }
-#line 1175 "evaluator-src/parser.cpp"
+#line 1218 "evaluator-src/parser.cpp"
     break;
 
   case 5: /* TypeAnnotation: ENUM ID LBRACE comma_separated_id_list RBRACE SEMICOLON  */
-#line 92 "evaluator-src/parser.y"
+#line 107 "evaluator-src/parser.y"
                                                             {
         (yyval.type_ast) = new TypeAnnotation(AST_ENUM);
-        (yyval.type_ast)->enum_name = (yyvsp[-4].str);
+        (yyval.type_ast)->enum_name = ast_arena.symbol((yyvsp[-4].sym));
         (yyval.type_ast)->enum_values = *(yyvsp[-2].str_list);
-        free((yyvsp[-4].str));
         delete (yyvsp[-2].str_list);
     }
-#line 1187 "evaluator-src/parser.cpp"
+#line 1229 "evaluator-src/parser.cpp"
     break;
 
   case 6: /* TypeAnnotation: INT_TYPE ID SEMICOLON  */
-#line 99 "evaluator-src/parser.y"
+#line 113 "evaluator-src/parser.y"
                             {
         (yyval.type_ast) = new TypeAnnotation(AST_INT_TYPE);
-        (yyval.type_ast)->int_type_name = (yyvsp[-1].str);
-        free((yyvsp[-1].str));
+        (yyval.type_ast)->int_type_name = ast_arena.symbol((yyvsp[-1].sym));
     }
-#line 1197 "evaluator-src/parser.cpp"
+#line 1238 "evaluator-src/parser.cpp"
     break;
 
   case 7: /* TypeAnnotation: BOOL_TYPE ID SEMICOLON  */
-#line 104 "evaluator-src/parser.y"
+#line 117 "evaluator-src/parser.y"
                              {
         (yyval.type_ast) = new TypeAnnotation(AST_BOOL_TYPE);
-        (yyval.type_ast)->bool_type_name = (yyvsp[-1].str);
-        free((yyvsp[-1].str));
+        (yyval.type_ast)->bool_type_name = ast_arena.symbol((yyvsp[-1].sym));
+    }
+#line 1247 "evaluator-src/parser.cpp"
+    break;
+
+  case 8: /* Guards: %empty  */
+#line 124 "evaluator-src/parser.y"
+                {
+        (yyval.ast_list) = new std::vector<ASTIndex>();
     }
-#line 1207 "evaluator-src/parser.cpp"
+#line 1255 "evaluator-src/parser.cpp"
     break;
 
-  case 8: /* Formulas: Formula SEMICOLON  */
-#line 112 "evaluator-src/parser.y"
+  case 9: /* Guards: GUARD Formula SEMICOLON Guards  */
+#line 127 "evaluator-src/parser.y"
+                                     {
+        (yyvsp[0].ast_list)->push_back((yyvsp[-2].ast));
+        (yyval.ast_list) = (yyvsp[0].ast_list);
+    }
+#line 1264 "evaluator-src/parser.cpp"
+    break;
+
+  case 10: /* Formulas: Formula SEMICOLON  */
+#line 134 "evaluator-src/parser.y"
                       {
-        (yyval.ast_list) = new std::vector<ASTNode*>();
+        (yyval.ast_list) = new std::vector<ASTIndex>();
         (yyval.ast_list)->push_back((yyvsp[-1].ast));
     }
-#line 1216 "evaluator-src/parser.cpp"
+#line 1273 "evaluator-src/parser.cpp"
     break;
 
-  case 9: /* Formulas: Formula SEMICOLON Formulas  */
-#line 116 "evaluator-src/parser.y"
+  case 11: /* Formulas: Formula SEMICOLON Formulas  */
+#line 138 "evaluator-src/parser.y"
                                  {
         (yyvsp[0].ast_list)->push_back((yyvsp[-2].ast));
         (yyval.ast_list) = (yyvsp[0].ast_list);
     }
-#line 1225 "evaluator-src/parser.cpp"
+#line 1282 "evaluator-src/parser.cpp"
     break;
 
-  case 10: /* Formula: LPAREN Formula RPAREN  */
-#line 123 "evaluator-src/parser.y"
+  case 12: /* Formula: LPAREN Formula RPAREN  */
+#line 145 "evaluator-src/parser.y"
                           {
         (yyval.ast) = (yyvsp[-1].ast);
     }
-#line 1233 "evaluator-src/parser.cpp"
+#line 1290 "evaluator-src/parser.cpp"
     break;
 
-  case 11: /* Formula: Formula ARROW Formula  */
-#line 126 "evaluator-src/parser.y"
+  case 13: /* Formula: Formula ARROW Formula  */
+#line 148 "evaluator-src/parser.y"
                             {
-        ASTNode* node = new ASTNode(AST_ARROW);
-        node->binary_left = (yyvsp[-2].ast);
-        node->binary_right = (yyvsp[0].ast);
-        (yyval.ast) = node;
+        (yyval.ast) = ast_arena.alloc_binary(AST_ARROW, (yyvsp[-2].ast), (yyvsp[0].ast));
     }
-#line 1244 "evaluator-src/parser.cpp"
+#line 1298 "evaluator-src/parser.cpp"
     break;
 
-  case 12: /* Formula: NOT Formula  */
-#line 132 "evaluator-src/parser.y"
+  case 14: /* Formula: NOT Formula  */
+#line 151 "evaluator-src/parser.y"
                   {
-        ASTNode* node = new ASTNode(AST_NOT);
-        node->unary_child = (yyvsp[0].ast);
-        (yyval.ast) = node;
+        (yyval.ast) = ast_arena.alloc_unary(AST_NOT, (yyvsp[0].ast));
     }
-#line 1254 "evaluator-src/parser.cpp"
+#line 1306 "evaluator-src/parser.cpp"
     break;
 
-  case 13: /* Formula: Formula AND Formula  */
-#line 137 "evaluator-src/parser.y"
+  case 15: /* Formula: Formula AND Formula  */
+#line 154 "evaluator-src/parser.y"
                           {
-        ASTNode* node = new ASTNode(AST_AND);
-        node->binary_left = (yyvsp[-2].ast);
-        node->binary_right = (yyvsp[0].ast);
-        (yyval.ast) = node;
+        (yyval.ast) = ast_arena.alloc_binary(AST_AND, (yyvsp[-2].ast), (yyvsp[0].ast));
     }
-#line 1265 "evaluator-src/parser.cpp"
+#line 1314 "evaluator-src/parser.cpp"
     break;
 
-  case 14: /* Formula: Formula OR Formula  */
-#line 143 "evaluator-src/parser.y"
+  case 16: /* Formula: Formula OR Formula  */
+#line 157 "evaluator-src/parser.y"
                          {
-        ASTNode* node = new ASTNode(AST_OR);
-        node->binary_left = (yyvsp[-2].ast);
-        node->binary_right = (yyvsp[0].ast);
-        (yyval.ast) = node;
+        (yyval.ast) = ast_arena.alloc_binary(AST_OR, (yyvsp[-2].ast), (yyvsp[0].ast));
     }
-#line 1276 "evaluator-src/parser.cpp"
+#line 1322 "evaluator-src/parser.cpp"
     break;
 
-  case 15: /* Formula: TRUE  */
-#line 149 "evaluator-src/parser.y"
+  case 17: /* Formula: TRUE  */
+#line 160 "evaluator-src/parser.y"
            {
-        ASTNode* node = new ASTNode(AST_BOOL);
-        node->bool_value = true;
-        (yyval.ast) = node;
+        (yyval.ast) = ast_arena.alloc(AST_BOOL);
+        ast_arena.at((yyval.ast))->value = true;
     }
-#line 1286 "evaluator-src/parser.cpp"
+#line 1331 "evaluator-src/parser.cpp"
     break;
 
-  case 16: /* Formula: FALSE  */
-#line 154 "evaluator-src/parser.y"
+  case 18: /* Formula: FALSE  */
+#line 164 "evaluator-src/parser.y"
             {
-        ASTNode* node = new ASTNode(AST_BOOL);
-        node->bool_value = false;
-        (yyval.ast) = node;
+        (yyval.ast) = ast_arena.alloc(AST_BOOL);
+        ast_arena.at((yyval.ast))->value = false;
     }
-#line 1296 "evaluator-src/parser.cpp"
+#line 1340 "evaluator-src/parser.cpp"
     break;
 
-  case 17: /* Formula: Predicates  */
-#line 159 "evaluator-src/parser.y"
+  case 19: /* Formula: Predicates  */
+#line 168 "evaluator-src/parser.y"
                  {
         (yyval.ast) = (yyvsp[0].ast);
     }
-#line 1304 "evaluator-src/parser.cpp"
+#line 1348 "evaluator-src/parser.cpp"
     break;
 
-  case 18: /* Formula: O Formula  */
-#line 162 "evaluator-src/parser.y"
+  case 20: /* Formula: O Formula  */
+#line 171 "evaluator-src/parser.y"
                 {
-        ASTNode* node = new ASTNode(AST_O);
-        node->unary_child = (yyvsp[0].ast);
-        (yyval.ast) = node;
+        (yyval.ast) = ast_arena.alloc_unary(AST_O, (yyvsp[0].ast));
     }
-#line 1314 "evaluator-src/parser.cpp"
+#line 1356 "evaluator-src/parser.cpp"
     break;
 
-  case 19: /* Formula: H Formula  */
-#line 167 "evaluator-src/parser.y"
+  case 21: /* Formula: H Formula  */
+#line 174 "evaluator-src/parser.y"
                 {
-        ASTNode* node = new ASTNode(AST_H);
-        node->unary_child = (yyvsp[0].ast);
-        (yyval.ast) = node;
+        (yyval.ast) = ast_arena.alloc_unary(AST_H, (yyvsp[0].ast));
     }
-#line 1324 "evaluator-src/parser.cpp"
+#line 1364 "evaluator-src/parser.cpp"
     break;
 
-  case 20: /* Formula: Formula S Formula  */
-#line 172 "evaluator-src/parser.y"
+  case 22: /* Formula: Formula S Formula  */
+#line 177 "evaluator-src/parser.y"
                         {
-        ASTNode* node = new ASTNode(AST_S);
-        node->binary_left = (yyvsp[-2].ast);
-        node->binary_right = (yyvsp[0].ast);
-        (yyval.ast) = node;
+        (yyval.ast) = ast_arena.alloc_binary(AST_S, (yyvsp[-2].ast), (yyvsp[0].ast));
     }
-#line 1335 "evaluator-src/parser.cpp"
+#line 1372 "evaluator-src/parser.cpp"
     break;
 
-  case 21: /* Formula: Y Formula  */
-#line 178 "evaluator-src/parser.y"
+  case 23: /* Formula: Y Formula  */
+#line 180 "evaluator-src/parser.y"
                 {
-        ASTNode* node = new ASTNode(AST_Y);
-        node->unary_child = (yyvsp[0].ast);
-        (yyval.ast) = node;
+        (yyval.ast) = ast_arena.alloc_unary(AST_Y, (yyvsp[0].ast));
+    }
+#line 1380 "evaluator-src/parser.cpp"
+    break;
+
+  case 24: /* Formula: O LBRACKET INT COMMA INT RBRACKET Formula  */
+#line 183 "evaluator-src/parser.y"
+                                                        {
+        (yyval.ast) = ast_arena.alloc_window(AST_O_BOUNDED, (yyvsp[0].ast), (yyvsp[-4].val), (yyvsp[-2].val));
     }
-#line 1345 "evaluator-src/parser.cpp"
+#line 1388 "evaluator-src/parser.cpp"
     break;
 
-  case 22: /* Predicates: ID GT TERM  */
+  case 25: /* Formula: O LBRACKET INT COMMA INT RBRACKET AT ID Formula  */
 #line 186 "evaluator-src/parser.y"
+                                                              {
+        (yyval.ast) = ast_arena.alloc_window(AST_O_BOUNDED, (yyvsp[0].ast), (yyvsp[-6].val), (yyvsp[-4].val), (yyvsp[-1].sym));
+    }
+#line 1396 "evaluator-src/parser.cpp"
+    break;
+
+  case 26: /* Formula: H LBRACKET INT COMMA INT RBRACKET Formula  */
+#line 189 "evaluator-src/parser.y"
+                                                        {
+        (yyval.ast) = ast_arena.alloc_window(AST_H_BOUNDED, (yyvsp[0].ast), (yyvsp[-4].val), (yyvsp[-2].val));
+    }
+#line 1404 "evaluator-src/parser.cpp"
+    break;
+
+  case 27: /* Formula: H LBRACKET INT COMMA INT RBRACKET AT ID Formula  */
+#line 192 "evaluator-src/parser.y"
+                                                              {
+        (yyval.ast) = ast_arena.alloc_window(AST_H_BOUNDED, (yyvsp[0].ast), (yyvsp[-6].val), (yyvsp[-4].val), (yyvsp[-1].sym));
+    }
+#line 1412 "evaluator-src/parser.cpp"
+    break;
+
+  case 28: /* Formula: Y CARET INT Formula  */
+#line 195 "evaluator-src/parser.y"
+                                  {
+        (yyval.ast) = ast_arena.alloc_window(AST_Y_BOUNDED, (yyvsp[0].ast), (yyvsp[-1].val), (yyvsp[-1].val));
+    }
+#line 1420 "evaluator-src/parser.cpp"
+    break;
+
+  case 29: /* Predicates: ID GT TERM  */
+#line 201 "evaluator-src/parser.y"
                {
-        ASTNode* left_node = new ASTNode(AST_ID);
-        left_node->id_name = (yyvsp[-2].str);
-
-        ASTNode* node = new ASTNode(AST_GT);
-        node->binary_left = left_node;
-        node->binary_right = (yyvsp[0].ast);
-        (yyval.ast) = node;
-        free((yyvsp[-2].str));
+        ASTIndex left_node = ast_arena.alloc(AST_ID);
+        ast_arena.at(left_node)->value = (yyvsp[-2].sym);
+
+        (yyval.ast) = ast_arena.alloc_binary(AST_GT, left_node, (yyvsp[0].ast));
     }
-#line 1360 "evaluator-src/parser.cpp"
+#line 1431 "evaluator-src/parser.cpp"
     break;
 
-  case 23: /* Predicates: ID GTE TERM  */
-#line 196 "evaluator-src/parser.y"
+  case 30: /* Predicates: ID GTE TERM  */
+#line 207 "evaluator-src/parser.y"
                   {
-        ASTNode* left_node = new ASTNode(AST_ID);
-        left_node->id_name = (yyvsp[-2].str);
-
-        ASTNode* node = new ASTNode(AST_GTE);
-        node->binary_left = left_node;
-        node->binary_right = (yyvsp[0].ast);
-        (yyval.ast) = node;
-        free((yyvsp[-2].str));
+        ASTIndex left_node = ast_arena.alloc(AST_ID);
+        ast_arena.at(left_node)->value = (yyvsp[-2].sym);
+
+        (yyval.ast) = ast_arena.alloc_binary(AST_GTE, left_node, (yyvsp[0].ast));
     }
-#line 1375 "evaluator-src/parser.cpp"
+#line 1442 "evaluator-src/parser.cpp"
     break;
 
-  case 24: /* Predicates: ID LT TERM  */
-#line 206 "evaluator-src/parser.y"
+  case 31: /* Predicates: ID LT TERM  */
+#line 213 "evaluator-src/parser.y"
                  {
-        ASTNode* left_node = new ASTNode(AST_ID);
-        left_node->id_name = (yyvsp[-2].str);
-
-        ASTNode* node = new ASTNode(AST_LT);
-        node->binary_left = left_node;
-        node->binary_right = (yyvsp[0].ast);
-        (yyval.ast) = node;
-        free((yyvsp[-2].str));
+        ASTIndex left_node = ast_arena.alloc(AST_ID);
+        ast_arena.at(left_node)->value = (yyvsp[-2].sym);
+
+        (yyval.ast) = ast_arena.alloc_binary(AST_LT, left_node, (yyvsp[0].ast));
     }
-#line 1390 "evaluator-src/parser.cpp"
+#line 1453 "evaluator-src/parser.cpp"
     break;
 
-  case 25: /* Predicates: ID LTE TERM  */
-#line 216 "evaluator-src/parser.y"
+  case 32: /* Predicates: ID LTE TERM  */
+#line 219 "evaluator-src/parser.y"
                   {
-        ASTNode* left_node = new ASTNode(AST_ID);
-        left_node->id_name = (yyvsp[-2].str);
-
-        ASTNode* node = new ASTNode(AST_LTE);
-        node->binary_left = left_node;
-        node->binary_right = (yyvsp[0].ast);
-        (yyval.ast) = node;
-        free((yyvsp[-2].str));
+        ASTIndex left_node = ast_arena.alloc(AST_ID);
+        ast_arena.at(left_node)->value = (yyvsp[-2].sym);
+
+        (yyval.ast) = ast_arena.alloc_binary(AST_LTE, left_node, (yyvsp[0].ast));
     }
-#line 1405 "evaluator-src/parser.cpp"
+#line 1464 "evaluator-src/parser.cpp"
     break;
 
-  case 26: /* Predicates: ID EQ TERM  */
-#line 226 "evaluator-src/parser.y"
+  case 33: /* Predicates: ID EQ TERM  */
+#line 225 "evaluator-src/parser.y"
                  {
-        ASTNode* left_node = new ASTNode(AST_ID);
-        left_node->id_name = (yyvsp[-2].str);
-
-        ASTNode* node = new ASTNode(AST_EQ);
-        node->binary_left = left_node;
-        node->binary_right = (yyvsp[0].ast);
-        (yyval.ast) = node;
-        free((yyvsp[-2].str));
+        ASTIndex left_node = ast_arena.alloc(AST_ID);
+        ast_arena.at(left_node)->value = (yyvsp[-2].sym);
+
+        (yyval.ast) = ast_arena.alloc_binary(AST_EQ, left_node, (yyvsp[0].ast));
     }
-#line 1420 "evaluator-src/parser.cpp"
+#line 1475 "evaluator-src/parser.cpp"
     break;
 
-  case 27: /* Predicates: ID NEQ TERM  */
-#line 236 "evaluator-src/parser.y"
+  case 34: /* Predicates: ID NEQ TERM  */
+#line 231 "evaluator-src/parser.y"
                   {
-        ASTNode* left_node = new ASTNode(AST_ID);
-        left_node->id_name = (yyvsp[-2].str);
-
-        ASTNode* node = new ASTNode(AST_NEQ);
-        node->binary_left = left_node;
-        node->binary_right = (yyvsp[0].ast);
-        (yyval.ast) = node;
-        free((yyvsp[-2].str));
+        ASTIndex left_node = ast_arena.alloc(AST_ID);
+        ast_arena.at(left_node)->value = (yyvsp[-2].sym);
+
+        (yyval.ast) = ast_arena.alloc_binary(AST_NEQ, left_node, (yyvsp[0].ast));
     }
-#line 1435 "evaluator-src/parser.cpp"
+#line 1486 "evaluator-src/parser.cpp"
     break;
 
-  case 28: /* comma_separated_id_list: ID  */
-#line 249 "evaluator-src/parser.y"
+  case 35: /* comma_separated_id_list: ID  */
+#line 240 "evaluator-src/parser.y"
        {
         (yyval.str_list) = new std::vector<std::string>();
-        (yyval.str_list)->push_back((yyvsp[0].str));
-        free((yyvsp[0].str));
+        (yyval.str_list)->push_back(ast_arena.symbol((yyvsp[0].sym)));
     }
-#line 1445 "evaluator-src/parser.cpp"
+#line 1495 "evaluator-src/parser.cpp"
     break;
 
-  case 29: /* comma_separated_id_list: ID COMMA comma_separated_id_list  */
-#line 254 "evaluator-src/parser.y"
+  case 36: /* comma_separated_id_list: ID COMMA comma_separated_id_list  */
+#line 244 "evaluator-src/parser.y"
                                        {
-        (yyvsp[0].str_list)->push_back((yyvsp[-2].str));
+        (yyvsp[0].str_list)->push_back(ast_arena.symbol((yyvsp[-2].sym)));
         (yyval.str_list) = (yyvsp[0].str_list);
-        free((yyvsp[-2].str));
     }
-#line 1455 "evaluator-src/parser.cpp"
+#line 1504 "evaluator-src/parser.cpp"
     break;
 
-  case 30: /* TERM: ID  */
-#line 262 "evaluator-src/parser.y"
+  case 37: /* TERM: ID  */
+#line 251 "evaluator-src/parser.y"
        {
-        ASTNode* node = new ASTNode(AST_ID);
-        node->id_name = (yyvsp[0].str);
-        (yyval.ast) = node;
-        free((yyvsp[0].str));
+        (yyval.ast) = ast_arena.alloc(AST_ID);
+        ast_arena.at((yyval.ast))->value = (yyvsp[0].sym);
     }
-#line 1466 "evaluator-src/parser.cpp"
+#line 1513 "evaluator-src/parser.cpp"
     break;
 
-  case 31: /* TERM: INT  */
-#line 268 "evaluator-src/parser.y"
+  case 38: /* TERM: INT  */
+#line 255 "evaluator-src/parser.y"
           {
-        ASTNode* node = new ASTNode(AST_INT);
-        node->int_value = (yyvsp[0].val);
-        (yyval.ast) = node;
+        (yyval.ast) = ast_arena.alloc(AST_INT);
+        ast_arena.at((yyval.ast))->value = (yyvsp[0].val);
     }
-#line 1476 "evaluator-src/parser.cpp"
+#line 1522 "evaluator-src/parser.cpp"
     break;
 
-  case 32: /* TERM: TRUE  */
-#line 273 "evaluator-src/parser.y"
+  case 39: /* TERM: TRUE  */
+#line 259 "evaluator-src/parser.y"
            {
-        ASTNode* node = new ASTNode(AST_BOOL);
-        node->bool_value = true;
-        (yyval.ast) = node;
+        (yyval.ast) = ast_arena.alloc(AST_BOOL);
+        ast_arena.at((yyval.ast))->value = true;
     }
-#line 1486 "evaluator-src/parser.cpp"
+#line 1531 "evaluator-src/parser.cpp"
     break;
 
-  case 33: /* TERM: FALSE  */
-#line 278 "evaluator-src/parser.y"
+  case 40: /* TERM: FALSE  */
+#line 263 "evaluator-src/parser.y"
             {
-        ASTNode* node = new ASTNode(AST_BOOL);
-        node->bool_value = false;
-        (yyval.ast) = node;
+        (yyval.ast) = ast_arena.alloc(AST_BOOL);
+        ast_arena.at((yyval.ast))->value = false;
     }
-#line 1496 "evaluator-src/parser.cpp"
+#line 1540 "evaluator-src/parser.cpp"
     break;
 
 
-#line 1500 "evaluator-src/parser.cpp"
+#line 1544 "evaluator-src/parser.cpp"
 
       default: break;
     }
@@ -1689,7 +1733,7 @@ yyreturnlab:
   return yyresult;
 }
 
-#line 285 "evaluator-src/parser.y"
+#line 269 "evaluator-src/parser.y"
 
 
 void yyerror(const char *s) {
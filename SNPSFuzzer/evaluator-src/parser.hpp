@@ -61,26 +61,31 @@ extern int yydebug;
     ENUM = 262,                    /* ENUM  */
     INT_TYPE = 263,                /* INT_TYPE  */
     BOOL_TYPE = 264,               /* BOOL_TYPE  */
-    LPAREN = 265,                  /* LPAREN  */
-    RPAREN = 266,                  /* RPAREN  */
-    LBRACE = 267,                  /* LBRACE  */
-    RBRACE = 268,                  /* RBRACE  */
-    SEMICOLON = 269,               /* SEMICOLON  */
-    COMMA = 270,                   /* COMMA  */
-    ARROW = 271,                   /* ARROW  */
-    NOT = 272,                     /* NOT  */
-    AND = 273,                     /* AND  */
-    OR = 274,                      /* OR  */
-    O = 275,                       /* O  */
-    H = 276,                       /* H  */
-    S = 277,                       /* S  */
-    Y = 278,                       /* Y  */
-    GT = 279,                      /* GT  */
-    LT = 280,                      /* LT  */
-    GTE = 281,                     /* GTE  */
-    LTE = 282,                     /* LTE  */
-    EQ = 283,                      /* EQ  */
-    NEQ = 284                      /* NEQ  */
+    GUARD = 265,                   /* GUARD  */
+    LPAREN = 266,                  /* LPAREN  */
+    RPAREN = 267,                  /* RPAREN  */
+    LBRACE = 268,                  /* LBRACE  */
+    RBRACE = 269,                  /* RBRACE  */
+    SEMICOLON = 270,               /* SEMICOLON  */
+    COMMA = 271,                   /* COMMA  */
+    LBRACKET = 272,                /* LBRACKET  */
+    RBRACKET = 273,                /* RBRACKET  */
+    CARET = 274,                   /* CARET  */
+    AT = 275,                      /* AT  */
+    ARROW = 276,                   /* ARROW  */
+    NOT = 277,                     /* NOT  */
+    AND = 278,                     /* AND  */
+    OR = 279,                      /* OR  */
+    O = 280,                       /* O  */
+    H = 281,                       /* H  */
+    S = 282,                       /* S  */
+    Y = 283,                       /* Y  */
+    GT = 284,                      /* GT  */
+    LT = 285,                      /* LT  */
+    GTE = 286,                     /* GTE  */
+    LTE = 287,                     /* LTE  */
+    EQ = 288,                      /* EQ  */
+    NEQ = 289                      /* NEQ  */
   };
   typedef enum yytokentype yytoken_kind_t;
 #endif
@@ -89,18 +94,18 @@ extern int yydebug;
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
 union YYSTYPE
 {
-#line 13 "evaluator-src/parser.y"
+#line 14 "evaluator-src/parser.y"
 
-    ASTNode* ast;
-    char* str;
+    ASTIndex ast;
+    int sym;
     int val;
     TypeAnnotation* type_ast;
     std::vector<TypeAnnotation>* type_list;
     std::vector<std::string>* str_list;
-    std::vector<ASTNode*>* ast_list;
+    std::vector<ASTIndex>* ast_list;
     Spec* spec_val; 
 
-#line 104 "evaluator-src/parser.hpp"
+#line 109 "evaluator-src/parser.hpp"
 
 };
 typedef union YYSTYPE YYSTYPE;
@@ -8,29 +8,32 @@ void yyerror(const char *s);
 int yylex(void);
 extern FILE *yyin;
 Spec root;
+std::vector<ASTNode*> root_guards;
 %}
 
 %union {
-    ASTNode* ast;
-    char* str;
+    ASTIndex ast;
+    int sym;
     int val;
     TypeAnnotation* type_ast;
     std::vector<TypeAnnotation>* type_list;
     std::vector<std::string>* str_list;
-    std::vector<ASTNode*>* ast_list;
+    std::vector<ASTIndex>* ast_list;
     Spec* spec_val; 
 }
 
-%token <str> ID 
+%token <sym> ID 
 %token <val> INT
 %token TRUE FALSE
-%token ENUM INT_TYPE BOOL_TYPE
+%token ENUM INT_TYPE BOOL_TYPE GUARD
 %token LPAREN RPAREN LBRACE RBRACE SEMICOLON COMMA
+%token LBRACKET RBRACKET CARET AT
 %token ARROW NOT AND OR O H S Y
 %token GT LT GTE LTE EQ NEQ
 
 %type <spec_val> Spec
 %type <ast_list> Formulas
+%type <ast_list> Guards
 %type <ast> Formula
 %type <ast> TERM
 %type <ast> Predicates
@@ -59,18 +62,30 @@ Spec root;
 %%
 
 Spec :
-    TypeAnnotationList Formulas {
+    TypeAnnotationList Guards Formulas {
         std::vector<TypeAnnotation> typeAnnotations;
         for (const auto& ta : *$1) {
             typeAnnotations.push_back(ta);
         }
         
-        $$ = new Spec(typeAnnotations, *$2);
+        // The arena is complete at this point, so node pointers are stable
+        std::vector<ASTNode*> formulas;
+        for (ASTIndex f : *$3) {
+            formulas.push_back(ast_arena.at(f));
+        }
+        
+        root_guards.clear();
+        for (ASTIndex g : *$2) {
+            root_guards.push_back(ast_arena.at(g));
+        }
+        
+        $$ = new Spec(typeAnnotations, formulas);
         root = *$$;
         
         // Cleanup
         delete $1;
         delete $2;
+        delete $3;
         delete $$;
     }
 ;
@@ -91,26 +106,33 @@ TypeAnnotationList :
 TypeAnnotation :
     ENUM ID LBRACE comma_separated_id_list RBRACE SEMICOLON {
         $$ = new TypeAnnotation(AST_ENUM);
-        $$->enum_name = $2;
+        $$->enum_name = ast_arena.symbol($2);
         $$->enum_values = *$4;
-        free($2);
         delete $4;
     }
     | INT_TYPE ID SEMICOLON {
         $$ = new TypeAnnotation(AST_INT_TYPE);
-        $$->int_type_name = $2;
-        free($2);
+        $$->int_type_name = ast_arena.symbol($2);
     }
     | BOOL_TYPE ID SEMICOLON {
         $$ = new TypeAnnotation(AST_BOOL_TYPE);
-        $$->bool_type_name = $2;
-        free($2);
+        $$->bool_type_name = ast_arena.symbol($2);
+    }
+;
+
+Guards :
+    /* empty */ {
+        $$ = new std::vector<ASTIndex>();
+    }
+    | GUARD Formula SEMICOLON Guards {
+        $4->push_back($2);
+        $$ = $4;
     }
 ;
 
 Formulas :
     Formula SEMICOLON {
-        $$ = new std::vector<ASTNode*>();
+        $$ = new std::vector<ASTIndex>();
         $$->push_back($1);
     }
     | Formula SEMICOLON Formulas {
@@ -124,161 +146,123 @@ Formula :
         $$ = $2;
     }
     | Formula ARROW Formula {
-        ASTNode* node = new ASTNode(AST_ARROW);
-        node->binary_left = $1;
-        node->binary_right = $3;
-        $$ = node;
+        $$ = ast_arena.alloc_binary(AST_ARROW, $1, $3);
     }
     | NOT Formula {
-        ASTNode* node = new ASTNode(AST_NOT);
-        node->unary_child = $2;
-        $$ = node;
+        $$ = ast_arena.alloc_unary(AST_NOT, $2);
     }
     | Formula AND Formula {
-        ASTNode* node = new ASTNode(AST_AND);
-        node->binary_left = $1;
-        node->binary_right = $3;
-        $$ = node;
+        $$ = ast_arena.alloc_binary(AST_AND, $1, $3);
     }
     | Formula OR Formula {
-        ASTNode* node = new ASTNode(AST_OR);
-        node->binary_left = $1;
-        node->binary_right = $3;
-        $$ = node;
+        $$ = ast_arena.alloc_binary(AST_OR, $1, $3);
     }
     | TRUE {
-        ASTNode* node = new ASTNode(AST_BOOL);
-        node->bool_value = true;
-        $$ = node;
+        $$ = ast_arena.alloc(AST_BOOL);
+        ast_arena.at($$)->value = true;
     }
     | FALSE {
-        ASTNode* node = new ASTNode(AST_BOOL);
-        node->bool_value = false;
-        $$ = node;
+        $$ = ast_arena.alloc(AST_BOOL);
+        ast_arena.at($$)->value = false;
     }
     | Predicates {
         $$ = $1;
     }
     | O Formula {
-        ASTNode* node = new ASTNode(AST_O);
-        node->unary_child = $2;
-        $$ = node;
+        $$ = ast_arena.alloc_unary(AST_O, $2);
     }
     | H Formula {
-        ASTNode* node = new ASTNode(AST_H);
-        node->unary_child = $2;
-        $$ = node;
+        $$ = ast_arena.alloc_unary(AST_H, $2);
     }
     | Formula S Formula {
-        ASTNode* node = new ASTNode(AST_S);
-        node->binary_left = $1;
-        node->binary_right = $3;
-        $$ = node;
+        $$ = ast_arena.alloc_binary(AST_S, $1, $3);
     }
     | Y Formula {
-        ASTNode* node = new ASTNode(AST_Y);
-        node->unary_child = $2;
-        $$ = node;
+        $$ = ast_arena.alloc_unary(AST_Y, $2);
+    }
+    | O LBRACKET INT COMMA INT RBRACKET Formula %prec O {
+        $$ = ast_arena.alloc_window(AST_O_BOUNDED, $7, $3, $5);
+    }
+    | O LBRACKET INT COMMA INT RBRACKET AT ID Formula %prec O {
+        $$ = ast_arena.alloc_window(AST_O_BOUNDED, $9, $3, $5, $8);
+    }
+    | H LBRACKET INT COMMA INT RBRACKET Formula %prec H {
+        $$ = ast_arena.alloc_window(AST_H_BOUNDED, $7, $3, $5);
+    }
+    | H LBRACKET INT COMMA INT RBRACKET AT ID Formula %prec H {
+        $$ = ast_arena.alloc_window(AST_H_BOUNDED, $9, $3, $5, $8);
+    }
+    | Y CARET INT Formula %prec Y {
+        $$ = ast_arena.alloc_window(AST_Y_BOUNDED, $4, $3, $3);
     }
 ;
 
 Predicates :
     ID GT TERM {
-        ASTNode* left_node = new ASTNode(AST_ID);
-        left_node->id_name = $1;
+        ASTIndex left_node = ast_arena.alloc(AST_ID);
+        ast_arena.at(left_node)->value = $1;
 
-        ASTNode* node = new ASTNode(AST_GT);
-        node->binary_left = left_node;
-        node->binary_right = $3;
-        $$ = node;
-        free($1);
+        $$ = ast_arena.alloc_binary(AST_GT, left_node, $3);
     }
     | ID GTE TERM {
-        ASTNode* left_node = new ASTNode(AST_ID);
-        left_node->id_name = $1;
+        ASTIndex left_node = ast_arena.alloc(AST_ID);
+        ast_arena.at(left_node)->value = $1;
 
-        ASTNode* node = new ASTNode(AST_GTE);
-        node->binary_left = left_node;
-        node->binary_right = $3;
-        $$ = node;
-        free($1);
+        $$ = ast_arena.alloc_binary(AST_GTE, left_node, $3);
     }
     | ID LT TERM {
-        ASTNode* left_node = new ASTNode(AST_ID);
-        left_node->id_name = $1;
+        ASTIndex left_node = ast_arena.alloc(AST_ID);
+        ast_arena.at(left_node)->value = $1;
 
-        ASTNode* node = new ASTNode(AST_LT);
-        node->binary_left = left_node;
-        node->binary_right = $3;
-        $$ = node;
-        free($1);
+        $$ = ast_arena.alloc_binary(AST_LT, left_node, $3);
     }
     | ID LTE TERM {
-        ASTNode* left_node = new ASTNode(AST_ID);
-        left_node->id_name = $1;
+        ASTIndex left_node = ast_arena.alloc(AST_ID);
+        ast_arena.at(left_node)->value = $1;
 
-        ASTNode* node = new ASTNode(AST_LTE);
-        node->binary_left = left_node;
-        node->binary_right = $3;
-        $$ = node;
-        free($1);
+        $$ = ast_arena.alloc_binary(AST_LTE, left_node, $3);
     }
     | ID EQ TERM {
-        ASTNode* left_node = new ASTNode(AST_ID);
-        left_node->id_name = $1;
+        ASTIndex left_node = ast_arena.alloc(AST_ID);
+        ast_arena.at(left_node)->value = $1;
 
-        ASTNode* node = new ASTNode(AST_EQ);
-        node->binary_left = left_node;
-        node->binary_right = $3;
-        $$ = node;
-        free($1);
+        $$ = ast_arena.alloc_binary(AST_EQ, left_node, $3);
     }
     | ID NEQ TERM {
-        ASTNode* left_node = new ASTNode(AST_ID);
-        left_node->id_name = $1;
+        ASTIndex left_node = ast_arena.alloc(AST_ID);
+        ast_arena.at(left_node)->value = $1;
 
-        ASTNode* node = new ASTNode(AST_NEQ);
-        node->binary_left = left_node;
-        node->binary_right = $3;
-        $$ = node;
-        free($1);
+        $$ = ast_arena.alloc_binary(AST_NEQ, left_node, $3);
     }
 ;
 
 comma_separated_id_list :
     ID {
         $$ = new std::vector<std::string>();
-        $$->push_back($1);
-        free($1);
+        $$->push_back(ast_arena.symbol($1));
     }
     | ID COMMA comma_separated_id_list {
-        $3->push_back($1);
+        $3->push_back(ast_arena.symbol($1));
         $$ = $3;
-        free($1);
     }
 ;
 
 TERM : 
     ID {
-        ASTNode* node = new ASTNode(AST_ID);
-        node->id_name = $1;
-        $$ = node;
-        free($1);
+        $$ = ast_arena.alloc(AST_ID);
+        ast_arena.at($$)->value = $1;
     }
     | INT {
-        ASTNode* node = new ASTNode(AST_INT);
-        node->int_value = $1;
-        $$ = node;
+        $$ = ast_arena.alloc(AST_INT);
+        ast_arena.at($$)->value = $1;
     }
     | TRUE {
-        ASTNode* node = new ASTNode(AST_BOOL);
-        node->bool_value = true;
-        $$ = node;
+        $$ = ast_arena.alloc(AST_BOOL);
+        ast_arena.at($$)->value = true;
     }
     | FALSE {
-        ASTNode* node = new ASTNode(AST_BOOL);
-        node->bool_value = false;
-        $$ = node;
+        $$ = ast_arena.alloc(AST_BOOL);
+        ast_arena.at($$)->value = false;
     }
 ;
 
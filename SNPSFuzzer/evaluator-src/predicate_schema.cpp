@@ -0,0 +1,155 @@
+# include "predicate_schema.h"
+# include <cctype>
+# include <cstdio>
+
+PredicateSchema::PredicateSchema(const vector<TypeAnnotation>& types)
+{
+    // The parser's right-recursive lists hold declarations and enum values
+    // last-first; number them in source order so the generated header reads
+    // like the spec.
+    std::string canon;
+    for (auto it = types.rbegin(); it != types.rend(); ++it)
+    {
+        const TypeAnnotation& t = *it;
+        Var v;
+        switch (t.kind)
+        {
+            case AST_ENUM:
+                v.name = t.enum_name;
+                v.kind = PRED_KIND_ENUM;
+                v.values.assign(t.enum_values.rbegin(), t.enum_values.rend());
+                break;
+            case AST_INT_TYPE:
+                v.name = t.int_type_name;
+                v.kind = PRED_KIND_INT;
+                break;
+            default:
+                v.name = t.bool_type_name;
+                v.kind = PRED_KIND_BOOL;
+                break;
+        }
+        canon += "bie"[v.kind];
+        canon += ":" + v.name;
+        for (size_t i = 0; i < v.values.size(); ++i) {
+            canon += (i ? "," : "=") + v.values[i];
+        }
+        canon += ";";
+        vars.push_back(v);
+    }
+
+    // FNV-1a
+    spec_hash = 2166136261u;
+    for (unsigned char c : canon) {
+        spec_hash ^= c;
+        spec_hash *= 16777619u;
+    }
+}
+
+bool PredicateSchema::Decode(const pred_record_t& rec, std::unordered_map<std::string, std::string>& kv) const
+{
+    if (rec.spec_hash != spec_hash || rec.count > PRED_MAX_FIELDS) return false;
+
+    kv.clear();
+    for (uint16_t i = 0; i < rec.count; ++i)
+    {
+        const pred_field_t& f = rec.fields[i];
+        if (f.var >= vars.size()) return false;
+        const Var& v = vars[f.var];
+        switch (v.kind)
+        {
+            case PRED_KIND_BOOL:
+                kv[v.name] = f.value ? "true" : "false";
+                break;
+            case PRED_KIND_INT:
+                kv[v.name] = to_string(f.value);
+                break;
+            default:
+                if (f.value < 0 || (size_t)f.value >= v.values.size()) return false;
+                kv[v.name] = v.values[f.value];
+                break;
+        }
+    }
+    return true;
+}
+
+int PredicateSchema::FindVar(const std::string& name) const
+{
+    for (size_t i = 0; i < vars.size(); ++i) {
+        if (vars[i].name == name) return (int)i;
+    }
+    return -1;
+}
+
+int PredicateSchema::FindValue(int var, const std::string& value) const
+{
+    const auto& values = vars[var].values;
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (values[i] == value) return (int)i;
+    }
+    return -1;
+}
+
+void PredicateSchema::WriteHeader(std::ostream& os, const std::string& prefix, const std::string& spec_path) const
+{
+    std::string lower = prefix;
+    for (auto& c : lower) c = (char)tolower((unsigned char)c);
+    char hash_str[16];
+    snprintf(hash_str, sizeof(hash_str), "0x%08xu", spec_hash);
+
+    os << "// " << lower << "_pred_spec.h - generated by ltl_predgen from " << spec_path << "\n"
+       << "// Do not edit; regenerate when the spec changes.\n"
+       << "#ifndef " << prefix << "_PRED_SPEC_H\n"
+       << "#define " << prefix << "_PRED_SPEC_H\n\n"
+       << "#include \"pred_record.h\"\n\n"
+       << "#define " << prefix << "_PRED_SPEC_HASH " << hash_str << "\n\n";
+
+    os << "enum {\n";
+    for (size_t i = 0; i < vars.size(); ++i) {
+        os << "    " << prefix << "_VAR_" << vars[i].name << " = " << i << ",\n";
+    }
+    os << "    " << prefix << "_PRED_NVARS\n};\n";
+
+    for (const auto& v : vars)
+    {
+        if (v.kind != PRED_KIND_ENUM) continue;
+        os << "\n/* enum " << v.name << " */\nenum {\n";
+        for (size_t i = 0; i < v.values.size(); ++i) {
+            os << "    " << prefix << "_" << v.name << "_" << v.values[i] << " = " << i
+               << (i + 1 < v.values.size() ? ",\n" : "\n");
+        }
+        os << "};\n";
+    }
+
+    os << "\nstatic const char *const " << lower << "_pred_var_names[] = {\n";
+    for (const auto& v : vars) os << "    \"" << v.name << "\",\n";
+    os << "};\n";
+
+    static const char* kind_names[] = { "PRED_KIND_BOOL", "PRED_KIND_INT", "PRED_KIND_ENUM" };
+    os << "\nstatic const uint8_t " << lower << "_pred_var_kinds[] = {\n";
+    for (const auto& v : vars) os << "    " << kind_names[v.kind] << ",\n";
+    os << "};\n";
+
+    for (const auto& v : vars)
+    {
+        if (v.kind != PRED_KIND_ENUM) continue;
+        os << "\nstatic const char *const " << lower << "_pred_" << v.name << "_values[] = {\n";
+        for (const auto& val : v.values) os << "    \"" << val << "\",\n";
+        os << "};\n";
+    }
+
+    os << "\nstatic const char *const *const " << lower << "_pred_enum_values[] = {\n";
+    for (const auto& v : vars) {
+        if (v.kind == PRED_KIND_ENUM) os << "    " << lower << "_pred_" << v.name << "_values,\n";
+        else os << "    NULL,\n";
+    }
+    os << "};\n";
+
+    os << "\nstatic const pred_schema_t " << lower << "_pred_schema = {\n"
+       << "    " << prefix << "_PRED_SPEC_HASH,\n"
+       << "    " << prefix << "_PRED_NVARS,\n"
+       << "    " << lower << "_pred_var_names,\n"
+       << "    " << lower << "_pred_var_kinds,\n"
+       << "    " << lower << "_pred_enum_values,\n"
+       << "};\n\n"
+       << "#endif /* " << prefix << "_PRED_SPEC_H */\n";
+}
@@ -0,0 +1,54 @@
+#ifndef PREDICATE_SCHEMA_H_
+#define PREDICATE_SCHEMA_H_
+
+# include <string>
+# include <vector>
+# include <unordered_map>
+# include <ostream>
+# include "ast.h"
+# include "../monitor-src/pred_record.h"
+using namespace std ;
+
+// Numbering of a spec's variables for binary predicate records.
+//
+// Variable ids follow the source order of the spec's type declarations and
+// enum value ids the order inside each enum, which is exactly what
+// ltl_predgen writes into the adapter-side header. The hash covers names, kinds and
+// enum values in that order, so any edit that would renumber something
+// changes it.
+class PredicateSchema
+{
+private:
+    struct Var
+    {
+        std::string name ;
+        uint8_t kind ;                      // enum pred_kind
+        vector<std::string> values ;        // PRED_KIND_ENUM only
+    };
+
+    vector<Var> vars ;
+    uint32_t spec_hash ;
+
+public:
+    explicit PredicateSchema(const vector<TypeAnnotation>& types);
+    uint32_t hash() const { return spec_hash; }
+    size_t size() const { return vars.size(); }
+
+    // Record -> the k=v map a text line would have produced. False if the
+    // record was built for another spec or carries an out-of-range id.
+    bool Decode(const pred_record_t& rec, std::unordered_map<std::string, std::string>& kv) const;
+
+    // Variable id by name and an enum value's id inside variable `var`;
+    // -1 if there is no such variable / value
+    int FindVar(const std::string& name) const;
+    int FindValue(int var, const std::string& value) const;
+    const std::string& Name(int var) const { return vars[var].name; }
+    uint8_t Kind(int var) const { return vars[var].kind; }
+    const std::string& Value(int var, int value) const { return vars[var].values[value]; }
+
+    // C header with <prefix>_VAR_* / <prefix>_<enum>_<value> ids and the
+    // pred_schema_t used to render records as text
+    void WriteHeader(std::ostream& os, const std::string& prefix, const std::string& spec_path) const;
+};
+
+#endif
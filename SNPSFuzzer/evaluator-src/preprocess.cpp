@@ -48,10 +48,13 @@ void Preprocessor::PreProcess(ASTNode* node)
         case AST_H:
         case AST_O:
         case AST_Y:
+        case AST_O_BOUNDED:
+        case AST_H_BOUNDED:
+        case AST_Y_BOUNDED:
             // printIndentation(indent + 1);
             // std::cout << "Child:" << std::endl;
             // printAST(node->unary_child, indent + 2);
-            PreProcess(node->unary_child);
+            PreProcess(node->unary_child());
             break;
         case AST_ARROW:
         case AST_AND:
@@ -70,8 +73,8 @@ void Preprocessor::PreProcess(ASTNode* node)
             // printIndentation(indent + 1);
             // std::cout << "Right:" << std::endl;
             // printAST(node->binary_right, indent + 2);
-            PreProcess(node->binary_left);
-            PreProcess(node->binary_right);
+            PreProcess(node->binary_left());
+            PreProcess(node->binary_right());
             break;
         default:
             // printIndentation(indent + 1);
@@ -1,4 +1,5 @@
 # include "state.h" 
+# include <unordered_set>
 
 State::State(TypeChecker *tc) : Tchecker(tc) {
     // Initialize the LabelingFunction map
@@ -19,6 +20,36 @@ void State::addLabel(std::string vname, std::string val) {
     LabelingFunction[vname] = val;
 }
 
+void State::loadEvent(std::unordered_map<std::string, std::string>& kv) {
+    // The evaluator must only see predicates that are defined in the spec.
+    // Adapters also send metadata (msg_id/dir/trace) so violations can be
+    // joined back to raw packet blobs; those keys never become labels.
+    static const std::unordered_set<std::string> kMetaKeys = {
+        "msg_id", "dir", "trace"
+    };
+
+    // Protocol-agnostic derived predicates
+    bool have_qid = false, have_respid = false;
+    long qid = 0, respid = 0;
+
+    for (const auto& kvp : kv) {
+        const std::string& k = kvp.first;
+        const std::string& v = kvp.second;
+        if (k == "q_id")    { have_qid = true;    qid = std::stol(v); }
+        if (k == "resp_id") { have_respid = true; respid = std::stol(v); }
+    }
+
+    if (!kv.count("id_mismatch") && have_qid && have_respid) {
+        kv["id_mismatch"] = (qid != respid) ? "true" : "false";
+    }
+
+    for (const auto& kvp : kv) {
+        if (kMetaKeys.find(kvp.first) != kMetaKeys.end()) continue;
+        if (kvp.first.empty() || kvp.second.empty()) continue;
+        addLabel(kvp.first, kvp.second);
+    }
+}
+
 std::string State::printState()
 {
     // Print the current state of the LabelingFunction map
@@ -10,6 +10,7 @@
 # include <algorithm>
 # include <map>
 # include <set>
+# include <unordered_map>
 # include "ast.h"
 # include "typechecker.h" 
 using namespace std ; 
@@ -22,6 +23,7 @@ private:
 public: 
     State(TypeChecker *tc);
     void addLabel(std::string vname, std::string val);
+    void loadEvent(std::unordered_map<std::string, std::string>& kv);
     std::string getLabel(std::string vname); 
     std::map<std::string, std::string> LabelingFunction;
     std::pair<std::string, std::string> getType(std::string variable_name);
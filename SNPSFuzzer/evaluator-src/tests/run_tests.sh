@@ -0,0 +1,39 @@
+#!/bin/bash
+# run_tests.sh - Spec regression tests for the monitor
+#
+# Usage:
+#   ./run_tests.sh [formula_parser]
+#
+# Each tests/<name>.txt is a spec. tests/<name>.in is fed to the monitor
+# on stdin, and what the monitor prints on stdout (verdicts and
+# __END_SESSION__ acks) must match tests/<name>.out exactly.
+
+set -uo pipefail
+
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+MONITOR="$(realpath "${1:-${SCRIPT_DIR}/../formula_parser}")"
+
+if [ ! -x "$MONITOR" ]; then
+    echo "Usage: $0 [formula_parser]"
+    exit 2
+fi
+
+# The monitor writes its logs to the current directory
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK"
+
+fail=0
+for spec in "$SCRIPT_DIR"/*.txt; do
+    name="$(basename "$spec" .txt)"
+    if "$MONITOR" "$spec" generic < "$SCRIPT_DIR/$name.in" 2>/dev/null |
+       diff -u "$SCRIPT_DIR/$name.out" - > "$name.diff"; then
+        echo "[+] $name"
+    else
+        echo "[-] $name"
+        cat "$name.diff"
+        fail=1
+    fi
+done
+
+exit $fail
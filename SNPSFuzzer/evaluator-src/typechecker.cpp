@@ -1,4 +1,5 @@
 # include "typechecker.h"
+# include <algorithm>
 
 TypeChecker::TypeChecker(Spec spec)
 {
@@ -75,11 +76,11 @@ std::pair<bool, std::pair<std::string, std::string>> TypeChecker::TypeCheck(ASTN
         case AST_ID:
         {
             // Check if the identifier is in the type context
-            if (TypeContext.find(node->id_name) == TypeContext.end()) {
-                std::cerr << "Error: Identifier not found in type context: " << node->id_name << std::endl;
+            if (TypeContext.find(node->id_name()) == TypeContext.end()) {
+                std::cerr << "Error: Identifier not found in type context: " << node->id_name() << std::endl;
                 return FALSE_VALUE;
             }
-            return MAKE_TRIPLE(true, TypeContext[node->id_name].first, TypeContext[node->id_name].second);
+            return MAKE_TRIPLE(true, TypeContext[node->id_name()].first, TypeContext[node->id_name()].second);
         }    // break;
         case AST_INT:
         {
@@ -92,8 +93,8 @@ std::pair<bool, std::pair<std::string, std::string>> TypeChecker::TypeCheck(ASTN
         case AST_AND:
         case AST_OR:
         case AST_S:{            
-            std::pair<bool, std::pair<std::string, std::string>> leftType = TypeCheck(node->binary_left);
-            std::pair<bool, std::pair<std::string, std::string>> rightType = TypeCheck(node->binary_right);
+            std::pair<bool, std::pair<std::string, std::string>> leftType = TypeCheck(node->binary_left());
+            std::pair<bool, std::pair<std::string, std::string>> rightType = TypeCheck(node->binary_right());
             if (!leftType.first || !rightType.first) {
                 return FALSE_VALUE;
             }
@@ -102,8 +103,8 @@ std::pair<bool, std::pair<std::string, std::string>> TypeChecker::TypeCheck(ASTN
         case AST_EQ:
         case AST_NEQ:
         {
-            std::pair<bool, std::pair<std::string, std::string>> leftType = TypeCheck(node->binary_left);
-            std::pair<bool, std::pair<std::string, std::string>> rightType = TypeCheck(node->binary_right);
+            std::pair<bool, std::pair<std::string, std::string>> leftType = TypeCheck(node->binary_left());
+            std::pair<bool, std::pair<std::string, std::string>> rightType = TypeCheck(node->binary_right());
             if (!leftType.first || !rightType.first) {
                 return FALSE_VALUE;
             }
@@ -116,8 +117,8 @@ std::pair<bool, std::pair<std::string, std::string>> TypeChecker::TypeCheck(ASTN
         case AST_LT:
         case AST_LTE:
         {
-            std::pair<bool, std::pair<std::string, std::string>> leftType = TypeCheck(node->binary_left);
-            std::pair<bool, std::pair<std::string, std::string>> rightType = TypeCheck(node->binary_right);
+            std::pair<bool, std::pair<std::string, std::string>> leftType = TypeCheck(node->binary_left());
+            std::pair<bool, std::pair<std::string, std::string>> rightType = TypeCheck(node->binary_right());
             if (!leftType.first || !rightType.first) {
                 return FALSE_VALUE;
             }
@@ -129,7 +130,30 @@ std::pair<bool, std::pair<std::string, std::string>> TypeChecker::TypeCheck(ASTN
         case AST_O:
         case AST_Y:
         {
-            std::pair<bool, std::pair<std::string, std::string>> leftType = TypeCheck(node->unary_child);
+            std::pair<bool, std::pair<std::string, std::string>> leftType = TypeCheck(node->unary_child());
+            if (!leftType.first) {
+                return FALSE_VALUE;
+            }
+            return MAKE_TRIPLE(true, "", ""); 
+        }
+        case AST_O_BOUNDED:
+        case AST_H_BOUNDED:
+        case AST_Y_BOUNDED:
+        {
+            const ASTWindow& w = node->window();
+            if (w.lo < 0 || w.hi < w.lo) {
+                std::cerr << "Error: Invalid window bounds [" << w.lo << "," << w.hi << "]" << std::endl;
+                return FALSE_VALUE;
+            }
+            if (w.clock >= 0) {
+                const std::string& clock = ast_arena.symbol(w.clock);
+                auto it = TypeContext.find(clock);
+                if (it == TypeContext.end() || it->second.first != "INT") {
+                    std::cerr << "Error: Window clock must be an int variable: " << clock << std::endl;
+                    return FALSE_VALUE;
+                }
+            }
+            std::pair<bool, std::pair<std::string, std::string>> leftType = TypeCheck(node->unary_child());
             if (!leftType.first) {
                 return FALSE_VALUE;
             }
@@ -152,4 +176,34 @@ std::pair<std::string,std::string> TypeChecker::getType(std::string variable_nam
         assert(0);
         return std::make_pair("", "");
     }
-}
\ No newline at end of file
+}
+
+bool TypeChecker::CheckGuard(ASTNode* node)
+{
+    // Guards judge a single event, so only state formulas are allowed
+    switch (node->kind)
+    {
+        case AST_O:
+        case AST_H:
+        case AST_S:
+        case AST_Y:
+        case AST_O_BOUNDED:
+        case AST_H_BOUNDED:
+        case AST_Y_BOUNDED:
+            std::cerr << "Error: Temporal operator in guard: " << ASTPrinter::printStuff(node) << std::endl;
+            return false;
+        case AST_NOT:
+            return CheckGuard(node->unary_child());
+        case AST_ARROW:
+        case AST_AND:
+        case AST_OR:
+            return CheckGuard(node->binary_left()) && CheckGuard(node->binary_right());
+        default:
+            return TypeCheck(node).first;
+    }
+}
+
+bool TypeChecker::IsConstant(const std::string& name) const
+{
+    return std::find(constant_list.begin(), constant_list.end(), name) != constant_list.end();
+}
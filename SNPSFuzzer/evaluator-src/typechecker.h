@@ -19,6 +19,8 @@ class TypeChecker {
 public: 
     TypeChecker(Spec spec);
     std::pair<std::string,std::string> getType(std::string variable_name);    
+    bool CheckGuard(ASTNode* node);
+    bool IsConstant(const std::string& name) const;
     std::vector<std::string> constant_list ;
 private: 
    
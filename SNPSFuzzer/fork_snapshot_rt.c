@@ -0,0 +1,481 @@
+/*
+   SNPSFuzzer - fork snapshot runtime
+   ----------------------------------
+
+   Preloaded into the target by afl-fuzz when AFL_FORK_SNAPSHOT is set, as
+   a fork()-speed alternative to CRIU for single-process servers.
+
+   After replaying the M1 prefix, afl-fuzz sends FORK_SNAPSHOT_SIG. The
+   thread serving the connection notices it the next time it reads from a
+   socket (the signal interrupts a blocked read) and, instead of reading,
+   parks the process as a snapshot server on FORK_SNAPSHOT_FD:
+
+     - FORK_SNAPSHOT_FORK: fork() a child that resumes the interrupted read.
+       For TCP the child's connection descriptor is replaced by a fresh
+       loopback connection whose client end goes back to afl-fuzz over
+       SCM_RIGHTS, so every child sees the connection exactly as M1 left
+       it. UDP sockets are shared, queued datagrams are dropped first;
+     - reply with the child's PID, then with its wait status once it exits;
+     - anything else, or afl-fuzz going away: exit.
+
+   Reads are recognised in read(), recv(), recvfrom(), recvmsg(), poll()
+   and select(); a server waiting in epoll_wait() is not parked.
+
+*/
+
+#define _GNU_SOURCE
+
+#include "config.h"
+#include "types.h"
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#define SNAP_MAX_FD 1024
+
+static u8 snap_active;
+
+static volatile sig_atomic_t snap_pending;
+static volatile pid_t io_tid;           /* thread last seen reading a socket */
+static __thread pid_t my_tid;
+
+static u8  fd_dgram[SNAP_MAX_FD];       /* UDP sockets                       */
+static u8  fd_conn[SNAP_MAX_FD];        /* accepted stream connections       */
+static s32 last_conn = -1;
+
+static int     (*real_socket)(int, int, int);
+static int     (*real_accept)(int, struct sockaddr*, socklen_t*);
+static int     (*real_accept4)(int, struct sockaddr*, socklen_t*, int);
+static int     (*real_close)(int);
+static ssize_t (*real_read)(int, void*, size_t);
+static ssize_t (*real_recv)(int, void*, size_t, int);
+static ssize_t (*real_recvfrom)(int, void*, size_t, int, struct sockaddr*, socklen_t*);
+static ssize_t (*real_recvmsg)(int, struct msghdr*, int);
+static int     (*real_poll)(struct pollfd*, nfds_t, int);
+static int     (*real_select)(int, fd_set*, fd_set*, fd_set*, struct timeval*);
+
+static void* resolve(void** slot, const char* name) {
+
+  if (!*slot) *slot = dlsym(RTLD_NEXT, name);
+  return *slot;
+
+}
+
+#define REAL(name) \
+  ((__typeof__(real_##name))resolve((void**)&real_##name, #name))
+
+static u8 tracked(s32 fd) {
+
+  return fd >= 0 && fd < SNAP_MAX_FD && (fd_dgram[fd] || fd_conn[fd]);
+
+}
+
+/* Runs in whichever thread the kernel picked; hand it on to the one
+   blocked on the connection so that its read returns EINTR. */
+
+static void snap_signal(int sig) {
+
+  pid_t tid = io_tid;
+
+  snap_pending = 1;
+  if (tid && tid != syscall(SYS_gettid)) syscall(SYS_tgkill, getpid(), tid, sig);
+
+}
+
+/* ---------- snapshot server ---------- */
+
+/* Loopback TCP connection of the same family as conn. */
+
+static s32 make_pair(s32 conn, s32* srv, s32* cli) {
+
+  struct sockaddr_storage a;
+  socklen_t len = sizeof(a);
+  s32 l;
+
+  if (getsockname(conn, (struct sockaddr*)&a, &len)) return -1;
+
+  if (a.ss_family == AF_INET6) {
+    struct sockaddr_in6* a6 = (struct sockaddr_in6*)&a;
+    memset(a6, 0, sizeof(*a6));
+    a6->sin6_family = AF_INET6;
+    a6->sin6_addr   = in6addr_loopback;
+    len = sizeof(*a6);
+  } else {
+    struct sockaddr_in* a4 = (struct sockaddr_in*)&a;
+    memset(a4, 0, sizeof(*a4));
+    a4->sin_family      = AF_INET;
+    a4->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    len = sizeof(*a4);
+  }
+
+  l = REAL(socket)(a.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (l < 0) return -1;
+
+  if (bind(l, (struct sockaddr*)&a, len) || listen(l, 1) ||
+      getsockname(l, (struct sockaddr*)&a, &len)) {
+    REAL(close)(l);
+    return -1;
+  }
+
+  *cli = REAL(socket)(a.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (*cli < 0 || connect(*cli, (struct sockaddr*)&a, len)) {
+    if (*cli >= 0) REAL(close)(*cli);
+    REAL(close)(l);
+    return -1;
+  }
+
+  *srv = REAL(accept4)(l, NULL, NULL, SOCK_CLOEXEC);
+  REAL(close)(l);
+
+  if (*srv < 0) {
+    REAL(close)(*cli);
+    return -1;
+  }
+
+  return 0;
+
+}
+
+static void send_u32(u32 val, s32 fd) {
+
+  struct msghdr msg;
+  struct iovec iov = { &val, sizeof(val) };
+  char cbuf[CMSG_SPACE(sizeof(s32))];
+
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov    = &iov;
+  msg.msg_iovlen = 1;
+
+  if (fd >= 0) {
+
+    struct cmsghdr* c;
+
+    msg.msg_control    = cbuf;
+    msg.msg_controllen = sizeof(cbuf);
+
+    c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type  = SCM_RIGHTS;
+    c->cmsg_len   = CMSG_LEN(sizeof(s32));
+    memcpy(CMSG_DATA(c), &fd, sizeof(s32));
+
+  }
+
+  if (sendmsg(FORK_SNAPSHOT_FD, &msg, MSG_NOSIGNAL) != sizeof(val)) _exit(0);
+
+}
+
+static void drain_dgram(void) {
+
+  char buf[512];
+  s32 fd;
+
+  for (fd = 0; fd < SNAP_MAX_FD; fd++)
+    if (fd_dgram[fd])
+      while (REAL(recv)(fd, buf, sizeof(buf), MSG_DONTWAIT) >= 0);
+
+}
+
+/* Park here; returns only in a forked child, which then redoes the read
+   it was about to make on fd. */
+
+static void snap_serve(s32 fd) {
+
+  sigset_t all, old;
+  s32 conn = fd >= 0 && fd < SNAP_MAX_FD && fd_conn[fd] ? fd : last_conn;
+  u32 cmd;
+
+  snap_pending = 0;
+
+  /* None of the target's handlers (SIGCHLD reapers in particular) may run
+     in the server. */
+
+  sigfillset(&all);
+  pthread_sigmask(SIG_BLOCK, &all, &old);
+
+  send_u32(FORK_SNAPSHOT_READY, -1);
+
+  for (;;) {
+
+    s32 srv = -1, cli = -1, status;
+    pid_t pid;
+
+    if (REAL(recv)(FORK_SNAPSHOT_FD, &cmd, sizeof(cmd), 0) != sizeof(cmd) ||
+        cmd != FORK_SNAPSHOT_FORK)
+      _exit(0);
+
+    drain_dgram();
+
+    if (conn >= 0 && make_pair(conn, &srv, &cli)) {
+      send_u32(0, -1);
+      continue;
+    }
+
+    pid = fork();
+
+    if (pid < 0) {
+      if (srv >= 0) { REAL(close)(srv); REAL(close)(cli); }
+      send_u32(0, -1);
+      continue;
+    }
+
+    if (!pid) {
+
+      if (srv >= 0) {
+        s32 fl = fcntl(conn, F_GETFL);
+        dup2(srv, conn);
+        fcntl(conn, F_SETFL, fl);
+        REAL(close)(srv);
+        REAL(close)(cli);
+      }
+
+      REAL(close)(FORK_SNAPSHOT_FD);
+      snap_active = 0;
+      pthread_sigmask(SIG_SETMASK, &old, NULL);
+      return;
+
+    }
+
+    send_u32(pid, cli);
+
+    if (srv >= 0) {
+      REAL(close)(srv);
+      REAL(close)(cli);
+    }
+
+    while (waitpid(pid, &status, 0) < 0)
+      if (errno != EINTR) _exit(0);
+
+    send_u32(status, -1);
+
+  }
+
+}
+
+/* Called around every read-like call on fd (-1: unknown / several). */
+
+static void snap_enter(s32 fd) {
+
+  if (!snap_active || !tracked(fd)) return;
+
+  if (!my_tid) my_tid = syscall(SYS_gettid);
+  io_tid = my_tid;
+  if (snap_pending) snap_serve(fd);
+
+}
+
+/* After the call: 1 if it was cut short by the snapshot signal and has to
+   be repeated (now in a forked child). */
+
+static u8 snap_retry(s64 ret, s32 fd) {
+
+  if (ret >= 0 || errno != EINTR || !snap_active || !snap_pending ||
+      !tracked(fd))
+    return 0;
+
+  snap_serve(fd);
+  return 1;
+
+}
+
+/* ---------- socket bookkeeping ---------- */
+
+int socket(int domain, int type, int protocol) {
+
+  int fd = REAL(socket)(domain, type, protocol);
+
+  if (fd >= 0 && fd < SNAP_MAX_FD)
+    fd_dgram[fd] = (domain == AF_INET || domain == AF_INET6) &&
+                   (type & 0xff) == SOCK_DGRAM;
+
+  return fd;
+
+}
+
+static int track_conn(int fd) {
+
+  if (fd >= 0 && fd < SNAP_MAX_FD) {
+    fd_conn[fd]  = 1;
+    fd_dgram[fd] = 0;
+    last_conn    = fd;
+  }
+
+  return fd;
+
+}
+
+int accept(int fd, struct sockaddr* addr, socklen_t* len) {
+
+  return track_conn(REAL(accept)(fd, addr, len));
+
+}
+
+int accept4(int fd, struct sockaddr* addr, socklen_t* len, int flags) {
+
+  return track_conn(REAL(accept4)(fd, addr, len, flags));
+
+}
+
+int close(int fd) {
+
+  if (fd >= 0 && fd < SNAP_MAX_FD) {
+    fd_dgram[fd] = fd_conn[fd] = 0;
+    if (fd == last_conn) last_conn = -1;
+  }
+
+  return REAL(close)(fd);
+
+}
+
+/* ---------- read-like calls ---------- */
+
+ssize_t read(int fd, void* buf, size_t len) {
+
+  ssize_t r;
+
+  do {
+    snap_enter(fd);
+    r = REAL(read)(fd, buf, len);
+  } while (snap_retry(r, fd));
+
+  return r;
+
+}
+
+ssize_t recv(int fd, void* buf, size_t len, int flags) {
+
+  ssize_t r;
+
+  do {
+    snap_enter(fd);
+    r = REAL(recv)(fd, buf, len, flags);
+  } while (snap_retry(r, fd));
+
+  return r;
+
+}
+
+ssize_t recvfrom(int fd, void* buf, size_t len, int flags,
+                 struct sockaddr* addr, socklen_t* alen) {
+
+  ssize_t r;
+
+  do {
+    snap_enter(fd);
+    r = REAL(recvfrom)(fd, buf, len, flags, addr, alen);
+  } while (snap_retry(r, fd));
+
+  return r;
+
+}
+
+ssize_t recvmsg(int fd, struct msghdr* msg, int flags) {
+
+  ssize_t r;
+
+  do {
+    snap_enter(fd);
+    r = REAL(recvmsg)(fd, msg, flags);
+  } while (snap_retry(r, fd));
+
+  return r;
+
+}
+
+/* First tracked socket a poll() / select() waits on, -1 if none. */
+
+static s32 poll_fd(struct pollfd* fds, nfds_t n) {
+
+  nfds_t i;
+
+  for (i = 0; i < n; i++)
+    if ((fds[i].events & POLLIN) && tracked(fds[i].fd)) return fds[i].fd;
+
+  return -1;
+
+}
+
+static s32 select_fd(int n, fd_set* rd) {
+
+  s32 fd;
+
+  if (!rd) return -1;
+
+  for (fd = 0; fd < n && fd < FD_SETSIZE; fd++)
+    if (FD_ISSET(fd, rd) && tracked(fd)) return fd;
+
+  return -1;
+
+}
+
+int poll(struct pollfd* fds, nfds_t n, int timeout) {
+
+  s32 fd = snap_active ? poll_fd(fds, n) : -1;
+  int r;
+
+  do {
+    snap_enter(fd);
+    r = REAL(poll)(fds, n, timeout);
+  } while (snap_retry(r, fd));
+
+  return r;
+
+}
+
+int select(int n, fd_set* rd, fd_set* wr, fd_set* ex, struct timeval* tv) {
+
+  s32 fd = snap_active ? select_fd(n, rd) : -1;
+  fd_set rd0, wr0, ex0;
+  int r;
+
+  /* select() clobbers its sets even when interrupted. */
+
+  if (rd) rd0 = *rd;
+  if (wr) wr0 = *wr;
+  if (ex) ex0 = *ex;
+
+  for (;;) {
+
+    snap_enter(fd);
+    r = REAL(select)(n, rd, wr, ex, tv);
+    if (!snap_retry(r, fd)) break;
+
+    if (rd) *rd = rd0;
+    if (wr) *wr = wr0;
+    if (ex) *ex = ex0;
+
+  }
+
+  return r;
+
+}
+
+__attribute__((constructor)) static void snap_init(void) {
+
+  struct sigaction sa;
+
+  if (!getenv("AFL_FORK_SNAPSHOT") || fcntl(FORK_SNAPSHOT_FD, F_GETFD) < 0)
+    return;
+
+  /* No SA_RESTART: the read the signal interrupts is where we park. */
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = snap_signal;
+  sigemptyset(&sa.sa_mask);
+  sigaction(FORK_SNAPSHOT_SIG, &sa, NULL);
+
+  snap_active = 1;
+
+}
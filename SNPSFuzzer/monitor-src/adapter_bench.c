@@ -0,0 +1,512 @@
+// adapter_bench.c
+// Throughput and differential-correctness harness for the predicate adapters.
+//
+// Usage:
+//   ./adapter_bench [-n iters] [-a adapter] [-r] <file|dir> ...
+//
+// Every regular file under the given paths is one session:
+//   - trace files (lines "msg_id=N dir=C2S|S2C trace=<hex>", as written by
+//     the adapters and found in test_trace.txt or monitor logs) give
+//     messages with their direction;
+//   - anything else is a raw seed (profuzzbench in-* directories,
+//     testcases/), split into messages with each adapter's response framing
+//     and fed once as requests and once as responses.
+//
+// Each adapter replays the whole corpus -n times through its text builders
+// and, when it has them, its record builders, and messages/s and bytes/s
+// are reported per path. The first pass is also a differential check: the
+// text line of every message must start with the rendering of the record
+// built for the same message, i.e. both paths agree on every predicate.
+// The first mismatch is printed and the exit status is 1.
+//
+// Before that, the response framer is checked on its own: a few fixed
+// replies, and every raw seed, are fed in two windows split at each byte
+// position in turn and must come out as the same messages as when fed in
+// one.
+//
+// Every message lives in its own allocation, so a sanitizer build
+// (make bench_adapters) catches an adapter reading past a message's end.
+
+#include "predicate_adapter.h"
+#include "pred_trace.h"
+#include "ssh_predicate_adapter.h"
+#include "rtsp_predicate_adapter.h"
+#include "ftp_predicate_adapter.h"
+#include "dtls_predicate_adapter.h"
+#include "sip_predicate_adapter.h"
+#include "dnsmasq_predicate_adapter.h"
+#include "dnsmasq_pred_spec.h"
+#include "smtp_predicate_adapter.h"
+#include "smtp_pred_spec.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define BENCH_LINE_MAX 32768
+
+static const struct bench_adapter {
+    const predicate_adapter_t *ad;
+    const pred_schema_t *schema;    // typed adapters only
+} adapters[] = {
+    { &ssh_predicate_adapter,     NULL },
+    { &rtsp_predicate_adapter,    NULL },
+    { &ftp_predicate_adapter,     NULL },
+    { &dtls_predicate_adapter,    NULL },
+    { &sip_predicate_adapter,     NULL },
+    { &dnsmasq_predicate_adapter, &dnsmasq_pred_schema },
+    { &smtp_predicate_adapter,    &smtp_pred_schema },
+};
+
+typedef struct {
+    unsigned char *data;
+    uint32_t len;
+    bool request;
+} bench_msg_t;
+
+typedef struct {
+    char *path;
+    unsigned char *buf;     // raw file contents
+    size_t len;
+    bool trace;
+    bench_msg_t *msgs;      // trace files: parsed once; raw: per adapter
+    size_t n_msgs;
+    size_t cap_msgs;
+} bench_session_t;
+
+static bench_session_t *sessions;
+static size_t n_sessions, cap_sessions;
+
+static void *xrealloc(void *p, size_t size) {
+    p = realloc(p, size);
+    if (!p) {
+        fprintf(stderr, "ERROR: out of memory\n");
+        exit(2);
+    }
+    return p;
+}
+
+static void add_msg(bench_session_t *s, const unsigned char *data, uint32_t len, bool request) {
+    if (s->n_msgs == s->cap_msgs) {
+        s->cap_msgs = s->cap_msgs ? 2 * s->cap_msgs : 16;
+        s->msgs = xrealloc(s->msgs, s->cap_msgs * sizeof(*s->msgs));
+    }
+    bench_msg_t *m = &s->msgs[s->n_msgs++];
+    m->data = xrealloc(NULL, len ? len : 1);
+    memcpy(m->data, data, len);
+    m->len = len;
+    m->request = request;
+}
+
+static void clear_msgs(bench_session_t *s) {
+    for (size_t i = 0; i < s->n_msgs; i++) free(s->msgs[i].data);
+    s->n_msgs = 0;
+}
+
+// ---------- corpus loading ----------
+static int hex_val(int c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Parse "... dir=C2S trace=<hex>" lines; false if the file has none.
+static bool parse_trace_file(bench_session_t *s) {
+    unsigned char *raw = xrealloc(NULL, s->len / 2 + 1);
+    const char *p = (const char *)s->buf;
+    const char *end = p + s->len;
+
+    while (p < end) {
+        const char *eol = memchr(p, '\n', (size_t)(end - p));
+        if (!eol) eol = end;
+
+        const char *dir = NULL, *hex = NULL;
+        for (const char *q = p; q + 6 <= eol; q++) {
+            if (!dir && memcmp(q, "dir=", 4) == 0) dir = q + 4;
+            if (!hex && memcmp(q, "trace=", 6) == 0) hex = q + 6;
+        }
+
+        if (dir && hex && dir + 3 <= eol) {
+            uint32_t n = 0;
+            while (hex + 1 < eol && hex_val(hex[0]) >= 0 && hex_val(hex[1]) >= 0) {
+                raw[n++] = (unsigned char)(hex_val(hex[0]) << 4 | hex_val(hex[1]));
+                hex += 2;
+            }
+            add_msg(s, raw, n, memcmp(dir, "C2S", 3) == 0);
+        }
+        p = eol + 1;
+    }
+
+    free(raw);
+    return s->n_msgs > 0;
+}
+
+static void add_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "WARNING: cannot open %s\n", path);
+        return;
+    }
+
+    if (n_sessions == cap_sessions) {
+        cap_sessions = cap_sessions ? 2 * cap_sessions : 64;
+        sessions = xrealloc(sessions, cap_sessions * sizeof(*sessions));
+    }
+    bench_session_t *s = &sessions[n_sessions];
+    memset(s, 0, sizeof(*s));
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size <= 0) {
+        fclose(f);
+        return;
+    }
+    s->buf = xrealloc(NULL, (size_t)size);
+    s->len = fread(s->buf, 1, (size_t)size, f);
+    fclose(f);
+
+    s->path = strdup(path);
+    s->trace = parse_trace_file(s);
+    n_sessions++;
+}
+
+static void add_path(const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        fprintf(stderr, "WARNING: cannot stat %s\n", path);
+        return;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        add_file(path);
+        return;
+    }
+
+    DIR *d = opendir(path);
+    if (!d) return;
+
+    struct dirent *e;
+    while ((e = readdir(d))) {
+        if (e->d_name[0] == '.') continue;
+        size_t n = strlen(path) + strlen(e->d_name) + 2;
+        char *child = xrealloc(NULL, n);
+        snprintf(child, n, "%s/%s", path, e->d_name);
+        add_path(child);
+        free(child);
+    }
+    closedir(d);
+}
+
+// Split raw seeds the way the fuzzer would frame this adapter's responses.
+static void frame_raw_sessions(enum pred_framing framing) {
+    pred_stream_t st;
+    pred_stream_init(&st, framing);
+
+    for (size_t i = 0; i < n_sessions; i++) {
+        bench_session_t *s = &sessions[i];
+        if (s->trace) continue;
+        clear_msgs(s);
+
+        const unsigned char *msg;
+        uint32_t msg_len;
+        uint64_t msg_off;
+        size_t first = s->n_msgs;
+
+        pred_stream_reset(&st, 0);
+        pred_stream_feed(&st, s->buf, (uint32_t)s->len);
+        while (pred_stream_next(&st, &msg, &msg_len, &msg_off))
+            add_msg(s, msg, msg_len, true);
+        if (pred_stream_flush(&st, &msg, &msg_len, &msg_off))
+            add_msg(s, msg, msg_len, true);
+
+        // ... and the same messages again in the other direction
+        size_t last = s->n_msgs;
+        for (size_t k = first; k < last; k++)
+            add_msg(s, s->msgs[k].data, s->msgs[k].len, false);
+    }
+
+    pred_stream_free(&st);
+}
+
+// ---------- framing ----------
+typedef struct {
+    unsigned char *buf;     // messages back to back
+    uint32_t len;
+    uint32_t ends[64];      // end offset of each message
+    uint32_t n;
+} framed_t;
+
+// Frame data[0..len) fed as windows data[0..cut) and data[cut..len).
+static void frame_split(enum pred_framing framing, const unsigned char *data,
+                        uint32_t len, uint32_t cut, framed_t *out) {
+    pred_stream_t st;
+    const unsigned char *msg;
+    uint32_t msg_len;
+    uint64_t msg_off;
+
+    pred_stream_init(&st, framing);
+    out->len = out->n = 0;
+
+    for (int w = 0; w < 3; w++) {
+        if (w < 2) {
+            if (w == 0) pred_stream_feed(&st, data, cut);
+            else pred_stream_feed(&st, data + cut, len - cut);
+            while (pred_stream_next(&st, &msg, &msg_len, &msg_off)) {
+                memcpy(out->buf + out->len, msg, msg_len);
+                out->len += msg_len;
+                if (out->n < 64) out->ends[out->n++] = out->len;
+            }
+        } else if (pred_stream_flush(&st, &msg, &msg_len, &msg_off)) {
+            memcpy(out->buf + out->len, msg, msg_len);
+            out->len += msg_len;
+            if (out->n < 64) out->ends[out->n++] = out->len;
+        }
+    }
+
+    pred_stream_free(&st);
+}
+
+// Every split of data must frame like the whole; false on the first that
+// does not. want, if given, is the expected message count.
+static bool split_check_one(const char *what, enum pred_framing framing,
+                            const unsigned char *data, uint32_t len, uint32_t want) {
+    framed_t whole, split;
+    bool ok = true;
+
+    whole.buf = xrealloc(NULL, len + 1);
+    split.buf = xrealloc(NULL, len + 1);
+    frame_split(framing, data, len, len, &whole);
+
+    if (want && whole.n != want) {
+        fprintf(stderr, "FRAMING %s: %u messages, expected %u\n", what, whole.n, want);
+        ok = false;
+    }
+
+    // Long seeds: a few hundred evenly spaced cuts are plenty
+    uint32_t step = len > 512 ? len / 512 : 1;
+    for (uint32_t cut = 1; ok && cut < len; cut += step) {
+        frame_split(framing, data, len, cut, &split);
+        if (split.n != whole.n || split.len != whole.len ||
+            memcmp(split.ends, whole.ends, whole.n * sizeof(whole.ends[0]))) {
+            fprintf(stderr, "FRAMING %s: split at byte %u gives %u messages, whole gives %u\n",
+                    what, cut, split.n, whole.n);
+            ok = false;
+        }
+    }
+
+    free(whole.buf);
+    free(split.buf);
+    return ok;
+}
+
+static bool split_check(void) {
+    static const struct {
+        const char *what;
+        enum pred_framing framing;
+        const char *data;
+        uint32_t msgs;
+    } fixed[] = {
+        { "ftp multi-line", PRED_FRAME_FTP_REPLY,
+          "220-Welcome to\r\n server\r\n220 ready\r\n331 Password required\r\n", 2 },
+        { "rtsp body", PRED_FRAME_TEXT,
+          "RTSP/1.0 200 OK\r\nCSeq: 2\r\nContent-Length: 10\r\n\r\n0123456789"
+          "RTSP/1.0 200 OK\r\nCSeq: 3\r\n\r\n", 2 },
+        { "sip compact", PRED_FRAME_TEXT,
+          "SIP/2.0 100 Trying\r\nl: 0\r\n\r\nSIP/2.0 200 OK\r\nl: 4\r\n\r\nv=0\n", 2 },
+        { "dtls records", PRED_FRAME_DTLS,
+          "\x16\xfe\xfd\0\0\0\0\0\0\0\0\0\x03" "abc"
+          "\x15\xfe\xfd\0\0\0\0\0\0\0\x01\0\x02" "xy", 2 },
+    };
+    bool ok = true;
+
+    for (size_t i = 0; i < sizeof(fixed) / sizeof(fixed[0]); i++) {
+        uint32_t len = fixed[i].framing == PRED_FRAME_DTLS ? 2 * 13 + 3 + 2
+                                                           : (uint32_t)strlen(fixed[i].data);
+        ok &= split_check_one(fixed[i].what, fixed[i].framing,
+                              (const unsigned char *)fixed[i].data, len, fixed[i].msgs);
+    }
+
+    static const enum pred_framing framings[] = {
+        PRED_FRAME_DTLS, PRED_FRAME_TEXT, PRED_FRAME_FTP_REPLY
+    };
+    for (size_t f = 0; f < sizeof(framings) / sizeof(framings[0]); f++)
+        for (size_t i = 0; i < n_sessions; i++)
+            if (!sessions[i].trace && sessions[i].len < PRED_STREAM_MAX_MSG)
+                ok &= split_check_one(sessions[i].path, framings[f], sessions[i].buf,
+                                      (uint32_t)sessions[i].len, 0);
+
+    return ok;
+}
+
+// ---------- replay ----------
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Both paths over every message, comparing their output; false on mismatch.
+static bool diff_check(const struct bench_adapter *b) {
+    const predicate_adapter_t *ad = b->ad;
+    void *text_ctx = ad->create();
+    void *rec_ctx = ad->create();
+    static char line[BENCH_LINE_MAX], rendered[BENCH_LINE_MAX];
+    bool ok = true;
+
+    for (size_t i = 0; i < n_sessions && ok; i++) {
+        bench_session_t *s = &sessions[i];
+        ad->reset(text_ctx);
+        ad->reset(rec_ctx);
+
+        for (size_t k = 0; k < s->n_msgs; k++) {
+            bench_msg_t *m = &s->msgs[k];
+            pred_record_t rec;
+
+            line[0] = '\0';
+            if (m->request) {
+                ad->build_request(text_ctx, m->data, m->len, line, sizeof(line));
+                ad->build_request_record(rec_ctx, m->data, m->len, &rec);
+            } else {
+                ad->build_response(text_ctx, m->data, m->len, line, sizeof(line));
+                ad->build_response_record(rec_ctx, m->data, m->len, &rec);
+            }
+
+            size_t n = pred_record_format(&rec, b->schema, rendered, sizeof(rendered));
+            if (rec.spec_hash != b->schema->spec_hash || strncmp(line, rendered, n) != 0 ||
+                (line[n] != '\0' && line[n] != ' ')) {
+                fprintf(stderr, "MISMATCH %s: %s message %zu (%s, %u bytes)\n"
+                                "  text:   %s\n  record: %s\n",
+                        ad->name, s->path, k, m->request ? "C2S" : "S2C", m->len, line, rendered);
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    ad->destroy(text_ctx);
+    ad->destroy(rec_ctx);
+    return ok;
+}
+
+static void report(const char *name, const char *path, size_t msgs, size_t bytes, double secs) {
+    if (secs <= 0) secs = 1e-9;
+    printf("%-8s %-6s %10zu msgs %12zu bytes %12.0f msgs/s %9.2f MB/s\n",
+           name, path, msgs, bytes, msgs / secs, bytes / secs / 1e6);
+}
+
+static void bench(const struct bench_adapter *b, int iters) {
+    const predicate_adapter_t *ad = b->ad;
+    void *ctx = ad->create();
+    static char line[BENCH_LINE_MAX];
+    size_t msgs = 0, bytes = 0;
+
+    double t0 = now_sec();
+    for (int it = 0; it < iters; it++) {
+        for (size_t i = 0; i < n_sessions; i++) {
+            bench_session_t *s = &sessions[i];
+            ad->reset(ctx);
+            for (size_t k = 0; k < s->n_msgs; k++) {
+                bench_msg_t *m = &s->msgs[k];
+                line[0] = '\0';
+                if (m->request) ad->build_request(ctx, m->data, m->len, line, sizeof(line));
+                else ad->build_response(ctx, m->data, m->len, line, sizeof(line));
+                bytes += m->len;
+            }
+            msgs += s->n_msgs;
+        }
+    }
+    report(ad->name, "text", msgs, bytes, now_sec() - t0);
+
+    if (ad->build_request_record) {
+        pred_record_t rec;
+        msgs = bytes = 0;
+        t0 = now_sec();
+        for (int it = 0; it < iters; it++) {
+            for (size_t i = 0; i < n_sessions; i++) {
+                bench_session_t *s = &sessions[i];
+                ad->reset(ctx);
+                for (size_t k = 0; k < s->n_msgs; k++) {
+                    bench_msg_t *m = &s->msgs[k];
+                    if (m->request) ad->build_request_record(ctx, m->data, m->len, &rec);
+                    else ad->build_response_record(ctx, m->data, m->len, &rec);
+                    bytes += m->len;
+                }
+                msgs += s->n_msgs;
+            }
+        }
+        report(ad->name, "record", msgs, bytes, now_sec() - t0);
+    }
+
+    ad->destroy(ctx);
+}
+
+// ---------- main ----------
+int main(int argc, char **argv) {
+    int iters = 1;
+    const char *only = NULL;
+    int first_path = argc;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iters = atoi(argv[++i]);
+            if (iters < 1) iters = 1;
+        } else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+            only = argv[++i];
+        } else if (strcmp(argv[i], "-r") == 0) {
+            pred_trace_set_mode(PRED_TRACE_REF);
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            fprintf(stderr,
+                "Usage: %s [-n iters] [-a adapter] [-r] <file|dir> ...\n"
+                "\n"
+                "Replays message corpora through every predicate adapter, checks\n"
+                "the record builders against the text builders and reports\n"
+                "throughput per adapter and path.\n"
+                "\n"
+                "  -n iters     Replay the corpus this many times (default 1)\n"
+                "  -a adapter   Only this adapter (ssh, rtsp, ftp, dtls, sip, dnsmasq, smtp)\n"
+                "  -r           Text lines without the hex trace (LTL_TRACE_REF mode)\n",
+                argv[0]);
+            return 0;
+        } else {
+            first_path = i;
+            break;
+        }
+    }
+
+    for (int i = first_path; i < argc; i++) add_path(argv[i]);
+    if (!n_sessions) {
+        fprintf(stderr, "ERROR: no corpus files (try --help)\n");
+        return 1;
+    }
+
+    size_t traces = 0;
+    for (size_t i = 0; i < n_sessions; i++) traces += sessions[i].trace;
+    fprintf(stderr, "=== Adapter bench: %zu sessions (%zu traces, %zu raw seeds), %d iteration%s ===\n",
+            n_sessions, traces, n_sessions - traces, iters, iters == 1 ? "" : "s");
+
+    int rc = split_check() ? 0 : 1;
+    for (size_t a = 0; a < sizeof(adapters) / sizeof(adapters[0]); a++) {
+        const struct bench_adapter *b = &adapters[a];
+        if (only && strcmp(only, b->ad->name) != 0) continue;
+
+        frame_raw_sessions(b->ad->response_framing);
+        if (b->schema && !diff_check(b)) rc = 1;
+        bench(b, iters);
+    }
+
+    for (size_t i = 0; i < n_sessions; i++) {
+        clear_msgs(&sessions[i]);
+        free(sessions[i].msgs);
+        free(sessions[i].buf);
+        free(sessions[i].path);
+    }
+    free(sessions);
+    return rc;
+}
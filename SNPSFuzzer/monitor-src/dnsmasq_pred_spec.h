@@ -0,0 +1,195 @@
+// dnsmasq_pred_spec.h - generated by ltl_predgen from monitor-bin/dnsmasq.ltl
+// Do not edit; regenerate when the spec changes.
+#ifndef DNSMASQ_PRED_SPEC_H
+#define DNSMASQ_PRED_SPEC_H
+
+#include "pred_record.h"
+
+#define DNSMASQ_PRED_SPEC_HASH 0xefbe364eu
+
+enum {
+    DNSMASQ_VAR_message_type = 0,
+    DNSMASQ_VAR_opcode = 1,
+    DNSMASQ_VAR_rcode = 2,
+    DNSMASQ_VAR_qtype = 3,
+    DNSMASQ_VAR_is_query = 4,
+    DNSMASQ_VAR_is_response = 5,
+    DNSMASQ_VAR_aa = 6,
+    DNSMASQ_VAR_tc = 7,
+    DNSMASQ_VAR_rd = 8,
+    DNSMASQ_VAR_ra = 9,
+    DNSMASQ_VAR_ad = 10,
+    DNSMASQ_VAR_cd = 11,
+    DNSMASQ_VAR_qdcount = 12,
+    DNSMASQ_VAR_ancount = 13,
+    DNSMASQ_VAR_nscount = 14,
+    DNSMASQ_VAR_arcount = 15,
+    DNSMASQ_VAR_response_valid = 16,
+    DNSMASQ_VAR_dnssec_ok = 17,
+    DNSMASQ_VAR_query_id = 18,
+    DNSMASQ_VAR_id_match = 19,
+    DNSMASQ_VAR_cache_hit = 20,
+    DNSMASQ_VAR_upstream_queried = 21,
+    DNSMASQ_PRED_NVARS
+};
+
+/* enum message_type */
+enum {
+    DNSMASQ_message_type_messageNotSet = 0,
+    DNSMASQ_message_type_query = 1,
+    DNSMASQ_message_type_response = 2
+};
+
+/* enum opcode */
+enum {
+    DNSMASQ_opcode_QUERY = 0,
+    DNSMASQ_opcode_IQUERY = 1,
+    DNSMASQ_opcode_STATUS = 2,
+    DNSMASQ_opcode_OPCODE_UNKNOWN = 3
+};
+
+/* enum rcode */
+enum {
+    DNSMASQ_rcode_NOERROR = 0,
+    DNSMASQ_rcode_FORMERR = 1,
+    DNSMASQ_rcode_SERVFAIL = 2,
+    DNSMASQ_rcode_NXDOMAIN = 3,
+    DNSMASQ_rcode_NOTIMP = 4,
+    DNSMASQ_rcode_REFUSED = 5,
+    DNSMASQ_rcode_RCODE_UNKNOWN = 6
+};
+
+/* enum qtype */
+enum {
+    DNSMASQ_qtype_A = 0,
+    DNSMASQ_qtype_AAAA = 1,
+    DNSMASQ_qtype_MX = 2,
+    DNSMASQ_qtype_NS = 3,
+    DNSMASQ_qtype_CNAME = 4,
+    DNSMASQ_qtype_PTR = 5,
+    DNSMASQ_qtype_SOA = 6,
+    DNSMASQ_qtype_TXT = 7,
+    DNSMASQ_qtype_ANY = 8,
+    DNSMASQ_qtype_QTYPE_UNKNOWN = 9
+};
+
+static const char *const dnsmasq_pred_var_names[] = {
+    "message_type",
+    "opcode",
+    "rcode",
+    "qtype",
+    "is_query",
+    "is_response",
+    "aa",
+    "tc",
+    "rd",
+    "ra",
+    "ad",
+    "cd",
+    "qdcount",
+    "ancount",
+    "nscount",
+    "arcount",
+    "response_valid",
+    "dnssec_ok",
+    "query_id",
+    "id_match",
+    "cache_hit",
+    "upstream_queried",
+};
+
+static const uint8_t dnsmasq_pred_var_kinds[] = {
+    PRED_KIND_ENUM,
+    PRED_KIND_ENUM,
+    PRED_KIND_ENUM,
+    PRED_KIND_ENUM,
+    PRED_KIND_BOOL,
+    PRED_KIND_BOOL,
+    PRED_KIND_BOOL,
+    PRED_KIND_BOOL,
+    PRED_KIND_BOOL,
+    PRED_KIND_BOOL,
+    PRED_KIND_BOOL,
+    PRED_KIND_BOOL,
+    PRED_KIND_INT,
+    PRED_KIND_INT,
+    PRED_KIND_INT,
+    PRED_KIND_INT,
+    PRED_KIND_BOOL,
+    PRED_KIND_BOOL,
+    PRED_KIND_INT,
+    PRED_KIND_BOOL,
+    PRED_KIND_BOOL,
+    PRED_KIND_BOOL,
+};
+
+static const char *const dnsmasq_pred_message_type_values[] = {
+    "messageNotSet",
+    "query",
+    "response",
+};
+
+static const char *const dnsmasq_pred_opcode_values[] = {
+    "QUERY",
+    "IQUERY",
+    "STATUS",
+    "OPCODE_UNKNOWN",
+};
+
+static const char *const dnsmasq_pred_rcode_values[] = {
+    "NOERROR",
+    "FORMERR",
+    "SERVFAIL",
+    "NXDOMAIN",
+    "NOTIMP",
+    "REFUSED",
+    "RCODE_UNKNOWN",
+};
+
+static const char *const dnsmasq_pred_qtype_values[] = {
+    "A",
+    "AAAA",
+    "MX",
+    "NS",
+    "CNAME",
+    "PTR",
+    "SOA",
+    "TXT",
+    "ANY",
+    "QTYPE_UNKNOWN",
+};
+
+static const char *const *const dnsmasq_pred_enum_values[] = {
+    dnsmasq_pred_message_type_values,
+    dnsmasq_pred_opcode_values,
+    dnsmasq_pred_rcode_values,
+    dnsmasq_pred_qtype_values,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+};
+
+static const pred_schema_t dnsmasq_pred_schema = {
+    DNSMASQ_PRED_SPEC_HASH,
+    DNSMASQ_PRED_NVARS,
+    dnsmasq_pred_var_names,
+    dnsmasq_pred_var_kinds,
+    dnsmasq_pred_enum_values,
+};
+
+#endif /* DNSMASQ_PRED_SPEC_H */
@@ -9,10 +9,13 @@
 // FIX: Trust the network layer direction, not the packet bytes.
 
 #include "dnsmasq_predicate_adapter.h"
+#include "dnsmasq_pred_spec.h"
 
 #include <string.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
 
 /* --- DNS Constants (from RFC 1035) --- */
 
@@ -45,30 +48,81 @@
 #define DNS_FLAG_AD     0x0020
 #define DNS_FLAG_CD     0x0010
 
-/* --- Static per-session state --- */
+/* --- Per-session state --- */
+
+/* Outstanding queries live in a fixed-capacity ring (oldest at head) with
+ * an open-addressing index keyed by (query_id, qtype), so tracking,
+ * matching and eviction are all O(1) whatever the history size. */
 
 typedef struct {
     uint16_t query_id;
     uint16_t qtype;
-    bool valid;
-    uint64_t timestamp;
+    uint64_t timestamp;             // CLOCK_MONOTONIC, ms
 } query_record_t;
 
-#define MAX_TRACKED_QUERIES 256
+typedef struct {
+    uint32_t key;                   // query_id << 16 | qtype
+    uint32_t live;                  // tracked queries with this key, 0 = empty
+} query_slot_t;
+
+static size_t   g_query_capacity   = DNSMASQ_DEFAULT_QUERY_CAPACITY;
+static uint64_t g_query_max_age_ms = 0;
+
+struct dnsmasq_adapter_ctx {
+    query_record_t *queries;        // ring of `capacity` records
+    size_t capacity;
+    size_t head;
+    size_t query_count;
+    query_slot_t *index;            // power of two, >= 2 x capacity
+    size_t index_mask;
+    uint64_t max_age_ms;            // 0 = queries never expire
+    size_t cache_hits;
+    size_t upstream_queries;
+};
+
+void dnsmasq_adapter_set_query_limits(size_t capacity, unsigned int max_age_ms)
+{
+    g_query_capacity = capacity ? capacity : DNSMASQ_DEFAULT_QUERY_CAPACITY;
+    g_query_max_age_ms = max_age_ms;
+}
+
+dnsmasq_adapter_ctx_t *dnsmasq_adapter_create(void)
+{
+    dnsmasq_adapter_ctx_t *ctx = calloc(1, sizeof(*ctx));
+    if (!ctx) return NULL;
+
+    size_t index_size = 1;
+    while (index_size < 2 * g_query_capacity) index_size <<= 1;
 
-static query_record_t g_query_history[MAX_TRACKED_QUERIES];
-static size_t g_query_count = 0;
-static bool g_session_initialized = false;
-static size_t g_cache_hits = 0;
-static size_t g_upstream_queries = 0;
+    ctx->capacity = g_query_capacity;
+    ctx->index_mask = index_size - 1;
+    ctx->max_age_ms = g_query_max_age_ms;
+    ctx->queries = malloc(ctx->capacity * sizeof(*ctx->queries));
+    ctx->index = malloc(index_size * sizeof(*ctx->index));
+    if (!ctx->queries || !ctx->index) {
+        dnsmasq_adapter_destroy(ctx);
+        return NULL;
+    }
 
-void dnsmasq_predicate_reset_session(void)
+    dnsmasq_adapter_reset(ctx);
+    return ctx;
+}
+
+void dnsmasq_adapter_reset(dnsmasq_adapter_ctx_t *ctx)
 {
-    memset(g_query_history, 0, sizeof(g_query_history));
-    g_query_count = 0;
-    g_cache_hits = 0;
-    g_upstream_queries = 0;
-    g_session_initialized = true;
+    memset(ctx->index, 0, (ctx->index_mask + 1) * sizeof(*ctx->index));
+    ctx->head = 0;
+    ctx->query_count = 0;
+    ctx->cache_hits = 0;
+    ctx->upstream_queries = 0;
+}
+
+void dnsmasq_adapter_destroy(dnsmasq_adapter_ctx_t *ctx)
+{
+    if (!ctx) return;
+    free(ctx->queries);
+    free(ctx->index);
+    free(ctx);
 }
 
 /* --- Helpers --- */
@@ -138,89 +192,163 @@ static uint16_t dns_parse_first_question(const unsigned char *buf,
     return read_u16_be(&buf[pos]);
 }
 
-static void track_query(uint16_t query_id, uint16_t qtype)
+static uint64_t now_ms(void)
 {
-    if (g_query_count >= MAX_TRACKED_QUERIES) {
-        memmove(&g_query_history[0], &g_query_history[1],
-                sizeof(query_record_t) * (MAX_TRACKED_QUERIES - 1));
-        g_query_count = MAX_TRACKED_QUERIES - 1;
-    }
-    
-    g_query_history[g_query_count].query_id = query_id;
-    g_query_history[g_query_count].qtype = qtype;
-    g_query_history[g_query_count].valid = true;
-    g_query_history[g_query_count].timestamp = 0;
-    g_query_count++;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
 }
 
-static bool find_matching_query(uint16_t query_id, uint16_t response_qtype,
-                                uint16_t *qtype_out)
+static inline uint32_t query_key(uint16_t query_id, uint16_t qtype)
 {
-    for (size_t i = 0; i < g_query_count; i++) {
-        if (g_query_history[i].valid &&
-            g_query_history[i].query_id == query_id &&
-            g_query_history[i].qtype == response_qtype) {
-            if (qtype_out) *qtype_out = g_query_history[i].qtype;
-            return true;
+    return ((uint32_t)query_id << 16) | qtype;
+}
+
+/* Slot holding key, or the empty slot where it would go. */
+static size_t query_slot(const dnsmasq_adapter_ctx_t *ctx, uint32_t key)
+{
+    size_t s = (key * 2654435761u) & ctx->index_mask;
+    while (ctx->index[s].live && ctx->index[s].key != key)
+        s = (s + 1) & ctx->index_mask;
+    return s;
+}
+
+static void index_release(dnsmasq_adapter_ctx_t *ctx, uint32_t key)
+{
+    size_t s = query_slot(ctx, key);
+    if (--ctx->index[s].live) return;
+
+    // Backward-shift deletion keeps probe chains intact without tombstones
+    size_t next = (s + 1) & ctx->index_mask;
+    while (ctx->index[next].live) {
+        size_t home = (ctx->index[next].key * 2654435761u) & ctx->index_mask;
+        if (((next - home) & ctx->index_mask) >= ((next - s) & ctx->index_mask)) {
+            ctx->index[s] = ctx->index[next];
+            ctx->index[next].live = 0;
+            s = next;
         }
+        next = (next + 1) & ctx->index_mask;
     }
-    return false;
 }
 
-static const char *qtype_to_string(uint16_t qtype)
+static void evict_oldest(dnsmasq_adapter_ctx_t *ctx)
+{
+    const query_record_t *q = &ctx->queries[ctx->head];
+    index_release(ctx, query_key(q->query_id, q->qtype));
+    ctx->head = (ctx->head + 1) % ctx->capacity;
+    ctx->query_count--;
+}
+
+/* Drop queries older than max_age_ms; the ring is in send order, so they
+ * are all at the head. */
+static void expire_queries(dnsmasq_adapter_ctx_t *ctx, uint64_t now)
+{
+    if (!ctx->max_age_ms) return;
+    while (ctx->query_count &&
+           now - ctx->queries[ctx->head].timestamp > ctx->max_age_ms) {
+        evict_oldest(ctx);
+    }
+}
+
+static void track_query(dnsmasq_adapter_ctx_t *ctx, uint16_t query_id, uint16_t qtype)
+{
+    // Timestamps only matter when queries expire; spare the clock otherwise
+    uint64_t now = ctx->max_age_ms ? now_ms() : 0;
+
+    expire_queries(ctx, now);
+    if (ctx->query_count == ctx->capacity) evict_oldest(ctx);
+
+    query_record_t *q = &ctx->queries[(ctx->head + ctx->query_count) % ctx->capacity];
+    q->query_id = query_id;
+    q->qtype = qtype;
+    q->timestamp = now;
+    ctx->query_count++;
+
+    uint32_t key = query_key(query_id, qtype);
+    size_t s = query_slot(ctx, key);
+    ctx->index[s].key = key;
+    ctx->index[s].live++;
+}
+
+static bool find_matching_query(dnsmasq_adapter_ctx_t *ctx,
+                                uint16_t query_id, uint16_t response_qtype,
+                                uint16_t *qtype_out)
+{
+    if (ctx->max_age_ms) expire_queries(ctx, now_ms());
+
+    if (!ctx->index[query_slot(ctx, query_key(query_id, response_qtype))].live)
+        return false;
+    if (qtype_out) *qtype_out = response_qtype;
+    return true;
+}
+
+static uint16_t qtype_to_id(uint16_t qtype)
 {
     switch (qtype) {
-        case DNS_QTYPE_A:     return "A";
-        case DNS_QTYPE_AAAA:  return "AAAA";
-        case DNS_QTYPE_MX:    return "MX";
-        case DNS_QTYPE_NS:    return "NS";
-        case DNS_QTYPE_CNAME: return "CNAME";
-        case DNS_QTYPE_PTR:   return "PTR";
-        case DNS_QTYPE_SOA:   return "SOA";
-        case DNS_QTYPE_TXT:   return "TXT";
-        case DNS_QTYPE_ANY:   return "ANY";
-        default:              return "QTYPE_UNKNOWN";
+        case DNS_QTYPE_A:     return DNSMASQ_qtype_A;
+        case DNS_QTYPE_AAAA:  return DNSMASQ_qtype_AAAA;
+        case DNS_QTYPE_MX:    return DNSMASQ_qtype_MX;
+        case DNS_QTYPE_NS:    return DNSMASQ_qtype_NS;
+        case DNS_QTYPE_CNAME: return DNSMASQ_qtype_CNAME;
+        case DNS_QTYPE_PTR:   return DNSMASQ_qtype_PTR;
+        case DNS_QTYPE_SOA:   return DNSMASQ_qtype_SOA;
+        case DNS_QTYPE_TXT:   return DNSMASQ_qtype_TXT;
+        case DNS_QTYPE_ANY:   return DNSMASQ_qtype_ANY;
+        default:              return DNSMASQ_qtype_QTYPE_UNKNOWN;
     }
 }
 
-static const char *opcode_to_string(uint8_t opcode)
+static uint16_t opcode_to_id(uint8_t opcode)
 {
     switch (opcode) {
-        case DNS_OPCODE_QUERY:  return "QUERY";
-        case DNS_OPCODE_IQUERY: return "IQUERY";
-        case DNS_OPCODE_STATUS: return "STATUS";
-        default:                return "OPCODE_UNKNOWN";
+        case DNS_OPCODE_QUERY:  return DNSMASQ_opcode_QUERY;
+        case DNS_OPCODE_IQUERY: return DNSMASQ_opcode_IQUERY;
+        case DNS_OPCODE_STATUS: return DNSMASQ_opcode_STATUS;
+        default:                return DNSMASQ_opcode_OPCODE_UNKNOWN;
     }
 }
 
-static const char *rcode_to_string(uint8_t rcode)
+static uint16_t rcode_to_id(uint8_t rcode)
 {
     switch (rcode) {
-        case DNS_RCODE_NOERROR:  return "NOERROR";
-        case DNS_RCODE_FORMERR:  return "FORMERR";
-        case DNS_RCODE_SERVFAIL: return "SERVFAIL";
-        case DNS_RCODE_NXDOMAIN: return "NXDOMAIN";
-        case DNS_RCODE_NOTIMP:   return "NOTIMP";
-        case DNS_RCODE_REFUSED:  return "REFUSED";
-        default:                 return "RCODE_UNKNOWN";
+        case DNS_RCODE_NOERROR:  return DNSMASQ_rcode_NOERROR;
+        case DNS_RCODE_FORMERR:  return DNSMASQ_rcode_FORMERR;
+        case DNS_RCODE_SERVFAIL: return DNSMASQ_rcode_SERVFAIL;
+        case DNS_RCODE_NXDOMAIN: return DNSMASQ_rcode_NXDOMAIN;
+        case DNS_RCODE_NOTIMP:   return DNSMASQ_rcode_NOTIMP;
+        case DNS_RCODE_REFUSED:  return DNSMASQ_rcode_REFUSED;
+        default:                 return DNSMASQ_rcode_RCODE_UNKNOWN;
     }
 }
 
 /* --- Default error output for all error paths --- */
 
-static void output_default_error(char *out, size_t out_sz,
+static void output_default_error(pred_record_t *rec,
                                  bool force_query, bool force_response)
 {
-    snprintf(out, out_sz,
-             "message_type=messageNotSet opcode=OPCODE_UNKNOWN rcode=RCODE_UNKNOWN qtype=QTYPE_UNKNOWN "
-             "is_query=%s is_response=%s "
-             "aa=false tc=false rd=false ra=false ad=false cd=false "
-             "qdcount=-1 ancount=-1 nscount=-1 arcount=-1 "
-             "response_valid=false dnssec_ok=false "
-             "query_id=-1 id_match=false "
-             "cache_hit=false upstream_queried=false",
-             force_query ? "true" : "false",
-             force_response ? "true" : "false");
+    pred_begin(rec, DNSMASQ_PRED_SPEC_HASH);
+    pred_set_enum(rec, DNSMASQ_VAR_message_type, DNSMASQ_message_type_messageNotSet);
+    pred_set_enum(rec, DNSMASQ_VAR_opcode, DNSMASQ_opcode_OPCODE_UNKNOWN);
+    pred_set_enum(rec, DNSMASQ_VAR_rcode, DNSMASQ_rcode_RCODE_UNKNOWN);
+    pred_set_enum(rec, DNSMASQ_VAR_qtype, DNSMASQ_qtype_QTYPE_UNKNOWN);
+    pred_set_bool(rec, DNSMASQ_VAR_is_query, force_query);
+    pred_set_bool(rec, DNSMASQ_VAR_is_response, force_response);
+    pred_set_bool(rec, DNSMASQ_VAR_aa, false);
+    pred_set_bool(rec, DNSMASQ_VAR_tc, false);
+    pred_set_bool(rec, DNSMASQ_VAR_rd, false);
+    pred_set_bool(rec, DNSMASQ_VAR_ra, false);
+    pred_set_bool(rec, DNSMASQ_VAR_ad, false);
+    pred_set_bool(rec, DNSMASQ_VAR_cd, false);
+    pred_set_int(rec, DNSMASQ_VAR_qdcount, -1);
+    pred_set_int(rec, DNSMASQ_VAR_ancount, -1);
+    pred_set_int(rec, DNSMASQ_VAR_nscount, -1);
+    pred_set_int(rec, DNSMASQ_VAR_arcount, -1);
+    pred_set_bool(rec, DNSMASQ_VAR_response_valid, false);
+    pred_set_bool(rec, DNSMASQ_VAR_dnssec_ok, false);
+    pred_set_int(rec, DNSMASQ_VAR_query_id, -1);
+    pred_set_bool(rec, DNSMASQ_VAR_id_match, false);
+    pred_set_bool(rec, DNSMASQ_VAR_cache_hit, false);
+    pred_set_bool(rec, DNSMASQ_VAR_upstream_queried, false);
 }
 
 /* --- Internal: shared parsing + predicate assembly --- */
@@ -230,22 +358,18 @@ typedef enum {
     DNS_DIR_S2C   /* Response: dnsmasq -> client */
 } dns_direction_t;
 
-static void dnsmasq_build_pred_line_internal(const unsigned char *buf,
-                                             unsigned int len,
-                                             char *out,
-                                             size_t out_sz,
-                                             dns_direction_t direction)
+static void dnsmasq_build_record_internal(dnsmasq_adapter_ctx_t *ctx,
+                                          const unsigned char *buf,
+                                          unsigned int len,
+                                          pred_record_t *rec,
+                                          dns_direction_t direction)
 {
-    if (!g_session_initialized) {
-        dnsmasq_predicate_reset_session();
-    }
-    
     bool is_query    = (direction == DNS_DIR_C2S);
     bool is_response = (direction == DNS_DIR_S2C);
     
     /* Error paths */
-    if (!buf || len < 12 || !out || out_sz == 0) {
-        output_default_error(out, out_sz, is_query, is_response);
+    if (!buf || len < 12) {
+        output_default_error(rec, is_query, is_response);
         return;
     }
     
@@ -253,7 +377,7 @@ static void dnsmasq_build_pred_line_internal(const unsigned char *buf,
     uint16_t qdcount = 0, ancount = 0, nscount = 0, arcount = 0;
     
     if (!dns_parse_header(buf, len, &id, &flags, &qdcount, &ancount, &nscount, &arcount)) {
-        output_default_error(out, out_sz, is_query, is_response);
+        output_default_error(rec, is_query, is_response);
         return;
     }
     
@@ -269,7 +393,8 @@ static void dnsmasq_build_pred_line_internal(const unsigned char *buf,
     
     /* Direction comes from the network layer, NOT the QR bit.
      * Fuzzed packets can have QR=1 in a C2S query. */
-    const char *msg_type = is_query ? "query" : "response";
+    uint16_t msg_type = is_query ? DNSMASQ_message_type_query
+                                 : DNSMASQ_message_type_response;
     
     /* Parse first question to get QTYPE */
     uint16_t qtype = dns_parse_first_question(buf, len, qdcount);
@@ -281,18 +406,18 @@ static void dnsmasq_build_pred_line_internal(const unsigned char *buf,
     
     if (is_query) {
         /* C2S: this is a query, track it */
-        track_query(id, qtype);
+        track_query(ctx, id, qtype);
         upstream_queried = true;
-        g_upstream_queries++;
+        ctx->upstream_queries++;
     } else {
         /* S2C: this is a response, match against tracked queries */
         uint16_t matching_qtype = 0;
-        id_match = find_matching_query(id, qtype, &matching_qtype);
+        id_match = find_matching_query(ctx, id, qtype, &matching_qtype);
         
         if (id_match && ancount > 0 && rcode == DNS_RCODE_NOERROR) {
             if ((id % 3) == 0) {
                 cache_hit = true;
-                g_cache_hits++;
+                ctx->cache_hits++;
             } else {
                 upstream_queried = true;
             }
@@ -304,79 +429,109 @@ static void dnsmasq_build_pred_line_internal(const unsigned char *buf,
     
     bool dnssec_ok = ad;
     
-    /* Build predicate line */
-    snprintf(out, out_sz,
-             "message_type=%s opcode=%s rcode=%s qtype=%s "
-             "is_query=%s is_response=%s "
-             "aa=%s tc=%s rd=%s ra=%s ad=%s cd=%s "
-             "qdcount=%u ancount=%u nscount=%u arcount=%u "
-             "response_valid=%s dnssec_ok=%s "
-             "query_id=%u id_match=%s "
-             "cache_hit=%s upstream_queried=%s",
-             msg_type,
-             opcode_to_string(opcode),
-             rcode_to_string(rcode),
-             qtype_to_string(qtype),
-             is_query ? "true" : "false",
-             is_response ? "true" : "false",
-             aa ? "true" : "false",
-             tc ? "true" : "false",
-             rd ? "true" : "false",
-             ra ? "true" : "false",
-             ad ? "true" : "false",
-             cd ? "true" : "false",
-             qdcount,
-             ancount,
-             nscount,
-             arcount,
-             response_valid ? "true" : "false",
-             dnssec_ok ? "true" : "false",
-             id,
-             id_match ? "true" : "false",
-             cache_hit ? "true" : "false",
-             upstream_queried ? "true" : "false");
+    /* Build predicate record */
+    pred_begin(rec, DNSMASQ_PRED_SPEC_HASH);
+    pred_set_enum(rec, DNSMASQ_VAR_message_type, msg_type);
+    pred_set_enum(rec, DNSMASQ_VAR_opcode, opcode_to_id(opcode));
+    pred_set_enum(rec, DNSMASQ_VAR_rcode, rcode_to_id(rcode));
+    pred_set_enum(rec, DNSMASQ_VAR_qtype, qtype_to_id(qtype));
+    pred_set_bool(rec, DNSMASQ_VAR_is_query, is_query);
+    pred_set_bool(rec, DNSMASQ_VAR_is_response, is_response);
+    pred_set_bool(rec, DNSMASQ_VAR_aa, aa);
+    pred_set_bool(rec, DNSMASQ_VAR_tc, tc);
+    pred_set_bool(rec, DNSMASQ_VAR_rd, rd);
+    pred_set_bool(rec, DNSMASQ_VAR_ra, ra);
+    pred_set_bool(rec, DNSMASQ_VAR_ad, ad);
+    pred_set_bool(rec, DNSMASQ_VAR_cd, cd);
+    pred_set_int(rec, DNSMASQ_VAR_qdcount, qdcount);
+    pred_set_int(rec, DNSMASQ_VAR_ancount, ancount);
+    pred_set_int(rec, DNSMASQ_VAR_nscount, nscount);
+    pred_set_int(rec, DNSMASQ_VAR_arcount, arcount);
+    pred_set_bool(rec, DNSMASQ_VAR_response_valid, response_valid);
+    pred_set_bool(rec, DNSMASQ_VAR_dnssec_ok, dnssec_ok);
+    pred_set_int(rec, DNSMASQ_VAR_query_id, id);
+    pred_set_bool(rec, DNSMASQ_VAR_id_match, id_match);
+    pred_set_bool(rec, DNSMASQ_VAR_cache_hit, cache_hit);
+    pred_set_bool(rec, DNSMASQ_VAR_upstream_queried, upstream_queried);
+}
+
+/* Text form of a record, for callers that still speak k=v lines */
+static void dnsmasq_build_pred_line_internal(dnsmasq_adapter_ctx_t *ctx,
+                                             const unsigned char *buf,
+                                             unsigned int len,
+                                             char *out,
+                                             size_t out_sz,
+                                             dns_direction_t direction)
+{
+    if (!out || out_sz == 0) return;
+
+    pred_record_t rec;
+    dnsmasq_build_record_internal(ctx, buf, len, &rec, direction);
+    pred_record_format(&rec, &dnsmasq_pred_schema, out, out_sz);
 }
 
 /* --- Public API --- */
 
-void dnsmasq_build_request_pred_line(const unsigned char *buf,
+void dnsmasq_build_request_pred_line(dnsmasq_adapter_ctx_t *ctx,
+                                     const unsigned char *buf,
                                      unsigned int len,
                                      char *out,
                                      size_t out_sz)
 {
-    dnsmasq_build_pred_line_internal(buf, len, out, out_sz, DNS_DIR_C2S);
+    dnsmasq_build_pred_line_internal(ctx, buf, len, out, out_sz, DNS_DIR_C2S);
 }
 
-void dnsmasq_build_response_pred_line(const unsigned char *buf,
+void dnsmasq_build_response_pred_line(dnsmasq_adapter_ctx_t *ctx,
+                                      const unsigned char *buf,
                                       unsigned int len,
                                       char *out,
                                       size_t out_sz)
 {
-    dnsmasq_build_pred_line_internal(buf, len, out, out_sz, DNS_DIR_S2C);
+    dnsmasq_build_pred_line_internal(ctx, buf, len, out, out_sz, DNS_DIR_S2C);
+}
+
+void dnsmasq_build_request_record(dnsmasq_adapter_ctx_t *ctx,
+                                  const unsigned char *buf,
+                                  unsigned int len,
+                                  pred_record_t *rec)
+{
+    dnsmasq_build_record_internal(ctx, buf, len, rec, DNS_DIR_C2S);
+}
+
+void dnsmasq_build_response_record(dnsmasq_adapter_ctx_t *ctx,
+                                   const unsigned char *buf,
+                                   unsigned int len,
+                                   pred_record_t *rec)
+{
+    dnsmasq_build_record_internal(ctx, buf, len, rec, DNS_DIR_S2C);
 }
 
 /* Backward-compatible wrapper — DEPRECATED */
-void dnsmasq_build_pred_line(const unsigned char *buf,
+void dnsmasq_build_pred_line(dnsmasq_adapter_ctx_t *ctx,
+                              const unsigned char *buf,
                               unsigned int len,
                               char *out,
                               size_t out_sz)
 {
-    if (!g_session_initialized) {
-        dnsmasq_predicate_reset_session();
-    }
-    
     /* Try to guess direction from QR bit (old behavior, unreliable on fuzzed data) */
     if (buf && len >= 12) {
         uint16_t flags = read_u16_be(&buf[2]);
         bool qr = (flags & DNS_FLAG_QR) != 0;
         if (qr) {
-            dnsmasq_build_pred_line_internal(buf, len, out, out_sz, DNS_DIR_S2C);
+            dnsmasq_build_pred_line_internal(ctx, buf, len, out, out_sz, DNS_DIR_S2C);
         } else {
-            dnsmasq_build_pred_line_internal(buf, len, out, out_sz, DNS_DIR_C2S);
+            dnsmasq_build_pred_line_internal(ctx, buf, len, out, out_sz, DNS_DIR_C2S);
         }
         return;
     }
     
     /* Fallback: unknown direction — default to C2S (safer for H() rules) */
-    dnsmasq_build_pred_line_internal(buf, len, out, out_sz, DNS_DIR_C2S);
+    dnsmasq_build_pred_line_internal(ctx, buf, len, out, out_sz, DNS_DIR_C2S);
 }
+
+PREDICATE_ADAPTER_DEFINE_TYPED(dnsmasq, dnsmasq_adapter_ctx_t,
+                               dnsmasq_build_request_pred_line,
+                               dnsmasq_build_response_pred_line,
+                               dnsmasq_build_request_record,
+                               dnsmasq_build_response_record,
+                               PRED_FRAME_NONE);
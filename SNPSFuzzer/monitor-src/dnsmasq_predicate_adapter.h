@@ -6,6 +6,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "predicate_adapter.h"
+
 /*
  * DNSMASQ predicate adapter for DNS messages -> "k=v ..." lines.
  *
@@ -18,6 +20,10 @@
  * from the DNS header to guess direction, which fails on fuzzed data where
  * the QR bit may be flipped.
  *
+ * The *_record builders fill a pred_record_t with the ids from
+ * dnsmasq_pred_spec.h (generated from monitor-bin/dnsmasq.ltl by
+ * ltl_predgen); the *_pred_line builders render the same record as text.
+ *
  * Direction-aware guarantees:
  *   Request builder:  always is_query=true,  is_response=false, message_type=query
  *   Response builder: always is_query=false, is_response=true,  message_type=response
@@ -27,14 +33,28 @@
 extern "C" {
 #endif
 
-/* Reset per-session adapter state (query tracking, cache state, etc.). */
-void dnsmasq_predicate_reset_session(void);
+/* Per-session decoding state (query tracking, cache state, etc.).
+ * One context per concurrently decoded session. */
+typedef struct dnsmasq_adapter_ctx dnsmasq_adapter_ctx_t;
+
+#define DNSMASQ_DEFAULT_QUERY_CAPACITY 256
+
+/* Query-tracking limits for contexts created after the call: at most
+ * `capacity` outstanding queries (the oldest is evicted first), each one
+ * matchable by a response for `max_age_ms` after it was sent (0 = no
+ * expiry). capacity 0 restores the default. */
+void dnsmasq_adapter_set_query_limits(size_t capacity, unsigned int max_age_ms);
+
+dnsmasq_adapter_ctx_t *dnsmasq_adapter_create(void);
+void dnsmasq_adapter_reset(dnsmasq_adapter_ctx_t *ctx);
+void dnsmasq_adapter_destroy(dnsmasq_adapter_ctx_t *ctx);
 
 /* Build predicate line for a C2S DNS query.
  * Always sets is_query=true, is_response=false, message_type=query
  * regardless of the QR bit in the packet.
  */
-void dnsmasq_build_request_pred_line(const unsigned char *buf,
+void dnsmasq_build_request_pred_line(dnsmasq_adapter_ctx_t *ctx,
+                                     const unsigned char *buf,
                                      unsigned int len,
                                      char *out,
                                      size_t out_sz);
@@ -43,19 +63,34 @@ void dnsmasq_build_request_pred_line(const unsigned char *buf,
  * Always sets is_query=false, is_response=true, message_type=response
  * regardless of the QR bit in the packet.
  */
-void dnsmasq_build_response_pred_line(const unsigned char *buf,
+void dnsmasq_build_response_pred_line(dnsmasq_adapter_ctx_t *ctx,
+                                      const unsigned char *buf,
                                       unsigned int len,
                                       char *out,
                                       size_t out_sz);
 
+/* Typed equivalents of the two builders above. */
+void dnsmasq_build_request_record(dnsmasq_adapter_ctx_t *ctx,
+                                  const unsigned char *buf,
+                                  unsigned int len,
+                                  pred_record_t *rec);
+
+void dnsmasq_build_response_record(dnsmasq_adapter_ctx_t *ctx,
+                                   const unsigned char *buf,
+                                   unsigned int len,
+                                   pred_record_t *rec);
+
 /* DEPRECATED: Generic builder that reads the QR bit to guess direction.
  * Kept for backward compatibility only.
  */
-void dnsmasq_build_pred_line(const unsigned char *buf,
+void dnsmasq_build_pred_line(dnsmasq_adapter_ctx_t *ctx,
+                              const unsigned char *buf,
                               unsigned int len,
                               char *out,
                               size_t out_sz);
 
+extern const predicate_adapter_t dnsmasq_predicate_adapter;
+
 #ifdef __cplusplus
 }
 #endif
@@ -11,10 +11,12 @@
 // ONLY populate the enum for the known direction.
 
 #include "dtls_predicate_adapter.h"
+#include "pred_trace.h"
 
 #include <string.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 /* --- DTLS Constants (from RFC 6347) --- */
 
@@ -39,70 +41,50 @@
 #define DTLS_ALERT_LEVEL_WARNING  1
 #define DTLS_ALERT_LEVEL_FATAL    2
 
-/* --- Static per-session state --- */
+/* --- Per-session state --- */
 
-static bool g_cookie_exchange_done = false;
-static bool g_server_hello_sent = false;
-static bool g_server_hello_done_sent = false;
-static bool g_client_key_exchange_received = false;
-static bool g_client_ccs_received = false;
-static bool g_server_ccs_sent = false;
-static bool g_client_finished_received = false;
-static bool g_server_finished_sent = false;
-static bool g_handshake_complete = false;
-static bool g_cipher_negotiated = false;
-static bool g_certificate_request_sent = false;
-static bool g_session_initialized = false;
+struct dtls_adapter_ctx {
+    bool cookie_exchange_done;
+    bool server_hello_sent;
+    bool server_hello_done_sent;
+    bool client_key_exchange_received;
+    bool client_ccs_received;
+    bool server_ccs_sent;
+    bool client_finished_received;
+    bool server_finished_sent;
+    bool handshake_complete;
+    bool cipher_negotiated;
+    bool certificate_request_sent;
 
-static unsigned int g_msg_id = 0;
+    unsigned int msg_id;
+};
 
-void dtls_predicate_reset_session(void)
+dtls_adapter_ctx_t *dtls_adapter_create(void)
 {
-    g_cookie_exchange_done = false;
-    g_server_hello_sent = false;
-    g_server_hello_done_sent = false;
-    g_client_key_exchange_received = false;
-    g_client_ccs_received = false;
-    g_server_ccs_sent = false;
-    g_client_finished_received = false;
-    g_server_finished_sent = false;
-    g_handshake_complete = false;
-    g_cipher_negotiated = false;
-    g_certificate_request_sent = false;
-    g_session_initialized = true;
-    g_msg_id = 0;
+    dtls_adapter_ctx_t *ctx = calloc(1, sizeof(*ctx));
+    if (ctx) dtls_adapter_reset(ctx);
+    return ctx;
+}
+
+void dtls_adapter_reset(dtls_adapter_ctx_t *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void dtls_adapter_destroy(dtls_adapter_ctx_t *ctx)
+{
+    free(ctx);
 }
 
 /* --- Helper: Append packet trace --- */
-static void append_packet_trace(char *out, size_t out_sz,
+static void append_packet_trace(dtls_adapter_ctx_t *ctx,
+                                char *out, size_t out_sz,
                                 const unsigned char *buf,
                                 unsigned int len,
                                 const char *direction)
 {
-    g_msg_id++;
-    
-    size_t current_len = strlen(out);
-    size_t remaining = out_sz - current_len;
-    
-    if (remaining < 50) return;
-    
-    int written = snprintf(out + current_len, remaining,
-                          " msg_id=%u dir=%s trace=",
-                          g_msg_id, direction);
-    
-    if (written < 0 || (size_t)written >= remaining) return;
-    
-    current_len += written;
-    remaining -= written;
-    
-    unsigned int trace_len = len;
-    if (trace_len > 256) trace_len = 256;
-    
-    for (unsigned int i = 0; i < trace_len && remaining > 2; i++) {
-        snprintf(out + current_len, remaining, "%02x", buf[i]);
-        current_len += 2;
-        remaining -= 2;
-    }
+    ctx->msg_id++;
+    pred_append_packet_trace(out, out_sz, ctx->msg_id, direction, buf, len);
 }
 
 /* --- Helpers --- */
@@ -170,13 +152,14 @@ static uint8_t dtls_parse_handshake_type(const unsigned char *payload,
 /* --- Direction-specific enum mapping --- */
 
 /* Map message type to C2S request enum. Only called for known C2S packets. */
-static const char *dtls_request_enum_for_type(uint8_t content_type,
+static const char *dtls_request_enum_for_type(const dtls_adapter_ctx_t *ctx,
+                                              uint8_t content_type,
                                                uint8_t message_type)
 {
     if (content_type == DTLS_CT_HANDSHAKE) {
         switch (message_type) {
             case DTLS_MT_CLIENT_HELLO:
-                return g_cookie_exchange_done
+                return ctx->cookie_exchange_done
                     ? "c2s_ClientHello_with_cookie"
                     : "c2s_ClientHello";
             case DTLS_MT_CLIENT_KEY_EXCHANGE:
@@ -184,16 +167,16 @@ static const char *dtls_request_enum_for_type(uint8_t content_type,
             case DTLS_MT_CERTIFICATE_VERIFY:
                 return "c2s_CertificateVerify";
             case DTLS_MT_CERTIFICATE:
-                if (g_certificate_request_sent)
+                if (ctx->certificate_request_sent)
                     return "c2s_Certificate";
                 break;
             case DTLS_MT_FINISHED:
-                if (g_client_ccs_received && !g_client_finished_received)
+                if (ctx->client_ccs_received && !ctx->client_finished_received)
                     return "c2s_Finished";
                 break;
         }
     } else if (content_type == DTLS_CT_CHANGE_CIPHER_SPEC) {
-        if (g_client_key_exchange_received && !g_client_ccs_received)
+        if (ctx->client_key_exchange_received && !ctx->client_ccs_received)
             return "c2s_ChangeCipherSpec";
     } else if (content_type == DTLS_CT_ALERT) {
         return "c2s_Alert";
@@ -205,7 +188,8 @@ static const char *dtls_request_enum_for_type(uint8_t content_type,
 }
 
 /* Map message type to S2C response enum. Only called for known S2C packets. */
-static const char *dtls_response_enum_for_type(uint8_t content_type,
+static const char *dtls_response_enum_for_type(const dtls_adapter_ctx_t *ctx,
+                                               uint8_t content_type,
                                                 uint8_t message_type)
 {
     if (content_type == DTLS_CT_HANDSHAKE) {
@@ -223,12 +207,12 @@ static const char *dtls_response_enum_for_type(uint8_t content_type,
             case DTLS_MT_SERVER_HELLO_DONE:
                 return "s2c_ServerHelloDone";
             case DTLS_MT_FINISHED:
-                if (g_server_ccs_sent && !g_server_finished_sent)
+                if (ctx->server_ccs_sent && !ctx->server_finished_sent)
                     return "s2c_Finished";
                 break;
         }
     } else if (content_type == DTLS_CT_CHANGE_CIPHER_SPEC) {
-        if (g_client_finished_received && !g_server_ccs_sent)
+        if (ctx->client_finished_received && !ctx->server_ccs_sent)
             return "s2c_ChangeCipherSpec";
     } else if (content_type == DTLS_CT_ALERT) {
         return "s2c_Alert";
@@ -246,16 +230,13 @@ typedef enum {
     DTLS_DIR_S2C
 } dtls_direction_t;
 
-static void dtls_build_pred_line_internal(const unsigned char *buf,
+static void dtls_build_pred_line_internal(dtls_adapter_ctx_t *ctx,
+                                          const unsigned char *buf,
                                           unsigned int len,
                                           char *out,
                                           size_t out_sz,
                                           dtls_direction_t direction)
 {
-    if (!g_session_initialized) {
-        dtls_predicate_reset_session();
-    }
-    
     const char *dir_str = (direction == DTLS_DIR_C2S) ? "C2S" : "S2C";
     
     /* Error path: unparseable packet */
@@ -269,10 +250,10 @@ static void dtls_build_pred_line_internal(const unsigned char *buf,
                  "record_length=0 fragment_length=0 "
                  "handshake_complete=%s cipher_negotiated=%s "
                  "alert_level=0 alert_description=0",
-                 g_handshake_complete ? "true" : "false",
-                 g_cipher_negotiated ? "true" : "false");
+                 ctx->handshake_complete ? "true" : "false",
+                 ctx->cipher_negotiated ? "true" : "false");
         if (buf && len > 0) {
-            append_packet_trace(out, out_sz, buf, len, dir_str);
+            append_packet_trace(ctx, out, out_sz, buf, len, dir_str);
         }
         return;
     }
@@ -293,9 +274,9 @@ static void dtls_build_pred_line_internal(const unsigned char *buf,
                  "record_length=0 fragment_length=0 "
                  "handshake_complete=%s cipher_negotiated=%s "
                  "alert_level=0 alert_description=0",
-                 g_handshake_complete ? "true" : "false",
-                 g_cipher_negotiated ? "true" : "false");
-        append_packet_trace(out, out_sz, buf, len, dir_str);
+                 ctx->handshake_complete ? "true" : "false",
+                 ctx->cipher_negotiated ? "true" : "false");
+        append_packet_trace(ctx, out, out_sz, buf, len, dir_str);
         return;
     }
     
@@ -389,11 +370,11 @@ static void dtls_build_pred_line_internal(const unsigned char *buf,
     
     if (direction == DTLS_DIR_C2S) {
         /* We KNOW this is C2S. Only set request enum. */
-        req_enum = dtls_request_enum_for_type(content_type, message_type);
+        req_enum = dtls_request_enum_for_type(ctx, content_type, message_type);
         /* resp_enum stays "responseNotSet" — no matter what the bytes look like */
     } else {
         /* We KNOW this is S2C. Only set response enum. */
-        resp_enum = dtls_response_enum_for_type(content_type, message_type);
+        resp_enum = dtls_response_enum_for_type(ctx, content_type, message_type);
         /* req_enum stays "requestNotSet" — no matter what the bytes look like */
     }
     
@@ -405,42 +386,42 @@ static void dtls_build_pred_line_internal(const unsigned char *buf,
                 break;
             case DTLS_MT_HELLO_VERIFY_REQUEST:
                 if (direction == DTLS_DIR_S2C)
-                    g_cookie_exchange_done = true;
+                    ctx->cookie_exchange_done = true;
                 break;
             case DTLS_MT_SERVER_HELLO:
                 if (direction == DTLS_DIR_S2C) {
-                    g_server_hello_sent = true;
-                    g_cipher_negotiated = true;
+                    ctx->server_hello_sent = true;
+                    ctx->cipher_negotiated = true;
                 }
                 break;
             case DTLS_MT_CERTIFICATE_REQUEST:
                 if (direction == DTLS_DIR_S2C)
-                    g_certificate_request_sent = true;
+                    ctx->certificate_request_sent = true;
                 break;
             case DTLS_MT_SERVER_HELLO_DONE:
                 if (direction == DTLS_DIR_S2C)
-                    g_server_hello_done_sent = true;
+                    ctx->server_hello_done_sent = true;
                 break;
             case DTLS_MT_CLIENT_KEY_EXCHANGE:
                 if (direction == DTLS_DIR_C2S)
-                    g_client_key_exchange_received = true;
+                    ctx->client_key_exchange_received = true;
                 break;
             case DTLS_MT_FINISHED:
                 if (direction == DTLS_DIR_C2S) {
-                    g_client_finished_received = true;
+                    ctx->client_finished_received = true;
                 } else {
-                    g_server_finished_sent = true;
+                    ctx->server_finished_sent = true;
                 }
-                if (g_client_finished_received && g_server_finished_sent) {
-                    g_handshake_complete = true;
+                if (ctx->client_finished_received && ctx->server_finished_sent) {
+                    ctx->handshake_complete = true;
                 }
                 break;
         }
     } else if (content_type == DTLS_CT_CHANGE_CIPHER_SPEC) {
         if (direction == DTLS_DIR_C2S) {
-            g_client_ccs_received = true;
+            ctx->client_ccs_received = true;
         } else {
-            g_server_ccs_sent = true;
+            ctx->server_ccs_sent = true;
         }
     }
     
@@ -449,7 +430,7 @@ static void dtls_build_pred_line_internal(const unsigned char *buf,
     bool cookie_valid = false;
     
     if (content_type == DTLS_CT_HANDSHAKE && message_type == DTLS_MT_CLIENT_HELLO) {
-        if (g_cookie_exchange_done) {
+        if (ctx->cookie_exchange_done) {
             cookie_present = true;
             cookie_valid = true;
         }
@@ -489,46 +470,45 @@ static void dtls_build_pred_line_internal(const unsigned char *buf,
              (unsigned long long)sequence,
              record_length,
              fragment_length,
-             g_handshake_complete ? "true" : "false",
-             g_cipher_negotiated ? "true" : "false",
+             ctx->handshake_complete ? "true" : "false",
+             ctx->cipher_negotiated ? "true" : "false",
              alert_level,
              alert_description);
     
-    append_packet_trace(out, out_sz, buf, len, dir_str);
+    append_packet_trace(ctx, out, out_sz, buf, len, dir_str);
 }
 
 /* --- Public API --- */
 
-void dtls_build_request_pred_line(const unsigned char *buf,
+void dtls_build_request_pred_line(dtls_adapter_ctx_t *ctx,
+                                  const unsigned char *buf,
                                   unsigned int len,
                                   char *out,
                                   size_t out_sz)
 {
-    dtls_build_pred_line_internal(buf, len, out, out_sz, DTLS_DIR_C2S);
+    dtls_build_pred_line_internal(ctx, buf, len, out, out_sz, DTLS_DIR_C2S);
 }
 
-void dtls_build_response_pred_line(const unsigned char *buf,
+void dtls_build_response_pred_line(dtls_adapter_ctx_t *ctx,
+                                   const unsigned char *buf,
                                    unsigned int len,
                                    char *out,
                                    size_t out_sz)
 {
-    dtls_build_pred_line_internal(buf, len, out, out_sz, DTLS_DIR_S2C);
+    dtls_build_pred_line_internal(ctx, buf, len, out, out_sz, DTLS_DIR_S2C);
 }
 
 /* Backward-compatible wrapper — DEPRECATED, do not use in new code.
  * Kept so old code that references dtls_build_pred_line still compiles,
  * but it falls back to the old ambiguous behavior. */
-void dtls_build_pred_line(const unsigned char *buf,
+void dtls_build_pred_line(dtls_adapter_ctx_t *ctx,
+                          const unsigned char *buf,
                           unsigned int len,
                           char *out,
                           size_t out_sz)
 {
     /* Best-effort: parse record to guess direction, then delegate.
      * This is the OLD behavior and is only here for link compatibility. */
-    if (!g_session_initialized) {
-        dtls_predicate_reset_session();
-    }
-    
     /* Try to guess direction from content — the exact bug we're fixing,
      * but kept for any callers that haven't been updated yet. */
     if (buf && len >= 13) {
@@ -542,14 +522,14 @@ void dtls_build_pred_line(const unsigned char *buf,
                 case DTLS_MT_CLIENT_HELLO:
                 case DTLS_MT_CLIENT_KEY_EXCHANGE:
                 case DTLS_MT_CERTIFICATE_VERIFY:
-                    dtls_build_pred_line_internal(buf, len, out, out_sz, DTLS_DIR_C2S);
+                    dtls_build_pred_line_internal(ctx, buf, len, out, out_sz, DTLS_DIR_C2S);
                     return;
                 case DTLS_MT_HELLO_VERIFY_REQUEST:
                 case DTLS_MT_SERVER_HELLO:
                 case DTLS_MT_SERVER_KEY_EXCHANGE:
                 case DTLS_MT_SERVER_HELLO_DONE:
                 case DTLS_MT_CERTIFICATE_REQUEST:
-                    dtls_build_pred_line_internal(buf, len, out, out_sz, DTLS_DIR_S2C);
+                    dtls_build_pred_line_internal(ctx, buf, len, out, out_sz, DTLS_DIR_S2C);
                     return;
             }
         }
@@ -557,5 +537,10 @@ void dtls_build_pred_line(const unsigned char *buf,
     
     /* Fallback: unknown direction — use C2S so we don't set any response= values
      * that could trigger false violations on H() rules. */
-    dtls_build_pred_line_internal(buf, len, out, out_sz, DTLS_DIR_C2S);
+    dtls_build_pred_line_internal(ctx, buf, len, out, out_sz, DTLS_DIR_C2S);
 }
+
+PREDICATE_ADAPTER_DEFINE(dtls, dtls_adapter_ctx_t,
+                         dtls_build_request_pred_line,
+                         dtls_build_response_pred_line,
+                         PRED_FRAME_DTLS);
@@ -6,6 +6,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "predicate_adapter.h"
+
 /*
  * DTLS predicate adapter for DTLS records -> "k=v ..." lines.
  *
@@ -32,8 +34,13 @@
 extern "C" {
 #endif
 
-/* Reset per-session adapter state (cookie exchange, handshake state, etc.). */
-void dtls_predicate_reset_session(void);
+/* Per-session decoding state (cookie exchange, handshake state, msg_id, etc.).
+ * One context per concurrently decoded session. */
+typedef struct dtls_adapter_ctx dtls_adapter_ctx_t;
+
+dtls_adapter_ctx_t *dtls_adapter_create(void);
+void dtls_adapter_reset(dtls_adapter_ctx_t *ctx);
+void dtls_adapter_destroy(dtls_adapter_ctx_t *ctx);
 
 /* Build predicate line for a C2S (client-to-server) DTLS record.
  * Always sets response=responseNotSet regardless of packet content.
@@ -44,7 +51,8 @@ void dtls_predicate_reset_session(void);
  *   out:    Output buffer for predicate line
  *   out_sz: Size of output buffer
  */
-void dtls_build_request_pred_line(const unsigned char *buf,
+void dtls_build_request_pred_line(dtls_adapter_ctx_t *ctx,
+                                  const unsigned char *buf,
                                   unsigned int len,
                                   char *out,
                                   size_t out_sz);
@@ -58,7 +66,8 @@ void dtls_build_request_pred_line(const unsigned char *buf,
  *   out:    Output buffer for predicate line
  *   out_sz: Size of output buffer
  */
-void dtls_build_response_pred_line(const unsigned char *buf,
+void dtls_build_response_pred_line(dtls_adapter_ctx_t *ctx,
+                                   const unsigned char *buf,
                                    unsigned int len,
                                    char *out,
                                    size_t out_sz);
@@ -67,11 +76,14 @@ void dtls_build_response_pred_line(const unsigned char *buf,
  * Kept for backward compatibility. New code should use the
  * direction-specific builders above.
  */
-void dtls_build_pred_line(const unsigned char *buf,
+void dtls_build_pred_line(dtls_adapter_ctx_t *ctx,
+                          const unsigned char *buf,
                           unsigned int len,
                           char *out,
                           size_t out_sz);
 
+extern const predicate_adapter_t dtls_predicate_adapter;
+
 #ifdef __cplusplus
 }
 #endif
@@ -5,6 +5,7 @@
 // 3. Command inference from response codes if command missed
 
 #include "ftp_predicate_adapter.h"
+#include "pred_trace.h"
 
 #include <string.h>
 #include <stdio.h>
@@ -15,7 +16,7 @@
 // Session State Tracking
 // ============================================================================
 
-static struct {
+struct ftp_adapter_ctx {
     // Authentication
     bool user_logged_in;
     bool user_sent;
@@ -55,11 +56,26 @@ static struct {
     
     // Last command for state transitions
     char last_command[16];
-} g_ftp_state = { .last_command = "cmdNotSet" };
 
-void ftp_predicate_reset_session(void) {
-    memset(&g_ftp_state, 0, sizeof(g_ftp_state));
-    strcpy(g_ftp_state.last_command, "cmdNotSet");
+    // Trace reference counter, kept across sessions
+    unsigned int msg_id;
+};
+
+ftp_adapter_ctx_t *ftp_adapter_create(void) {
+    ftp_adapter_ctx_t *ctx = calloc(1, sizeof(*ctx));
+    if (ctx) ftp_adapter_reset(ctx);
+    return ctx;
+}
+
+void ftp_adapter_reset(ftp_adapter_ctx_t *ctx) {
+    unsigned int msg_id = ctx->msg_id;
+    memset(ctx, 0, sizeof(*ctx));
+    strcpy(ctx->last_command, "cmdNotSet");
+    ctx->msg_id = msg_id;
+}
+
+void ftp_adapter_destroy(ftp_adapter_ctx_t *ctx) {
+    free(ctx);
 }
 
 // ============================================================================
@@ -81,41 +97,15 @@ static void extract_command(const unsigned char *buf, unsigned int len,
     cmd[i] = '\0';
 }
 
-static unsigned int g_msg_id = 0;
-
 // Helper function
-static void append_packet_trace(char *out, size_t out_sz,
+static void append_packet_trace(ftp_adapter_ctx_t *ctx,
+                                char *out, size_t out_sz,
                                 const unsigned char *buf,
                                 unsigned int len,
                                 const char *direction)
 {
-    g_msg_id++;
-    
-    // Calculate current length
-    size_t current_len = strlen(out);
-    size_t remaining = out_sz - current_len;
-    
-    if (remaining < 50) return;  // Not enough space
-    
-    // Append msg_id and dir
-    int written = snprintf(out + current_len, remaining,
-                          " msg_id=%u dir=%s trace=",
-                          g_msg_id, direction);
-    
-    if (written < 0 || (size_t)written >= remaining) return;
-    
-    current_len += written;
-    remaining -= written;
-    
-    // Append hex trace (truncate if needed)
-    unsigned int trace_len = len;
-    if (trace_len > 256) trace_len = 256;  // Max 512 hex chars
-    
-    for (unsigned int i = 0; i < trace_len && remaining > 2; i++) {
-        snprintf(out + current_len, remaining, "%02x", buf[i]);
-        current_len += 2;
-        remaining -= 2;
-    }
+    ctx->msg_id++;
+    pred_append_packet_trace(out, out_sz, ctx->msg_id, direction, buf, len);
 }
 
 static const char* map_ftp_command(const char *cmd) {
@@ -181,18 +171,18 @@ static const char* map_status_class(int code) {
     return "scNotSet";
 }
 
-static const char* get_auth_state(void) {
-    if (g_ftp_state.user_logged_in) return "authComplete";
-    if (g_ftp_state.login_failed) return "authFailed";
-    if (g_ftp_state.pass_sent) return "authPasswordSent";
-    if (g_ftp_state.user_sent) return "authUserSent";
+static const char* get_auth_state(const ftp_adapter_ctx_t *ctx) {
+    if (ctx->user_logged_in) return "authComplete";
+    if (ctx->login_failed) return "authFailed";
+    if (ctx->pass_sent) return "authPasswordSent";
+    if (ctx->user_sent) return "authUserSent";
     return "authNone";
 }
 
-static const char* get_data_state(void) {
-    if (g_ftp_state.data_connection_open) return "dataActive";
-    if (g_ftp_state.port_sent) return "dataPORT";
-    if (g_ftp_state.pasv_sent) return "dataPASV";
+static const char* get_data_state(const ftp_adapter_ctx_t *ctx) {
+    if (ctx->data_connection_open) return "dataActive";
+    if (ctx->port_sent) return "dataPORT";
+    if (ctx->pasv_sent) return "dataPASV";
     return "dataNotSet";
 }
 
@@ -200,9 +190,7 @@ static bool is_cmd_malformed(const unsigned char *buf, unsigned int len) {
     if (len == 0) return true;
     if (len > 512) return true;
     
-    for (unsigned int i = 0; i < len - 1; i++) {
-        if (buf[i] == '\0') return true;
-    }
+    if (memchr(buf, '\0', len - 1)) return true;
     
     char cmd[16];
     extract_command(buf, len, cmd, sizeof(cmd));
@@ -218,8 +206,8 @@ static bool is_resp_malformed(const unsigned char *buf, unsigned int len) {
 
     while (start < len) {
         // Find end-of-line (LF) or end-of-buffer
-        unsigned int end = start;
-        while (end < len && buf[end] != '\n') end++;
+        const unsigned char *lf = memchr(buf + start, '\n', len - start);
+        unsigned int end = lf ? (unsigned int)(lf - buf) : len;
 
         // Compute line length excluding trailing "\n" and optional "\r"
         unsigned int line_len = end - start;
@@ -257,56 +245,56 @@ static bool is_resp_malformed(const unsigned char *buf, unsigned int len) {
  * This caused false positives on Rule 1 (auth bypass): garbled input → 230
  * → inference says cmdPASS → user_sent=false → violation.
  */
-static void infer_command_from_response(int resp_code) {
+static void infer_command_from_response(ftp_adapter_ctx_t *ctx, int resp_code) {
     // If command is already set from parsing, nothing to do
-    if (strcmp(g_ftp_state.last_command, "cmdNotSet") != 0) {
+    if (strcmp(ctx->last_command, "cmdNotSet") != 0) {
         return;
     }
     
     switch (resp_code) {
         case 220:  // Welcome banner or REIN response
-            if (g_ftp_state.sequence_number == 0) {
+            if (ctx->sequence_number == 0) {
                 // First message = banner, no command to infer
-            } else if (g_ftp_state.reinit_sent) {
-                strcpy(g_ftp_state.last_command, "cmdREIN");
+            } else if (ctx->reinit_sent) {
+                strcpy(ctx->last_command, "cmdREIN");
             }
             break;
         case 331:  // USER response
-            if (g_ftp_state.user_sent) {
-                strcpy(g_ftp_state.last_command, "cmdUSER");
+            if (ctx->user_sent) {
+                strcpy(ctx->last_command, "cmdUSER");
             }
             break;
         case 230:  // PASS success (or anonymous banner)
-            if (g_ftp_state.sequence_number == 0) {
+            if (ctx->sequence_number == 0) {
                 // Some servers send 230 as initial banner for anonymous access
                 // This is NOT a PASS response — leave as cmdNotSet
-            } else if (g_ftp_state.pass_sent) {
-                strcpy(g_ftp_state.last_command, "cmdPASS");
+            } else if (ctx->pass_sent) {
+                strcpy(ctx->last_command, "cmdPASS");
             }
             break;
         case 227:  // PASV response
-            if (g_ftp_state.pasv_sent) {
-                strcpy(g_ftp_state.last_command, "cmdPASV");
+            if (ctx->pasv_sent) {
+                strcpy(ctx->last_command, "cmdPASV");
             }
             break;
         case 350:  // RNFR response
-            if (g_ftp_state.rnfr_sent) {
-                strcpy(g_ftp_state.last_command, "cmdRNFR");
+            if (ctx->rnfr_sent) {
+                strcpy(ctx->last_command, "cmdRNFR");
             }
             break;
         case 221:  // QUIT response
-            if (g_ftp_state.quit_sent) {
-                strcpy(g_ftp_state.last_command, "cmdQUIT");
+            if (ctx->quit_sent) {
+                strcpy(ctx->last_command, "cmdQUIT");
             }
             break;
         case 257:  // PWD response
-            strcpy(g_ftp_state.last_command, "cmdPWD");
+            strcpy(ctx->last_command, "cmdPWD");
             break;
         case 215:  // SYST response
-            strcpy(g_ftp_state.last_command, "cmdSYST");
+            strcpy(ctx->last_command, "cmdSYST");
             break;
         case 211:  // FEAT response
-            strcpy(g_ftp_state.last_command, "cmdFEAT");
+            strcpy(ctx->last_command, "cmdFEAT");
             break;
         // For ambiguous codes (200, 250, 150, 226, etc.), leave as cmdNotSet
         default:
@@ -318,7 +306,8 @@ static void infer_command_from_response(int resp_code) {
 // Public API
 // ============================================================================
 
-void ftp_build_command_pred_line(const unsigned char *buf,
+void ftp_build_command_pred_line(ftp_adapter_ctx_t *ctx,
+                                 const unsigned char *buf,
                                  unsigned int len,
                                  char *out,
                                  size_t out_sz) {
@@ -326,41 +315,41 @@ void ftp_build_command_pred_line(const unsigned char *buf,
     extract_command(buf, len, cmd_str, sizeof(cmd_str));
     const char *cmd_enum = map_ftp_command(cmd_str);
     
-    strncpy(g_ftp_state.last_command, cmd_enum, sizeof(g_ftp_state.last_command) - 1);
+    strncpy(ctx->last_command, cmd_enum, sizeof(ctx->last_command) - 1);
     
     if (strcmp(cmd_enum, "cmdUSER") == 0) {
-        g_ftp_state.user_sent = true;
+        ctx->user_sent = true;
     } else if (strcmp(cmd_enum, "cmdPASS") == 0) {
-        g_ftp_state.pass_sent = true;
+        ctx->pass_sent = true;
     } else if (strcmp(cmd_enum, "cmdPORT") == 0) {
-        g_ftp_state.port_sent = true;
-        g_ftp_state.pasv_sent = false;
+        ctx->port_sent = true;
+        ctx->pasv_sent = false;
     } else if (strcmp(cmd_enum, "cmdPASV") == 0) {
-        g_ftp_state.pasv_sent = true;
-        g_ftp_state.port_sent = false;
+        ctx->pasv_sent = true;
+        ctx->port_sent = false;
     } else if (strcmp(cmd_enum, "cmdRETR") == 0) {
-        g_ftp_state.retr_sent = true;
+        ctx->retr_sent = true;
     } else if (strcmp(cmd_enum, "cmdSTOR") == 0) {
-        g_ftp_state.stor_sent = true;
+        ctx->stor_sent = true;
     } else if (strcmp(cmd_enum, "cmdRNFR") == 0) {
-        g_ftp_state.rnfr_sent = true;
+        ctx->rnfr_sent = true;
     } else if (strcmp(cmd_enum, "cmdRNTO") == 0) {
-        g_ftp_state.rnto_sent = true;
+        ctx->rnto_sent = true;
     } else if (strcmp(cmd_enum, "cmdABOR") == 0) {
-        g_ftp_state.transfer_aborted = true;
-        g_ftp_state.transfer_in_progress = false;
+        ctx->transfer_aborted = true;
+        ctx->transfer_in_progress = false;
     } else if (strcmp(cmd_enum, "cmdQUIT") == 0) {
-        g_ftp_state.quit_sent = true;
+        ctx->quit_sent = true;
     } else if (strcmp(cmd_enum, "cmdREIN") == 0) {
-        g_ftp_state.reinit_sent = true;
+        ctx->reinit_sent = true;
     } else if (strcmp(cmd_enum, "cmdREST") == 0) {
         const char *p = (const char *)buf + strlen(cmd_str);
         skip_ws(&p);
-        g_ftp_state.rest_position = atoi(p);
+        ctx->rest_position = atoi(p);
     }
     
     /* ===== FIX #1: Increment sequence for commands ===== */
-    g_ftp_state.sequence_number++;
+    ctx->sequence_number++;
     
     /* ===== FIX #2: Better timeout detection ===== */
     bool cmd_malformed = is_cmd_malformed(buf, len);
@@ -379,40 +368,41 @@ void ftp_build_command_pred_line(const unsigned char *buf,
              "session_initialized=%s quit_sent=%s reinit_sent=%s "
              "auth_state=%s data_state=%s transfer_type=typeNotSet",
              cmd_enum,
-             g_ftp_state.sequence_number,
-             g_ftp_state.rest_position,
+             ctx->sequence_number,
+             ctx->rest_position,
              cmd_malformed ? "true" : "false",
-             g_ftp_state.user_logged_in ? "true" : "false",
-             g_ftp_state.data_connection_open ? "true" : "false",
-             g_ftp_state.transfer_in_progress ? "true" : "false",
+             ctx->user_logged_in ? "true" : "false",
+             ctx->data_connection_open ? "true" : "false",
+             ctx->transfer_in_progress ? "true" : "false",
              timeout ? "true" : "false",
-             g_ftp_state.connection_closed ? "true" : "false",
-             g_ftp_state.user_sent ? "true" : "false",
-             g_ftp_state.pass_sent ? "true" : "false",
-             g_ftp_state.login_successful ? "true" : "false",
-             g_ftp_state.login_failed ? "true" : "false",
-             g_ftp_state.port_sent ? "true" : "false",
-             g_ftp_state.pasv_sent ? "true" : "false",
-             g_ftp_state.pasv_response_received ? "true" : "false",
-             g_ftp_state.port_accepted ? "true" : "false",
-             g_ftp_state.retr_sent ? "true" : "false",
-             g_ftp_state.stor_sent ? "true" : "false",
-             g_ftp_state.transfer_started ? "true" : "false",
-             g_ftp_state.transfer_complete ? "true" : "false",
-             g_ftp_state.transfer_aborted ? "true" : "false",
-             g_ftp_state.rnfr_sent ? "true" : "false",
-             g_ftp_state.rnfr_accepted ? "true" : "false",
-             g_ftp_state.rnto_sent ? "true" : "false",
-             g_ftp_state.session_initialized ? "true" : "false",
-             g_ftp_state.quit_sent ? "true" : "false",
-             g_ftp_state.reinit_sent ? "true" : "false",
-             get_auth_state(),
-             get_data_state());
+             ctx->connection_closed ? "true" : "false",
+             ctx->user_sent ? "true" : "false",
+             ctx->pass_sent ? "true" : "false",
+             ctx->login_successful ? "true" : "false",
+             ctx->login_failed ? "true" : "false",
+             ctx->port_sent ? "true" : "false",
+             ctx->pasv_sent ? "true" : "false",
+             ctx->pasv_response_received ? "true" : "false",
+             ctx->port_accepted ? "true" : "false",
+             ctx->retr_sent ? "true" : "false",
+             ctx->stor_sent ? "true" : "false",
+             ctx->transfer_started ? "true" : "false",
+             ctx->transfer_complete ? "true" : "false",
+             ctx->transfer_aborted ? "true" : "false",
+             ctx->rnfr_sent ? "true" : "false",
+             ctx->rnfr_accepted ? "true" : "false",
+             ctx->rnto_sent ? "true" : "false",
+             ctx->session_initialized ? "true" : "false",
+             ctx->quit_sent ? "true" : "false",
+             ctx->reinit_sent ? "true" : "false",
+             get_auth_state(ctx),
+             get_data_state(ctx));
     
-    append_packet_trace(out, out_sz, buf, len, "C2S");
+    append_packet_trace(ctx, out, out_sz, buf, len, "C2S");
 }
 
-void ftp_build_response_pred_line(const unsigned char *buf,
+void ftp_build_response_pred_line(ftp_adapter_ctx_t *ctx,
+                                  const unsigned char *buf,
                                   unsigned int len,
                                   char *out,
                                   size_t out_sz) {
@@ -425,40 +415,40 @@ void ftp_build_response_pred_line(const unsigned char *buf,
     bool timeout = (len == 0 || resp_code == 0);
     
     /* ===== FIX #3: Infer command if missed ===== */
-    infer_command_from_response(resp_code);
+    infer_command_from_response(ctx, resp_code);
     
     // Update state based on response
-    if (resp_code == 220 && g_ftp_state.sequence_number == 0) {
-        g_ftp_state.session_initialized = true;
+    if (resp_code == 220 && ctx->sequence_number == 0) {
+        ctx->session_initialized = true;
     } else if (resp_code == 230) {
-        g_ftp_state.user_logged_in = true;
-        g_ftp_state.login_successful = true;
+        ctx->user_logged_in = true;
+        ctx->login_successful = true;
     } else if (resp_code == 530) {
-        g_ftp_state.login_failed = true;
-        g_ftp_state.user_logged_in = false;
-    } else if (resp_code == 200 && strcmp(g_ftp_state.last_command, "cmdPORT") == 0) {
-        g_ftp_state.port_accepted = true;
+        ctx->login_failed = true;
+        ctx->user_logged_in = false;
+    } else if (resp_code == 200 && strcmp(ctx->last_command, "cmdPORT") == 0) {
+        ctx->port_accepted = true;
     } else if (resp_code == 227) {
-        g_ftp_state.pasv_response_received = true;
+        ctx->pasv_response_received = true;
     } else if (resp_code == 150) {
-        g_ftp_state.transfer_started = true;
-        g_ftp_state.transfer_in_progress = true;
-        g_ftp_state.data_connection_open = true;
+        ctx->transfer_started = true;
+        ctx->transfer_in_progress = true;
+        ctx->data_connection_open = true;
     } else if (resp_code == 226) {
-        g_ftp_state.transfer_complete = true;
-        g_ftp_state.transfer_in_progress = false;
-        g_ftp_state.data_connection_open = false;
-    } else if (resp_code == 350 && strcmp(g_ftp_state.last_command, "cmdRNFR") == 0) {
-        g_ftp_state.rnfr_accepted = true;
-    } else if (resp_code == 220 && strcmp(g_ftp_state.last_command, "cmdREIN") == 0) {
-        ftp_predicate_reset_session();
-        g_ftp_state.session_initialized = true;
+        ctx->transfer_complete = true;
+        ctx->transfer_in_progress = false;
+        ctx->data_connection_open = false;
+    } else if (resp_code == 350 && strcmp(ctx->last_command, "cmdRNFR") == 0) {
+        ctx->rnfr_accepted = true;
+    } else if (resp_code == 220 && strcmp(ctx->last_command, "cmdREIN") == 0) {
+        ftp_adapter_reset(ctx);
+        ctx->session_initialized = true;
     } else if (resp_code == 221) {
-        g_ftp_state.connection_closed = true;
+        ctx->connection_closed = true;
     }
     
     /* ===== FIX #1: Increment sequence for responses too ===== */
-    g_ftp_state.sequence_number++;
+    ctx->sequence_number++;
     
     snprintf(out, out_sz,
              "ftp_command=%s ftp_status_class=%s "
@@ -472,38 +462,43 @@ void ftp_build_response_pred_line(const unsigned char *buf,
              "rnfr_sent=%s rnfr_accepted=%s rnto_sent=%s "
              "session_initialized=%s quit_sent=%s reinit_sent=%s "
              "auth_state=%s data_state=%s transfer_type=typeNotSet",
-             g_ftp_state.last_command,
+             ctx->last_command,
              status_class,
              resp_code,
-             g_ftp_state.sequence_number,
-             g_ftp_state.rest_position,
+             ctx->sequence_number,
+             ctx->rest_position,
              resp_malformed ? "true" : "false",
-             g_ftp_state.user_logged_in ? "true" : "false",
-             g_ftp_state.data_connection_open ? "true" : "false",
-             g_ftp_state.transfer_in_progress ? "true" : "false",
+             ctx->user_logged_in ? "true" : "false",
+             ctx->data_connection_open ? "true" : "false",
+             ctx->transfer_in_progress ? "true" : "false",
              timeout ? "true" : "false",
-             g_ftp_state.connection_closed ? "true" : "false",
-             g_ftp_state.user_sent ? "true" : "false",
-             g_ftp_state.pass_sent ? "true" : "false",
-             g_ftp_state.login_successful ? "true" : "false",
-             g_ftp_state.login_failed ? "true" : "false",
-             g_ftp_state.port_sent ? "true" : "false",
-             g_ftp_state.pasv_sent ? "true" : "false",
-             g_ftp_state.pasv_response_received ? "true" : "false",
-             g_ftp_state.port_accepted ? "true" : "false",
-             g_ftp_state.retr_sent ? "true" : "false",
-             g_ftp_state.stor_sent ? "true" : "false",
-             g_ftp_state.transfer_started ? "true" : "false",
-             g_ftp_state.transfer_complete ? "true" : "false",
-             g_ftp_state.transfer_aborted ? "true" : "false",
-             g_ftp_state.rnfr_sent ? "true" : "false",
-             g_ftp_state.rnfr_accepted ? "true" : "false",
-             g_ftp_state.rnto_sent ? "true" : "false",
-             g_ftp_state.session_initialized ? "true" : "false",
-             g_ftp_state.quit_sent ? "true" : "false",
-             g_ftp_state.reinit_sent ? "true" : "false",
-             get_auth_state(),
-             get_data_state());
+             ctx->connection_closed ? "true" : "false",
+             ctx->user_sent ? "true" : "false",
+             ctx->pass_sent ? "true" : "false",
+             ctx->login_successful ? "true" : "false",
+             ctx->login_failed ? "true" : "false",
+             ctx->port_sent ? "true" : "false",
+             ctx->pasv_sent ? "true" : "false",
+             ctx->pasv_response_received ? "true" : "false",
+             ctx->port_accepted ? "true" : "false",
+             ctx->retr_sent ? "true" : "false",
+             ctx->stor_sent ? "true" : "false",
+             ctx->transfer_started ? "true" : "false",
+             ctx->transfer_complete ? "true" : "false",
+             ctx->transfer_aborted ? "true" : "false",
+             ctx->rnfr_sent ? "true" : "false",
+             ctx->rnfr_accepted ? "true" : "false",
+             ctx->rnto_sent ? "true" : "false",
+             ctx->session_initialized ? "true" : "false",
+             ctx->quit_sent ? "true" : "false",
+             ctx->reinit_sent ? "true" : "false",
+             get_auth_state(ctx),
+             get_data_state(ctx));
     
-     append_packet_trace(out, out_sz, buf, len, "S2C");
+     append_packet_trace(ctx, out, out_sz, buf, len, "S2C");
 }
+
+PREDICATE_ADAPTER_DEFINE(ftp, ftp_adapter_ctx_t,
+                         ftp_build_command_pred_line,
+                         ftp_build_response_pred_line,
+                         PRED_FRAME_FTP_REPLY);
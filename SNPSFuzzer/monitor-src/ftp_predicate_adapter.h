@@ -5,37 +5,49 @@
 #include <stddef.h>
 #include <stdbool.h>
 
+#include "predicate_adapter.h"
+
 /*
  * FTP predicate adapter for LightFTP semantic monitoring.
  *
  * Tracks FTP protocol state and generates predicate lines matching
  * the lightftp.txt LTL specification.
  *
- * Usage in aflnet.c extract functions:
+ * Usage:
+ *   - Create one context per decoded session with ftp_adapter_create()
  *   - Call ftp_build_command_pred_line() for client commands
  *   - Call ftp_build_response_pred_line() for server responses
- *   - Call ftp_predicate_reset_session() on new connection
+ *   - Call ftp_adapter_reset() on new connection
  */
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* Per-session FTP state (auth, data connection, transfer, msg_id) */
+typedef struct ftp_adapter_ctx ftp_adapter_ctx_t;
+
+ftp_adapter_ctx_t *ftp_adapter_create(void);
 /* Reset adapter state for a new FTP session */
-void ftp_predicate_reset_session(void);
+void ftp_adapter_reset(ftp_adapter_ctx_t *ctx);
+void ftp_adapter_destroy(ftp_adapter_ctx_t *ctx);
 
 /* Build predicate line from FTP command (client → server) */
-void ftp_build_command_pred_line(const unsigned char *buf,
+void ftp_build_command_pred_line(ftp_adapter_ctx_t *ctx,
+                                 const unsigned char *buf,
                                  unsigned int len,
                                  char *out,
                                  size_t out_sz);
 
 /* Build predicate line from FTP response (server → client) */
-void ftp_build_response_pred_line(const unsigned char *buf,
+void ftp_build_response_pred_line(ftp_adapter_ctx_t *ctx,
+                                  const unsigned char *buf,
                                   unsigned int len,
                                   char *out,
                                   size_t out_sz);
 
+extern const predicate_adapter_t ftp_predicate_adapter;
+
 #ifdef __cplusplus
 }
 #endif
@@ -142,7 +142,12 @@ int main(int argc, char **argv) {
         }
     }
 
-    ftp_predicate_reset_session();
+    ftp_adapter_ctx_t *ctx = ftp_adapter_create();
+    if (!ctx) {
+        fprintf(stderr, "ERROR: Cannot allocate FTP adapter context\n");
+        if (in != stdin) fclose(in);
+        return 1;
+    }
 
     char line_buf[16384];
     int line_no = 0;
@@ -173,9 +178,9 @@ int main(int argc, char **argv) {
         bool is_command = (strcmp(tl.dir, "C2S") == 0);
 
         if (is_command) {
-            ftp_build_command_pred_line(raw, raw_len, pred_line, sizeof(pred_line));
+            ftp_build_command_pred_line(ctx, raw, raw_len, pred_line, sizeof(pred_line));
         } else {
-            ftp_build_response_pred_line(raw, raw_len, pred_line, sizeof(pred_line));
+            ftp_build_response_pred_line(ctx, raw, raw_len, pred_line, sizeof(pred_line));
         }
 
         // Strip trailing metadata (msg_id=, dir=, trace=) that the adapter
@@ -200,6 +205,7 @@ int main(int argc, char **argv) {
 
     fprintf(stderr, "=== Done: %d messages processed ===\n", msg_count);
 
+    ftp_adapter_destroy(ctx);
     if (in != stdin) fclose(in);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,224 @@
+// header_index.c
+#define _GNU_SOURCE
+#include "header_index.h"
+
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+unsigned int hdr_find_eol(const unsigned char *buf, unsigned int len,
+                          unsigned int from)
+{
+    unsigned int i = from;
+
+#if defined(__SSE2__)
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(buf + i));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, cr),
+                                                  _mm_cmpeq_epi8(v, lf)));
+        if (mask) return i + (unsigned int)__builtin_ctz(mask);
+    }
+#endif
+
+    for (; i < len; i++) {
+        if (buf[i] == '\r' || buf[i] == '\n') return i;
+    }
+    return len;
+}
+
+static uint32_t hash_name(const unsigned char *p, size_t n)
+{
+    uint32_t h = 2166136261u;                 // FNV-1a over lowercase bytes
+    for (size_t i = 0; i < n; i++) {
+        h ^= (uint32_t)tolower(p[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static bool entry_matches(const hdr_index_t *ix, const hdr_entry_t *e,
+                          uint32_t hash, const char *name, size_t name_len)
+{
+    return e->hash == hash && e->name_len == name_len &&
+           strncasecmp((const char *)ix->buf + e->name_off, name, name_len) == 0;
+}
+
+/* Name length of the header line [off, eol), or -1 if it has no ':'. */
+static int header_name_len(const unsigned char *buf, unsigned int off, unsigned int eol)
+{
+    const unsigned char *colon = memchr(buf + off, ':', eol - off);
+    return colon ? (int)(colon - (buf + off)) : -1;
+}
+
+void hdr_index_build(hdr_index_t *ix, const unsigned char *buf, unsigned int len)
+{
+    ix->buf = buf;
+    ix->len = buf ? len : 0;
+    ix->nhdrs = 0;
+    ix->rest_off = 0;
+    memset(ix->slots, 0xff, sizeof(ix->slots));
+
+    // Skip the request/status line
+    unsigned int off = hdr_skip_eol(buf, ix->len, hdr_find_eol(buf, ix->len, 0));
+
+    while (off < ix->len) {
+        if (buf[off] == '\r' || buf[off] == '\n') {
+            ix->body_off = hdr_skip_eol(buf, ix->len, off);
+            return;
+        }
+
+        unsigned int eol = hdr_find_eol(buf, ix->len, off);
+        int name_len = header_name_len(buf, off, eol);
+
+        if (name_len >= 0) {
+            if (ix->nhdrs == HDR_INDEX_MAX_HEADERS) {
+                // Table full: later lookups fall back to scanning from here
+                ix->rest_off = off;
+                break;
+            }
+
+            hdr_entry_t *e = &ix->hdrs[ix->nhdrs];
+            e->name_off = off;
+            e->line_end = eol;
+            e->name_len = (uint16_t)name_len;
+            e->last = (int16_t)ix->nhdrs;
+            e->hash = hash_name(buf + off, (size_t)name_len);
+
+            unsigned int s = e->hash & (HDR_INDEX_SLOTS - 1);
+            while (ix->slots[s] >= 0 &&
+                   !entry_matches(ix, &ix->hdrs[ix->slots[s]], e->hash,
+                                  (const char *)buf + off, (size_t)name_len)) {
+                s = (s + 1) & (HDR_INDEX_SLOTS - 1);
+            }
+            if (ix->slots[s] < 0) ix->slots[s] = (int16_t)ix->nhdrs;
+            else ix->hdrs[ix->slots[s]].last = (int16_t)ix->nhdrs;
+
+            ix->nhdrs++;
+        }
+
+        off = hdr_skip_eol(buf, ix->len, eol);
+    }
+
+    ix->body_off = ix->len;
+}
+
+/* Occurrences past a full table: first (or last) match of the remaining
+ * header lines, as an (offset, eol) pair. */
+static bool scan_rest(const hdr_index_t *ix, const char *name, size_t name_len,
+                      bool want_last, unsigned int *off_out, unsigned int *eol_out)
+{
+    bool found = false;
+    unsigned int off = ix->rest_off;
+
+    while (off < ix->len && ix->buf[off] != '\r' && ix->buf[off] != '\n') {
+        unsigned int eol = hdr_find_eol(ix->buf, ix->len, off);
+        if (header_name_len(ix->buf, off, eol) == (int)name_len &&
+            strncasecmp((const char *)ix->buf + off, name, name_len) == 0) {
+            *off_out = off;
+            *eol_out = eol;
+            found = true;
+            if (!want_last) break;
+        }
+        off = hdr_skip_eol(ix->buf, ix->len, eol);
+    }
+    return found;
+}
+
+static int lookup(const hdr_index_t *ix, const char *name)
+{
+    size_t name_len = strlen(name);
+    uint32_t hash = hash_name((const unsigned char *)name, name_len);
+    unsigned int s = hash & (HDR_INDEX_SLOTS - 1);
+
+    while (ix->slots[s] >= 0) {
+        if (entry_matches(ix, &ix->hdrs[ix->slots[s]], hash, name, name_len))
+            return ix->slots[s];
+        s = (s + 1) & (HDR_INDEX_SLOTS - 1);
+    }
+    return -1;
+}
+
+int hdr_index_find(const hdr_index_t *ix, const char *name)
+{
+    return lookup(ix, name);
+}
+
+int hdr_index_find_last(const hdr_index_t *ix, const char *name)
+{
+    int h = lookup(ix, name);
+    return h < 0 ? -1 : ix->hdrs[h].last;
+}
+
+bool hdr_index_has(const hdr_index_t *ix, const char *name)
+{
+    unsigned int off, eol;
+    return lookup(ix, name) >= 0 ||
+           (ix->rest_off && scan_rest(ix, name, strlen(name), false, &off, &eol));
+}
+
+static size_t value_span(const hdr_index_t *ix, unsigned int name_off,
+                         size_t name_len, unsigned int eol, const char **value)
+{
+    unsigned int v = name_off + (unsigned int)name_len + 1;    // past ':'
+    while (v < eol && (ix->buf[v] == ' ' || ix->buf[v] == '\t')) v++;
+    *value = (const char *)ix->buf + v;
+    return eol - v;
+}
+
+size_t hdr_index_value(const hdr_index_t *ix, int h, const char **value)
+{
+    const hdr_entry_t *e = &ix->hdrs[h];
+    return value_span(ix, e->name_off, e->name_len, e->line_end, value);
+}
+
+static bool copy_value(const char *value, size_t n, char *out, size_t out_sz)
+{
+    if (out_sz == 0) return true;
+    if (n > out_sz - 1) n = out_sz - 1;
+    memcpy(out, value, n);
+    out[n] = '\0';
+    return true;
+}
+
+static bool copy_header(const hdr_index_t *ix, const char *name,
+                        bool want_last, char *out, size_t out_sz)
+{
+    const char *value;
+    size_t n;
+    unsigned int off, eol;
+    int h = want_last ? hdr_index_find_last(ix, name) : hdr_index_find(ix, name);
+
+    if (ix->rest_off && (h < 0 || want_last) &&
+        scan_rest(ix, name, strlen(name), want_last, &off, &eol)) {
+        n = value_span(ix, off, strlen(name), eol, &value);
+        return copy_value(value, n, out, out_sz);
+    }
+    if (h < 0) return false;
+
+    n = hdr_index_value(ix, h, &value);
+    return copy_value(value, n, out, out_sz);
+}
+
+bool hdr_index_copy(const hdr_index_t *ix, const char *name,
+                    char *out, size_t out_sz)
+{
+    return copy_header(ix, name, false, out, out_sz);
+}
+
+bool hdr_index_copy_last(const hdr_index_t *ix, const char *name,
+                         char *out, size_t out_sz)
+{
+    return copy_header(ix, name, true, out, out_sz);
+}
+
+bool hdr_contains(const unsigned char *buf, unsigned int len, const char *needle)
+{
+    return buf && memmem(buf, len, needle, strlen(needle)) != NULL;
+}
@@ -0,0 +1,98 @@
+// header_index.h
+#ifndef HEADER_INDEX_H
+#define HEADER_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Single-pass header index for the text-protocol adapters (SIP, RTSP).
+ *
+ * hdr_index_build() walks the message once: it finds line ends with a
+ * vector scan for CR/LF, skips the start line, and records every
+ * "Name: value" line up to the first empty line in a small open-addressing
+ * table keyed by the case-folded name. Every header query for that message
+ * is then a hash probe instead of another scan of the buffer:
+ *
+ *   hdr_index_t ix;
+ *   hdr_index_build(&ix, buf, len);
+ *   if (hdr_index_copy(&ix, "Call-ID", value, sizeof(value))) ...
+ *
+ * A line ends at CR, LF or CRLF. A header's name is everything before the
+ * first ':' on its line and matches case-insensitively; its value starts
+ * after the ':' and any spaces or tabs, and runs to the end of the line.
+ * Nothing is read outside buf[0..len).
+ *
+ * The index keeps a pointer to buf, which must outlive it.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HDR_INDEX_MAX_HEADERS 128
+#define HDR_INDEX_SLOTS       256   /* power of two, > 1.5 x MAX_HEADERS */
+
+typedef struct hdr_entry {
+    uint32_t name_off;       /* start of the line */
+    uint32_t line_end;       /* offset of the line's CR/LF (or len) */
+    uint16_t name_len;
+    int16_t  last;           /* latest header with the same name */
+    uint32_t hash;
+} hdr_entry_t;
+
+typedef struct hdr_index {
+    const unsigned char *buf;
+    unsigned int len;
+    unsigned int body_off;   /* first byte after the empty line, or len */
+    unsigned int rest_off;   /* where indexing stopped if the table filled */
+    uint16_t nhdrs;
+    hdr_entry_t hdrs[HDR_INDEX_MAX_HEADERS];
+    int16_t slots[HDR_INDEX_SLOTS];     /* -1 = empty, else first occurrence */
+} hdr_index_t;
+
+/* Offset of the first CR or LF in buf[from..len), or len. */
+unsigned int hdr_find_eol(const unsigned char *buf, unsigned int len,
+                          unsigned int from);
+
+/* Offset just past the line terminator (CR, LF or CRLF) at eol. */
+static inline unsigned int hdr_skip_eol(const unsigned char *buf,
+                                        unsigned int len,
+                                        unsigned int eol)
+{
+    if (eol < len && buf[eol] == '\r') eol++;
+    if (eol < len && buf[eol] == '\n') eol++;
+    return eol;
+}
+
+void hdr_index_build(hdr_index_t *ix, const unsigned char *buf, unsigned int len);
+
+/* Header id of the first / last occurrence of name among the indexed
+ * headers, or -1. */
+int hdr_index_find(const hdr_index_t *ix, const char *name);
+int hdr_index_find_last(const hdr_index_t *ix, const char *name);
+
+/* Whether the message has a header called name (indexed or not). */
+bool hdr_index_has(const hdr_index_t *ix, const char *name);
+
+/* Value of header id h as a (pointer, length) span into the message. */
+size_t hdr_index_value(const hdr_index_t *ix, int h, const char **value);
+
+/* Copy the value of the first occurrence of name into out (NUL-terminated,
+ * truncated to out_sz). False, with out untouched, if there is none. */
+bool hdr_index_copy(const hdr_index_t *ix, const char *name,
+                    char *out, size_t out_sz);
+
+/* Same, for the last occurrence. */
+bool hdr_index_copy_last(const hdr_index_t *ix, const char *name,
+                         char *out, size_t out_sz);
+
+/* Whether needle occurs anywhere in buf[0..len) (headers or body). */
+bool hdr_contains(const unsigned char *buf, unsigned int len, const char *needle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HEADER_INDEX_H */
@@ -6,10 +6,23 @@
 #include <string.h>
 #include <unistd.h>
 #include <sys/wait.h>
-#include <sys/select.h>  // NEW: for select()
+#include <sys/ipc.h>
+#include <sys/shm.h>
 #include <errno.h>
 #include <signal.h>
 
+static void monitor_release_coverage(monitor_handle_t *h)
+{
+    if (h->cov_bits) {
+        shmdt(h->cov_bits);
+        h->cov_bits = NULL;
+    }
+    if (h->cov_shm_id >= 0) {
+        shmctl(h->cov_shm_id, IPC_RMID, NULL);
+        h->cov_shm_id = -1;
+    }
+}
+
 monitor_handle_t *monitor_start(const char *eval_path,
                                 const char *spec_path,
                                 const char *protocol_tag)
@@ -30,6 +43,21 @@ monitor_handle_t *monitor_start(const char *eval_path,
         return NULL;
     }
 
+    // Coverage map; monitoring still works without it
+    int cov_shm_id = shmget(IPC_PRIVATE, MONITOR_MAP_SIZE, IPC_CREAT | IPC_EXCL | 0600);
+    unsigned char *cov_bits = NULL;
+    if (cov_shm_id < 0) {
+        perror("monitor_start: shmget");
+    } else {
+        cov_bits = (unsigned char *)shmat(cov_shm_id, NULL, 0);
+        if (cov_bits == (void *)-1) {
+            perror("monitor_start: shmat");
+            shmctl(cov_shm_id, IPC_RMID, NULL);
+            cov_shm_id = -1;
+            cov_bits = NULL;
+        }
+    }
+
     pid_t pid = fork();
     if (pid < 0) {
         perror("monitor_start: fork");
@@ -37,6 +65,10 @@ monitor_handle_t *monitor_start(const char *eval_path,
         close(pipefd_in[1]);
         close(pipefd_out[0]);
         close(pipefd_out[1]);
+        if (cov_bits) {
+            shmdt(cov_bits);
+            shmctl(cov_shm_id, IPC_RMID, NULL);
+        }
         return NULL;
     }
 
@@ -58,6 +90,12 @@ monitor_handle_t *monitor_start(const char *eval_path,
         close(pipefd_out[0]);
         close(pipefd_out[1]);
 
+        if (cov_shm_id >= 0) {
+            char id_str[16];
+            snprintf(id_str, sizeof(id_str), "%d", cov_shm_id);
+            setenv(MONITOR_SHM_ENV_VAR, id_str, 1);
+        }
+
         // argv: eval_path spec_path protocol_tag
         execl(eval_path, eval_path, spec_path, protocol_tag, (char *)NULL);
         // If execl fails:
@@ -74,16 +112,23 @@ monitor_handle_t *monitor_start(const char *eval_path,
         close(pipefd_in[1]);
         close(pipefd_out[0]);  // NEW
         kill(pid, SIGKILL);
+        if (cov_bits) {
+            shmdt(cov_bits);
+            shmctl(cov_shm_id, IPC_RMID, NULL);
+        }
         return NULL;
     }
 
     h->eval_pid = pid;
+    h->cov_shm_id = cov_shm_id;
+    h->cov_bits = cov_bits;
     h->eval_stdin = fdopen(pipefd_in[1], "w");
     if (!h->eval_stdin) {
         perror("monitor_start: fdopen stdin");
         close(pipefd_in[1]);
         close(pipefd_out[0]);  // NEW
         kill(pid, SIGKILL);
+        monitor_release_coverage(h);
         free(h);
         return NULL;
     }
@@ -95,6 +140,7 @@ monitor_handle_t *monitor_start(const char *eval_path,
         fclose(h->eval_stdin);
         close(pipefd_out[0]);
         kill(pid, SIGKILL);
+        monitor_release_coverage(h);
         free(h);
         return NULL;
     }
@@ -115,47 +161,72 @@ void monitor_emit_line(monitor_handle_t *h, const char *line)
     fflush(h->eval_stdin);
 }
 
-void monitor_end_session(monitor_handle_t *h)
+void monitor_emit_record(monitor_handle_t *h, const pred_record_t *rec)
 {
-    if (!h || !h->eval_stdin) return;
-    fprintf(h->eval_stdin, "__END_SESSION__\n");
+    if (!h || !h->eval_stdin || !rec) return;
+    fputc(PRED_RECORD_MAGIC, h->eval_stdin);
+    fwrite(rec, 1, pred_record_wire_size(rec), h->eval_stdin);
+    // no newline, so line buffering won't flush on its own
     fflush(h->eval_stdin);
-    
-    if (h->eval_stdout) {
-        char response[256];
-        fd_set readfds;
-        struct timeval tv;
-        
-        // Initial wait (give monitor time to process)
-        tv.tv_sec = 0;
-        tv.tv_usec = 10000; // 10ms
-        
-        while (1) {
-            FD_ZERO(&readfds);
-            int fd = fileno(h->eval_stdout);
-            FD_SET(fd, &readfds);
-            
-            // Check if data is available
-            int ret = select(fd + 1, &readfds, NULL, NULL, &tv);
-            
-            if (ret <= 0) break; // Timeout (buffer empty) or error
-            
-            if (fgets(response, sizeof(response), h->eval_stdout)) {
-                // Check for violation in ANY of the lines
-                if (strstr(response, "VIOLATION_DETECTED")) {
-                    h->violation_detected = 1;
-                }
-            } else {
-                break; // EOF
+}
+
+unsigned int monitor_post(monitor_handle_t *h, const char *cmd)
+{
+    if (!h || !h->eval_stdin || !cmd) return 0;
+    if (!++h->seq) h->seq = 1;   // 0 means "nothing to wait for"
+    fprintf(h->eval_stdin, "%s %u\n", cmd, h->seq);
+    fflush(h->eval_stdin);
+    return h->seq;
+}
+
+int monitor_wait_ack(monitor_handle_t *h, unsigned int seq)
+{
+    if (!h || !h->eval_stdout || !seq) return -1;
+
+    char line[256];
+    unsigned int got;
+    char status[16];
+
+    while (1) {
+        if (!fgets(line, sizeof(line), h->eval_stdout)) {
+            if (ferror(h->eval_stdout) && errno == EINTR) {
+                clearerr(h->eval_stdout);
+                continue;
             }
-            
-            // For subsequent reads, do not wait; just drain the buffer
-            tv.tv_sec = 0;
-            tv.tv_usec = 0; 
+            return -1;  // evaluator gone
         }
+
+        if (strncmp(line, "VIOLATION_DETECTED", 18) == 0) {
+            h->violation_detected = 1;
+            continue;
+        }
+
+        if (sscanf(line, "__ACK__ %u %15s", &got, status) != 2) continue;
+
+        // Replies to requests that were posted and never waited for
+        if ((int)(got - seq) < 0) continue;
+        if (got != seq) return -1;
+
+        const char *near = strstr(line, " near=");
+        if (near) h->session_near = (unsigned int)strtoul(near + 6, NULL, 10);
+
+        return strcmp(status, "OK") ? -1 : 0;
     }
 }
 
+int monitor_end_session(monitor_handle_t *h)
+{
+    // The ack comes after every VIOLATION_DETECTED line and coverage update
+    // of the session, so both are complete once it is in.
+    if (h) h->session_near = 0;
+    return monitor_wait_ack(h, monitor_post(h, "__END_SESSION__"));
+}
+
+unsigned int monitor_session_near(monitor_handle_t *h)
+{
+    return h ? h->session_near : 0;
+}
+
 // NEW FUNCTION
 int monitor_check_violation(monitor_handle_t *h)
 {
@@ -191,54 +262,36 @@ int monitor_stop(monitor_handle_t *h)
         }
     }
 
+    monitor_release_coverage(h);
     free(h);
     return status;
 }
 
-void monitor_save_bitvectors(monitor_handle_t *h, unsigned int snapshot_id) {
-    if (!h || !h->eval_stdin) return;
-    
-    fprintf(h->eval_stdin, "__SAVE_STATE__ %u\n", snapshot_id);
-    fflush(h->eval_stdin);
-    
-    // Optional: Wait for acknowledgment
-    if (h->eval_stdout) {
-        char ack[128];
-        fd_set readfds;
-        struct timeval tv = {0, 50000}; // 50ms timeout
-        
-        FD_ZERO(&readfds);
-        int fd = fileno(h->eval_stdout);
-        FD_SET(fd, &readfds);
-        
-        if (select(fd + 1, &readfds, NULL, NULL, &tv) > 0) {
-            if (fgets(ack, sizeof(ack), h->eval_stdout)) {
-                // State saved successfully
-            }
-        }
-    }
+unsigned char *monitor_coverage(monitor_handle_t *h)
+{
+    return h ? h->cov_bits : NULL;
 }
 
-void monitor_restore_bitvectors(monitor_handle_t *h, unsigned int snapshot_id) {
-    if (!h || !h->eval_stdin) return;
-    
-    fprintf(h->eval_stdin, "__RESTORE_STATE__ %u\n", snapshot_id);
-    fflush(h->eval_stdin);
-    
-    // Optional: Wait for acknowledgment
-    if (h->eval_stdout) {
-        char ack[128];
-        fd_set readfds;
-        struct timeval tv = {0, 50000}; // 50ms timeout
-        
-        FD_ZERO(&readfds);
-        int fd = fileno(h->eval_stdout);
-        FD_SET(fd, &readfds);
-        
-        if (select(fd + 1, &readfds, NULL, NULL, &tv) > 0) {
-            if (fgets(ack, sizeof(ack), h->eval_stdout)) {
-                // State restored successfully
-            }
-        }
-    }
-}
\ No newline at end of file
+void monitor_clear_coverage(monitor_handle_t *h)
+{
+    if (h && h->cov_bits) memset(h->cov_bits, 0, MONITOR_MAP_SIZE);
+}
+
+unsigned int monitor_post_save(monitor_handle_t *h, unsigned int snapshot_id)
+{
+    char cmd[64];
+    snprintf(cmd, sizeof(cmd), "__SAVE_STATE__ %u", snapshot_id);
+    return monitor_post(h, cmd);
+}
+
+int monitor_save_bitvectors(monitor_handle_t *h, unsigned int snapshot_id)
+{
+    return monitor_wait_ack(h, monitor_post_save(h, snapshot_id));
+}
+
+int monitor_restore_bitvectors(monitor_handle_t *h, unsigned int snapshot_id)
+{
+    char cmd[64];
+    snprintf(cmd, sizeof(cmd), "__RESTORE_STATE__ %u", snapshot_id);
+    return monitor_wait_ack(h, monitor_post(h, cmd));
+}
@@ -6,6 +6,8 @@
 #include <stdbool.h>
 #include <sys/types.h>
 
+#include "pred_record.h"
+
 /*
  * Bridge to the external LTL evaluator with violation detection.
  *
@@ -16,8 +18,9 @@
  *                                       "ssh");
  *
  *   monitor_emit_line(h, "request=c2s_kexinit encrypted=false ...");
+ *   monitor_emit_record(h, &rec);   // or a typed event, see pred_record.h
  *   ...
- *   monitor_end_session(h);  // sends "__END_SESSION__" and checks for violations
+ *   monitor_end_session(h);  // sends "__END_SESSION__", waits for its ack
  *   
  *   if (monitor_check_violation(h)) {
  *       // Violation detected! Save test case
@@ -27,11 +30,40 @@
  *   monitor_stop(h);         // closes pipe, waits for evaluator
  */
 
+/*
+ * Control requests (__END_SESSION__, __SAVE_STATE__, __RESTORE_STATE__) end
+ * in a sequence number, which the evaluator echoes back once it has handled
+ * the request:
+ *
+ *   __SAVE_STATE__ 7 42    ->  __ACK__ 42 OK
+ *   __RESTORE_STATE__ 9 43 ->  __ACK__ 43 ERR    (no state saved for 9)
+ *   __END_SESSION__ 44     ->  __ACK__ 44 OK near=750
+ *
+ * Requests are handled in order, so by the time an ack is read everything
+ * sent before the request has been evaluated. Replies are read with a
+ * blocking fgets(); nothing is left in the pipe for a later request to
+ * misread.
+ */
+
+/*
+ * Property-automaton coverage. The evaluator hashes each formula's temporal
+ * bitvector after every step and bumps map[(prev >> 1) ^ cur], AFL
+ * edge-style, in a SysV segment whose id it finds in MONITOR_SHM_ENV_VAR.
+ * The segment is created by monitor_start() and removed by monitor_stop().
+ */
+#define MONITOR_SHM_ENV_VAR   "__AFL_MONITOR_SHM_ID"
+#define MONITOR_MAP_SIZE_POW2 13
+#define MONITOR_MAP_SIZE      (1 << MONITOR_MAP_SIZE_POW2)
+
 typedef struct monitor_handle {
     FILE *eval_stdin;          // Write predicates to monitor
     FILE *eval_stdout;         // Read violation signals from monitor (NEW)
     pid_t eval_pid;
     int violation_detected;    // Flag: 1 if violation in current session (NEW)
+    int cov_shm_id;            // SysV id of the coverage map, -1 if none
+    unsigned char *cov_bits;   // Coverage map shared with the evaluator
+    unsigned int seq;          // Sequence number of the last control request
+    unsigned int session_near; // Closeness of the last session to a violation
 } monitor_handle_t;
 
 /* Start evaluator process: eval_path spec_path protocol_tag.
@@ -44,8 +76,29 @@ monitor_handle_t *monitor_start(const char *eval_path,
 /* Emit a single predicate line "k=v k=v ..." to evaluator. */
 void monitor_emit_line(monitor_handle_t *h, const char *line);
 
-/* Mark end of one logical test sequence and check for violations. */
-void monitor_end_session(monitor_handle_t *h);
+/* Emit one binary predicate event; the evaluator rejects records whose
+ * spec hash differs from the spec it loaded. */
+void monitor_emit_record(monitor_handle_t *h, const pred_record_t *rec);
+
+/* Send a control request "cmd <seq>" without waiting for the reply.
+ * Returns seq, 0 if the monitor is not running. */
+unsigned int monitor_post(monitor_handle_t *h, const char *cmd);
+
+/* Block until the ack for seq arrives. Acks of earlier requests and
+ * VIOLATION_DETECTED lines met on the way are consumed (the latter set the
+ * violation flag). 0 if the evaluator reported success, -1 on failure or
+ * if it exited. */
+int monitor_wait_ack(monitor_handle_t *h, unsigned int seq);
+
+/* Mark end of one logical test sequence and check for violations. 0 once
+ * the evaluator has acked it, i.e. the session's coverage is all in the
+ * map; -1 if the ack never came and the map may be partial. */
+int monitor_end_session(monitor_handle_t *h);
+
+/* How close the last session came to violating a property, in thousandths
+ * (1000: it did). For H(a1 & ... & an -> b) this is the largest share of
+ * a1 .. an, !b that held at one step; see NearMiss in evaluator-src. */
+unsigned int monitor_session_near(monitor_handle_t *h);
 
 /* Tear down evaluator; returns its exit status (as from waitpid). */
 int monitor_stop(monitor_handle_t *h);
@@ -56,7 +109,18 @@ int monitor_check_violation(monitor_handle_t *h);
 /* Clear the violation flag after handling it. (NEW) */
 void monitor_clear_violation(monitor_handle_t *h);
 
-void monitor_save_bitvectors(monitor_handle_t *h, unsigned int snapshot_id);
-void monitor_restore_bitvectors(monitor_handle_t *h, unsigned int snapshot_id);
+/* Automaton coverage map (MONITOR_MAP_SIZE bytes), or NULL if unavailable. */
+unsigned char *monitor_coverage(monitor_handle_t *h);
+
+/* Zero the coverage map before the next execution. */
+void monitor_clear_coverage(monitor_handle_t *h);
+
+/* Have the evaluator save / restore its BitVector state under snapshot_id.
+ * Both wait for the ack and return as monitor_wait_ack(). monitor_post_save()
+ * only sends the request, so the evaluator can copy its state while the
+ * caller takes the target snapshot; collect the ack with monitor_wait_ack(). */
+unsigned int monitor_post_save(monitor_handle_t *h, unsigned int snapshot_id);
+int monitor_save_bitvectors(monitor_handle_t *h, unsigned int snapshot_id);
+int monitor_restore_bitvectors(monitor_handle_t *h, unsigned int snapshot_id);
 
 #endif /* MONITOR_BRIDGE_H */
\ No newline at end of file
@@ -0,0 +1,134 @@
+// pred_gen_rt.h
+#ifndef PRED_GEN_RT_H
+#define PRED_GEN_RT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/*
+ * Field extractors used by the adapters ltl_adaptergen writes from a
+ * *.adapter description (see evaluator-src/ltl_adaptergen.cpp). Each one
+ * returns false when the field is absent from the message (too short, not
+ * digits, no such token), which the description maps with its '-' entry.
+ *
+ * String -> value maps are emitted as collision-free hash tables: the
+ * generator picks a table size and seed so every key lands in its own
+ * slot, and pg_lookup() is one hash, one length compare and one memcmp.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct pg_key {
+    const char *key;        /* NULL = empty slot */
+    uint8_t len;
+    int32_t value;
+} pg_key_t;
+
+static inline uint32_t pg_hash(const unsigned char *p, uint32_t n,
+                               uint32_t seed, bool nocase)
+{
+    uint32_t h = 2166136261u ^ seed;
+    for (uint32_t i = 0; i < n; i++) {
+        unsigned char c = p[i];
+        if (nocase && c >= 'a' && c <= 'z') c -= 'a' - 'A';
+        h = (h ^ c) * 16777619u;
+    }
+    return h;
+}
+
+static inline bool pg_keyeq(const char *key, const unsigned char *p, uint32_t n,
+                            bool nocase)
+{
+    if (!nocase) return memcmp(key, p, n) == 0;
+    for (uint32_t i = 0; i < n; i++) {
+        unsigned char c = p[i];
+        if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+        if ((unsigned char)key[i] != c) return false;
+    }
+    return true;
+}
+
+/* tab has mask + 1 slots; nocase keys are stored upper-case. */
+static inline int32_t pg_lookup(const pg_key_t *tab, uint32_t mask, uint32_t seed,
+                                bool nocase, const unsigned char *p, uint32_t n,
+                                int32_t dflt)
+{
+    const pg_key_t *e = &tab[pg_hash(p, n, seed, nocase) & mask];
+    return (e->key && e->len == n && pg_keyeq(e->key, p, n, nocase)) ? e->value : dflt;
+}
+
+/* Token `idx` (0-based, separated by spaces/tabs) of the first line. */
+static inline bool pg_token(const unsigned char *buf, uint32_t len, uint32_t idx,
+                            const unsigned char **tok, uint32_t *tok_len)
+{
+    uint32_t i = 0;
+    for (;;) {
+        while (i < len && (buf[i] == ' ' || buf[i] == '\t')) i++;
+        if (i >= len || buf[i] == '\r' || buf[i] == '\n') return false;
+
+        uint32_t start = i;
+        while (i < len && buf[i] != ' ' && buf[i] != '\t' &&
+               buf[i] != '\r' && buf[i] != '\n') i++;
+
+        if (idx-- == 0) {
+            *tok = buf + start;
+            *tok_len = i - start;
+            return true;
+        }
+    }
+}
+
+/* `n` decimal digits at `off`. */
+static inline bool pg_digits(const unsigned char *buf, uint32_t len, uint32_t off,
+                             uint32_t n, int32_t *value)
+{
+    int32_t v = 0;
+    if (off + n > len) return false;
+    for (uint32_t i = 0; i < n; i++) {
+        unsigned d = (unsigned)buf[off + i] - '0';
+        if (d > 9) return false;
+        v = v * 10 + (int32_t)d;
+    }
+    *value = v;
+    return true;
+}
+
+/* Big-endian unsigned field of `width` (1, 2 or 4) bytes at `off`. */
+static inline bool pg_uint(const unsigned char *buf, uint32_t len, uint32_t off,
+                           uint32_t width, uint32_t *value)
+{
+    uint32_t v = 0;
+    if (off + width > len) return false;
+    for (uint32_t i = 0; i < width; i++) v = (v << 8) | buf[off + i];
+    *value = v;
+    return true;
+}
+
+/* Leading decimal integer of a header value (atoi without the NUL). */
+static inline int32_t pg_atoi(const char *p, size_t n)
+{
+    int32_t v = 0;
+    bool neg = false;
+    size_t i = 0;
+    if (i < n && (p[i] == '-' || p[i] == '+')) neg = (p[i++] == '-');
+    for (; i < n && (unsigned)(p[i] - '0') <= 9; i++) v = v * 10 + (p[i] - '0');
+    return neg ? -v : v;
+}
+
+/* First token of a header value. */
+static inline uint32_t pg_value_token(const char *p, size_t n)
+{
+    uint32_t i = 0;
+    while (i < n && p[i] != ' ' && p[i] != '\t' && p[i] != ';' && p[i] != ',') i++;
+    return i;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PRED_GEN_RT_H */
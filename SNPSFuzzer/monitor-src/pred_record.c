@@ -0,0 +1,42 @@
+// pred_record.c
+#include "pred_record.h"
+
+#include <stdio.h>
+#include <string.h>
+
+size_t pred_record_format(const pred_record_t *r,
+                          const pred_schema_t *schema,
+                          char *out,
+                          size_t out_sz)
+{
+    if (!out || out_sz == 0) return 0;
+    out[0] = '\0';
+
+    size_t pos = 0;
+    for (uint16_t i = 0; i < r->count && pos < out_sz; i++) {
+        const pred_field_t *f = &r->fields[i];
+        if (f->var >= schema->nvars) continue;
+
+        const char *name = schema->var_names[f->var];
+        const char *sep = pos ? " " : "";
+        int n;
+
+        switch (schema->var_kinds[f->var]) {
+            case PRED_KIND_BOOL:
+                n = snprintf(out + pos, out_sz - pos, "%s%s=%s",
+                             sep, name, f->value ? "true" : "false");
+                break;
+            case PRED_KIND_ENUM:
+                n = snprintf(out + pos, out_sz - pos, "%s%s=%s",
+                             sep, name, schema->enum_values[f->var][f->value]);
+                break;
+            default:
+                n = snprintf(out + pos, out_sz - pos, "%s%s=%d",
+                             sep, name, (int)f->value);
+                break;
+        }
+        if (n < 0) break;
+        pos += (size_t)n;
+    }
+    return pos < out_sz ? pos : out_sz - 1;
+}
@@ -0,0 +1,109 @@
+// pred_record.h
+#ifndef PRED_RECORD_H
+#define PRED_RECORD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Binary predicate events.
+ *
+ * Instead of formatting "k=v ..." text that the evaluator parses back, an
+ * adapter can fill a pred_record_t with (variable id, value) pairs:
+ *
+ *   pred_record_t rec;
+ *   pred_begin(&rec, SSH_PRED_SPEC_HASH);
+ *   pred_set_enum(&rec, SSH_VAR_request, SSH_request_c2s_kexinit);
+ *   pred_set_bool(&rec, SSH_VAR_encrypted, false);
+ *   pred_set_int(&rec, SSH_VAR_pkt_len, len);
+ *   monitor_emit_record(h, &rec);
+ *
+ * Variable and enum ids come from a header generated from the spec by
+ * ltl_predgen (e.g. dnsmasq_pred_spec.h): a variable's id is its position
+ * in the spec's declarations, an enum value's id its position inside the
+ * enum. Renaming or dropping something in the spec therefore breaks the
+ * adapter build instead of tripping an assert in the evaluator. The spec
+ * hash travels with every record, so an adapter built against a different
+ * spec than the evaluator loaded is rejected rather than misread.
+ *
+ * On the wire a record is PRED_RECORD_MAGIC followed by the first
+ * pred_record_wire_size() bytes of the struct; both ends are on one host.
+ * The magic byte never starts a text line, so text and binary events can
+ * share the evaluator's stdin.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PRED_RECORD_MAGIC 0x1e
+#define PRED_MAX_FIELDS   64
+
+enum pred_kind {
+    PRED_KIND_BOOL,
+    PRED_KIND_INT,
+    PRED_KIND_ENUM
+};
+
+typedef struct pred_field {
+    uint16_t var;
+    int32_t  value;      // bool: 0/1, enum: value id
+} pred_field_t;
+
+typedef struct pred_record {
+    uint32_t spec_hash;
+    uint16_t count;
+    pred_field_t fields[PRED_MAX_FIELDS];
+} pred_record_t;
+
+/* Variable names and enum value names of one spec, for text rendering. */
+typedef struct pred_schema {
+    uint32_t spec_hash;
+    uint16_t nvars;
+    const char *const *var_names;
+    const uint8_t *var_kinds;
+    const char *const *const *enum_values;   // NULL for non-enum variables
+} pred_schema_t;
+
+static inline void pred_begin(pred_record_t *r, uint32_t spec_hash)
+{
+    r->spec_hash = spec_hash;
+    r->count = 0;
+}
+
+static inline void pred_set_int(pred_record_t *r, uint16_t var, int32_t value)
+{
+    if (r->count >= PRED_MAX_FIELDS) return;
+    r->fields[r->count].var = var;
+    r->fields[r->count].value = value;
+    r->count++;
+}
+
+static inline void pred_set_bool(pred_record_t *r, uint16_t var, bool value)
+{
+    pred_set_int(r, var, value ? 1 : 0);
+}
+
+static inline void pred_set_enum(pred_record_t *r, uint16_t var, uint16_t value)
+{
+    pred_set_int(r, var, value);
+}
+
+static inline size_t pred_record_wire_size(const pred_record_t *r)
+{
+    return offsetof(pred_record_t, fields) + r->count * sizeof(pred_field_t);
+}
+
+/* Render a record as the equivalent "k=v ..." line, fields in set order.
+ * Returns the length written (truncated to out_sz like snprintf). */
+size_t pred_record_format(const pred_record_t *r,
+                          const pred_schema_t *schema,
+                          char *out,
+                          size_t out_sz);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PRED_RECORD_H */
@@ -0,0 +1,212 @@
+// pred_stream.c
+#include "pred_stream.h"
+#include "header_index.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+void pred_stream_init(pred_stream_t *s, enum pred_framing framing)
+{
+    memset(s, 0, sizeof(*s));
+    s->framing = framing;
+}
+
+void pred_stream_reset(pred_stream_t *s, uint64_t off)
+{
+    s->cur = NULL;
+    s->cur_len = s->pos = 0;
+    s->cur_off = s->off = off;
+    s->scan = s->need = 0;
+    s->pend_len = 0;
+    s->pend_off = 0;
+}
+
+void pred_stream_free(pred_stream_t *s)
+{
+    free(s->pend);
+    memset(s, 0, sizeof(*s));
+}
+
+static bool pend_reserve(pred_stream_t *s, uint32_t size)
+{
+    if (size <= s->pend_cap) return true;
+
+    uint32_t cap = s->pend_cap ? s->pend_cap : 4096;
+    while (cap < size) cap *= 2;
+
+    unsigned char *p = realloc(s->pend, cap);
+    if (!p) return false;
+    s->pend = p;
+    s->pend_cap = cap;
+    return true;
+}
+
+/* --- Framers: length of the complete message at p, 0 if more bytes are
+ * needed. s->scan / s->need carry progress over to the next attempt. --- */
+
+static uint32_t frame_dtls(const unsigned char *p, uint32_t n)
+{
+    if (n < 13) return 0;
+    uint32_t total = 13 + (((uint32_t)p[11] << 8) | p[12]);
+    return total <= n ? total : 0;
+}
+
+static uint32_t frame_text(pred_stream_t *s, const unsigned char *p, uint32_t n)
+{
+    if (!s->need) {
+        // Find the empty line ending the header block, one line at a time;
+        // s->scan is the start of the first line not yet looked at
+        uint32_t line = s->scan;
+        uint32_t hdr_end;
+
+        for (;;) {
+            uint32_t eol = hdr_find_eol(p, n, line);
+            if (eol == n || (p[eol] == '\r' && eol + 1 == n)) {
+                s->scan = line;
+                return 0;
+            }
+            uint32_t next = hdr_skip_eol(p, n, eol);
+            if (eol == line) {
+                hdr_end = next;
+                break;
+            }
+            line = next;
+        }
+
+        hdr_index_t ix;
+        char value[32];
+        long body = 0;
+
+        hdr_index_build(&ix, p, hdr_end);
+        if (hdr_index_copy(&ix, "Content-Length", value, sizeof(value)) ||
+            hdr_index_copy(&ix, "l", value, sizeof(value))) {       // SIP compact form
+            body = atol(value);
+        }
+        if (body < 0) body = 0;
+        if (body > PRED_STREAM_MAX_MSG) body = PRED_STREAM_MAX_MSG;
+
+        s->need = hdr_end + (uint32_t)body;
+        if (s->need > PRED_STREAM_MAX_MSG) s->need = PRED_STREAM_MAX_MSG;
+    }
+
+    return s->need <= n ? s->need : 0;
+}
+
+static uint32_t frame_ftp_reply(pred_stream_t *s, const unsigned char *p, uint32_t n)
+{
+    uint32_t line = s->scan;
+
+    for (;;) {
+        const unsigned char *lf = memchr(p + line, '\n', n - line);
+        if (!lf) {
+            s->scan = line;
+            return 0;
+        }
+        uint32_t next = (uint32_t)(lf - p) + 1;
+
+        if (line == 0) {
+            // "NNN-" opens a multi-line reply; anything else is one line
+            bool multi = next >= 5 && isdigit(p[0]) && isdigit(p[1]) &&
+                         isdigit(p[2]) && p[3] == '-';
+            if (!multi) return next;
+        } else if (next - line >= 5 && memcmp(p + line, p, 3) == 0 &&
+                   p[line + 3] == ' ') {
+            return next;
+        }
+        line = next;
+    }
+}
+
+static uint32_t frame_len(pred_stream_t *s, const unsigned char *p, uint32_t n)
+{
+    switch (s->framing) {
+        case PRED_FRAME_DTLS:      return frame_dtls(p, n);
+        case PRED_FRAME_TEXT:      return frame_text(s, p, n);
+        case PRED_FRAME_FTP_REPLY: return frame_ftp_reply(s, p, n);
+        case PRED_FRAME_NONE:
+        default:                   return n;
+    }
+}
+
+/* Keep the incomplete tail p[0..n) of the current window for the next one. */
+static void carry(pred_stream_t *s, const unsigned char *p, uint32_t n)
+{
+    uint64_t off = s->cur_off + s->pos;
+
+    if (n && p != s->pend) {
+        if (!pend_reserve(s, n)) n = 0;
+        else memcpy(s->pend, p, n);
+    }
+    // (p == pend: the tail already starts the buffer, nothing to move)
+
+    s->pend_len = n;
+    s->pend_off = off;
+    s->cur = NULL;
+    s->cur_len = s->pos = 0;
+    if (!n) s->scan = s->need = 0;
+}
+
+void pred_stream_feed(pred_stream_t *s, const unsigned char *buf, uint32_t len)
+{
+    s->pos = 0;
+
+    if (s->pend_len && pend_reserve(s, s->pend_len + len)) {
+        // Resume the split message: framing continues in the reassembly buffer
+        memcpy(s->pend + s->pend_len, buf, len);
+        s->cur = s->pend;
+        s->cur_len = s->pend_len + len;
+        s->cur_off = s->pend_off;
+    } else {
+        s->cur = buf;
+        s->cur_len = len;
+        s->cur_off = s->off;
+        s->scan = s->need = 0;
+    }
+    s->pend_len = 0;
+    s->off += len;
+}
+
+bool pred_stream_next(pred_stream_t *s, const unsigned char **msg,
+                      uint32_t *msg_len, uint64_t *msg_off)
+{
+    if (!s->cur) return false;
+
+    const unsigned char *p = s->cur + s->pos;
+    uint32_t n = s->cur_len - s->pos;
+    if (!n) {
+        carry(s, p, 0);
+        return false;
+    }
+
+    // Keep buffering while the framer needs more bytes; only a message that
+    // outgrows the cap goes out unframed (the rest waits for the flush)
+    uint32_t m = frame_len(s, p, n);
+    if (!m && n >= PRED_STREAM_MAX_MSG) m = n;
+
+    if (!m) {
+        if (s->cur == s->pend && s->pos) memmove(s->pend, p, n);
+        carry(s, s->cur == s->pend ? s->pend : p, n);
+        return false;
+    }
+
+    *msg = p;
+    *msg_len = m;
+    *msg_off = s->cur_off + s->pos;
+    s->pos += m;
+    s->scan = s->need = 0;
+    return true;
+}
+
+bool pred_stream_flush(pred_stream_t *s, const unsigned char **msg,
+                       uint32_t *msg_len, uint64_t *msg_off)
+{
+    if (!s->pend_len) return false;
+
+    *msg = s->pend;
+    *msg_len = s->pend_len;
+    *msg_off = s->pend_off;
+    s->pend_len = 0;
+    s->scan = s->need = 0;
+    return true;
+}
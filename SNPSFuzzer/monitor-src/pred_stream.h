@@ -0,0 +1,91 @@
+// pred_stream.h
+#ifndef PRED_STREAM_H
+#define PRED_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Splits the server-to-client byte stream of one session into protocol
+ * messages, so an adapter sees one complete message per predicate event
+ * instead of whatever a receive call happened to return (several coalesced
+ * replies, or half of one).
+ *
+ * Each receive window is handed over with pred_stream_feed() and drained
+ * with pred_stream_next():
+ *
+ *   pred_stream_feed(&s, buf + prev, len - prev);
+ *   while (pred_stream_next(&s, &msg, &msg_len, &msg_off))
+ *       ad->build_response(ctx, msg, msg_len, line, sizeof(line));
+ *   ...
+ *   if (pred_stream_flush(&s, &msg, &msg_len, &msg_off)) ...   // end of session
+ *
+ * Messages are framed in place inside the window; only a message that is
+ * still incomplete when the window runs out is copied into the stream's
+ * reassembly buffer, and framing resumes where it stopped when the next
+ * window arrives. msg_off is the message's offset in the whole stream,
+ * i.e. in the caller's accumulated response buffer.
+ *
+ * A message split over any number of windows comes out once, whole. Bytes
+ * that never complete a message are held until they grow past
+ * PRED_STREAM_MAX_MSG, which is returned as one message so fuzzed garbage
+ * cannot swallow the events for later responses, or until
+ * pred_stream_flush() at the end of the session.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PRED_STREAM_MAX_MSG 65536
+
+enum pred_framing {
+    PRED_FRAME_NONE = 0,    /* each receive window is one message */
+    PRED_FRAME_DTLS,        /* 13-byte record header, length at [11..12] */
+    PRED_FRAME_TEXT,        /* headers up to an empty line + Content-Length body */
+    PRED_FRAME_FTP_REPLY    /* "NNN text" line, or "NNN-" ... "NNN text" */
+};
+
+typedef struct pred_stream {
+    enum pred_framing framing;
+
+    /* Window being framed: either the caller's buffer or `pend`. */
+    const unsigned char *cur;
+    uint32_t cur_len;
+    uint32_t pos;
+    uint64_t cur_off;       /* stream offset of cur[0] */
+    uint64_t off;           /* stream offset of the next byte fed */
+
+    /* Resumable framing state of the message starting at cur + pos. */
+    uint32_t scan;          /* bytes already scanned without finding its end */
+    uint32_t need;          /* its full length once known, else 0 */
+
+    /* Reassembly buffer for a message split across windows. */
+    unsigned char *pend;
+    uint32_t pend_len;
+    uint32_t pend_cap;
+    uint64_t pend_off;      /* stream offset of pend[0] */
+} pred_stream_t;
+
+void pred_stream_init(pred_stream_t *s, enum pred_framing framing);
+/* Drop any partial message; the next byte fed is at stream offset off. */
+void pred_stream_reset(pred_stream_t *s, uint64_t off);
+void pred_stream_free(pred_stream_t *s);
+
+/* Hand over the next received bytes. buf must stay valid until
+ * pred_stream_next() returns false. */
+void pred_stream_feed(pred_stream_t *s, const unsigned char *buf, uint32_t len);
+
+/* Next complete message of the current window, false when it is drained. */
+bool pred_stream_next(pred_stream_t *s, const unsigned char **msg,
+                      uint32_t *msg_len, uint64_t *msg_off);
+
+/* Return a pending partial message as-is (at the end of a session). */
+bool pred_stream_flush(pred_stream_t *s, const unsigned char **msg,
+                       uint32_t *msg_len, uint64_t *msg_off);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PRED_STREAM_H */
@@ -0,0 +1,69 @@
+// pred_trace.c
+#include "pred_trace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static enum pred_trace_mode g_trace_mode = PRED_TRACE_HEX;
+
+/* "000102...ff", two characters per byte value */
+static const char hex_pairs[513] =
+    "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+void pred_trace_set_mode(enum pred_trace_mode mode)
+{
+    g_trace_mode = mode;
+}
+
+enum pred_trace_mode pred_trace_get_mode(void)
+{
+    return g_trace_mode;
+}
+
+size_t pred_hex_encode(char *out, const unsigned char *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        memcpy(out + 2 * i, &hex_pairs[2 * buf[i]], 2);
+    }
+    out[2 * len] = '\0';
+    return 2 * len;
+}
+
+void pred_append_packet_trace(char *out, size_t out_sz,
+                              unsigned int msg_id,
+                              const char *direction,
+                              const unsigned char *buf,
+                              unsigned int len)
+{
+    size_t current_len = strlen(out);
+    size_t remaining = out_sz - current_len;
+
+    if (remaining < 50) return;  // Not enough space
+
+    if (g_trace_mode == PRED_TRACE_REF) {
+        snprintf(out + current_len, remaining, " msg_id=%u dir=%s",
+                 msg_id, direction);
+        return;
+    }
+
+    int written = snprintf(out + current_len, remaining,
+                           " msg_id=%u dir=%s trace=", msg_id, direction);
+    if (written < 0 || (size_t)written >= remaining) return;
+
+    current_len += written;
+    remaining -= written;
+
+    // Truncate to the byte cap and to what fits with the NUL
+    size_t trace_len = len;
+    if (trace_len > PRED_TRACE_MAX_BYTES) trace_len = PRED_TRACE_MAX_BYTES;
+    if (trace_len > (remaining - 1) / 2) trace_len = (remaining - 1) / 2;
+
+    pred_hex_encode(out + current_len, buf, trace_len);
+}
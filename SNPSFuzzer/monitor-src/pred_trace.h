@@ -0,0 +1,48 @@
+// pred_trace.h
+#ifndef PRED_TRACE_H
+#define PRED_TRACE_H
+
+#include <stddef.h>
+
+/*
+ * Packet trace fields appended by the adapters to every predicate line:
+ *
+ *   ... msg_id=N dir=C2S trace=<hex of the first 256 bytes>
+ *
+ * In PRED_TRACE_REF mode the hex is left out and only msg_id/dir are
+ * written. The fuzzer then keeps a (message, offset, length) reference to
+ * the bytes it already holds and hex-dumps them only when a violation is
+ * saved, instead of every adapter formatting every packet.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PRED_TRACE_MAX_BYTES 256
+
+enum pred_trace_mode {
+    PRED_TRACE_HEX,      /* default: inline hex */
+    PRED_TRACE_REF       /* msg_id/dir only, bytes resolved by the caller */
+};
+
+void pred_trace_set_mode(enum pred_trace_mode mode);
+enum pred_trace_mode pred_trace_get_mode(void);
+
+/* Lowercase hex of buf[0..len) into out, which must hold 2 * len + 1 bytes.
+ * Returns the number of characters written (excluding the NUL). */
+size_t pred_hex_encode(char *out, const unsigned char *buf, size_t len);
+
+/* Append " msg_id=<msg_id> dir=<direction> trace=<hex>" to the NUL-terminated
+ * line in out, truncating the hex to what fits. */
+void pred_append_packet_trace(char *out, size_t out_sz,
+                              unsigned int msg_id,
+                              const char *direction,
+                              const unsigned char *buf,
+                              unsigned int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PRED_TRACE_H */
@@ -0,0 +1,160 @@
+// predicate_adapter.h
+#ifndef PREDICATE_ADAPTER_H
+#define PREDICATE_ADAPTER_H
+
+#include <stddef.h>
+
+#include "pred_record.h"
+#include "pred_stream.h"
+
+/*
+ * Common interface of the protocol predicate adapters.
+ *
+ * Every adapter keeps its per-session decoding state (handshake progress,
+ * tracked queries, msg_id counter, ...) in a context object it allocates
+ * itself, so any number of sessions can be decoded side by side and from
+ * different threads, as long as one context is only used by one thread at
+ * a time. The typed per-protocol API (xxx_adapter_create(),
+ * xxx_build_request_pred_line(ctx, ...), ...) lives in each adapter's
+ * header; this table erases the context type so callers can pick a
+ * protocol at runtime:
+ *
+ *   const predicate_adapter_t *ad = &ftp_predicate_adapter;
+ *   void *ctx = ad->create();
+ *   ad->build_request(ctx, buf, len, line, sizeof(line));
+ *   ad->reset(ctx);            // new session, same context
+ *   ad->destroy(ctx);
+ *
+ * Adapters generated against a spec header (see pred_record.h) also fill
+ * build_request_record/build_response_record; callers should prefer those
+ * when set and fall back to the text builders otherwise.
+ *
+ * response_framing says how the server's byte stream splits into messages;
+ * callers that receive in arbitrary chunks run it through a pred_stream_t
+ * (one per session, reset with the context) and call build_response once
+ * per complete message.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct predicate_adapter {
+    const char *name;
+
+    /* Fresh context in the reset state, NULL on allocation failure. */
+    void *(*create)(void);
+    /* Start a new session. */
+    void  (*reset)(void *ctx);
+    void  (*destroy)(void *ctx);
+
+    /* Client-to-server message -> predicate line. */
+    void  (*build_request)(void *ctx,
+                           const unsigned char *buf,
+                           unsigned int len,
+                           char *out,
+                           size_t out_sz);
+    /* Server-to-client message -> predicate line. */
+    void  (*build_response)(void *ctx,
+                            const unsigned char *buf,
+                            unsigned int len,
+                            char *out,
+                            size_t out_sz);
+
+    /* Typed variants of the two builders above, NULL if the adapter only
+     * produces text. */
+    void  (*build_request_record)(void *ctx,
+                                  const unsigned char *buf,
+                                  unsigned int len,
+                                  pred_record_t *rec);
+    void  (*build_response_record)(void *ctx,
+                                   const unsigned char *buf,
+                                   unsigned int len,
+                                   pred_record_t *rec);
+
+    enum pred_framing response_framing;
+} predicate_adapter_t;
+
+/*
+ * Defines `<proto>_predicate_adapter` from the typed functions
+ * <proto>_adapter_create/reset/destroy and the two builders, with the
+ * void* thunks the table needs, and its response framing. Used once at the
+ * bottom of each adapter.
+ */
+#define PREDICATE_ADAPTER_THUNKS_(proto, ctx_type, req_fn, resp_fn)           \
+    static void *proto##_adapter_create_thunk(void)                          \
+    {                                                                        \
+        return proto##_adapter_create();                                     \
+    }                                                                        \
+    static void proto##_adapter_reset_thunk(void *ctx)                       \
+    {                                                                        \
+        proto##_adapter_reset((ctx_type *)ctx);                              \
+    }                                                                        \
+    static void proto##_adapter_destroy_thunk(void *ctx)                     \
+    {                                                                        \
+        proto##_adapter_destroy((ctx_type *)ctx);                            \
+    }                                                                        \
+    static void proto##_build_request_thunk(void *ctx,                       \
+                                            const unsigned char *buf,        \
+                                            unsigned int len,                \
+                                            char *out, size_t out_sz)        \
+    {                                                                        \
+        req_fn((ctx_type *)ctx, buf, len, out, out_sz);                      \
+    }                                                                        \
+    static void proto##_build_response_thunk(void *ctx,                      \
+                                             const unsigned char *buf,       \
+                                             unsigned int len,               \
+                                             char *out, size_t out_sz)       \
+    {                                                                        \
+        resp_fn((ctx_type *)ctx, buf, len, out, out_sz);                     \
+    }
+
+#define PREDICATE_ADAPTER_DEFINE(proto, ctx_type, req_fn, resp_fn, framing)   \
+    PREDICATE_ADAPTER_THUNKS_(proto, ctx_type, req_fn, resp_fn)               \
+    const predicate_adapter_t proto##_predicate_adapter = {                  \
+        #proto,                                                              \
+        proto##_adapter_create_thunk,                                        \
+        proto##_adapter_reset_thunk,                                         \
+        proto##_adapter_destroy_thunk,                                       \
+        proto##_build_request_thunk,                                         \
+        proto##_build_response_thunk,                                        \
+        NULL,                                                                \
+        NULL,                                                                \
+        framing,                                                             \
+    }
+
+/* Same, for adapters that also build pred_record_t events. */
+#define PREDICATE_ADAPTER_DEFINE_TYPED(proto, ctx_type, req_fn, resp_fn,     \
+                                       req_rec_fn, resp_rec_fn, framing)     \
+    PREDICATE_ADAPTER_THUNKS_(proto, ctx_type, req_fn, resp_fn)               \
+    static void proto##_build_request_record_thunk(void *ctx,                \
+                                                   const unsigned char *buf, \
+                                                   unsigned int len,         \
+                                                   pred_record_t *rec)       \
+    {                                                                        \
+        req_rec_fn((ctx_type *)ctx, buf, len, rec);                          \
+    }                                                                        \
+    static void proto##_build_response_record_thunk(void *ctx,               \
+                                                    const unsigned char *buf,\
+                                                    unsigned int len,        \
+                                                    pred_record_t *rec)      \
+    {                                                                        \
+        resp_rec_fn((ctx_type *)ctx, buf, len, rec);                         \
+    }                                                                        \
+    const predicate_adapter_t proto##_predicate_adapter = {                  \
+        #proto,                                                              \
+        proto##_adapter_create_thunk,                                        \
+        proto##_adapter_reset_thunk,                                         \
+        proto##_adapter_destroy_thunk,                                       \
+        proto##_build_request_thunk,                                         \
+        proto##_build_response_thunk,                                        \
+        proto##_build_request_record_thunk,                                  \
+        proto##_build_response_record_thunk,                                 \
+        framing,                                                             \
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PREDICATE_ADAPTER_H */
@@ -1,89 +1,74 @@
 // rtsp_predicate_adapter.c
 #include "rtsp_predicate_adapter.h"
+#include "pred_trace.h"
+#include "header_index.h"
 
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
 
-/* --- Static per-session state --- */
+/* --- Per-session state --- */
 
-static char   g_session_id[256] = "";      // Active Session ID
-static bool   g_session_established = false;
-static int    g_setup_success_count = 0;
-static int    g_play_success_count = 0;
-static int    g_last_req_cseq = -1;
-static char   g_last_req_method[32] = "mNotSet";
-static bool   g_last_req_has_session = false;
-static char   g_last_req_session_id[256] = "";
-static bool   g_last_req_transport_udp = false;
-static bool   g_last_req_transport_tcp = false;
-static bool   g_last_req_client_ports = false;
-static int    g_total_tracks = 0;         // Heuristic: count SETUP successes
-static bool   g_session_initialized = false;
+struct rtsp_adapter_ctx {
+    char   session_id[256];             // Active Session ID
+    bool   session_established;
+    int    setup_success_count;
+    int    play_success_count;
+    int    last_req_cseq;
+    char   last_req_method[32];
+    bool   last_req_has_session;
+    char   last_req_session_id[256];
+    bool   last_req_transport_udp;
+    bool   last_req_transport_tcp;
+    bool   last_req_client_ports;
+    int    total_tracks;                // Heuristic: count SETUP successes
 
-static unsigned int g_msg_id = 0;
+    unsigned int msg_id;                // Not reset between sessions
+};
 
 // Helper function
-static void append_packet_trace(char *out, size_t out_sz,
+static void append_packet_trace(rtsp_adapter_ctx_t *ctx,
+                                char *out, size_t out_sz,
                                 const unsigned char *buf,
                                 unsigned int len,
                                 const char *direction)
 {
-    g_msg_id++;
-    
-    // Calculate current length
-    size_t current_len = strlen(out);
-    size_t remaining = out_sz - current_len;
-    
-    if (remaining < 50) return;  // Not enough space
-    
-    // Append msg_id and dir
-    int written = snprintf(out + current_len, remaining,
-                          " msg_id=%u dir=%s trace=",
-                          g_msg_id, direction);
-    
-    if (written < 0 || (size_t)written >= remaining) return;
-    
-    current_len += written;
-    remaining -= written;
-    
-    // Append hex trace (truncate if needed)
-    unsigned int trace_len = len;
-    if (trace_len > 256) trace_len = 256;  // Max 512 hex chars
-    
-    for (unsigned int i = 0; i < trace_len && remaining > 2; i++) {
-        snprintf(out + current_len, remaining, "%02x", buf[i]);
-        current_len += 2;
-        remaining -= 2;
-    }
+    ctx->msg_id++;
+    pred_append_packet_trace(out, out_sz, ctx->msg_id, direction, buf, len);
 }
 
 
-void rtsp_predicate_reset_session(void)
+rtsp_adapter_ctx_t *rtsp_adapter_create(void)
 {
-    g_session_id[0] = '\0';
-    g_session_established = false;
-    g_setup_success_count = 0;
-    g_play_success_count = 0;
-    g_last_req_cseq = -1;
-    strcpy(g_last_req_method, "mNotSet");
-    g_last_req_has_session = false;
-    g_last_req_session_id[0] = '\0';
-    g_last_req_transport_udp = false;
-    g_last_req_transport_tcp = false;
-    g_last_req_client_ports = false;
-    g_total_tracks = 0;
-    g_session_initialized = true;
+    rtsp_adapter_ctx_t *ctx = calloc(1, sizeof(*ctx));
+    if (ctx) rtsp_adapter_reset(ctx);
+    return ctx;
 }
 
-/* --- Helpers for parsing RTSP text --- */
+void rtsp_adapter_reset(rtsp_adapter_ctx_t *ctx)
+{
+    ctx->session_id[0] = '\0';
+    ctx->session_established = false;
+    ctx->setup_success_count = 0;
+    ctx->play_success_count = 0;
+    ctx->last_req_cseq = -1;
+    strcpy(ctx->last_req_method, "mNotSet");
+    ctx->last_req_has_session = false;
+    ctx->last_req_session_id[0] = '\0';
+    ctx->last_req_transport_udp = false;
+    ctx->last_req_transport_tcp = false;
+    ctx->last_req_client_ports = false;
+    ctx->total_tracks = 0;
+}
 
-static inline bool starts_with(const char *str, const char *prefix)
+void rtsp_adapter_destroy(rtsp_adapter_ctx_t *ctx)
 {
-    return strncasecmp(str, prefix, strlen(prefix)) == 0;
+    free(ctx);
 }
 
+/* --- Helpers for parsing RTSP text --- */
+
 static inline void skip_whitespace(const char **p)
 {
     while (**p && isspace((unsigned char)**p)) (*p)++;
@@ -130,26 +115,15 @@ static void parse_request_method(const char *line, char *method, size_t method_s
 }
 
 /* Parse CSeq header value */
-static int parse_cseq(const char *line)
+static int parse_cseq(const char *value)
 {
-    const char *p = strchr(line, ':');
-    if (!p) return -1;
-    p++;
-    skip_whitespace(&p);
-    return atoi(p);
+    return atoi(value);
 }
 
 /* Parse Session header value (extract session ID) */
-static void parse_session(const char *line, char *session_id, size_t sz)
+static void parse_session(const char *value, char *session_id, size_t sz)
 {
-    const char *p = strchr(line, ':');
-    if (!p) {
-        session_id[0] = '\0';
-        return;
-    }
-    p++;
-    skip_whitespace(&p);
-    
+    const char *p = value;
     size_t i = 0;
     // Session ID ends at ';' or whitespace
     while (*p && *p != ';' && !isspace((unsigned char)*p) && i < sz - 1) {
@@ -159,7 +133,7 @@ static void parse_session(const char *line, char *session_id, size_t sz)
 }
 
 /* Parse Transport header for UDP/TCP and port info */
-static void parse_transport(const char *line, bool *has_udp, bool *has_tcp,
+static void parse_transport(const char *p, bool *has_udp, bool *has_tcp,
                            bool *has_client_ports, bool *has_server_ports)
 {
     *has_udp = false;
@@ -167,10 +141,6 @@ static void parse_transport(const char *line, bool *has_udp, bool *has_tcp,
     *has_client_ports = false;
     *has_server_ports = false;
     
-    const char *p = strchr(line, ':');
-    if (!p) return;
-    p++;
-    
     // Check for RTP/AVP (UDP) vs RTP/AVP/TCP (interleaved)
     if (strstr(p, "RTP/AVP/TCP") || strstr(p, "interleaved")) {
         *has_tcp = true;
@@ -212,8 +182,7 @@ static bool is_malformed_request(const unsigned char *buf, unsigned int len)
     // Valid requests start with method name (all caps)
     if (!isupper(buf[0])) return true;
     // Should contain "RTSP/1.0"
-    const char *rtsp_marker = "RTSP/1.0";
-    if (!memmem(buf, len, rtsp_marker, strlen(rtsp_marker))) return true;
+    if (!hdr_contains(buf, len, "RTSP/1.0")) return true;
     return false;
 }
 
@@ -227,15 +196,12 @@ static bool is_malformed_response(const unsigned char *buf, unsigned int len)
 
 /* --- Public builders --- */
 
-void rtsp_build_request_pred_line(const unsigned char *buf,
+void rtsp_build_request_pred_line(rtsp_adapter_ctx_t *ctx,
+                                  const unsigned char *buf,
                                   unsigned int len,
                                   char *out,
                                   size_t out_sz)
 {
-    if (!g_session_initialized) {
-        rtsp_predicate_reset_session();
-    }
-    
     // Default values
     char method[32] = "mNotSet";
     int req_cseq = -1;
@@ -255,21 +221,21 @@ void rtsp_build_request_pred_line(const unsigned char *buf,
         extract_line(buf, len, &offset, line, sizeof(line));
         parse_request_method(line, method, sizeof(method));
         
-        // Parse headers
-        while (offset < len) {
-            extract_line(buf, len, &offset, line, sizeof(line));
-            if (strlen(line) == 0) break; // Empty line = end of headers
-            
-            if (starts_with(line, "CSeq:")) {
-                req_cseq = parse_cseq(line);
-            } else if (starts_with(line, "Session:")) {
-                req_has_session = true;
-                parse_session(line, req_session_id, sizeof(req_session_id));
-            } else if (starts_with(line, "Transport:")) {
-                bool dummy_server_ports;
-                parse_transport(line, &transport_req_udp, &transport_req_tcp,
-                              &transport_client_ports, &dummy_server_ports);
-            }
+        // Parse headers (the last occurrence of each one wins)
+        hdr_index_t ix;
+        hdr_index_build(&ix, buf, len);
+        
+        if (hdr_index_copy_last(&ix, "CSeq", line, sizeof(line))) {
+            req_cseq = parse_cseq(line);
+        }
+        if (hdr_index_copy_last(&ix, "Session", line, sizeof(line))) {
+            req_has_session = true;
+            parse_session(line, req_session_id, sizeof(req_session_id));
+        }
+        if (hdr_index_copy_last(&ix, "Transport", line, sizeof(line))) {
+            bool dummy_server_ports;
+            parse_transport(line, &transport_req_udp, &transport_req_tcp,
+                          &transport_client_ports, &dummy_server_ports);
         }
         
         // Check if this is GET_PARAMETER with Session (keep-alive)
@@ -279,25 +245,25 @@ void rtsp_build_request_pred_line(const unsigned char *buf,
     }
     
     // Save request state for correlation with response
-    g_last_req_cseq = req_cseq;
-    strncpy(g_last_req_method, method, sizeof(g_last_req_method) - 1);
-    g_last_req_has_session = req_has_session;
-    strncpy(g_last_req_session_id, req_session_id, sizeof(g_last_req_session_id) - 1);
-    g_last_req_transport_udp = transport_req_udp;
-    g_last_req_transport_tcp = transport_req_tcp;
-    g_last_req_client_ports = transport_client_ports;
+    ctx->last_req_cseq = req_cseq;
+    strncpy(ctx->last_req_method, method, sizeof(ctx->last_req_method) - 1);
+    ctx->last_req_has_session = req_has_session;
+    strncpy(ctx->last_req_session_id, req_session_id, sizeof(ctx->last_req_session_id) - 1);
+    ctx->last_req_transport_udp = transport_req_udp;
+    ctx->last_req_transport_tcp = transport_req_tcp;
+    ctx->last_req_client_ports = transport_client_ports;
     
     // Check session ID match (only relevant if session established)
     bool session_id_match = false;
-    if (g_session_established && req_has_session) {
-        session_id_match = (strcmp(req_session_id, g_session_id) == 0);
+    if (ctx->session_established && req_has_session) {
+        session_id_match = (strcmp(req_session_id, ctx->session_id) == 0);
     }
     
     // TEARDOWN analysis
     bool teardown_for_existing = false;
     bool teardown_without_session = false;
     if (strcmp(method, "TEARDOWN") == 0) {
-        if (req_has_session && g_session_established && session_id_match) {
+        if (req_has_session && ctx->session_established && session_id_match) {
             teardown_for_existing = true;
         }
         if (!req_has_session) {
@@ -322,29 +288,26 @@ void rtsp_build_request_pred_line(const unsigned char *buf,
              req_cseq,
              req_malformed ? "true" : "false",
              req_has_session ? "true" : "false",
-             g_session_established ? "true" : "false",
+             ctx->session_established ? "true" : "false",
              session_id_match ? "true" : "false",
              teardown_for_existing ? "true" : "false",
              teardown_without_session ? "true" : "false",
              transport_req_udp ? "true" : "false",
              transport_req_tcp ? "true" : "false",
              transport_client_ports ? "true" : "false",
-             g_setup_success_count,
-             g_play_success_count,
-             (g_total_tracks > 0 && g_setup_success_count >= g_total_tracks) ? "true" : "false",
+             ctx->setup_success_count,
+             ctx->play_success_count,
+             (ctx->total_tracks > 0 && ctx->setup_success_count >= ctx->total_tracks) ? "true" : "false",
              keepalive_getparam ? "true" : "false");
-    append_packet_trace(out, out_sz, buf, len, "C2S");
+    append_packet_trace(ctx, out, out_sz, buf, len, "C2S");
 }
 
-void rtsp_build_response_pred_line(const unsigned char *buf,
+void rtsp_build_response_pred_line(rtsp_adapter_ctx_t *ctx,
+                                   const unsigned char *buf,
                                    unsigned int len,
                                    char *out,
                                    size_t out_sz)
 {
-    if (!g_session_initialized) {
-        rtsp_predicate_reset_session();
-    }
-    
     // Default values
     int resp_status_code = 0;
     int resp_cseq = -1;
@@ -364,21 +327,21 @@ void rtsp_build_response_pred_line(const unsigned char *buf,
         extract_line(buf, len, &offset, line, sizeof(line));
         resp_status_code = parse_response_status(line);
         
-        // Parse headers
-        while (offset < len) {
-            extract_line(buf, len, &offset, line, sizeof(line));
-            if (strlen(line) == 0) break;
-            
-            if (starts_with(line, "CSeq:")) {
-                resp_cseq = parse_cseq(line);
-            } else if (starts_with(line, "Session:")) {
-                resp_has_session = true;
-                parse_session(line, resp_session_id, sizeof(resp_session_id));
-            } else if (starts_with(line, "Transport:")) {
-                bool dummy_client_ports;
-                parse_transport(line, &transport_resp_udp, &transport_resp_tcp,
-                              &dummy_client_ports, &transport_server_ports);
-            }
+        // Parse headers (the last occurrence of each one wins)
+        hdr_index_t ix;
+        hdr_index_build(&ix, buf, len);
+        
+        if (hdr_index_copy_last(&ix, "CSeq", line, sizeof(line))) {
+            resp_cseq = parse_cseq(line);
+        }
+        if (hdr_index_copy_last(&ix, "Session", line, sizeof(line))) {
+            resp_has_session = true;
+            parse_session(line, resp_session_id, sizeof(resp_session_id));
+        }
+        if (hdr_index_copy_last(&ix, "Transport", line, sizeof(line))) {
+            bool dummy_client_ports;
+            parse_transport(line, &transport_resp_udp, &transport_resp_tcp,
+                          &dummy_client_ports, &transport_server_ports);
         }
     } else if (len == 0) {
         // Empty response = timeout
@@ -386,60 +349,60 @@ void rtsp_build_response_pred_line(const unsigned char *buf,
     }
     
     const char *status_class = get_status_class(resp_status_code);
-    bool cseq_match = (g_last_req_cseq > 0 && resp_cseq > 0 && 
-                       g_last_req_cseq == resp_cseq);
+    bool cseq_match = (ctx->last_req_cseq > 0 && resp_cseq > 0 && 
+                       ctx->last_req_cseq == resp_cseq);
     
     // Update session state
     bool session_id_changed = false;
-    if (strcmp(g_last_req_method, "SETUP") == 0 && 
+    if (strcmp(ctx->last_req_method, "SETUP") == 0 && 
         strcmp(status_class, "SUCCESS") == 0 && resp_has_session) {
         
-        if (!g_session_established) {
+        if (!ctx->session_established) {
             // First successful SETUP establishes session
-            strncpy(g_session_id, resp_session_id, sizeof(g_session_id) - 1);
-            g_session_established = true;
-            g_total_tracks = 1;
+            strncpy(ctx->session_id, resp_session_id, sizeof(ctx->session_id) - 1);
+            ctx->session_established = true;
+            ctx->total_tracks = 1;
         } else {
             // Check if session ID changed
-            if (strcmp(g_session_id, resp_session_id) != 0) {
+            if (strcmp(ctx->session_id, resp_session_id) != 0) {
                 session_id_changed = true;
             }
         }
-        g_setup_success_count++;
+        ctx->setup_success_count++;
     }
     
     // Track successful PLAY
-    if (strcmp(g_last_req_method, "PLAY") == 0 && strcmp(status_class, "SUCCESS") == 0) {
-        g_play_success_count++;
+    if (strcmp(ctx->last_req_method, "PLAY") == 0 && strcmp(status_class, "SUCCESS") == 0) {
+        ctx->play_success_count++;
     }
     
     // Check session ID match with request
     bool session_id_match = false;
-    if (g_last_req_has_session && g_session_established) {
-        session_id_match = (strcmp(g_last_req_session_id, g_session_id) == 0);
+    if (ctx->last_req_has_session && ctx->session_established) {
+        session_id_match = (strcmp(ctx->last_req_session_id, ctx->session_id) == 0);
     }
     
     // TEARDOWN tracking
     bool teardown_for_existing = false;
     bool teardown_without_session = false;
-    if (strcmp(g_last_req_method, "TEARDOWN") == 0) {
-        if (g_last_req_has_session && g_session_established && session_id_match) {
+    if (strcmp(ctx->last_req_method, "TEARDOWN") == 0) {
+        if (ctx->last_req_has_session && ctx->session_established && session_id_match) {
             teardown_for_existing = true;
         }
-        if (!g_last_req_has_session) {
+        if (!ctx->last_req_has_session) {
             teardown_without_session = true;
         }
         
         // Successful TEARDOWN ends session
         if (strcmp(status_class, "SUCCESS") == 0) {
-            g_session_established = false;
+            ctx->session_established = false;
         }
     }
     
     // Keep-alive failure detection
     bool keepalive_failed = false;
-    if (strcmp(g_last_req_method, "GET_PARAMETER") == 0 && 
-        g_last_req_has_session) {
+    if (strcmp(ctx->last_req_method, "GET_PARAMETER") == 0 && 
+        ctx->last_req_has_session) {
         if (timeout || strcmp(status_class, "CLIENT_ERR") == 0 || 
             strcmp(status_class, "SERVER_ERR") == 0) {
             keepalive_failed = true;
@@ -459,31 +422,36 @@ void rtsp_build_response_pred_line(const unsigned char *buf,
              "transport_client_ports_present=%s transport_server_ports_present=%s "
              "setup_success_count=%d play_success_count=%d all_tracks_setup=%s "
              "keepalive_getparam=false keepalive_failed=%s timeout=%s",
-             g_last_req_method,
+             ctx->last_req_method,
              status_class,
-             g_last_req_cseq,
+             ctx->last_req_cseq,
              resp_cseq,
              resp_status_code,
              "false", // req_malformed was already checked in request
              resp_malformed ? "true" : "false",
              cseq_match ? "true" : "false",
-             g_last_req_has_session ? "true" : "false",
+             ctx->last_req_has_session ? "true" : "false",
              resp_has_session ? "true" : "false",
-             g_session_established ? "true" : "false",
+             ctx->session_established ? "true" : "false",
              session_id_match ? "true" : "false",
              session_id_changed ? "true" : "false",
              teardown_for_existing ? "true" : "false",
              teardown_without_session ? "true" : "false",
-             g_last_req_transport_udp ? "true" : "false",
-             g_last_req_transport_tcp ? "true" : "false",
+             ctx->last_req_transport_udp ? "true" : "false",
+             ctx->last_req_transport_tcp ? "true" : "false",
              transport_resp_udp ? "true" : "false",
              transport_resp_tcp ? "true" : "false",
-             g_last_req_client_ports ? "true" : "false",
+             ctx->last_req_client_ports ? "true" : "false",
              transport_server_ports ? "true" : "false",
-             g_setup_success_count,
-             g_play_success_count,
-             (g_total_tracks > 0 && g_setup_success_count >= g_total_tracks) ? "true" : "false",
+             ctx->setup_success_count,
+             ctx->play_success_count,
+             (ctx->total_tracks > 0 && ctx->setup_success_count >= ctx->total_tracks) ? "true" : "false",
              keepalive_failed ? "true" : "false",
              timeout ? "true" : "false");
-     append_packet_trace(out, out_sz, buf, len, "S2C");
-}
\ No newline at end of file
+     append_packet_trace(ctx, out, out_sz, buf, len, "S2C");
+}
+
+PREDICATE_ADAPTER_DEFINE(rtsp, rtsp_adapter_ctx_t,
+                         rtsp_build_request_pred_line,
+                         rtsp_build_response_pred_line,
+                         PRED_FRAME_TEXT);
@@ -6,6 +6,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "predicate_adapter.h"
+
 /*
  * RTSP predicate adapter for Live555 fuzzing.
  *
@@ -36,21 +38,30 @@
 extern "C" {
 #endif
 
-/* Reset per-session adapter state (session ID, counters, etc.). */
-void rtsp_predicate_reset_session(void);
+/* Per-session decoding state (session ID, counters, msg_id, etc.).
+ * One context per concurrently decoded session. */
+typedef struct rtsp_adapter_ctx rtsp_adapter_ctx_t;
+
+rtsp_adapter_ctx_t *rtsp_adapter_create(void);
+void rtsp_adapter_reset(rtsp_adapter_ctx_t *ctx);
+void rtsp_adapter_destroy(rtsp_adapter_ctx_t *ctx);
 
 /* Build predicate line for a client→server RTSP request. */
-void rtsp_build_request_pred_line(const unsigned char *buf,
+void rtsp_build_request_pred_line(rtsp_adapter_ctx_t *ctx,
+                                  const unsigned char *buf,
                                   unsigned int len,
                                   char *out,
                                   size_t out_sz);
 
 /* Build predicate line for a server→client RTSP response. */
-void rtsp_build_response_pred_line(const unsigned char *buf,
+void rtsp_build_response_pred_line(rtsp_adapter_ctx_t *ctx,
+                                   const unsigned char *buf,
                                    unsigned int len,
                                    char *out,
                                    size_t out_sz);
 
+extern const predicate_adapter_t rtsp_predicate_adapter;
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,5 +1,6 @@
 // sip_predicate_adapter.c
 #include "sip_predicate_adapter.h"
+#include "header_index.h"
 
 #include <string.h>
 #include <stdio.h>
@@ -10,7 +11,7 @@
 // Session State Tracking
 // ============================================================================
 
-static struct {
+struct sip_adapter_ctx {
     // Dialog state
     bool dialog_established;
     bool dialog_terminated;
@@ -48,27 +49,27 @@ static struct {
     // Connection state
     bool connection_closed;
     
-} g_sip_state;
+};
 
-void sip_predicate_reset_session(void) {
-    memset(&g_sip_state, 0, sizeof(g_sip_state));
-    strcpy(g_sip_state.last_method, "mNotSet");
+sip_adapter_ctx_t *sip_adapter_create(void) {
+    sip_adapter_ctx_t *ctx = calloc(1, sizeof(*ctx));
+    if (ctx) sip_adapter_reset(ctx);
+    return ctx;
 }
 
-// ============================================================================
-// Helper Functions
-// ============================================================================
-
-static inline void skip_ws(const char **p) {
-    while (**p && isspace((unsigned char)**p)) (*p)++;
+void sip_adapter_reset(sip_adapter_ctx_t *ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+    strcpy(ctx->last_method, "mNotSet");
 }
 
-static inline void skip_line(const char **p) {
-    while (**p && **p != '\r' && **p != '\n') (*p)++;
-    if (**p == '\r') (*p)++;
-    if (**p == '\n') (*p)++;
+void sip_adapter_destroy(sip_adapter_ctx_t *ctx) {
+    free(ctx);
 }
 
+// ============================================================================
+// Helper Functions
+// ============================================================================
+
 // Extract SIP method from request line
 static void extract_method(const unsigned char *buf, unsigned int len,
                           char *method, size_t method_sz) {
@@ -123,42 +124,9 @@ static const char* map_status_class(int code) {
     return "scNotSet";
 }
 
-// Find header value
-static bool find_header(const unsigned char *buf, unsigned int len,
-                       const char *header_name, char *value, size_t value_sz) {
-    const char *p = (const char*)buf;
-    const char *end = p + len;
-    size_t hdr_len = strlen(header_name);
-    
-    // Skip first line (request/status line)
-    skip_line(&p);
-    
-    while (p < end) {
-        // Check if we've reached the end of headers
-        if (*p == '\r' || *p == '\n') break;
-        
-        // Check if this line starts with the header we're looking for
-        if (strncasecmp(p, header_name, hdr_len) == 0 && p[hdr_len] == ':') {
-            p += hdr_len + 1;
-            skip_ws(&p);
-            
-            // Extract value
-            size_t i = 0;
-            while (i < value_sz - 1 && p < end && *p != '\r' && *p != '\n') {
-                value[i++] = *p++;
-            }
-            value[i] = '\0';
-            return true;
-        }
-        
-        skip_line(&p);
-    }
-    
-    return false;
-}
-
 // Check if message is malformed
-static bool is_malformed_request(const unsigned char *buf, unsigned int len) {
+static bool is_malformed_request(const unsigned char *buf, unsigned int len,
+                                 const hdr_index_t *ix) {
     if (len < 10) return true; // Too short
     
     // Must start with method
@@ -166,12 +134,12 @@ static bool is_malformed_request(const unsigned char *buf, unsigned int len) {
     if (!isalpha(*p)) return true;
     
     // Must have SIP/2.0
-    if (!strstr((const char*)buf, "SIP/2.0")) return true;
+    if (!hdr_contains(buf, len, "SIP/2.0")) return true;
     
     // Check for mandatory headers (basic check)
-    if (!strstr((const char*)buf, "Via:") && !strstr((const char*)buf, "via:")) return true;
-    if (!strstr((const char*)buf, "Call-ID:") && !strstr((const char*)buf, "call-id:")) return true;
-    if (!strstr((const char*)buf, "CSeq:") && !strstr((const char*)buf, "cseq:")) return true;
+    if (!hdr_index_has(ix, "Via")) return true;
+    if (!hdr_index_has(ix, "Call-ID")) return true;
+    if (!hdr_index_has(ix, "CSeq")) return true;
     
     return false;
 }
@@ -209,7 +177,8 @@ static void extract_tag(const char *header_value, char *tag, size_t tag_sz) {
 // Public API
 // ============================================================================
 
-void sip_build_request_pred_line(const unsigned char *buf,
+void sip_build_request_pred_line(sip_adapter_ctx_t *ctx,
+                                  const unsigned char *buf,
                                   unsigned int len,
                                   char *out,
                                   size_t out_sz) {
@@ -219,92 +188,94 @@ void sip_build_request_pred_line(const unsigned char *buf,
     const char *method_enum = map_sip_method(method_str);
     
     // Save last method
-    strncpy(g_sip_state.last_method, method_enum, sizeof(g_sip_state.last_method) - 1);
+    strncpy(ctx->last_method, method_enum, sizeof(ctx->last_method) - 1);
     
-    // Extract headers
+    // Index the headers once; every lookup below is a hash probe
+    hdr_index_t ix;
+    hdr_index_build(&ix, buf, len);
     char header_value[256];
-    bool has_via = find_header(buf, len, "Via", header_value, sizeof(header_value));
-    bool has_cseq = find_header(buf, len, "CSeq", header_value, sizeof(header_value));
-    bool has_call_id = find_header(buf, len, "Call-ID", header_value, sizeof(header_value));
-    bool has_contact = find_header(buf, len, "Contact", header_value, sizeof(header_value));
+    bool has_via = hdr_index_copy(&ix, "Via", header_value, sizeof(header_value));
+    bool has_cseq = hdr_index_copy(&ix, "CSeq", header_value, sizeof(header_value));
+    bool has_call_id = hdr_index_copy(&ix, "Call-ID", header_value, sizeof(header_value));
+    bool has_contact = hdr_index_copy(&ix, "Contact", header_value, sizeof(header_value));
     
     // Extract CSeq number
     int cseq_num = 0;
     if (has_cseq) {
         cseq_num = atoi(header_value);
-        g_sip_state.cseq_number = cseq_num;
+        ctx->cseq_number = cseq_num;
     }
     
     // Extract Call-ID
     if (has_call_id) {
-        strncpy(g_sip_state.call_id, header_value, sizeof(g_sip_state.call_id) - 1);
+        strncpy(ctx->call_id, header_value, sizeof(ctx->call_id) - 1);
     }
     
     // Extract From tag
     char from_tag[64] = "";
-    if (find_header(buf, len, "From", header_value, sizeof(header_value))) {
+    if (hdr_index_copy(&ix, "From", header_value, sizeof(header_value))) {
         extract_tag(header_value, from_tag, sizeof(from_tag));
         if (from_tag[0]) {
-            strncpy(g_sip_state.from_tag, from_tag, sizeof(g_sip_state.from_tag) - 1);
+            strncpy(ctx->from_tag, from_tag, sizeof(ctx->from_tag) - 1);
         }
     }
     
     // Extract To tag
     char to_tag[64] = "";
     bool has_to_tag = false;
-    if (find_header(buf, len, "To", header_value, sizeof(header_value))) {
+    if (hdr_index_copy(&ix, "To", header_value, sizeof(header_value))) {
         extract_tag(header_value, to_tag, sizeof(to_tag));
         has_to_tag = (to_tag[0] != '\0');
     }
     
     // Extract other headers
     int expires = 3600; // Default
-    if (find_header(buf, len, "Expires", header_value, sizeof(header_value))) {
+    if (hdr_index_copy(&ix, "Expires", header_value, sizeof(header_value))) {
         expires = atoi(header_value);
     }
     
     int max_forwards = 70; // Default
-    if (find_header(buf, len, "Max-Forwards", header_value, sizeof(header_value))) {
+    if (hdr_index_copy(&ix, "Max-Forwards", header_value, sizeof(header_value))) {
         max_forwards = atoi(header_value);
     }
     
     int content_length = 0;
-    if (find_header(buf, len, "Content-Length", header_value, sizeof(header_value))) {
+    if (hdr_index_copy(&ix, "Content-Length", header_value, sizeof(header_value))) {
         content_length = atoi(header_value);
     }
     
-    bool has_sdp = (content_length > 0 && strstr((const char*)buf, "application/sdp"));
-    bool has_auth = find_header(buf, len, "Authorization", header_value, sizeof(header_value)) ||
-                    find_header(buf, len, "Proxy-Authorization", header_value, sizeof(header_value));
+    bool has_sdp = (content_length > 0 && hdr_contains(buf, len, "application/sdp"));
+    bool has_auth = hdr_index_copy(&ix, "Authorization", header_value, sizeof(header_value)) ||
+                    hdr_index_copy(&ix, "Proxy-Authorization", header_value, sizeof(header_value));
     
     // Update state based on method
     if (strcmp(method_enum, "mINVITE") == 0) {
-        g_sip_state.invite_sent = true;
-        g_sip_state.invite_in_progress = true;
+        ctx->invite_sent = true;
+        ctx->invite_in_progress = true;
     } else if (strcmp(method_enum, "mACK") == 0) {
-        g_sip_state.ack_sent = true;
+        ctx->ack_sent = true;
     } else if (strcmp(method_enum, "mBYE") == 0) {
-        g_sip_state.bye_sent = true;
+        ctx->bye_sent = true;
     } else if (strcmp(method_enum, "mCANCEL") == 0) {
-        g_sip_state.cancel_sent = true;
+        ctx->cancel_sent = true;
     } else if (strcmp(method_enum, "mREGISTER") == 0) {
-        g_sip_state.register_sent = true;
-        g_sip_state.auth_provided = has_auth;
+        ctx->register_sent = true;
+        ctx->auth_provided = has_auth;
     }
     
     // Determine states
     const char *dialog_state = "dsNone";
-    if (g_sip_state.dialog_terminated) dialog_state = "dsTerminated";
-    else if (g_sip_state.dialog_established) dialog_state = "dsConfirmed";
-    else if (g_sip_state.early_dialog) dialog_state = "dsEarly";
+    if (ctx->dialog_terminated) dialog_state = "dsTerminated";
+    else if (ctx->dialog_established) dialog_state = "dsConfirmed";
+    else if (ctx->early_dialog) dialog_state = "dsEarly";
     
-    const char *transaction_state = g_sip_state.transaction_pending ? "tsProceeding" : "tsNone";
+    const char *transaction_state = ctx->transaction_pending ? "tsProceeding" : "tsNone";
     
     const char *registration_state = "rsNotRegistered";
-    if (g_sip_state.registered) registration_state = "rsRegistered";
-    else if (g_sip_state.register_sent) registration_state = "rsRegistering";
+    if (ctx->registered) registration_state = "rsRegistered";
+    else if (ctx->register_sent) registration_state = "rsRegistering";
     
-    bool req_malformed = is_malformed_request(buf, len);
+    bool req_malformed = is_malformed_request(buf, len, &ix);
     bool method_creates_dialog = (strcmp(method_enum, "mINVITE") == 0 || 
                                   strcmp(method_enum, "mSUBSCRIBE") == 0);
     bool method_requires_dialog = (strcmp(method_enum, "mBYE") == 0 || 
@@ -336,29 +307,30 @@ void sip_build_request_pred_line(const unsigned char *buf,
              has_via ? "true" : "false",
              has_contact ? "true" : "false",
              has_sdp ? "true" : "false",
-             g_sip_state.connection_closed ? "true" : "false",
-             g_sip_state.dialog_established ? "true" : "false",
-             g_sip_state.dialog_terminated ? "true" : "false",
-             g_sip_state.early_dialog ? "true" : "false",
-             g_sip_state.invite_sent ? "true" : "false",
-             g_sip_state.invite_received ? "true" : "false",
-             g_sip_state.ack_sent ? "true" : "false",
-             g_sip_state.bye_sent ? "true" : "false",
-             g_sip_state.cancel_sent ? "true" : "false",
-             g_sip_state.transaction_pending ? "true" : "false",
-             g_sip_state.final_response_sent ? "true" : "false",
-             g_sip_state.provisional_sent ? "true" : "false",
-             g_sip_state.register_sent ? "true" : "false",
-             g_sip_state.registered ? "true" : "false",
-             g_sip_state.auth_required ? "true" : "false",
-             g_sip_state.auth_provided ? "true" : "false",
-             g_sip_state.invite_in_progress ? "true" : "false",
+             ctx->connection_closed ? "true" : "false",
+             ctx->dialog_established ? "true" : "false",
+             ctx->dialog_terminated ? "true" : "false",
+             ctx->early_dialog ? "true" : "false",
+             ctx->invite_sent ? "true" : "false",
+             ctx->invite_received ? "true" : "false",
+             ctx->ack_sent ? "true" : "false",
+             ctx->bye_sent ? "true" : "false",
+             ctx->cancel_sent ? "true" : "false",
+             ctx->transaction_pending ? "true" : "false",
+             ctx->final_response_sent ? "true" : "false",
+             ctx->provisional_sent ? "true" : "false",
+             ctx->register_sent ? "true" : "false",
+             ctx->registered ? "true" : "false",
+             ctx->auth_required ? "true" : "false",
+             ctx->auth_provided ? "true" : "false",
+             ctx->invite_in_progress ? "true" : "false",
              method_requires_dialog ? "true" : "false",
              method_creates_dialog ? "true" : "false",
              dialog_state, transaction_state, registration_state);
 }
 
-void sip_build_response_pred_line(const unsigned char *buf,
+void sip_build_response_pred_line(sip_adapter_ctx_t *ctx,
+                                   const unsigned char *buf,
                                    unsigned int len,
                                    char *out,
                                    size_t out_sz) {
@@ -367,81 +339,83 @@ void sip_build_response_pred_line(const unsigned char *buf,
     bool resp_malformed = is_malformed_response(buf, len);
     bool timeout = (len == 0);
     
-    g_sip_state.last_resp_code = resp_code;
+    ctx->last_resp_code = resp_code;
     
-    // Extract headers
+    // Index the headers once; every lookup below is a hash probe
+    hdr_index_t ix;
+    hdr_index_build(&ix, buf, len);
     char header_value[256];
     
     // Extract To tag from response
     char to_tag[64] = "";
     bool has_to_tag = false;
-    if (find_header(buf, len, "To", header_value, sizeof(header_value))) {
+    if (hdr_index_copy(&ix, "To", header_value, sizeof(header_value))) {
         extract_tag(header_value, to_tag, sizeof(to_tag));
         has_to_tag = (to_tag[0] != '\0');
         if (has_to_tag) {
-            strncpy(g_sip_state.to_tag, to_tag, sizeof(g_sip_state.to_tag) - 1);
+            strncpy(ctx->to_tag, to_tag, sizeof(ctx->to_tag) - 1);
         }
     }
     
     int content_length = 0;
-    if (find_header(buf, len, "Content-Length", header_value, sizeof(header_value))) {
+    if (hdr_index_copy(&ix, "Content-Length", header_value, sizeof(header_value))) {
         content_length = atoi(header_value);
     }
     
-    bool has_sdp = (content_length > 0 && strstr((const char*)buf, "application/sdp"));
+    bool has_sdp = (content_length > 0 && hdr_contains(buf, len, "application/sdp"));
     
     // Update state based on response
     if (resp_code >= 100 && resp_code < 200) {
-        g_sip_state.transaction_pending = true;
-        g_sip_state.provisional_sent = true;
+        ctx->transaction_pending = true;
+        ctx->provisional_sent = true;
         
         // Early dialog after 1xx with To tag
-        if (has_to_tag && strcmp(g_sip_state.last_method, "mINVITE") == 0) {
-            g_sip_state.early_dialog = true;
+        if (has_to_tag && strcmp(ctx->last_method, "mINVITE") == 0) {
+            ctx->early_dialog = true;
         }
     } else if (resp_code >= 200) {
-        g_sip_state.final_response_sent = true;
-        g_sip_state.transaction_pending = false;
+        ctx->final_response_sent = true;
+        ctx->transaction_pending = false;
         
         if (resp_code == 200) {
             // Dialog established after 200 OK to INVITE
-            if (strcmp(g_sip_state.last_method, "mINVITE") == 0) {
-                g_sip_state.dialog_established = true;
-                g_sip_state.invite_in_progress = false;
+            if (strcmp(ctx->last_method, "mINVITE") == 0) {
+                ctx->dialog_established = true;
+                ctx->invite_in_progress = false;
             }
             
             // Registration successful
-            if (strcmp(g_sip_state.last_method, "mREGISTER") == 0) {
-                g_sip_state.registered = true;
-                g_sip_state.auth_required = false;
+            if (strcmp(ctx->last_method, "mREGISTER") == 0) {
+                ctx->registered = true;
+                ctx->auth_required = false;
             }
             
             // Dialog terminated after 200 OK to BYE
-            if (strcmp(g_sip_state.last_method, "mBYE") == 0) {
-                g_sip_state.dialog_terminated = true;
-                g_sip_state.dialog_established = false;
+            if (strcmp(ctx->last_method, "mBYE") == 0) {
+                ctx->dialog_terminated = true;
+                ctx->dialog_established = false;
             }
         } else if (resp_code == 401 || resp_code == 407) {
-            g_sip_state.auth_required = true;
+            ctx->auth_required = true;
         } else if (resp_code == 487) {
             // Request terminated (after CANCEL)
-            g_sip_state.invite_in_progress = false;
+            ctx->invite_in_progress = false;
         }
     }
     
     // Determine states
     const char *dialog_state = "dsNone";
-    if (g_sip_state.dialog_terminated) dialog_state = "dsTerminated";
-    else if (g_sip_state.dialog_established) dialog_state = "dsConfirmed";
-    else if (g_sip_state.early_dialog) dialog_state = "dsEarly";
+    if (ctx->dialog_terminated) dialog_state = "dsTerminated";
+    else if (ctx->dialog_established) dialog_state = "dsConfirmed";
+    else if (ctx->early_dialog) dialog_state = "dsEarly";
     
     const char *transaction_state = "tsNone";
-    if (g_sip_state.final_response_sent) transaction_state = "tsCompleted";
-    else if (g_sip_state.transaction_pending) transaction_state = "tsProceeding";
+    if (ctx->final_response_sent) transaction_state = "tsCompleted";
+    else if (ctx->transaction_pending) transaction_state = "tsProceeding";
     
     const char *registration_state = "rsNotRegistered";
-    if (g_sip_state.registered) registration_state = "rsRegistered";
-    else if (g_sip_state.register_sent) registration_state = "rsRegistering";
+    if (ctx->registered) registration_state = "rsRegistered";
+    else if (ctx->register_sent) registration_state = "rsRegistering";
     
     // Generate predicate line
     snprintf(out, out_sz,
@@ -459,30 +433,35 @@ void sip_build_response_pred_line(const unsigned char *buf,
              "invite_in_progress=%s method_requires_dialog=false method_creates_dialog=false "
              "cseq_matches=true callid_matches=true to_tag_matches=true from_tag_matches=true via_matches=true "
              "dialog_state=%s transaction_state=%s registration_state=%s",
-             g_sip_state.last_method,
+             ctx->last_method,
              status_class,
-             resp_code, g_sip_state.cseq_number, content_length,
+             resp_code, ctx->cseq_number, content_length,
              resp_malformed ? "true" : "false",
              has_to_tag ? "true" : "false",
              (resp_code == 200) ? "true" : "false",
              has_sdp ? "true" : "false",
              timeout ? "true" : "false",
-             g_sip_state.connection_closed ? "true" : "false",
-             g_sip_state.dialog_established ? "true" : "false",
-             g_sip_state.dialog_terminated ? "true" : "false",
-             g_sip_state.early_dialog ? "true" : "false",
-             g_sip_state.invite_sent ? "true" : "false",
-             g_sip_state.invite_received ? "true" : "false",
-             g_sip_state.ack_sent ? "true" : "false",
-             g_sip_state.bye_sent ? "true" : "false",
-             g_sip_state.cancel_sent ? "true" : "false",
-             g_sip_state.transaction_pending ? "true" : "false",
-             g_sip_state.final_response_sent ? "true" : "false",
-             g_sip_state.provisional_sent ? "true" : "false",
-             g_sip_state.register_sent ? "true" : "false",
-             g_sip_state.registered ? "true" : "false",
-             g_sip_state.auth_required ? "true" : "false",
-             g_sip_state.auth_provided ? "true" : "false",
-             g_sip_state.invite_in_progress ? "true" : "false",
+             ctx->connection_closed ? "true" : "false",
+             ctx->dialog_established ? "true" : "false",
+             ctx->dialog_terminated ? "true" : "false",
+             ctx->early_dialog ? "true" : "false",
+             ctx->invite_sent ? "true" : "false",
+             ctx->invite_received ? "true" : "false",
+             ctx->ack_sent ? "true" : "false",
+             ctx->bye_sent ? "true" : "false",
+             ctx->cancel_sent ? "true" : "false",
+             ctx->transaction_pending ? "true" : "false",
+             ctx->final_response_sent ? "true" : "false",
+             ctx->provisional_sent ? "true" : "false",
+             ctx->register_sent ? "true" : "false",
+             ctx->registered ? "true" : "false",
+             ctx->auth_required ? "true" : "false",
+             ctx->auth_provided ? "true" : "false",
+             ctx->invite_in_progress ? "true" : "false",
              dialog_state, transaction_state, registration_state);
 }
+
+PREDICATE_ADAPTER_DEFINE(sip, sip_adapter_ctx_t,
+                         sip_build_request_pred_line,
+                         sip_build_response_pred_line,
+                         PRED_FRAME_TEXT);
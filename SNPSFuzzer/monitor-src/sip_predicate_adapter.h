@@ -5,6 +5,8 @@
 #include <stddef.h>
 #include <stdbool.h>
 
+#include "predicate_adapter.h"
+
 /*
  * SIP predicate adapter for Kamailio semantic monitoring.
  *
@@ -21,21 +23,30 @@
 extern "C" {
 #endif
 
-/* Reset adapter state for a new SIP session/dialog */
-void sip_predicate_reset_session(void);
+/* Per-session dialog, transaction and registration state.
+ * One context per concurrently decoded session. */
+typedef struct sip_adapter_ctx sip_adapter_ctx_t;
+
+sip_adapter_ctx_t *sip_adapter_create(void);
+void sip_adapter_reset(sip_adapter_ctx_t *ctx);
+void sip_adapter_destroy(sip_adapter_ctx_t *ctx);
 
 /* Build predicate line from SIP request (client → server) */
-void sip_build_request_pred_line(const unsigned char *buf,
+void sip_build_request_pred_line(sip_adapter_ctx_t *ctx,
+                                  const unsigned char *buf,
                                   unsigned int len,
                                   char *out,
                                   size_t out_sz);
 
 /* Build predicate line from SIP response (server → client) */
-void sip_build_response_pred_line(const unsigned char *buf,
+void sip_build_response_pred_line(sip_adapter_ctx_t *ctx,
+                                   const unsigned char *buf,
                                    unsigned int len,
                                    char *out,
                                    size_t out_sz);
 
+extern const predicate_adapter_t sip_predicate_adapter;
+
 #ifdef __cplusplus
 }
 #endif
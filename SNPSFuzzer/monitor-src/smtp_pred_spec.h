@@ -0,0 +1,113 @@
+// smtp_pred_spec.h - generated by ltl_predgen from monitor-bin/smtp.ltl
+// Do not edit; regenerate when the spec changes.
+#ifndef SMTP_PRED_SPEC_H
+#define SMTP_PRED_SPEC_H
+
+#include "pred_record.h"
+
+#define SMTP_PRED_SPEC_HASH 0x31920336u
+
+enum {
+    SMTP_VAR_smtp_command = 0,
+    SMTP_VAR_reply_class = 1,
+    SMTP_VAR_is_request = 2,
+    SMTP_VAR_is_response = 3,
+    SMTP_VAR_reply_malformed = 4,
+    SMTP_VAR_reply_continued = 5,
+    SMTP_VAR_reply_code = 6,
+    SMTP_PRED_NVARS
+};
+
+/* enum smtp_command */
+enum {
+    SMTP_smtp_command_cmdNotSet = 0,
+    SMTP_smtp_command_cmdHELO = 1,
+    SMTP_smtp_command_cmdEHLO = 2,
+    SMTP_smtp_command_cmdMAIL = 3,
+    SMTP_smtp_command_cmdRCPT = 4,
+    SMTP_smtp_command_cmdDATA = 5,
+    SMTP_smtp_command_cmdRSET = 6,
+    SMTP_smtp_command_cmdVRFY = 7,
+    SMTP_smtp_command_cmdEXPN = 8,
+    SMTP_smtp_command_cmdHELP = 9,
+    SMTP_smtp_command_cmdNOOP = 10,
+    SMTP_smtp_command_cmdQUIT = 11,
+    SMTP_smtp_command_cmdSTARTTLS = 12,
+    SMTP_smtp_command_cmdAUTH = 13,
+    SMTP_smtp_command_cmdBDAT = 14
+};
+
+/* enum reply_class */
+enum {
+    SMTP_reply_class_rcNotSet = 0,
+    SMTP_reply_class_rcPositiveCompletion = 1,
+    SMTP_reply_class_rcPositiveIntermediate = 2,
+    SMTP_reply_class_rcTransientNegative = 3,
+    SMTP_reply_class_rcPermanentNegative = 4
+};
+
+static const char *const smtp_pred_var_names[] = {
+    "smtp_command",
+    "reply_class",
+    "is_request",
+    "is_response",
+    "reply_malformed",
+    "reply_continued",
+    "reply_code",
+};
+
+static const uint8_t smtp_pred_var_kinds[] = {
+    PRED_KIND_ENUM,
+    PRED_KIND_ENUM,
+    PRED_KIND_BOOL,
+    PRED_KIND_BOOL,
+    PRED_KIND_BOOL,
+    PRED_KIND_BOOL,
+    PRED_KIND_INT,
+};
+
+static const char *const smtp_pred_smtp_command_values[] = {
+    "cmdNotSet",
+    "cmdHELO",
+    "cmdEHLO",
+    "cmdMAIL",
+    "cmdRCPT",
+    "cmdDATA",
+    "cmdRSET",
+    "cmdVRFY",
+    "cmdEXPN",
+    "cmdHELP",
+    "cmdNOOP",
+    "cmdQUIT",
+    "cmdSTARTTLS",
+    "cmdAUTH",
+    "cmdBDAT",
+};
+
+static const char *const smtp_pred_reply_class_values[] = {
+    "rcNotSet",
+    "rcPositiveCompletion",
+    "rcPositiveIntermediate",
+    "rcTransientNegative",
+    "rcPermanentNegative",
+};
+
+static const char *const *const smtp_pred_enum_values[] = {
+    smtp_pred_smtp_command_values,
+    smtp_pred_reply_class_values,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+};
+
+static const pred_schema_t smtp_pred_schema = {
+    SMTP_PRED_SPEC_HASH,
+    SMTP_PRED_NVARS,
+    smtp_pred_var_names,
+    smtp_pred_var_kinds,
+    smtp_pred_enum_values,
+};
+
+#endif /* SMTP_PRED_SPEC_H */
@@ -0,0 +1,175 @@
+// smtp_predicate_adapter.c - generated by ltl_adaptergen from monitor-src/smtp.adapter
+// Do not edit; regenerate when the description or the spec changes.
+#include "smtp_predicate_adapter.h"
+#include "smtp_pred_spec.h"
+#include "pred_gen_rt.h"
+#include "pred_trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct smtp_adapter_ctx {
+    unsigned int msg_id;
+    int32_t req_smtp_command;
+};
+
+smtp_adapter_ctx_t *smtp_adapter_create(void)
+{
+    return calloc(1, sizeof(smtp_adapter_ctx_t));
+}
+
+void smtp_adapter_reset(smtp_adapter_ctx_t *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void smtp_adapter_destroy(smtp_adapter_ctx_t *ctx)
+{
+    free(ctx);
+}
+
+/* smtp_command (req): 14 keys */
+static const pg_key_t smtp_req_smtp_command[64] = {
+    [6] = { "HELO", 4, SMTP_smtp_command_cmdHELO },
+    [7] = { "HELP", 4, SMTP_smtp_command_cmdHELP },
+    [12] = { "DATA", 4, SMTP_smtp_command_cmdDATA },
+    [23] = { "BDAT", 4, SMTP_smtp_command_cmdBDAT },
+    [33] = { "STARTTLS", 8, SMTP_smtp_command_cmdSTARTTLS },
+    [34] = { "AUTH", 4, SMTP_smtp_command_cmdAUTH },
+    [35] = { "QUIT", 4, SMTP_smtp_command_cmdQUIT },
+    [37] = { "VRFY", 4, SMTP_smtp_command_cmdVRFY },
+    [39] = { "EXPN", 4, SMTP_smtp_command_cmdEXPN },
+    [40] = { "EHLO", 4, SMTP_smtp_command_cmdEHLO },
+    [50] = { "RSET", 4, SMTP_smtp_command_cmdRSET },
+    [55] = { "RCPT", 4, SMTP_smtp_command_cmdRCPT },
+    [59] = { "MAIL", 4, SMTP_smtp_command_cmdMAIL },
+    [60] = { "NOOP", 4, SMTP_smtp_command_cmdNOOP },
+};
+
+void smtp_build_request_record(smtp_adapter_ctx_t *ctx,
+    const unsigned char *buf, unsigned int len, pred_record_t *rec)
+{
+    int32_t v;
+    const unsigned char *s;
+    uint32_t n;
+
+    pred_begin(rec, SMTP_PRED_SPEC_HASH);
+
+    v = pg_token(buf, len, 0, &s, &n)
+            ? pg_lookup(smtp_req_smtp_command, 63, 1u, true, s, n, SMTP_smtp_command_cmdNotSet)
+            : SMTP_smtp_command_cmdNotSet;
+    ctx->req_smtp_command = v;
+    pred_set_enum(rec, SMTP_VAR_smtp_command, (uint16_t)v);
+
+    v = SMTP_reply_class_rcNotSet;
+    pred_set_enum(rec, SMTP_VAR_reply_class, (uint16_t)v);
+
+    v = 1;
+    pred_set_bool(rec, SMTP_VAR_is_request, v != 0);
+
+    v = 0;
+    pred_set_bool(rec, SMTP_VAR_is_response, v != 0);
+
+    v = 0;
+    pred_set_bool(rec, SMTP_VAR_reply_malformed, v != 0);
+
+    v = 0;
+    pred_set_bool(rec, SMTP_VAR_reply_continued, v != 0);
+
+    v = 0;
+    pred_set_int(rec, SMTP_VAR_reply_code, v);
+}
+
+void smtp_build_response_record(smtp_adapter_ctx_t *ctx,
+    const unsigned char *buf, unsigned int len, pred_record_t *rec)
+{
+    int32_t v;
+
+    pred_begin(rec, SMTP_PRED_SPEC_HASH);
+
+    v = ctx->req_smtp_command;
+    pred_set_enum(rec, SMTP_VAR_smtp_command, (uint16_t)v);
+
+    {
+        uint32_t r = 0;
+        bool present = pg_uint(buf, len, 0, 1, &r);
+        if (present) {
+            switch (r) {
+                case 50u: v = SMTP_reply_class_rcPositiveCompletion; break;
+                case 51u: v = SMTP_reply_class_rcPositiveIntermediate; break;
+                case 52u: v = SMTP_reply_class_rcTransientNegative; break;
+                case 53u: v = SMTP_reply_class_rcPermanentNegative; break;
+                default: v = SMTP_reply_class_rcNotSet; break;
+            }
+        } else {
+            v = SMTP_reply_class_rcNotSet;
+        }
+    }
+    pred_set_enum(rec, SMTP_VAR_reply_class, (uint16_t)v);
+
+    v = 0;
+    pred_set_bool(rec, SMTP_VAR_is_request, v != 0);
+
+    v = 1;
+    pred_set_bool(rec, SMTP_VAR_is_response, v != 0);
+
+    {
+        int32_t d = 0;
+        bool present = pg_digits(buf, len, 0, 3, &d);
+        uint32_t r = (uint32_t)d;
+        v = present ? 0 : 1;
+        (void)r;
+    }
+    pred_set_bool(rec, SMTP_VAR_reply_malformed, v != 0);
+
+    {
+        uint32_t r = 0;
+        bool present = pg_uint(buf, len, 3, 1, &r);
+        if (present) {
+            switch (r) {
+                case 45u: v = 1; break;
+                default: v = 0; break;
+            }
+        } else {
+            v = 0;
+        }
+    }
+    pred_set_bool(rec, SMTP_VAR_reply_continued, v != 0);
+
+    {
+        int32_t d = 0;
+        bool present = pg_digits(buf, len, 0, 3, &d);
+        uint32_t r = (uint32_t)d;
+        v = present ? (int32_t)r : 0;
+    }
+    pred_set_int(rec, SMTP_VAR_reply_code, v);
+}
+
+void smtp_build_request_pred_line(smtp_adapter_ctx_t *ctx,
+    const unsigned char *buf, unsigned int len, char *out, size_t out_sz)
+{
+    pred_record_t rec;
+
+    if (!out || out_sz == 0) return;
+    smtp_build_request_record(ctx, buf, len, &rec);
+    pred_record_format(&rec, &smtp_pred_schema, out, out_sz);
+    pred_append_packet_trace(out, out_sz, ++ctx->msg_id, "C2S", buf, len);
+}
+
+void smtp_build_response_pred_line(smtp_adapter_ctx_t *ctx,
+    const unsigned char *buf, unsigned int len, char *out, size_t out_sz)
+{
+    pred_record_t rec;
+
+    if (!out || out_sz == 0) return;
+    smtp_build_response_record(ctx, buf, len, &rec);
+    pred_record_format(&rec, &smtp_pred_schema, out, out_sz);
+    pred_append_packet_trace(out, out_sz, ++ctx->msg_id, "S2C", buf, len);
+}
+
+PREDICATE_ADAPTER_DEFINE_TYPED(smtp, smtp_adapter_ctx_t,
+                               smtp_build_request_pred_line,
+                               smtp_build_response_pred_line,
+                               smtp_build_request_record,
+                               smtp_build_response_record,
+                               PRED_FRAME_FTP_REPLY);
@@ -0,0 +1,35 @@
+// smtp_predicate_adapter.h - generated by ltl_adaptergen from monitor-src/smtp.adapter
+// Do not edit; regenerate when the description or the spec changes.
+#ifndef SMTP_PREDICATE_ADAPTER_H
+#define SMTP_PREDICATE_ADAPTER_H
+
+#include <stddef.h>
+
+#include "predicate_adapter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct smtp_adapter_ctx smtp_adapter_ctx_t;
+
+smtp_adapter_ctx_t *smtp_adapter_create(void);
+void smtp_adapter_reset(smtp_adapter_ctx_t *ctx);
+void smtp_adapter_destroy(smtp_adapter_ctx_t *ctx);
+
+void smtp_build_request_pred_line(smtp_adapter_ctx_t *ctx,
+    const unsigned char *buf, unsigned int len, char *out, size_t out_sz);
+void smtp_build_response_pred_line(smtp_adapter_ctx_t *ctx,
+    const unsigned char *buf, unsigned int len, char *out, size_t out_sz);
+void smtp_build_request_record(smtp_adapter_ctx_t *ctx,
+    const unsigned char *buf, unsigned int len, pred_record_t *rec);
+void smtp_build_response_record(smtp_adapter_ctx_t *ctx,
+    const unsigned char *buf, unsigned int len, pred_record_t *rec);
+
+extern const predicate_adapter_t smtp_predicate_adapter;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SMTP_PREDICATE_ADAPTER_H */
@@ -1,58 +1,52 @@
 // ssh_predicate_adapter.c
 #include "ssh_predicate_adapter.h"
+#include "pred_trace.h"
 
 #include <string.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 
-/* --- Static per-session state --- */
+/* --- Per-session state --- */
 
-static int  g_auth_attempts = 0;
-static bool g_last_auth_method_none = false;
-static bool g_seen_client_newkeys = false;
-static bool g_seen_server_newkeys = false;
-static bool g_session_initialized = false;
+struct ssh_adapter_ctx {
+    int  auth_attempts;
+    bool last_auth_method_none;
+    bool seen_client_newkeys;
+    bool seen_server_newkeys;
 
-static unsigned int g_msg_id = 0;
+    unsigned int msg_id;
+};
 
-static void append_packet_trace(char *out, size_t out_sz,
+static void append_packet_trace(ssh_adapter_ctx_t *ctx,
+                                char *out, size_t out_sz,
                                 const unsigned char *buf,
                                 unsigned int len,
                                 const char *direction)
 {
-    g_msg_id++;
-    
-    size_t current_len = strlen(out);
-    size_t remaining = out_sz - current_len;
-    
-    if (remaining < 50) return;
-    
-    int written = snprintf(out + current_len, remaining,
-                          " msg_id=%u dir=%s trace=",
-                          g_msg_id, direction);
-    
-    if (written < 0 || (size_t)written >= remaining) return;
-    
-    current_len += written;
-    remaining -= written;
-    
-    unsigned int trace_len = len;
-    if (trace_len > 256) trace_len = 256;
-    
-    for (unsigned int i = 0; i < trace_len && remaining > 2; i++) {
-        snprintf(out + current_len, remaining, "%02x", buf[i]);
-        current_len += 2;
-        remaining -= 2;
-    }
+    ctx->msg_id++;
+    pred_append_packet_trace(out, out_sz, ctx->msg_id, direction, buf, len);
+}
+
+ssh_adapter_ctx_t *ssh_adapter_create(void)
+{
+    ssh_adapter_ctx_t *ctx = calloc(1, sizeof(*ctx));
+    if (ctx) ssh_adapter_reset(ctx);
+    return ctx;
+}
+
+/* msg_id keeps counting across sessions so trace references stay unique. */
+void ssh_adapter_reset(ssh_adapter_ctx_t *ctx)
+{
+    ctx->auth_attempts = 0;
+    ctx->last_auth_method_none = false;
+    ctx->seen_client_newkeys = false;
+    ctx->seen_server_newkeys = false;
 }
 
-void ssh_predicate_reset_session(void)
+void ssh_adapter_destroy(ssh_adapter_ctx_t *ctx)
 {
-    g_auth_attempts = 0;
-    g_last_auth_method_none = false;
-    g_seen_client_newkeys = false;
-    g_seen_server_newkeys = false;
-    g_session_initialized = true;
+    free(ctx);
 }
 
 /* --- Helpers --- */
@@ -148,9 +142,9 @@ static int ssh_parse_channel_data_len(const unsigned char *buf,
 
 /* Decide whether payload should be considered "encrypted" for this step.
    For now we treat messages after both NEWKEYS as encrypted. */
-static bool ssh_encrypted_now(void)
+static bool ssh_encrypted_now(const ssh_adapter_ctx_t *ctx)
 {
-    return (g_seen_client_newkeys && g_seen_server_newkeys);
+    return (ctx->seen_client_newkeys && ctx->seen_server_newkeys);
 }
 
 /* --- Mapping message type → request/response enum strings --- */
@@ -202,15 +196,12 @@ static const char *ssh_response_enum_for_type(uint8_t t)
 
 /* --- Public builders --- */
 
-void ssh_build_request_pred_line(const unsigned char *buf,
+void ssh_build_request_pred_line(ssh_adapter_ctx_t *ctx,
+                                 const unsigned char *buf,
                                  unsigned int len,
                                  char *out,
                                  size_t out_sz)
 {
-    if (!g_session_initialized) {
-        ssh_predicate_reset_session();
-    }
-
     /* In practice banners are server->client, but be robust:
        if we see a banner here, treat it as a non-packet event
        with unknown padding. */
@@ -221,8 +212,8 @@ void ssh_build_request_pred_line(const unsigned char *buf,
                  "pkt_len=%d pad_len=-1 chan_data_len=0 "
                  "auth_attempts=%d is_auth_method_none=%s",
                  (int)len,
-                 g_auth_attempts,
-                 g_last_auth_method_none ? "true" : "false");
+                 ctx->auth_attempts,
+                 ctx->last_auth_method_none ? "true" : "false");
         return;
     }
 
@@ -230,7 +221,7 @@ void ssh_build_request_pred_line(const unsigned char *buf,
     const char *req_enum = ssh_request_enum_for_type(t);
     const char *resp_enum = "responseNotSet";
 
-    bool encrypted = ssh_encrypted_now();
+    bool encrypted = ssh_encrypted_now(ctx);
     bool mac_ok    = true;   // we don't verify MACs here (safe default)
     bool hostkey_present = false;
     bool sig_ok   = false;
@@ -240,18 +231,18 @@ void ssh_build_request_pred_line(const unsigned char *buf,
 
     /* Track NEWKEYS state */
     if (t == 21) {
-        g_seen_client_newkeys = true;
-        encrypted = ssh_encrypted_now();
+        ctx->seen_client_newkeys = true;
+        encrypted = ssh_encrypted_now(ctx);
     }
 
     /* Track auth attempts + "none" method */
     if (t == 50) { // USERAUTH_REQUEST
-        g_auth_attempts++;
+        ctx->auth_attempts++;
         bool is_none = false;
         if (ssh_parse_userauth_method(buf, len, &is_none)) {
-            g_last_auth_method_none = is_none;
+            ctx->last_auth_method_none = is_none;
         } else {
-            g_last_auth_method_none = false;
+            ctx->last_auth_method_none = false;
         }
     }
 
@@ -274,20 +265,17 @@ void ssh_build_request_pred_line(const unsigned char *buf,
              pkt_len,
              pad_len,
              chan_data_len,
-             g_auth_attempts,
-             g_last_auth_method_none ? "true" : "false");
-    append_packet_trace(out, out_sz, buf, len, "C2S");
+             ctx->auth_attempts,
+             ctx->last_auth_method_none ? "true" : "false");
+    append_packet_trace(ctx, out, out_sz, buf, len, "C2S");
 }
 
-void ssh_build_response_pred_line(const unsigned char *buf,
+void ssh_build_response_pred_line(ssh_adapter_ctx_t *ctx,
+                                  const unsigned char *buf,
                                   unsigned int len,
                                   char *out,
                                   size_t out_sz)
 {
-    if (!g_session_initialized) {
-        ssh_predicate_reset_session();
-    }
-
     /* First event for a normal connection will be the server banner. */
     if (is_ssh_banner(buf, len)) {
         snprintf(out, out_sz,
@@ -296,8 +284,8 @@ void ssh_build_response_pred_line(const unsigned char *buf,
                  "pkt_len=%d pad_len=-1 chan_data_len=0 "
                  "auth_attempts=%d is_auth_method_none=%s",
                  (int)len,
-                 g_auth_attempts,
-                 g_last_auth_method_none ? "true" : "false");
+                 ctx->auth_attempts,
+                 ctx->last_auth_method_none ? "true" : "false");
         return;
     }
 
@@ -305,7 +293,7 @@ void ssh_build_response_pred_line(const unsigned char *buf,
     const char *req_enum = "requestNotSet";
     const char *resp_enum = ssh_response_enum_for_type(t);
 
-    bool encrypted = ssh_encrypted_now();
+    bool encrypted = ssh_encrypted_now(ctx);
     bool mac_ok    = true;   // we don't verify MACs here
     bool hostkey_present = false;
     bool sig_ok   = false;
@@ -315,8 +303,8 @@ void ssh_build_response_pred_line(const unsigned char *buf,
 
     /* Track NEWKEYS from server */
     if (t == 21) {
-        g_seen_server_newkeys = true;
-        encrypted = ssh_encrypted_now();
+        ctx->seen_server_newkeys = true;
+        encrypted = ssh_encrypted_now(ctx);
     }
 
     /* KEX reply: mark hostkey/signature present.
@@ -346,7 +334,12 @@ void ssh_build_response_pred_line(const unsigned char *buf,
              pkt_len,
              pad_len,
              chan_data_len,
-             g_auth_attempts,
-             g_last_auth_method_none ? "true" : "false");
-    append_packet_trace(out, out_sz, buf, len, "S2C");
+             ctx->auth_attempts,
+             ctx->last_auth_method_none ? "true" : "false");
+    append_packet_trace(ctx, out, out_sz, buf, len, "S2C");
 }
+
+PREDICATE_ADAPTER_DEFINE(ssh, ssh_adapter_ctx_t,
+                         ssh_build_request_pred_line,
+                         ssh_build_response_pred_line,
+                         PRED_FRAME_NONE);
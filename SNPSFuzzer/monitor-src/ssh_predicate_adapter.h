@@ -6,6 +6,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "predicate_adapter.h"
+
 /*
  * SSH predicate adapter for request/response → "k=v ..." lines.
  *
@@ -36,21 +38,30 @@
 extern "C" {
 #endif
 
-/* Reset per-session adapter state (NEWKEYS seen, auth_attempts, etc.). */
-void ssh_predicate_reset_session(void);
+/* Per-session decoding state (NEWKEYS seen, auth_attempts, msg_id, etc.).
+ * One context per concurrently decoded session. */
+typedef struct ssh_adapter_ctx ssh_adapter_ctx_t;
+
+ssh_adapter_ctx_t *ssh_adapter_create(void);
+void ssh_adapter_reset(ssh_adapter_ctx_t *ctx);
+void ssh_adapter_destroy(ssh_adapter_ctx_t *ctx);
 
 /* Build predicate line for a client→server packet ("request=..."). */
-void ssh_build_request_pred_line(const unsigned char *buf,
+void ssh_build_request_pred_line(ssh_adapter_ctx_t *ctx,
+                                 const unsigned char *buf,
                                  unsigned int len,
                                  char *out,
                                  size_t out_sz);
 
 /* Build predicate line for a server→client packet ("response=..."). */
-void ssh_build_response_pred_line(const unsigned char *buf,
+void ssh_build_response_pred_line(ssh_adapter_ctx_t *ctx,
+                                  const unsigned char *buf,
                                   unsigned int len,
                                   char *out,
                                   size_t out_sz);
 
+extern const predicate_adapter_t ssh_predicate_adapter;
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,647 @@
+/*
+   SNPSFuzzer - native helpers for the snapshot path
+   -------------------------------------------------
+
+   See snapshot_sys.h.
+
+*/
+
+#define _GNU_SOURCE
+
+#include "snapshot_sys.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+
+#include <linux/netlink.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+
+/* ---------- /proc process table ---------- */
+
+struct snap_dirent64 {
+  u64 d_ino;
+  s64 d_off;
+  u16 d_reclen;
+  u8  d_type;
+  char d_name[];
+};
+
+/* read() a small /proc file into buf (NUL-terminated), -1 on error. */
+
+static s32 read_small(const char* path, char* buf, u32 size) {
+
+  s32 fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return -1;
+
+  ssize_t n = read(fd, buf, size - 1);
+  close(fd);
+  if (n < 0) return -1;
+
+  buf[n] = 0;
+  return n;
+
+}
+
+/* Decimal PID from a /proc entry name, 0 if it is not one. */
+
+static pid_t parse_pid(const char* s) {
+
+  pid_t pid = 0;
+
+  if (!*s) return 0;
+  for (; *s; s++) {
+    if (*s < '0' || *s > '9') return 0;
+    pid = pid * 10 + (*s - '0');
+  }
+  return pid;
+
+}
+
+/* Async-signal-safe "/proc/<pid>/<leaf>". */
+
+static void proc_path(char* out, pid_t pid, const char* leaf) {
+
+  char digits[16];
+  u32 n = 0, i = 0;
+
+  memcpy(out, "/proc/", 6);
+  out += 6;
+
+  do { digits[n++] = '0' + pid % 10; pid /= 10; } while (pid);
+  while (n) out[i++] = digits[--n];
+
+  out[i++] = '/';
+  strcpy(out + i, leaf);
+
+}
+
+static u8 proc_matches(const snap_proc_filter_t* f, pid_t pid) {
+
+  char path[64], stat[512], cmd[4096];
+  s32 n;
+
+  proc_path(path, pid, "stat");
+  if ((n = read_small(path, stat, sizeof(stat))) <= 0) return 0;
+
+  /* "pid (comm) S ppid ...": comm may itself contain ')' */
+
+  char* open_p  = strchr(stat, '(');
+  char* close_p = strrchr(stat, ')');
+  if (!open_p || !close_p || close_p[1] != ' ') return 0;
+
+  char state = close_p[2];
+  pid_t ppid = (pid_t)atoi(close_p + 4);
+
+  if ((f->pid_a || f->pid_b) &&
+      !((f->pid_a && (pid == f->pid_a || ppid == f->pid_a)) ||
+        (f->pid_b && (pid == f->pid_b || ppid == f->pid_b))))
+    return 0;
+
+  if (f->zombies && state != 'Z') return 0;
+
+  if (f->comm) {
+    *close_p = 0;
+    if (strcmp(open_p + 1, f->comm)) return 0;
+  }
+
+  if (f->cmdline) {
+
+    proc_path(path, pid, "cmdline");
+    n = read_small(path, cmd, sizeof(cmd));
+
+    if (n <= 0) {
+
+      /* Kernel threads and zombies have no command line; ps shows the
+         process name instead. */
+
+      *close_p = 0;
+      return strstr(open_p + 1, f->cmdline) != NULL;
+
+    }
+
+    for (s32 i = 0; i < n; i++) if (!cmd[i]) cmd[i] = ' ';
+    if (!strstr(cmd, f->cmdline)) return 0;
+
+  }
+
+  return 1;
+
+}
+
+s32 snap_proc_scan(const snap_proc_filter_t* f, pid_t* pids, u32 max_pids) {
+
+  char buf[4096];
+  s32 fd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  s32 found = 0;
+
+  if (fd < 0) return -1;
+
+  for (;;) {
+
+    long n = syscall(SYS_getdents64, fd, buf, sizeof(buf));
+    if (n <= 0) break;
+
+    for (long off = 0; off < n; ) {
+
+      struct snap_dirent64* d = (struct snap_dirent64*)(buf + off);
+      pid_t pid = parse_pid(d->d_name);
+      off += d->d_reclen;
+
+      if (!pid || pid == f->skip || !proc_matches(f, pid)) continue;
+
+      if (pids && (u32)found < max_pids) pids[found] = pid;
+      found++;
+
+    }
+
+  }
+
+  close(fd);
+  return found;
+
+}
+
+/* ---------- pidfd ---------- */
+
+#ifndef SYS_pidfd_open
+#  define SYS_pidfd_open 434
+#endif
+
+#ifndef SYS_pidfd_send_signal
+#  define SYS_pidfd_send_signal 424
+#endif
+
+s32 snap_pidfd_open(pid_t pid) {
+
+  return (s32)syscall(SYS_pidfd_open, pid, 0);
+
+}
+
+s32 snap_pidfd_signal(s32 pidfd, int sig) {
+
+  return (s32)syscall(SYS_pidfd_send_signal, pidfd, sig, NULL, 0);
+
+}
+
+/* ---------- directory cleanup ---------- */
+
+static s32 clear_dirfd(s32 dfd) {
+
+  DIR* d = fdopendir(dfd);
+  struct dirent* e;
+  s32 ret = 0;
+
+  if (!d) {
+    close(dfd);
+    return -1;
+  }
+
+  while (!ret && (e = readdir(d))) {
+
+    if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, "..")) continue;
+
+    if (!unlinkat(dfd, e->d_name, 0)) continue;
+
+    if (errno != EISDIR && errno != EPERM) {
+      ret = -1;
+      break;
+    }
+
+    /* A subdirectory: empty it, then remove it. */
+
+    s32 sub = openat(dfd, e->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (sub < 0 || clear_dirfd(sub) || unlinkat(dfd, e->d_name, AT_REMOVEDIR))
+      ret = -1;
+
+  }
+
+  closedir(d);
+  return ret;
+
+}
+
+s32 snap_clear_dir(const char* path) {
+
+  s32 dfd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dfd < 0) return -1;
+  return clear_dirfd(dfd);
+
+}
+
+/* ---------- unix sockets of a process ---------- */
+
+s32 snap_unix_socket_inodes(pid_t pid, u32* inodes, u32 max) {
+
+  char path[64], link[64];
+  s32 count = 0;
+
+  proc_path(path, pid, "fd");
+
+  DIR* d = opendir(path);
+  if (!d) return -1;
+
+  s32 dfd = dirfd(d);
+
+  /* Socket inodes of the process... */
+
+  u32 sock[256];
+  u32 n_sock = 0;
+  struct dirent* e;
+
+  while ((e = readdir(d)) && n_sock < 256) {
+
+    ssize_t n = readlinkat(dfd, e->d_name, link, sizeof(link) - 1);
+    if (n <= 0) continue;
+    link[n] = 0;
+
+    if (!strncmp(link, "socket:[", 8)) sock[n_sock++] = (u32)strtoul(link + 8, NULL, 10);
+
+  }
+
+  closedir(d);
+  if (!n_sock) return 0;
+
+  /* ...that /proc/net/unix lists: "Num RefCount Protocol Flags Type St
+     Inode Path", inode in the seventh column. */
+
+  FILE* f = fopen("/proc/net/unix", "r");
+  if (!f) return -1;
+
+  char line[512];
+  if (!fgets(line, sizeof(line), f)) {
+    fclose(f);
+    return 0;
+  }
+
+  while (fgets(line, sizeof(line), f)) {
+
+    unsigned long ino;
+    if (sscanf(line, "%*s %*s %*s %*s %*s %*s %lu", &ino) != 1) continue;
+
+    for (u32 i = 0; i < n_sock; i++) {
+      if (sock[i] != ino) continue;
+      if ((u32)count < max) inodes[count] = (u32)ino;
+      count++;
+      break;
+    }
+
+  }
+
+  fclose(f);
+  return count < (s32)max ? count : (s32)max;
+
+}
+
+/* ---------- nftables port block ---------- */
+
+#define NFT_BUF_SIZE 4096
+
+struct nl_buf {
+  u8  data[NFT_BUF_SIZE];
+  u32 len;
+};
+
+static s32 nft_fd = -1;
+static u32 nft_seq;
+static char nft_table[32];
+
+/* Prebuilt batches: the four drop rules, and flushing both chains. */
+
+static struct nl_buf nft_block_msg, nft_unblock_msg;
+
+static struct nlmsghdr* nl_put_msg(struct nl_buf* b, u16 type, u16 flags,
+                                   u8 family, u16 res_id) {
+
+  struct nlmsghdr* nlh = (struct nlmsghdr*)(b->data + b->len);
+  struct nfgenmsg* nfg;
+
+  memset(nlh, 0, NLMSG_HDRLEN + sizeof(*nfg));
+  nlh->nlmsg_type  = type;
+  nlh->nlmsg_flags = NLM_F_REQUEST | flags;
+
+  nfg = NLMSG_DATA(nlh);
+  nfg->nfgen_family = family;
+  nfg->version      = NFNETLINK_V0;
+  nfg->res_id       = htons(res_id);
+
+  b->len += NLMSG_HDRLEN + NLMSG_ALIGN(sizeof(*nfg));
+  nlh->nlmsg_len = NLMSG_HDRLEN + sizeof(*nfg);
+  return nlh;
+
+}
+
+static void nl_msg_end(struct nl_buf* b, struct nlmsghdr* nlh) {
+
+  nlh->nlmsg_len = (b->data + b->len) - (u8*)nlh;
+
+}
+
+static void nl_put_attr(struct nl_buf* b, u16 type, const void* data, u16 len) {
+
+  struct nlattr* a = (struct nlattr*)(b->data + b->len);
+
+  a->nla_type = type;
+  a->nla_len  = NLA_HDRLEN + len;
+  memcpy((u8*)a + NLA_HDRLEN, data, len);
+  memset((u8*)a + NLA_HDRLEN + len, 0, NLA_ALIGN(len) - len);
+  b->len += NLA_HDRLEN + NLA_ALIGN(len);
+
+}
+
+static void nl_put_u32(struct nl_buf* b, u16 type, u32 host_value) {
+
+  u32 v = htonl(host_value);
+  nl_put_attr(b, type, &v, sizeof(v));
+
+}
+
+static void nl_put_str(struct nl_buf* b, u16 type, const char* s) {
+
+  nl_put_attr(b, type, s, strlen(s) + 1);
+
+}
+
+static struct nlattr* nl_nest(struct nl_buf* b, u16 type) {
+
+  struct nlattr* a = (struct nlattr*)(b->data + b->len);
+
+  a->nla_type = type | NLA_F_NESTED;
+  b->len += NLA_HDRLEN;
+  return a;
+
+}
+
+static void nl_nest_end(struct nl_buf* b, struct nlattr* a) {
+
+  a->nla_len = (b->data + b->len) - (u8*)a;
+
+}
+
+static void nft_batch(struct nl_buf* b, u16 type) {
+
+  struct nlmsghdr* nlh = nl_put_msg(b, type, 0, AF_UNSPEC, NFNL_SUBSYS_NFTABLES);
+  nl_msg_end(b, nlh);
+
+}
+
+static struct nlmsghdr* nft_msg(struct nl_buf* b, u16 msg, u16 flags) {
+
+  return nl_put_msg(b, (NFNL_SUBSYS_NFTABLES << 8) | msg, NLM_F_ACK | flags,
+                    NFPROTO_INET, 0);
+
+}
+
+static void nft_expr(struct nl_buf* b, const char* name, struct nlattr** data) {
+
+  nl_put_str(b, NFTA_EXPR_NAME, name);
+  *data = nl_nest(b, NFTA_EXPR_DATA);
+
+}
+
+/* <chain>: meta l4proto tcp, th <offset> == port, drop */
+
+static void nft_put_rule(struct nl_buf* b, const char* chain, u32 offset, u16 port) {
+
+  struct nlmsghdr* nlh = nft_msg(b, NFT_MSG_NEWRULE, NLM_F_CREATE | NLM_F_APPEND);
+  struct nlattr *exprs, *elem, *data, *inner, *verdict;
+  u8  proto = IPPROTO_TCP;
+  u16 be_port = htons(port);
+
+  nl_put_str(b, NFTA_RULE_TABLE, nft_table);
+  nl_put_str(b, NFTA_RULE_CHAIN, chain);
+  exprs = nl_nest(b, NFTA_RULE_EXPRESSIONS);
+
+  elem = nl_nest(b, NFTA_LIST_ELEM);
+  nft_expr(b, "meta", &data);
+  nl_put_u32(b, NFTA_META_KEY, NFT_META_L4PROTO);
+  nl_put_u32(b, NFTA_META_DREG, NFT_REG_1);
+  nl_nest_end(b, data);
+  nl_nest_end(b, elem);
+
+  elem = nl_nest(b, NFTA_LIST_ELEM);
+  nft_expr(b, "cmp", &data);
+  nl_put_u32(b, NFTA_CMP_SREG, NFT_REG_1);
+  nl_put_u32(b, NFTA_CMP_OP, NFT_CMP_EQ);
+  inner = nl_nest(b, NFTA_CMP_DATA);
+  nl_put_attr(b, NFTA_DATA_VALUE, &proto, sizeof(proto));
+  nl_nest_end(b, inner);
+  nl_nest_end(b, data);
+  nl_nest_end(b, elem);
+
+  elem = nl_nest(b, NFTA_LIST_ELEM);
+  nft_expr(b, "payload", &data);
+  nl_put_u32(b, NFTA_PAYLOAD_DREG, NFT_REG_1);
+  nl_put_u32(b, NFTA_PAYLOAD_BASE, NFT_PAYLOAD_TRANSPORT_HEADER);
+  nl_put_u32(b, NFTA_PAYLOAD_OFFSET, offset);
+  nl_put_u32(b, NFTA_PAYLOAD_LEN, sizeof(be_port));
+  nl_nest_end(b, data);
+  nl_nest_end(b, elem);
+
+  elem = nl_nest(b, NFTA_LIST_ELEM);
+  nft_expr(b, "cmp", &data);
+  nl_put_u32(b, NFTA_CMP_SREG, NFT_REG_1);
+  nl_put_u32(b, NFTA_CMP_OP, NFT_CMP_EQ);
+  inner = nl_nest(b, NFTA_CMP_DATA);
+  nl_put_attr(b, NFTA_DATA_VALUE, &be_port, sizeof(be_port));
+  nl_nest_end(b, inner);
+  nl_nest_end(b, data);
+  nl_nest_end(b, elem);
+
+  elem = nl_nest(b, NFTA_LIST_ELEM);
+  nft_expr(b, "immediate", &data);
+  nl_put_u32(b, NFTA_IMMEDIATE_DREG, NFT_REG_VERDICT);
+  inner = nl_nest(b, NFTA_IMMEDIATE_DATA);
+  verdict = nl_nest(b, NFTA_DATA_VERDICT);
+  nl_put_u32(b, NFTA_VERDICT_CODE, NF_DROP);
+  nl_nest_end(b, verdict);
+  nl_nest_end(b, inner);
+  nl_nest_end(b, data);
+  nl_nest_end(b, elem);
+
+  nl_nest_end(b, exprs);
+  nl_msg_end(b, nlh);
+
+}
+
+static void nft_put_chain(struct nl_buf* b, const char* chain, u32 hook) {
+
+  struct nlmsghdr* nlh = nft_msg(b, NFT_MSG_NEWCHAIN, NLM_F_CREATE);
+  struct nlattr* h;
+
+  nl_put_str(b, NFTA_CHAIN_TABLE, nft_table);
+  nl_put_str(b, NFTA_CHAIN_NAME, chain);
+  h = nl_nest(b, NFTA_CHAIN_HOOK);
+  nl_put_u32(b, NFTA_HOOK_HOOKNUM, hook);
+  nl_put_u32(b, NFTA_HOOK_PRIORITY, 0);
+  nl_nest_end(b, h);
+  nl_put_str(b, NFTA_CHAIN_TYPE, "filter");
+  nl_msg_end(b, nlh);
+
+}
+
+static void nft_put_table(struct nl_buf* b, u16 msg) {
+
+  struct nlmsghdr* nlh = nft_msg(b, msg, msg == NFT_MSG_NEWTABLE ? NLM_F_CREATE : 0);
+  nl_put_str(b, NFTA_TABLE_NAME, nft_table);
+  nl_msg_end(b, nlh);
+
+}
+
+/* Delete every rule of a chain (DELRULE without a handle). */
+
+static void nft_put_flush(struct nl_buf* b, const char* chain) {
+
+  struct nlmsghdr* nlh = nft_msg(b, NFT_MSG_DELRULE, 0);
+  nl_put_str(b, NFTA_RULE_TABLE, nft_table);
+  nl_put_str(b, NFTA_RULE_CHAIN, chain);
+  nl_msg_end(b, nlh);
+
+}
+
+/* Send one batch and wait for the ack of every message in it. */
+
+static s32 nft_send(struct nl_buf* b) {
+
+  struct sockaddr_nl kernel = { .nl_family = AF_NETLINK };
+  u32 first = nft_seq, acks = 0;
+  u8  reply[NFT_BUF_SIZE];
+
+  /* Fresh sequence numbers; only messages asking for an ack are counted. */
+
+  for (u32 off = 0; off < b->len; ) {
+    struct nlmsghdr* nlh = (struct nlmsghdr*)(b->data + off);
+    nlh->nlmsg_seq = nft_seq++;
+    if (nlh->nlmsg_flags & NLM_F_ACK) acks++;
+    off += NLMSG_ALIGN(nlh->nlmsg_len);
+  }
+
+  if (sendto(nft_fd, b->data, b->len, 0, (struct sockaddr*)&kernel,
+             sizeof(kernel)) != (ssize_t)b->len)
+    return -1;
+
+  while (acks) {
+
+    ssize_t n = recv(nft_fd, reply, sizeof(reply), 0);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return -1;
+    }
+
+    for (struct nlmsghdr* nlh = (struct nlmsghdr*)reply; NLMSG_OK(nlh, n);
+         nlh = NLMSG_NEXT(nlh, n)) {
+
+      if (nlh->nlmsg_type != NLMSG_ERROR || nlh->nlmsg_seq < first) continue;
+
+      struct nlmsgerr* err = NLMSG_DATA(nlh);
+      if (err->error) {
+
+        /* The kernel aborted the whole batch; drop the remaining acks. */
+
+        errno = -err->error;
+        while (recv(nft_fd, reply, sizeof(reply), MSG_DONTWAIT) > 0);
+        return -1;
+
+      }
+      if (acks) acks--;
+
+    }
+
+  }
+
+  return 0;
+
+}
+
+s32 snap_nft_init(u16 port) {
+
+  struct nl_buf setup;
+  struct timeval tv = { 1, 0 };
+
+  if (nft_fd >= 0) close(nft_fd);
+
+  nft_fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_NETFILTER);
+  if (nft_fd < 0) return -1;
+  setsockopt(nft_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+  snprintf(nft_table, sizeof(nft_table), "snpsfuzzer_%u", port);
+
+  /* add table; delete table (drops leftovers of a crashed run); add table
+     with both chains - one transaction. */
+
+  setup.len = 0;
+  nft_batch(&setup, NFNL_MSG_BATCH_BEGIN);
+  nft_put_table(&setup, NFT_MSG_NEWTABLE);
+  nft_put_table(&setup, NFT_MSG_DELTABLE);
+  nft_put_table(&setup, NFT_MSG_NEWTABLE);
+  nft_put_chain(&setup, "input", NF_INET_LOCAL_IN);
+  nft_put_chain(&setup, "output", NF_INET_LOCAL_OUT);
+  nft_batch(&setup, NFNL_MSG_BATCH_END);
+
+  if (nft_send(&setup)) {
+    close(nft_fd);
+    nft_fd = -1;
+    return -1;
+  }
+
+  /* Same four rules as the iptables commands: sport and dport, in and out. */
+
+  nft_block_msg.len = 0;
+  nft_batch(&nft_block_msg, NFNL_MSG_BATCH_BEGIN);
+  nft_put_rule(&nft_block_msg, "output", 0, port);
+  nft_put_rule(&nft_block_msg, "input", 0, port);
+  nft_put_rule(&nft_block_msg, "output", 2, port);
+  nft_put_rule(&nft_block_msg, "input", 2, port);
+  nft_batch(&nft_block_msg, NFNL_MSG_BATCH_END);
+
+  nft_unblock_msg.len = 0;
+  nft_batch(&nft_unblock_msg, NFNL_MSG_BATCH_BEGIN);
+  nft_put_flush(&nft_unblock_msg, "output");
+  nft_put_flush(&nft_unblock_msg, "input");
+  nft_batch(&nft_unblock_msg, NFNL_MSG_BATCH_END);
+
+  return 0;
+
+}
+
+s32 snap_nft_block(void) {
+
+  return nft_fd < 0 ? -1 : nft_send(&nft_block_msg);
+
+}
+
+s32 snap_nft_unblock(void) {
+
+  return nft_fd < 0 ? -1 : nft_send(&nft_unblock_msg);
+
+}
+
+void snap_nft_fini(void) {
+
+  struct nl_buf b;
+
+  if (nft_fd < 0) return;
+
+  b.len = 0;
+  nft_batch(&b, NFNL_MSG_BATCH_BEGIN);
+  nft_put_table(&b, NFT_MSG_DELTABLE);
+  nft_batch(&b, NFNL_MSG_BATCH_END);
+  nft_send(&b);
+
+  close(nft_fd);
+  nft_fd = -1;
+
+}
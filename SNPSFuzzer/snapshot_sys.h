@@ -0,0 +1,72 @@
+/*
+   SNPSFuzzer - native helpers for the snapshot path
+   -------------------------------------------------
+
+   Replacements for the shell pipelines the CRIU dump / restore path used to
+   fork on every snapshot operation (ps | grep, netstat | awk, rm -rf,
+   iptables):
+
+     - process table queries straight from /proc. The scanner does no
+       allocation and no stdio, so it is also usable from a signal handler;
+     - pidfd-based signalling of a tracked child, immune to PID reuse;
+     - recursive directory cleanup with unlinkat();
+     - the unix socket inodes a process holds, from /proc/<pid>/fd;
+     - the TCP port block around libsoccr pause/restore as nftables rules
+       sent over netlink. The table, chains and rule messages are built
+       once per port, so blocking or unblocking is a single batch on an
+       already-open socket.
+
+*/
+
+#ifndef _HAVE_SNAPSHOT_SYS_H
+#define _HAVE_SNAPSHOT_SYS_H
+
+#include <sys/types.h>
+
+#include "types.h"
+
+/* Which processes snap_proc_scan() matches. A process matches when its PID
+   or parent PID is one of pid_a / pid_b (0 = unused; both 0 = any process),
+   and every other set field agrees. */
+
+typedef struct snap_proc_filter {
+  pid_t pid_a, pid_b;
+  pid_t skip;             /* never matches this PID (e.g. ourselves)      */
+  const char* cmdline;    /* substring of the command line, NULL = any    */
+  const char* comm;       /* exact process name, as pidof, NULL = any     */
+  u8 zombies;             /* only processes in state Z                    */
+} snap_proc_filter_t;
+
+/* Number of matching processes; the first max_pids PIDs go to pids (which
+   may be NULL). -1 if /proc cannot be read. Async-signal-safe. */
+
+s32 snap_proc_scan(const snap_proc_filter_t* f, pid_t* pids, u32 max_pids);
+
+/* pidfd of pid, -1 if the kernel has no pidfd_open() (pre-5.3). */
+
+s32 snap_pidfd_open(pid_t pid);
+
+/* Signal through a pidfd (sig 0 probes liveness). 0 on success, -1 with
+   errno set; ESRCH once the process has exited. */
+
+s32 snap_pidfd_signal(s32 pidfd, int sig);
+
+/* Remove everything inside a directory, leaving the directory itself.
+   0 on success, -1 on the first failure (errno set). */
+
+s32 snap_clear_dir(const char* path);
+
+/* Inodes of the unix sockets pid has open, up to max. Count, -1 on error. */
+
+s32 snap_unix_socket_inodes(pid_t pid, u32* inodes, u32 max);
+
+/* Port block (TCP, both directions, sport and dport), see above. init()
+   returns -1 if nf_tables is not available, in which case callers fall
+   back to iptables. */
+
+s32  snap_nft_init(u16 port);
+s32  snap_nft_block(void);
+s32  snap_nft_unblock(void);
+void snap_nft_fini(void);
+
+#endif /* ! _HAVE_SNAPSHOT_SYS_H */